@@ -1,6 +1,8 @@
 #include "BackgroundExtractionWidget.h"
 #include "ImageDisplayWidget.h"
 #include "ImageReader.h"
+#include "FITSImageWriter.h"
+#include "SimplifiedXISFWriter.h"
 
 #include <QHeaderView>
 #include <QFileDialog>
@@ -11,6 +13,19 @@
 #include <QApplication>
 #include <QDebug>
 #include <QSplitter>
+#include <QFileInfo>
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+namespace {
+const char* const kSaveImageFilters =
+    "XISF Files (*.xisf);;"
+    "FITS 32-bit float (*.fits);;"
+    "FITS 32-bit integer (*.fits);;"
+    "FITS 16-bit integer, dithered (*.fits);;"
+    "All Files (*)";
+}
 
 BackgroundExtractionWidget::BackgroundExtractionWidget(QWidget* parent)
     : QWidget(parent)
@@ -342,9 +357,24 @@ void BackgroundExtractionWidget::setupAdvancedTab()
     
     m_sampleCountLabel = new QLabel("Samples: 0");
     
+    m_interactiveFitCheck = new QCheckBox("Live refit (preview)");
+    m_interactiveFitCheck->setToolTip("Refit the polynomial model on every click and show it on a reduced preview; "
+                                      "clicking an existing sample removes it");
+    m_interactiveFitCheck->setEnabled(false);
+    connect(m_interactiveFitCheck, &QCheckBox::toggled,
+            this, &BackgroundExtractionWidget::onInteractiveFitToggled);
+    
+    m_commitFitButton = new QPushButton("Commit Full-Resolution Model");
+    m_commitFitButton->setToolTip("Render the live model at full resolution and apply it to the image");
+    m_commitFitButton->setEnabled(false);
+    connect(m_commitFitButton, &QPushButton::clicked,
+            this, &BackgroundExtractionWidget::onCommitFitClicked);
+    
     manualLayout->addWidget(m_manualSamplingCheck, 0, 0, 1, 2);
     manualLayout->addWidget(m_clearSamplesButton, 1, 0);
     manualLayout->addWidget(m_sampleCountLabel, 1, 1);
+    manualLayout->addWidget(m_interactiveFitCheck, 2, 0);
+    manualLayout->addWidget(m_commitFitButton, 2, 1);
     
     layout->addWidget(m_manualGroup);
     
@@ -449,6 +479,7 @@ void BackgroundExtractionWidget::setImageData(const ImageData& imageData)
     m_hasResult = false;
     m_extractor->clearResult();
     updateResults();
+    resetIncrementalFit();
     
     m_statusLabel->setText(QString("Image loaded: %1×%2×%3")
                           .arg(imageData.width)
@@ -463,6 +494,7 @@ void BackgroundExtractionWidget::clearImage()
     m_hasResult = false;
     m_extractor->clearResult();
     updateResults();
+    resetIncrementalFit();
     m_statusLabel->setText("No image loaded");
 }
 
@@ -684,6 +716,14 @@ void BackgroundExtractionWidget::onPreviewReady()
 void BackgroundExtractionWidget::onModelChanged()
 {
     updateParametersFromUI();
+    
+    // The live fit refactors for the new order without rerunning extraction
+    if (m_interactiveFitCheck->isChecked() && m_incrementalFit.isValid()) {
+        m_incrementalFit.setOrder(incrementalFitOrder());
+        updateIncrementalPreview(QString("Model order %1").arg(m_incrementalFit.order()));
+        return;
+    }
+    
     m_updateTimer->start(); // Trigger preview update
 }
 
@@ -815,6 +855,8 @@ void BackgroundExtractionWidget::onManualSamplingToggled(bool enabled)
 {
     m_manualSamplingMode = enabled;
     m_clearSamplesButton->setEnabled(enabled);
+    m_interactiveFitCheck->setEnabled(enabled);
+    m_commitFitButton->setEnabled(enabled && m_interactiveFitCheck->isChecked());
     
     if (enabled) {
         m_sampleGenCombo->setCurrentIndex(m_sampleGenCombo->findData(static_cast<int>(SampleGeneration::Manual)));
@@ -828,20 +870,147 @@ void BackgroundExtractionWidget::onManualSamplingToggled(bool enabled)
 void BackgroundExtractionWidget::onClearSamplesClicked()
 {
     m_extractor->clearManualSamples();
+    m_incrementalFit.clear();
     updateSampleDisplay();
 }
 
+void BackgroundExtractionWidget::onInteractiveFitToggled(bool enabled)
+{
+    m_commitFitButton->setEnabled(enabled && m_manualSamplingMode);
+    if (!enabled) return;
+    
+    // Seed the fit with the samples placed so far
+    resetIncrementalFit();
+    for (const QPoint& sample : m_extractor->getManualSamples()) {
+        m_incrementalFit.addSample(sample);
+    }
+    updateIncrementalPreview("Live refit enabled");
+}
+
+void BackgroundExtractionWidget::onCommitFitClicked()
+{
+    if (!m_imageData || !m_incrementalFit.isValid()) {
+        showError("No image data available");
+        return;
+    }
+    if (!m_incrementalFit.isDetermined()) {
+        showError(QString("At least %1 samples are needed for this model")
+                 .arg(m_incrementalFit.termCount()));
+        return;
+    }
+    
+    // The only full-resolution render of the interactive session
+    QElapsedTimer timer;
+    timer.start();
+    QVector<float> background = m_incrementalFit.renderFull();
+    QVector<float> corrected(m_imageData->pixels.size());
+    for (int i = 0; i < corrected.size(); ++i) {
+        corrected[i] = m_imageData->pixels[i] - background[i];
+    }
+    
+    qDebug() << "🎯 Committed incremental background:" << m_incrementalFit.samples().size()
+             << "samples, order" << m_incrementalFit.order()
+             << "rendered in" << timer.elapsed() << "ms";
+    
+    ImageData display = *m_imageData;
+    display.pixels = background;
+    display.format = "Background Model";
+    display.invalidateDerived();
+    m_backgroundDisplayWidget->setImageData(display);
+    
+    emit backgroundModelChanged(background, m_imageData->width, m_imageData->height, m_imageData->channels);
+    emit correctedImageReady(corrected, m_imageData->width, m_imageData->height, m_imageData->channels);
+    
+    m_statusLabel->setText(QString("Committed background model from %1 samples (RMS %2)")
+                          .arg(m_incrementalFit.samples().size())
+                          .arg(m_incrementalFit.rmsResidual(), 0, 'g', 4));
+}
+
 void BackgroundExtractionWidget::onImageClicked(int x, int y, float value)
 {
-    if (m_manualSamplingMode && m_imageData) {
+    if (!m_manualSamplingMode || !m_imageData) return;
+    
+    if (!m_interactiveFitCheck->isChecked()) {
         m_extractor->addManualSample(QPoint(x, y), value);
         updateSampleDisplay();
         
         m_statusLabel->setText(QString("Added sample at (%1, %2) = %3")
                               .arg(x).arg(y).arg(value, 0, 'f', 6));
+        return;
+    }
+    
+    // Live refit: clicking on an existing sample removes it, anywhere else
+    // adds one; either way the factorisation is updated in place and only
+    // the preview level is re-rendered
+    const QPoint point(x, y);
+    const double pickRadius = std::max(4.0, std::max(m_imageData->width, m_imageData->height) / 200.0);
+    const int existing = m_incrementalFit.nearestSample(point, pickRadius);
+    
+    QString action;
+    if (existing >= 0) {
+        const QPoint removed = m_incrementalFit.samples()[existing].position;
+        m_incrementalFit.removeSample(existing);
+        
+        // The extractor has no single-sample removal; mirror the fit's list
+        m_extractor->clearManualSamples();
+        for (const IncrementalSample& sample : m_incrementalFit.samples()) {
+            m_extractor->addManualSample(sample.position, sample.values.value(0));
+        }
+        action = QString("Removed sample at (%1, %2)").arg(removed.x()).arg(removed.y());
+    } else {
+        if (m_incrementalFit.addSample(point) < 0) return;
+        m_extractor->addManualSample(point, value);
+        action = QString("Added sample at (%1, %2)").arg(x).arg(y);
+    }
+    
+    updateSampleDisplay();
+    updateIncrementalPreview(action);
+}
+
+void BackgroundExtractionWidget::resetIncrementalFit()
+{
+    if (m_imageData) {
+        m_incrementalFit.reset(*m_imageData, incrementalFitOrder());
+    } else {
+        m_incrementalFit = IncrementalBackgroundFit();
+    }
+}
+
+int BackgroundExtractionWidget::incrementalFitOrder() const
+{
+    // RBF has no incremental form; the live fit uses a cubic in its place
+    switch (static_cast<BackgroundModel>(m_modelCombo->currentData().toInt())) {
+    case BackgroundModel::Linear:      return 1;
+    case BackgroundModel::Polynomial2: return 2;
+    default:                           return 3;
     }
 }
 
+void BackgroundExtractionWidget::updateIncrementalPreview(const QString& action)
+{
+    if (!m_incrementalFit.isValid()) return;
+    
+    if (!m_incrementalFit.isDetermined()) {
+        m_statusLabel->setText(QString("%1 - %2 of %3 samples needed for the model")
+                              .arg(action)
+                              .arg(m_incrementalFit.samples().size())
+                              .arg(m_incrementalFit.termCount()));
+        return;
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    const int level = m_incrementalFit.previewLevel();
+    m_backgroundDisplayWidget->setImageData(m_incrementalFit.renderPreview(level));
+    
+    m_statusLabel->setText(QString("%1 - %2 samples, RMS %3 (preview 1/%4, %5 ms)")
+                          .arg(action)
+                          .arg(m_incrementalFit.samples().size())
+                          .arg(m_incrementalFit.rmsResidual(), 0, 'g', 4)
+                          .arg(1 << level)
+                          .arg(timer.elapsed()));
+}
+
 void BackgroundExtractionWidget::updateSampleDisplay()
 {
     QVector<QPoint> samples = m_extractor->getManualSamples();
@@ -901,19 +1070,22 @@ void BackgroundExtractionWidget::onSaveBackgroundClicked()
         return;
     }
     
+    QString selectedFilter;
     QString fileName = QFileDialog::getSaveFileName(
         this,
         "Save Background Model",
         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/background_model.xisf",
-        "XISF Files (*.xisf);;FITS Files (*.fits);;All Files (*)"
+        kSaveImageFilters,
+        &selectedFilter
     );
     
     if (fileName.isEmpty()) {
         return;
     }
     
-    // Implementation would save the background model
-    showSuccess("Background model saved successfully");
+    if (saveImageFile(fileName, selectedFilter, m_extractor->result().backgroundData, "background")) {
+        showSuccess("Background model saved successfully");
+    }
 }
 
 void BackgroundExtractionWidget::onSaveCorrectedClicked()
@@ -923,19 +1095,90 @@ void BackgroundExtractionWidget::onSaveCorrectedClicked()
         return;
     }
     
+    QString selectedFilter;
     QString fileName = QFileDialog::getSaveFileName(
         this,
         "Save Corrected Image",
         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/corrected_image.xisf",
-        "XISF Files (*.xisf);;FITS Files (*.fits);;All Files (*)"
+        kSaveImageFilters,
+        &selectedFilter
     );
     
     if (fileName.isEmpty()) {
         return;
     }
     
-    // Implementation would save the corrected image
-    showSuccess("Corrected image saved successfully");
+    if (saveImageFile(fileName, selectedFilter, m_extractor->result().correctedData, "corrected")) {
+        showSuccess("Corrected image saved successfully");
+    }
+}
+
+bool BackgroundExtractionWidget::saveImageFile(const QString& requestedName, const QString& selectedFilter,
+                                               const QVector<float>& data, const QString& imageId)
+{
+    if (!m_imageData) {
+        showError("No image loaded");
+        return false;
+    }
+    
+    // Luminance-only models hold a single plane
+    const int width = m_imageData->width;
+    const int height = m_imageData->height;
+    const qsizetype planeSize = qsizetype(width) * height;
+    const int channels = planeSize > 0 ? int(data.size() / planeSize) : 0;
+    if (channels <= 0 || data.size() != planeSize * channels) {
+        showError("Result does not match the image dimensions");
+        return false;
+    }
+    
+    // The selected filter decides the format; the suffix only matters for
+    // "All Files". A missing or mismatched suffix gets the format's own.
+    QString fileName = requestedName;
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    const bool fitsSuffix = suffix == "fits" || suffix == "fit" || suffix == "fts";
+    bool writeFits = fitsSuffix;
+    if (selectedFilter.startsWith("FITS")) {
+        writeFits = true;
+    } else if (selectedFilter.startsWith("XISF")) {
+        writeFits = false;
+    }
+    if (writeFits && !fitsSuffix) {
+        fileName += ".fits";
+    } else if (!writeFits && suffix != "xisf") {
+        fileName += ".xisf";
+    }
+    
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool saved = false;
+    QString error;
+    
+    if (writeFits) {
+        FITSWriteOptions options;
+        if (selectedFilter.contains("16-bit")) {
+            options.bitpix = 16;
+            options.dither = true;
+        } else if (selectedFilter.contains("32-bit integer")) {
+            options.bitpix = 32;
+        }
+        if (options.bitpix > 0) {
+            auto range = std::minmax_element(data.constBegin(), data.constEnd());
+            options.dataMin = std::min(0.0f, *range.first);
+            options.dataMax = std::max(1.0f, *range.second);
+        }
+        saved = FITSImageWriter::write(fileName, data.constData(), width, height, channels,
+                                       options, &m_imageData->keywords, &error);
+    } else {
+        SimplifiedXISFWriter writer(fileName, CompressionType::None);
+        saved = writer.addImage(imageId, data.constData(), width, height, channels) && writer.write();
+        if (!saved) error = writer.lastError();
+    }
+    
+    QApplication::restoreOverrideCursor();
+    
+    if (!saved) {
+        showError(QString("Failed to save %1: %2").arg(fileName, error));
+    }
+    return saved;
 }
 
 void BackgroundExtractionWidget::updatePreview()
@@ -27,6 +27,7 @@
 #include <memory>
 
 #include "BackgroundExtractor.h"
+#include "IncrementalBackgroundFit.h"
 #include "ImageReader.h"
 
 // Forward declarations
@@ -112,6 +113,8 @@ private slots:
     // Manual sampling
     void onManualSamplingToggled(bool enabled);
     void onClearSamplesClicked();
+    void onInteractiveFitToggled(bool enabled);
+    void onCommitFitClicked();
   //    void onChannelSelectionChanged();
     
     // Display options
@@ -143,6 +146,9 @@ private:
     void updateChannelResults();    // NEW: Update per-channel results
     void updatePreview();
     void updateSampleDisplay();
+    void resetIncrementalFit();
+    void updateIncrementalPreview(const QString& action);
+    int incrementalFitOrder() const;
     void updateChannelDisplay();    // NEW: Update channel visualization
     void updateBackgroundDisplay();
     
@@ -150,6 +156,8 @@ private:
     void resetProgress();
     void showError(const QString& message);
     void showSuccess(const QString& message);
+    bool saveImageFile(const QString& requestedName, const QString& selectedFilter,
+                       const QVector<float>& data, const QString& imageId);
     
     // NEW: Channel analysis methods
     void performChannelAnalysis();
@@ -247,6 +255,8 @@ private:
     QCheckBox* m_manualSamplingCheck;
     QPushButton* m_clearSamplesButton;
     QLabel* m_sampleCountLabel;
+    QCheckBox* m_interactiveFitCheck;
+    QPushButton* m_commitFitButton;
     QComboBox* m_activeChannelCombo;  // NEW: Select which channel for manual sampling
     
     QPushButton* m_applyToChannelButton;     // NEW
@@ -300,6 +310,7 @@ private:
     // Data
     std::unique_ptr<BackgroundExtractor> m_extractor;
     std::unique_ptr<ImageData> m_imageData;
+    IncrementalBackgroundFit m_incrementalFit;  // Live refit of manual samples
     
     bool m_hasResult = false;
     bool m_manualSamplingMode = false;
@@ -1,5 +1,7 @@
 // BackgroundExtractor.cpp - Enhanced implementation with per-channel support
 #include "BackgroundExtractor.h"
+#include "ImagePlaneCache.h"
+#include "ParallelFor.h"
 
 #include "PCLMockAPI.h"
 #include <pcl/api/APIInterface.h>
@@ -291,85 +293,43 @@ QVector<float> BackgroundExtractor::getChannelCorrectedData(int channel, int wid
 }
 
 // Channel analysis utilities
-QVector<double> BackgroundExtractor::analyzeChannelCorrelations(const ImageData& imageData) const
+namespace {
+
+// Correlations between consecutive channels, taken from the full matrix that
+// the derived-plane cache computes in a single full-resolution pass
+QVector<double> consecutiveChannelCorrelations(const ChannelCovariance& covariance, int channels)
 {
     QVector<double> correlations;
-    
-    if (imageData.channels < 2) {
-        return correlations;
+    for (int ch = 0; ch < channels - 1; ++ch) {
+        correlations.append(covariance.valid && covariance.count > 10
+                            ? covariance.correlationBetween(ch, ch + 1)
+                            : 0.0);
     }
-    
-    int pixelsPerChannel = imageData.width * imageData.height;
-    
-    // Calculate correlations between consecutive channels
-    for (int ch = 0; ch < imageData.channels - 1; ++ch) {
-        double sumX = 0, sumY = 0, sumXY = 0, sumX2 = 0, sumY2 = 0;
-        int count = 0;
-        
-        // Sample every 10th pixel for efficiency
-        for (int i = 0; i < pixelsPerChannel; i += 10) {
-            int idx1 = i + ch * pixelsPerChannel;
-            int idx2 = i + (ch + 1) * pixelsPerChannel;
-            
-            if (idx1 < imageData.pixels.size() && idx2 < imageData.pixels.size()) {
-                double x = imageData.pixels[idx1];
-                double y = imageData.pixels[idx2];
-                
-                sumX += x;
-                sumY += y;
-                sumXY += x * y;
-                sumX2 += x * x;
-                sumY2 += y * y;
-                count++;
-            }
-        }
-        
-        if (count > 10) {
-            double meanX = sumX / count;
-            double meanY = sumY / count;
-            double covariance = (sumXY / count) - (meanX * meanY);
-            double stdX = std::sqrt((sumX2 / count) - (meanX * meanX));
-            double stdY = std::sqrt((sumY2 / count) - (meanY * meanY));
-            
-            if (stdX > 0 && stdY > 0) {
-                double correlation = covariance / (stdX * stdY);
-                correlations.append(correlation);
-            } else {
-                correlations.append(0.0);
-            }
-        } else {
-            correlations.append(0.0);
-        }
+    return correlations;
+}
+
+} // namespace
+
+QVector<double> BackgroundExtractor::analyzeChannelCorrelations(const ImageData& imageData,
+                                                                const QVector<uchar>& mask) const
+{
+    if (imageData.channels < 2) {
+        return QVector<double>();
     }
     
-    return correlations;
+    ChannelCovariance covariance = imageData.derived()->channelCovariance(mask);
+    return consecutiveChannelCorrelations(covariance, imageData.channels);
 }
 
 QVector<double> BackgroundExtractor::estimateChannelBackgroundLevels(const ImageData& imageData) const
 {
     QVector<double> levels;
     
-    int pixelsPerChannel = imageData.width * imageData.height;
-    
+    auto derived = imageData.derived();
     for (int ch = 0; ch < imageData.channels; ++ch) {
-        QVector<float> channelData;
-        
-        // Extract channel data
-        for (int i = 0; i < pixelsPerChannel; ++i) {
-            int idx = i + ch * pixelsPerChannel;
-            if (idx < imageData.pixels.size()) {
-                channelData.append(imageData.pixels[idx]);
-            }
-        }
-        
-        if (!channelData.isEmpty()) {
-            // Calculate median as background estimate
-            std::sort(channelData.begin(), channelData.end());
-            double median = channelData[channelData.size() / 2];
-            levels.append(median);
-        } else {
-            levels.append(0.0);
-        }
+        // Median as background estimate
+        ChannelStatistics stats = derived->channelStatistics(ch);
+        levels.append(stats.valid ? stats.median : 0.0);
     }
     
     return levels;
@@ -681,25 +641,18 @@ bool BackgroundExtractionWorker::extractChannelBackground(int channel, ChannelRe
     QElapsedTimer channelTimer;
     channelTimer.start();
     
-    // Extract channel data
-    QVector<float> channelData = extractChannelData(channel);
-    if (channelData.isEmpty()) {
+    // Channel statistics are shared through the image's derived-plane cache
+    ChannelStatistics stats = m_imageData.derived()->channelStatistics(channel);
+    if (!stats.valid) {
         result.errorMessage = "Empty channel data";
         return false;
     }
     
-    // Calculate channel statistics
-    std::sort(channelData.begin(), channelData.end());
-    result.channelMin = channelData.first();
-    result.channelMax = channelData.last();
-    result.channelMean = std::accumulate(channelData.begin(), channelData.end(), 0.0) / channelData.size();
-    
-    double variance = 0.0;
-    for (float val : channelData) {
-        variance += (val - result.channelMean) * (val - result.channelMean);
-    }
-    result.channelStdDev = std::sqrt(variance / channelData.size());
-    result.backgroundLevel = channelData[channelData.size() / 10]; // 10th percentile as background estimate
+    result.channelMin = stats.minimum;
+    result.channelMax = stats.maximum;
+    result.channelMean = stats.mean;
+    result.channelStdDev = stats.stdDev;
+    result.backgroundLevel = stats.percentile10; // 10th percentile as background estimate
     
     // Generate samples for this channel
     QVector<QPoint> samples;
@@ -760,19 +713,13 @@ bool BackgroundExtractionWorker::extractChannelBackground(int channel, ChannelRe
 
 QVector<float> BackgroundExtractionWorker::extractChannelData(int channel) const
 {
-    QVector<float> channelData;
-    int pixelsPerChannel = m_imageData.width * m_imageData.height;
-    
-    channelData.reserve(pixelsPerChannel);
-    
-    for (int i = 0; i < pixelsPerChannel; ++i) {
-        int index = i + channel * pixelsPerChannel;
-        if (index < m_imageData.pixels.size()) {
-            channelData.append(m_imageData.pixels[index]);
-        }
+    auto derived = m_imageData.derived();
+    const float* plane = derived->channelPlane(channel);
+    if (!plane) {
+        return QVector<float>();
     }
     
-    return channelData;
+    return QVector<float>(plane, plane + derived->planeSize());
 }
 
 bool BackgroundExtractionWorker::generateChannelSpecificSamples(int channel, QVector<QPoint>& samples, QVector<float>& values)
@@ -790,15 +737,13 @@ bool BackgroundExtractionWorker::generateChannelSpecificSamples(int channel, QVe
         maxSamples = m_settings.channelMaxSamples[channel];
     }
     
-    // Extract channel data for analysis
-    QVector<float> channelData = extractChannelData(channel);
-    if (channelData.isEmpty()) return false;
+    // Channel statistics from the shared derived-plane cache
+    ChannelStatistics stats = m_imageData.derived()->channelStatistics(channel);
+    if (!stats.valid) return false;
     
-    // Calculate channel statistics
-    std::sort(channelData.begin(), channelData.end());
-    double median = channelData[channelData.size() / 2];
-    double q25 = channelData[channelData.size() / 4];
-    double q75 = channelData[3 * channelData.size() / 4];
+    double median = stats.median;
+    double q25 = stats.quartile1;
+    double q75 = stats.quartile3;
     double iqr = q75 - q25;
     
     // Adaptive threshold based on channel characteristics
@@ -1071,56 +1016,43 @@ void BackgroundExtractionWorker::rejectChannelOutliers(int channel, QVector<QPoi
 
 QVector<double> BackgroundExtractionWorker::calculateChannelCorrelations()
 {
-    QVector<double> correlations;
-    
     if (m_imageData.channels < 2) {
-        return correlations;
+        return QVector<double>();
     }
     
-    int pixelsPerChannel = m_imageData.width * m_imageData.height;
+    auto derived = m_imageData.derived();
+    size_t pixelsPerChannel = derived->planeSize();
     
-    // Calculate correlations between consecutive channels
-    for (int ch = 0; ch < m_imageData.channels - 1; ++ch) {
-        double sumX = 0, sumY = 0, sumXY = 0, sumX2 = 0, sumY2 = 0;
-        int count = 0;
-        
-        // Sample every 10th pixel for efficiency
-        for (int i = 0; i < pixelsPerChannel; i += 10) {
-            int idx1 = i + ch * pixelsPerChannel;
-            int idx2 = i + (ch + 1) * pixelsPerChannel;
-            
-            if (idx1 < m_imageData.pixels.size() && idx2 < m_imageData.pixels.size()) {
-                double x = m_imageData.pixels[idx1];
-                double y = m_imageData.pixels[idx2];
-                
-                sumX += x;
-                sumY += y;
-                sumXY += x * y;
-                sumX2 += x * x;
-                sumY2 += y * y;
-                count++;
-            }
+    // Only background pixels should drive the correlation: use the same
+    // per-channel threshold as sample generation (median + deviation * sigma)
+    QVector<const float*> planes;
+    QVector<float> thresholds;
+    for (int ch = 0; ch < m_imageData.channels; ++ch) {
+        double deviation = m_settings.deviation;
+        if (m_settings.usePerChannelSettings && ch < m_settings.channelDeviations.size()) {
+            deviation = m_settings.channelDeviations[ch];
         }
-        
-        if (count > 10) {
-            double meanX = sumX / count;
-            double meanY = sumY / count;
-            double covariance = (sumXY / count) - (meanX * meanY);
-            double stdX = std::sqrt((sumX2 / count) - (meanX * meanX));
-            double stdY = std::sqrt((sumY2 / count) - (meanY * meanY));
-            
-            if (stdX > 0 && stdY > 0) {
-                double correlation = covariance / (stdX * stdY);
-                correlations.append(correlation);
-            } else {
-                correlations.append(0.0);
+        ChannelStatistics stats = derived->channelStatistics(ch);
+        planes.append(derived->channelPlane(ch));
+        thresholds.append(static_cast<float>(stats.median + deviation * (stats.quartile3 - stats.quartile1) / 1.349));
+    }
+    
+    QVector<uchar> backgroundMask(static_cast<int>(pixelsPerChannel));
+    uchar* mask = backgroundMask.data();
+    Parallel::forRange(pixelsPerChannel, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uchar isBackground = 1;
+            for (int ch = 0; ch < planes.size(); ++ch) {
+                isBackground &= planes[ch][i] <= thresholds[ch];
             }
-        } else {
-            correlations.append(0.0);
+            mask[i] = isBackground;
         }
-    }
+    });
     
-    return correlations;
+    ChannelCovariance covariance = derived->channelCovariance(backgroundMask);
+    m_result.channelCorrelationMatrix = covariance.correlation;
+    
+    return consecutiveChannelCorrelations(covariance, m_imageData.channels);
 }
 
 void BackgroundExtractionWorker::shareGoodSamplesBetweenChannels()
@@ -1381,27 +1313,9 @@ bool BackgroundExtractionWorker::performLuminanceOnlyExtraction()
 
 void BackgroundExtractionWorker::calculateLuminance(QVector<float>& luminance) const
 {
-    int pixelsPerChannel = m_imageData.width * m_imageData.height;
-    luminance.resize(pixelsPerChannel);
-    
-    // Use channel weights if specified, otherwise use standard RGB weights
-    QVector<double> weights = m_settings.channelWeights;
-    if (weights.size() < 3) {
-        weights = {0.299, 0.587, 0.114}; // Standard RGB to luminance conversion
-    }
-    
-    for (int i = 0; i < pixelsPerChannel; ++i) {
-        double lum = 0.0;
-        
-        for (int ch = 0; ch < std::min(m_imageData.channels, 3); ++ch) {
-            int channelIndex = i + ch * pixelsPerChannel;
-            if (channelIndex < m_imageData.pixels.size() && ch < weights.size()) {
-                lum += m_imageData.pixels[channelIndex] * weights[ch];
-            }
-        }
-        
-        luminance[i] = static_cast<float>(lum);
-    }
+    // Computed once per image and weight set, then shared by every stage;
+    // falls back to standard RGB weights when none are specified
+    luminance = m_imageData.derived()->luminance(m_settings.channelWeights);
 }
 
 // Existing methods from original implementation
@@ -1439,16 +1353,12 @@ bool BackgroundExtractionWorker::generateImprovedAutomaticSamples()
     const float* pixels = m_imageData.pixels.constData();
     
     // For multi-channel, use first channel or luminance
-    QVector<float> analysisData;
+    QVector<float> luminanceData;
+    const float* analysisData = pixels;
     if (m_imageData.channels > 1 && m_settings.channelMode != ChannelMode::Combined) {
         // Use luminance for analysis
-        calculateLuminance(analysisData);
-    } else {
-        // Use first channel
-        int pixelsPerChannel = width * height;
-        for (int i = 0; i < pixelsPerChannel; ++i) {
-            analysisData.append(pixels[i]);
-        }
+        calculateLuminance(luminanceData);
+        analysisData = luminanceData.constData();
     }
     
     // Analyze local variance to find uniform (background) regions
@@ -1474,12 +1384,9 @@ bool BackgroundExtractionWorker::generateImprovedAutomaticSamples()
                     int px = x + dx;
                     int py = y + dy;
                     if (px >= 0 && px < width && py >= 0 && py < height) {
-                        int index = py * width + px;
-                        if (index < analysisData.size()) {
-                            float val = analysisData[index];
-                            blockValues.append(val);
-                            sum += val;
-                        }
+                        float val = analysisData[py * width + px];
+                        blockValues.append(val);
+                        sum += val;
                     }
                 }
             }
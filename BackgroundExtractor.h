@@ -139,6 +139,7 @@ struct BackgroundExtractionResult {
     
     // NEW: Channel analysis results
     QVector<double> channelCorrelations;   // Correlation between channels
+    QVector<double> channelCorrelationMatrix; // Full matrix over background pixels (row-major)
     QVector<QString> channelNotes;         // Per-channel processing notes
     ChannelMode usedChannelMode = ChannelMode::Combined;
     
@@ -249,7 +250,8 @@ public:
     QVector<QPoint> getManualSamplesForChannel(int channel) const;
     
     // NEW: Channel analysis utilities
-    QVector<double> analyzeChannelCorrelations(const ImageData& imageData) const;
+    QVector<double> analyzeChannelCorrelations(const ImageData& imageData,
+                                               const QVector<uchar>& mask = QVector<uchar>()) const;
     QVector<double> estimateChannelBackgroundLevels(const ImageData& imageData) const;
     QString getChannelAnalysisReport(const ImageData& imageData) const;
 
@@ -0,0 +1,252 @@
+// CatalogCrossMatch.cpp - Positional cross-match of two catalog result sets
+#include "CatalogCrossMatch.h"
+#include "ParallelFor.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double kDegToRad = M_PI / 180.0;
+
+// Declination zones at least as tall as the match radius, so a source only
+// ever needs its own zone and the two neighbours
+struct ZoneIndex {
+    double height = 1.0;
+    int zoneCount = 0;
+    QVector<int> zoneStart;       // zoneCount + 1 offsets into the arrays below
+    QVector<int> sourceIndex;     // Original index, sorted by (zone, RA)
+    QVector<double> ra;
+    QVector<double> xyz;          // Unit vectors, 3 per entry
+
+    int zoneOf(double dec) const
+    {
+        int zone = static_cast<int>(std::floor((dec + 90.0) / height));
+        return std::clamp(zone, 0, zoneCount - 1);
+    }
+};
+
+inline void unitVector(double ra, double dec, double* v)
+{
+    double cd = std::cos(dec * kDegToRad);
+    v[0] = cd * std::cos(ra * kDegToRad);
+    v[1] = cd * std::sin(ra * kDegToRad);
+    v[2] = std::sin(dec * kDegToRad);
+}
+
+inline double normalizeRA(double ra)
+{
+    ra = std::fmod(ra, 360.0);
+    return ra < 0.0 ? ra + 360.0 : ra;
+}
+
+// Counting sort by zone; indices within a zone keep input order
+QVector<int> sortByZone(const ZoneIndex& index, const QVector<double>& dec, QVector<int>& zoneStart)
+{
+    zoneStart.fill(0, index.zoneCount + 1);
+    for (double d : dec) zoneStart[index.zoneOf(d) + 1]++;
+    for (int z = 0; z < index.zoneCount; ++z) zoneStart[z + 1] += zoneStart[z];
+
+    QVector<int> order(dec.size());
+    QVector<int> fill = zoneStart;
+    for (int i = 0; i < dec.size(); ++i) {
+        order[fill[index.zoneOf(dec[i])]++] = i;
+    }
+    return order;
+}
+
+ZoneIndex buildZoneIndex(const QVector<double>& ra, const QVector<double>& dec, double height)
+{
+    ZoneIndex index;
+    index.height = height;
+    index.zoneCount = static_cast<int>(std::ceil(180.0 / height)) + 1;
+    index.sourceIndex = sortByZone(index, dec, index.zoneStart);
+
+    // RA order within each zone
+    Parallel::forRange(index.zoneCount, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; ++z) {
+            auto first = index.sourceIndex.begin() + index.zoneStart[int(z)];
+            auto last = index.sourceIndex.begin() + index.zoneStart[int(z) + 1];
+            std::sort(first, last, [&](int a, int b) {
+                return normalizeRA(ra[a]) < normalizeRA(ra[b]);
+            });
+        }
+    }, 1024);
+
+    const int count = index.sourceIndex.size();
+    index.ra.resize(count);
+    index.xyz.resize(3 * count);
+    for (int k = 0; k < count; ++k) {
+        int i = index.sourceIndex[k];
+        index.ra[k] = normalizeRA(ra[i]);
+        unitVector(ra[i], dec[i], index.xyz.data() + 3 * k);
+    }
+    return index;
+}
+
+} // namespace
+
+QVector<CrossMatchPair> CatalogCrossMatch::match(const AstrometricArrays& primary,
+                                                 const AstrometricArrays& secondary,
+                                                 const CrossMatchOptions& options)
+{
+    QVector<CrossMatchPair> pairs;
+    if (primary.size() == 0 || secondary.size() == 0 || options.radiusArcsec <= 0.0) {
+        return pairs;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Bring the primary to the secondary epoch
+    EpochPropagationOptions epoch;
+    epoch.referenceEpoch = options.primaryEpoch;
+    epoch.targetEpoch = options.secondaryEpoch;
+    QVector<double> primaryRA, primaryDec;
+    EpochPropagator::propagate(primary, epoch, primaryRA, primaryDec);
+
+    const double radius = options.radiusArcsec / 3600.0;
+    const double maxChord = 2.0 * std::sin(0.5 * radius * kDegToRad);
+    const double maxChordSq = maxChord * maxChord;
+    const double sinRadius = std::sin(radius * kDegToRad);
+
+    // Zones no thinner than 2" keep the offset table small for tight radii
+    ZoneIndex index = buildZoneIndex(secondary.ra, secondary.dec, std::max(radius, 2.0 / 3600.0));
+
+    // Walk the primary zone by zone so each chunk touches a compact band
+    QVector<int> primaryZoneStart;
+    QVector<int> primaryOrder = sortByZone(index, primaryDec, primaryZoneStart);
+
+    QVector<CrossMatchPair> best(primary.size());
+
+    Parallel::forRange(primaryOrder.size(), [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            const int i = primaryOrder[int(k)];
+            const double ra = normalizeRA(primaryRA[i]);
+            const double dec = primaryDec[i];
+            double v[3];
+            unitVector(ra, dec, v);
+
+            // Half-width in RA of the search cap at this declination
+            double cosDec = std::cos(std::min(90.0, std::fabs(dec)) * kDegToRad);
+            bool fullCircle = sinRadius >= cosDec;
+            double halfWidth = fullCircle ? 180.0 : std::asin(sinRadius / cosDec) / kDegToRad;
+
+            CrossMatchPair& result = best[i];
+            result.primaryIndex = i;
+            double bestChordSq = maxChordSq;
+
+            auto scan = [&](int first, int last) {
+                for (int s = first; s < last; ++s) {
+                    const double* w = index.xyz.constData() + 3 * s;
+                    double dx = v[0] - w[0], dy = v[1] - w[1], dz = v[2] - w[2];
+                    double chordSq = dx * dx + dy * dy + dz * dz;
+                    if (chordSq > maxChordSq) continue;
+                    result.candidates++;
+                    if (chordSq <= bestChordSq) {
+                        bestChordSq = chordSq;
+                        result.secondaryIndex = index.sourceIndex[s];
+                    }
+                }
+            };
+            auto scanRA = [&](int zoneBegin, int zoneEnd, double low, double high) {
+                const double* zoneRA = index.ra.constData();
+                int first = int(std::lower_bound(zoneRA + zoneBegin, zoneRA + zoneEnd, low) - zoneRA);
+                int last = int(std::upper_bound(zoneRA + zoneBegin, zoneRA + zoneEnd, high) - zoneRA);
+                scan(first, last);
+            };
+
+            int zone = index.zoneOf(dec);
+            for (int z = std::max(0, zone - 1); z <= std::min(index.zoneCount - 1, zone + 1); ++z) {
+                int zoneBegin = index.zoneStart[z];
+                int zoneEnd = index.zoneStart[z + 1];
+                if (zoneBegin == zoneEnd) continue;
+
+                double low = ra - halfWidth;
+                double high = ra + halfWidth;
+                if (fullCircle) {
+                    scan(zoneBegin, zoneEnd);
+                } else if (low < 0.0) {
+                    scanRA(zoneBegin, zoneEnd, low + 360.0, 360.0);
+                    scanRA(zoneBegin, zoneEnd, 0.0, high);
+                } else if (high >= 360.0) {
+                    scanRA(zoneBegin, zoneEnd, low, 360.0);
+                    scanRA(zoneBegin, zoneEnd, 0.0, high - 360.0);
+                } else {
+                    scanRA(zoneBegin, zoneEnd, low, high);
+                }
+            }
+
+            if (result.secondaryIndex >= 0) {
+                result.separationArcsec = 2.0 * std::asin(0.5 * std::sqrt(bestChordSq)) / kDegToRad * 3600.0;
+            }
+        }
+    }, 2048);
+
+    for (const CrossMatchPair& pair : best) {
+        if (pair.secondaryIndex >= 0) pairs.append(pair);
+    }
+    int candidatePairs = pairs.size();
+
+    // Closest pairs claim their secondary first
+    if (options.oneToOne) {
+        std::sort(pairs.begin(), pairs.end(), [](const CrossMatchPair& a, const CrossMatchPair& b) {
+            return a.separationArcsec < b.separationArcsec;
+        });
+        QVector<bool> claimed(secondary.size(), false);
+        QVector<CrossMatchPair> unique;
+        unique.reserve(pairs.size());
+        for (const CrossMatchPair& pair : pairs) {
+            if (claimed[pair.secondaryIndex]) continue;
+            claimed[pair.secondaryIndex] = true;
+            unique.append(pair);
+        }
+        pairs = unique;
+    }
+
+    std::sort(pairs.begin(), pairs.end(), [](const CrossMatchPair& a, const CrossMatchPair& b) {
+        return a.primaryIndex < b.primaryIndex;
+    });
+
+    qDebug() << QString("🔗 Cross-matched %1 x %2 sources: %3 pairs (%4 before one-to-one) within %5\" in %6 ms")
+                .arg(primary.size()).arg(secondary.size()).arg(pairs.size()).arg(candidatePairs)
+                .arg(options.radiusArcsec, 0, 'f', 1).arg(timer.elapsed());
+
+    return pairs;
+}
+
+QVector<CrossMatchPair> CatalogCrossMatch::matchGaiaTo2MASS(const QVector<GaiaGDR3Catalog::Star>& gaia,
+                                                            const QVector<Local2MASSCatalog::Star>& twoMass,
+                                                            const CrossMatchOptions& options)
+{
+    return match(toArrays(gaia), toArrays(twoMass), options);
+}
+
+AstrometricArrays CatalogCrossMatch::toArrays(const QVector<GaiaGDR3Catalog::Star>& stars)
+{
+    AstrometricArrays arrays;
+    arrays.resize(stars.size());
+    for (int i = 0; i < stars.size(); ++i) {
+        arrays.ra[i] = stars[i].ra;
+        arrays.dec[i] = stars[i].dec;
+        arrays.pmRA[i] = stars[i].pmRA;
+        arrays.pmDec[i] = stars[i].pmDec;
+        arrays.parallax[i] = stars[i].parallax;
+    }
+    return arrays;
+}
+
+AstrometricArrays CatalogCrossMatch::toArrays(const QVector<Local2MASSCatalog::Star>& stars)
+{
+    AstrometricArrays arrays;
+    arrays.ra.resize(stars.size());
+    arrays.dec.resize(stars.size());
+    for (int i = 0; i < stars.size(); ++i) {
+        arrays.ra[i] = stars[i].ra;
+        arrays.dec[i] = stars[i].dec;
+    }
+    return arrays;
+}
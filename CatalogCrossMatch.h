@@ -0,0 +1,49 @@
+// CatalogCrossMatch.h - Positional cross-match of two catalog result sets
+#ifndef CATALOG_CROSS_MATCH_H
+#define CATALOG_CROSS_MATCH_H
+
+#include "EpochPropagator.h"
+#include "GaiaGDR3Catalog.h"
+#include "Local2MASSCatalog.h"
+
+#include <QVector>
+
+struct CrossMatchOptions {
+    double radiusArcsec = 2.0;        // Maximum separation of a pair
+    double primaryEpoch = 2016.0;     // Epoch of the primary positions (Gaia DR3: J2016.0)
+    double secondaryEpoch = 2000.0;   // Epoch of the secondary positions (2MASS: ~J2000)
+    bool oneToOne = true;             // Each secondary source is paired at most once
+};
+
+struct CrossMatchPair {
+    int primaryIndex = -1;
+    int secondaryIndex = -1;
+    double separationArcsec = 0.0;    // At the secondary epoch
+    int candidates = 0;               // Secondary sources inside the radius (>1: ambiguous)
+};
+
+// Joins two catalogs on the sphere. The primary is carried to the secondary
+// epoch with its proper motions, then each primary source looks for its
+// nearest secondary source through a declination-zone index whose zones are
+// sorted by RA: only the neighbouring zones and an RA window of the match
+// radius are visited, so cost grows as N log N rather than N x M. Zones of
+// primary sources are processed in parallel.
+class CatalogCrossMatch
+{
+public:
+    // Primary proper motions are optional (missing ones count as zero);
+    // secondary positions are used as given, at secondaryEpoch
+    static QVector<CrossMatchPair> match(const AstrometricArrays& primary,
+                                         const AstrometricArrays& secondary,
+                                         const CrossMatchOptions& options = CrossMatchOptions());
+
+    // Gaia DR3 (with proper motions) against 2MASS point sources
+    static QVector<CrossMatchPair> matchGaiaTo2MASS(const QVector<GaiaGDR3Catalog::Star>& gaia,
+                                                    const QVector<Local2MASSCatalog::Star>& twoMass,
+                                                    const CrossMatchOptions& options = CrossMatchOptions());
+
+    static AstrometricArrays toArrays(const QVector<GaiaGDR3Catalog::Star>& stars);
+    static AstrometricArrays toArrays(const QVector<Local2MASSCatalog::Star>& stars);
+};
+
+#endif // CATALOG_CROSS_MATCH_H
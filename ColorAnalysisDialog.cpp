@@ -225,6 +225,17 @@ void ColorAnalysisDialog::onRunColorAnalysis()
     }
 }
 
+void ColorAnalysisDialog::setColorData(const QVector<StarColorData>& colors)
+{
+    m_analyzer->setStarColorData(colors);
+    m_calculateCalibButton->setEnabled(!colors.isEmpty());
+    m_exportButton->setEnabled(!colors.isEmpty());
+    
+    populateResultsTable();
+    updateStatistics();
+    updateCharts();
+}
+
 void ColorAnalysisDialog::onColorAnalysisCompleted(int starsAnalyzed)
 {
     m_progressBar->setVisible(false);
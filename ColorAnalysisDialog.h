@@ -39,6 +39,9 @@ public:
 			       const QVector<float>& radii,
 			       const QVector<CatalogStar>& catalog,
 			       QWidget *parent = nullptr);    
+    
+    // Show colours already measured instead of running the analysis here
+    void setColorData(const QVector<StarColorData>& colors);
 
 signals:
     void colorCalibrationReady(const ColorCalibrationResult& result);
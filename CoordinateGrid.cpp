@@ -0,0 +1,329 @@
+// CoordinateGrid.cpp - RA/Dec graticule traced through a WCS with adaptive tessellation
+#include "CoordinateGrid.h"
+
+#include <QRectF>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int kExtentSamples = 24;      // Per axis, for the pixel->sky field extent
+const int kMaxLinesPerAxis = 64;
+
+// Spacings in degrees: Dec in arc units, RA in time units (1s = 15")
+const double kDecSteps[] = {
+    1 / 3600.0, 2 / 3600.0, 5 / 3600.0, 10 / 3600.0, 15 / 3600.0, 30 / 3600.0,
+    1 / 60.0, 2 / 60.0, 5 / 60.0, 10 / 60.0, 15 / 60.0, 30 / 60.0,
+    1.0, 2.0, 5.0, 10.0, 15.0, 30.0
+};
+const double kRASteps[] = {
+    0.1 / 240.0, 0.2 / 240.0, 0.5 / 240.0, 1 / 240.0, 2 / 240.0, 5 / 240.0,
+    10 / 240.0, 15 / 240.0, 30 / 240.0, 1 / 4.0, 2 / 4.0, 5 / 4.0, 10 / 4.0,
+    15 / 4.0, 30 / 4.0, 15.0, 30.0, 45.0, 90.0
+};
+
+template <size_t N>
+double niceStep(double ideal, const double (&steps)[N])
+{
+    for (double step : steps) {
+        if (step >= ideal) return step;
+    }
+    return steps[N - 1];
+}
+
+// Signed RA difference wrapped to (-180, 180]
+double wrapDelta(double ra, double center)
+{
+    double d = std::fmod(ra - center, 360.0);
+    if (d > 180.0) d -= 360.0;
+    if (d <= -180.0) d += 360.0;
+    return d;
+}
+
+double chordDeviation(const QPointF& p, const QPointF& a, const QPointF& b)
+{
+    const QPointF ab = b - a;
+    const double length = std::hypot(ab.x(), ab.y());
+    if (length < 1e-9) return std::hypot(p.x() - a.x(), p.y() - a.y());
+    return std::abs(ab.x() * (a.y() - p.y()) - ab.y() * (a.x() - p.x())) / length;
+}
+
+// Where the segment from `inside` to `outside` leaves the rectangle
+QPointF exitPoint(const QPointF& inside, const QPointF& outside, const QRectF& rect)
+{
+    double t = 1.0;
+    const QPointF d = outside - inside;
+    if (outside.x() < rect.left()) t = std::min(t, (rect.left() - inside.x()) / d.x());
+    if (outside.x() > rect.right()) t = std::min(t, (rect.right() - inside.x()) / d.x());
+    if (outside.y() < rect.top()) t = std::min(t, (rect.top() - inside.y()) / d.y());
+    if (outside.y() > rect.bottom()) t = std::min(t, (rect.bottom() - inside.y()) / d.y());
+    return inside + d * std::max(0.0, t);
+}
+
+} // namespace
+
+bool CoordinateGrid::isCurrent(quint64 wcsGeneration, double xScale, double yScale) const
+{
+    return m_built && m_generation == wcsGeneration &&
+           std::abs(m_xScale - xScale) < 1e-9 && std::abs(m_yScale - yScale) < 1e-9;
+}
+
+void CoordinateGrid::clear()
+{
+    m_built = false;
+    m_lines.clear();
+    m_vertexCount = 0;
+}
+
+void CoordinateGrid::build(quint64 wcsGeneration, int width, int height, double xScale, double yScale,
+                           const SkyToPixel& skyToPixel, const PixelToSky& pixelToSky,
+                           const CoordinateGridOptions& options)
+{
+    clear();
+    m_generation = wcsGeneration;
+    m_xScale = xScale;
+    m_yScale = yScale;
+    m_displaySize = QSizeF(width * xScale, height * yScale);
+    m_built = true;
+    if (width <= 0 || height <= 0) return;
+
+    // Field extent from a pixel->sky sample, RA unwrapped about the centre
+    double raCenter = 0.0, decCenter = 0.0;
+    if (!pixelToSky(width * 0.5, height * 0.5, raCenter, decCenter)) {
+        qDebug() << "Coordinate grid: image centre has no sky position";
+        return;
+    }
+
+    double raMin = 0.0, raMax = 0.0, decMin = decCenter, decMax = decCenter;
+    for (int j = 0; j <= kExtentSamples; ++j) {
+        for (int i = 0; i <= kExtentSamples; ++i) {
+            double ra, dec;
+            if (!pixelToSky(double(width) * i / kExtentSamples, double(height) * j / kExtentSamples, ra, dec)) {
+                continue;
+            }
+            const double d = wrapDelta(ra, raCenter);
+            raMin = std::min(raMin, d);
+            raMax = std::max(raMax, d);
+            decMin = std::min(decMin, dec);
+            decMax = std::max(decMax, dec);
+        }
+    }
+
+    // A pole in the frame: every meridian passes through it
+    const QRectF frame(0, 0, width, height);
+    bool fullCircle = raMax - raMin > 270.0;
+    for (double pole : {90.0, -90.0}) {
+        QPointF p;
+        if (skyToPixel(raCenter, pole, p) && frame.contains(p)) {
+            fullCircle = true;
+            (pole > 0 ? decMax : decMin) = pole;
+        }
+    }
+
+    const double decPad = (decMax - decMin) * 0.05 + 1e-6;
+    decMin = std::max(-90.0, decMin - decPad);
+    decMax = std::min(90.0, decMax + decPad);
+    if (fullCircle) {
+        raMin = -180.0;
+        raMax = 180.0;
+    } else {
+        const double raPad = (raMax - raMin) * 0.05 + 1e-6;
+        raMin -= raPad;
+        raMax += raPad;
+    }
+    raMin += raCenter;
+    raMax += raCenter;
+
+    const int lines = std::max(1, options.targetLines);
+    m_decStep = niceStep((decMax - decMin) / lines, kDecSteps);
+    m_raStep = niceStep((raMax - raMin) / lines, kRASteps);
+
+    // Parallels
+    for (double dec = std::ceil(decMin / m_decStep) * m_decStep;
+         dec <= decMax && m_lines.size() < kMaxLinesPerAxis; dec += m_decStep) {
+        if (std::abs(dec) > 90.0 - 1e-9) continue;
+        CoordinateGridLine line;
+        line.isRA = false;
+        line.value = dec;
+        line.label = formatDec(dec, m_decStep);
+        traceLine(line, raMin, raMax, skyToPixel, options);
+        m_lines.append(line);
+    }
+
+    // Meridians; on a full circle the last one would repeat the first
+    const int parallels = m_lines.size();
+    for (double ra = std::ceil(raMin / m_raStep) * m_raStep;
+         (fullCircle ? ra < raMax - 1e-9 : ra <= raMax) && m_lines.size() - parallels < kMaxLinesPerAxis;
+         ra += m_raStep) {
+        CoordinateGridLine line;
+        line.isRA = true;
+        line.value = std::fmod(ra + 360.0, 360.0);
+        line.label = formatRA(line.value, m_raStep);
+        traceLine(line, decMin, decMax, skyToPixel, options);
+        m_lines.append(line);
+    }
+
+    for (CoordinateGridLine& line : m_lines) {
+        placeLabel(line);
+    }
+
+    qDebug() << "Coordinate grid:" << m_lines.size() << "lines," << m_vertexCount << "vertices, RA step"
+             << m_raStep * 240.0 << "s, Dec step" << m_decStep * 3600.0 << "arcsec";
+}
+
+void CoordinateGrid::traceLine(CoordinateGridLine& line, double from, double to,
+                               const SkyToPixel& skyToPixel, const CoordinateGridOptions& options)
+{
+    // Points far outside the frame are dropped; they only cost vertices
+    const QRectF keep(-m_displaySize.width() * 0.5, -m_displaySize.height() * 0.5,
+                      m_displaySize.width() * 2.0, m_displaySize.height() * 2.0);
+    const double jump = std::hypot(m_displaySize.width(), m_displaySize.height()) * 0.25;
+
+    struct Sample {
+        double t;
+        QPointF p;
+        bool ok;
+    };
+
+    auto evaluate = [&](double t) {
+        Sample s{t, QPointF(), false};
+        QPointF pixel;
+        const bool projected = line.isRA ? skyToPixel(line.value, t, pixel)
+                                         : skyToPixel(t, line.value, pixel);
+        if (projected && std::isfinite(pixel.x()) && std::isfinite(pixel.y())) {
+            s.p = QPointF(pixel.x() * m_xScale, pixel.y() * m_yScale);
+            s.ok = keep.contains(s.p);
+        }
+        return s;
+    };
+
+    bool penDown = false;
+    QPointF last;
+    auto append = [&](const Sample& s) {
+        if (!s.ok) {
+            penDown = false;
+            return;
+        }
+        // A jump between adjacent accepted samples is a discontinuity
+        // (the far side of the tangent plane), not part of the line
+        if (penDown && std::hypot(s.p.x() - last.x(), s.p.y() - last.y()) > jump) penDown = false;
+        if (penDown) {
+            line.path.lineTo(s.p);
+        } else {
+            line.path.moveTo(s.p);
+        }
+        penDown = true;
+        last = s.p;
+        ++m_vertexCount;
+    };
+
+    std::function<void(const Sample&, const Sample&, int)> subdivide =
+        [&](const Sample& a, const Sample& b, int depth) {
+            if (depth >= options.maxDepth) {
+                append(b);
+                return;
+            }
+            const Sample m = evaluate(0.5 * (a.t + b.t));
+            if (a.ok && b.ok && m.ok &&
+                chordDeviation(m.p, a.p, b.p) <= options.tolerance &&
+                std::hypot(b.p.x() - a.p.x(), b.p.y() - a.p.y()) <= jump) {
+                append(b);
+                return;
+            }
+            if (!a.ok && !b.ok && !m.ok) {
+                append(b);
+                return;
+            }
+            subdivide(a, m, depth + 1);
+            subdivide(m, b, depth + 1);
+        };
+
+    const int segments = std::max(2, options.initialSegments);
+    Sample previous = evaluate(from);
+    append(previous);
+    for (int i = 1; i <= segments; ++i) {
+        const Sample next = evaluate(from + (to - from) * i / segments);
+        subdivide(previous, next, 0);
+        previous = next;
+    }
+}
+
+void CoordinateGrid::placeLabel(CoordinateGridLine& line) const
+{
+    const QRectF frame(0, 0, m_displaySize.width(), m_displaySize.height());
+    const QPointF inset(line.isRA ? 0.0 : 4.0, line.isRA ? -4.0 : 0.0);
+
+    // First point where the polyline crosses the frame edge
+    QPointF previous;
+    bool havePrevious = false;
+    for (int i = 0; i < line.path.elementCount(); ++i) {
+        const QPainterPath::Element e = line.path.elementAt(i);
+        const QPointF p(e.x, e.y);
+        if (e.isLineTo() && havePrevious) {
+            const bool inPrevious = frame.contains(previous);
+            const bool inCurrent = frame.contains(p);
+            if (inPrevious != inCurrent) {
+                line.labelPosition = inPrevious ? exitPoint(previous, p, frame) : exitPoint(p, previous, frame);
+                line.hasLabel = true;
+                break;
+            }
+        }
+        previous = p;
+        havePrevious = true;
+    }
+
+    // Closed inside the frame (a parallel around a pole): label its first vertex
+    if (!line.hasLabel && line.path.elementCount() > 0) {
+        const QPainterPath::Element e = line.path.elementAt(0);
+        if (frame.contains(QPointF(e.x, e.y))) {
+            line.labelPosition = QPointF(e.x, e.y);
+            line.hasLabel = true;
+        }
+    }
+
+    if (line.hasLabel) {
+        line.labelPosition.setX(std::clamp(line.labelPosition.x() + inset.x(), 2.0, std::max(2.0, frame.width() - 60.0)));
+        line.labelPosition.setY(std::clamp(line.labelPosition.y() + inset.y(), 12.0, std::max(12.0, frame.height() - 4.0)));
+    }
+}
+
+QString CoordinateGrid::formatRA(double ra, double step)
+{
+    // Work in seconds of time rounded to the step's precision
+    const double stepSeconds = step * 240.0;
+    const int decimals = stepSeconds < 1.0 ? 1 : 0;
+    const double unit = decimals ? 0.1 : 1.0;
+    double seconds = std::round(std::fmod(ra + 360.0, 360.0) * 240.0 / unit) * unit;
+    if (seconds >= 86400.0) seconds -= 86400.0;
+
+    const int h = int(seconds / 3600.0);
+    const int m = int((seconds - h * 3600.0) / 60.0);
+    const double s = seconds - h * 3600.0 - m * 60.0;
+
+    if (stepSeconds >= 3600.0) return QString("%1h").arg(h, 2, 10, QChar('0'));
+    if (stepSeconds >= 60.0) {
+        return QString("%1h%2m").arg(h, 2, 10, QChar('0')).arg(m, 2, 10, QChar('0'));
+    }
+    return QString("%1h%2m%3s").arg(h, 2, 10, QChar('0')).arg(m, 2, 10, QChar('0'))
+        .arg(s, decimals ? 4 : 2, 'f', decimals, QChar('0'));
+}
+
+QString CoordinateGrid::formatDec(double dec, double step)
+{
+    const double stepArcsec = step * 3600.0;
+    const QChar sign = dec < 0 ? QChar('-') : QChar('+');
+    const double arcsec = std::round(std::abs(dec) * 3600.0);
+
+    const int d = int(arcsec / 3600.0);
+    const int m = int((arcsec - d * 3600.0) / 60.0);
+    const int s = int(arcsec - d * 3600.0 - m * 60.0);
+
+    if (stepArcsec >= 3600.0) return QString("%1%2°").arg(sign).arg(d, 2, 10, QChar('0'));
+    if (stepArcsec >= 60.0) {
+        return QString("%1%2°%3'").arg(sign).arg(d, 2, 10, QChar('0')).arg(m, 2, 10, QChar('0'));
+    }
+    return QString("%1%2°%3'%4\"").arg(sign).arg(d, 2, 10, QChar('0'))
+        .arg(m, 2, 10, QChar('0')).arg(s, 2, 10, QChar('0'));
+}
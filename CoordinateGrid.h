@@ -0,0 +1,76 @@
+// CoordinateGrid.h - RA/Dec graticule traced through a WCS with adaptive tessellation
+#ifndef COORDINATE_GRID_H
+#define COORDINATE_GRID_H
+
+#include <QPainterPath>
+#include <QPointF>
+#include <QSizeF>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+struct CoordinateGridOptions {
+    int targetLines = 6;            // Approximate lines per axis across the field
+    double tolerance = 0.35;        // Max chord deviation in display pixels
+    int maxDepth = 12;              // Subdivision limit per initial segment
+    int initialSegments = 16;       // Uniform samples before subdivision
+};
+
+struct CoordinateGridLine {
+    bool isRA = false;              // Iso-RA (meridian) or iso-Dec (parallel)
+    double value = 0.0;             // degrees
+    QPainterPath path;              // Display coordinates
+    QString label;
+    QPointF labelPosition;          // Where the line meets the frame edge
+    bool hasLabel = false;
+};
+
+// Graticule for one WCS at one display scale. Lines are traced with
+// recursive midpoint subdivision until the curve stays within `tolerance`
+// display pixels of its chords, so strongly distorted fields (SIP) and
+// lines near a pole get dense vertices while straight stretches get two.
+// The field extent is found from a pixel->sky sample; RA is unwrapped
+// around the field centre, and a pole inside the frame widens RA to the
+// full circle.
+//
+// Building is done once per (WCS, scale); callers keep the instance and
+// check isCurrent() before rebuilding, so repaints only stroke paths.
+class CoordinateGrid
+{
+public:
+    using SkyToPixel = std::function<bool(double ra, double dec, QPointF& pixel)>;
+    using PixelToSky = std::function<bool(double x, double y, double& ra, double& dec)>;
+
+    bool isCurrent(quint64 wcsGeneration, double xScale, double yScale) const;
+
+    void build(quint64 wcsGeneration, int width, int height, double xScale, double yScale,
+               const SkyToPixel& skyToPixel, const PixelToSky& pixelToSky,
+               const CoordinateGridOptions& options = CoordinateGridOptions());
+    void clear();
+
+    const QVector<CoordinateGridLine>& lines() const { return m_lines; }
+    double raStep() const { return m_raStep; }
+    double decStep() const { return m_decStep; }
+    int vertexCount() const { return m_vertexCount; }
+
+    static QString formatRA(double ra, double step);
+    static QString formatDec(double dec, double step);
+
+private:
+    void traceLine(CoordinateGridLine& line, double from, double to,
+                   const SkyToPixel& skyToPixel, const CoordinateGridOptions& options);
+    void placeLabel(CoordinateGridLine& line) const;
+
+    quint64 m_generation = 0;
+    double m_xScale = 0.0;
+    double m_yScale = 0.0;
+    bool m_built = false;
+    QSizeF m_displaySize;
+
+    QVector<CoordinateGridLine> m_lines;
+    double m_raStep = 0.0;
+    double m_decStep = 0.0;
+    int m_vertexCount = 0;
+};
+
+#endif // COORDINATE_GRID_H
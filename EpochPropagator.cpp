@@ -0,0 +1,206 @@
+// EpochPropagator.cpp - Batched astrometric propagation of catalog positions
+#include "EpochPropagator.h"
+#include "ParallelFor.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <cmath>
+#include <cstring>
+#include <list>
+
+namespace {
+
+const double kDegToRad = M_PI / 180.0;
+const double kMasToRad = M_PI / (180.0 * 3600.0 * 1000.0);
+const double kKmPerSecondPerAuPerYear = 4.740470446;   // 1 AU/yr in km/s
+const double kSpeedOfLightAuPerDay = 173.1446326846693;
+const double kDaysPerJulianYear = 365.25;
+const double kJ2000 = 2000.0;
+
+struct CacheEntry {
+    quint64 key;
+    EpochPropagationOptions options;
+    AstrometricArrays input;        // Compared on a hit; the key alone may collide
+    QVector<double> ra;
+    QVector<double> dec;
+};
+
+// Most recently used first; bounded by total star count
+QMutex s_cacheMutex;
+std::list<CacheEntry> s_cache;
+const int kCacheMaxStars = 4000000;
+
+// Geocentric Sun from the Astronomical Almanac low-precision formulae
+void sunPosition(double julianYear, double sun[3])
+{
+    double n = (julianYear - kJ2000) * kDaysPerJulianYear;
+    double L = (280.460 + 0.9856474 * n) * kDegToRad;
+    double g = (357.528 + 0.9856003 * n) * kDegToRad;
+    double lambda = L + (1.915 * std::sin(g) + 0.020 * std::sin(2.0 * g)) * kDegToRad;
+    double R = 1.00014 - 0.01671 * std::cos(g) - 0.00014 * std::cos(2.0 * g);
+    double epsilon = (23.439 - 0.0000004 * n) * kDegToRad;
+
+    sun[0] = R * std::cos(lambda);
+    sun[1] = R * std::cos(epsilon) * std::sin(lambda);
+    sun[2] = R * std::sin(epsilon) * std::sin(lambda);
+}
+
+// Bitwise, so missing (NaN) proper motions and parallaxes compare equal
+bool sameValues(const QVector<double>& a, const QVector<double>& b)
+{
+    return a.size() == b.size() &&
+           (a.constData() == b.constData() ||
+            std::memcmp(a.constData(), b.constData(), size_t(a.size()) * sizeof(double)) == 0);
+}
+
+bool sameInput(const AstrometricArrays& a, const AstrometricArrays& b)
+{
+    return sameValues(a.ra, b.ra) && sameValues(a.dec, b.dec) &&
+           sameValues(a.pmRA, b.pmRA) && sameValues(a.pmDec, b.pmDec) &&
+           sameValues(a.parallax, b.parallax) && sameValues(a.radialVelocity, b.radialVelocity);
+}
+
+inline double valueOrZero(const QVector<double>& values, int i)
+{
+    if (i >= values.size()) return 0.0;
+    double v = values[i];
+    return std::isfinite(v) ? v : 0.0;
+}
+
+} // namespace
+
+void AstrometricArrays::resize(int count)
+{
+    ra.resize(count);
+    dec.resize(count);
+    pmRA.resize(count);
+    pmDec.resize(count);
+    parallax.resize(count);
+}
+
+bool EpochPropagationOptions::operator==(const EpochPropagationOptions& other) const
+{
+    return referenceEpoch == other.referenceEpoch && targetEpoch == other.targetEpoch &&
+           applyParallax == other.applyParallax && applyAberration == other.applyAberration &&
+           (!(applyParallax || applyAberration) || observationEpoch == other.observationEpoch);
+}
+
+bool EpochPropagationOptions::isIdentity() const
+{
+    return targetEpoch == referenceEpoch && !applyParallax && !applyAberration;
+}
+
+void EpochPropagator::earthState(double julianYear, double position[3], double velocity[3])
+{
+    // Earth is opposite the Sun; velocity by central difference over a day
+    const double halfStep = 0.5 / kDaysPerJulianYear;
+    double sun[3], before[3], after[3];
+    sunPosition(julianYear, sun);
+    sunPosition(julianYear - halfStep, before);
+    sunPosition(julianYear + halfStep, after);
+
+    for (int k = 0; k < 3; ++k) {
+        position[k] = -sun[k];
+        velocity[k] = -(after[k] - before[k]);
+    }
+}
+
+void EpochPropagator::propagate(const AstrometricArrays& input,
+                                const EpochPropagationOptions& options,
+                                QVector<double>& raOut,
+                                QVector<double>& decOut,
+                                quint64 cacheKey)
+{
+    const int count = input.size();
+
+    if (cacheKey != 0) {
+        QMutexLocker locker(&s_cacheMutex);
+        for (auto it = s_cache.begin(); it != s_cache.end(); ++it) {
+            if (it->key == cacheKey && it->options == options && sameInput(it->input, input)) {
+                raOut = it->ra;
+                decOut = it->dec;
+                s_cache.splice(s_cache.begin(), s_cache, it);
+                return;
+            }
+        }
+    }
+
+    raOut.resize(count);
+    decOut.resize(count);
+
+    if (options.isIdentity()) {
+        raOut = input.ra;
+        decOut = input.dec;
+        return;
+    }
+
+    // Per-epoch constants shared by every star
+    const double years = options.targetEpoch - options.referenceEpoch;
+    double earth[3] = {0.0, 0.0, 0.0}, earthVelocity[3] = {0.0, 0.0, 0.0};
+    if (options.applyParallax || options.applyAberration) {
+        earthState(options.observationEpoch, earth, earthVelocity);
+    }
+    double beta[3];
+    for (int k = 0; k < 3; ++k) {
+        beta[k] = options.applyAberration ? earthVelocity[k] / kSpeedOfLightAuPerDay : 0.0;
+    }
+    const bool parallax = options.applyParallax;
+
+    const double* ra = input.ra.constData();
+    const double* dec = input.dec.constData();
+    double* raResult = raOut.data();
+    double* decResult = decOut.data();
+
+    Parallel::forRange(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            double sa = std::sin(ra[i] * kDegToRad), ca = std::cos(ra[i] * kDegToRad);
+            double sd = std::sin(dec[i] * kDegToRad), cd = std::cos(dec[i] * kDegToRad);
+
+            double pmRA = valueOrZero(input.pmRA, int(i));
+            double pmDec = valueOrZero(input.pmDec, int(i));
+            double plx = valueOrZero(input.parallax, int(i));
+            double pmRadial = valueOrZero(input.radialVelocity, int(i)) * plx / kKmPerSecondPerAuPerYear;
+
+            // Direction u, unit vectors p (east) and q (north); the star
+            // moves along pmRA*p + pmDec*q + pmRadial*u (all mas/yr)
+            double u[3] = {cd * ca, cd * sa, sd};
+            double p[3] = {-sa, ca, 0.0};
+            double q[3] = {-sd * ca, -sd * sa, cd};
+
+            double x[3];
+            for (int k = 0; k < 3; ++k) {
+                x[k] = u[k] + years * kMasToRad * (pmRA * p[k] + pmDec * q[k] + pmRadial * u[k]);
+                if (parallax) x[k] -= plx * kMasToRad * earth[k];
+            }
+
+            double norm = std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+            for (int k = 0; k < 3; ++k) x[k] = x[k] / norm + beta[k];
+            norm = std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+
+            double alpha = std::atan2(x[1], x[0]) / kDegToRad;
+            raResult[i] = alpha < 0.0 ? alpha + 360.0 : alpha;
+            decResult[i] = std::asin(std::max(-1.0, std::min(1.0, x[2] / norm))) / kDegToRad;
+        }
+    }, 4096);
+
+    if (cacheKey != 0) {
+        QMutexLocker locker(&s_cacheMutex);
+        s_cache.push_front({cacheKey, options, input, raOut, decOut});
+
+        int stars = 0;
+        for (auto it = s_cache.begin(); it != s_cache.end(); ++it) {
+            stars += it->ra.size();
+            if (stars > kCacheMaxStars && it != s_cache.begin()) {
+                s_cache.erase(it, s_cache.end());
+                break;
+            }
+        }
+    }
+}
+
+void EpochPropagator::clearCache()
+{
+    QMutexLocker locker(&s_cacheMutex);
+    s_cache.clear();
+}
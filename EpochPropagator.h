@@ -0,0 +1,56 @@
+// EpochPropagator.h - Batched astrometric propagation of catalog positions
+#ifndef EPOCH_PROPAGATOR_H
+#define EPOCH_PROPAGATOR_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// Catalog astrometry as structure-of-arrays. Missing (non-finite) proper
+// motions, parallaxes or radial velocities count as zero; radialVelocity
+// may be left empty.
+struct AstrometricArrays {
+    QVector<double> ra;               // degrees, at the reference epoch
+    QVector<double> dec;
+    QVector<double> pmRA;             // mas/yr, includes cos(dec) as in Gaia
+    QVector<double> pmDec;            // mas/yr
+    QVector<double> parallax;         // mas
+    QVector<double> radialVelocity;   // km/s
+
+    int size() const { return ra.size(); }
+    void resize(int count);
+};
+
+struct EpochPropagationOptions {
+    double referenceEpoch = 2016.0;   // Julian years (Gaia DR3: J2016.0)
+    double targetEpoch = 2016.0;      // Epoch the space motion is carried to
+    double observationEpoch = 2016.0; // When Earth's position/velocity are taken
+    bool applyParallax = false;       // Annual parallax: geocentric direction
+    bool applyAberration = false;     // Annual aberration: apparent direction
+
+    bool operator==(const EpochPropagationOptions& other) const;
+    bool isIdentity() const;
+};
+
+// Rigorous space-motion propagation (position + velocity in three
+// dimensions, then renormalised) with optional annual parallax and annual
+// aberration from a low-precision Earth ephemeris (~0.01 AU; well under a
+// milliarcsecond of parallax error for any catalog star). Runs in parallel
+// chunks. Results for a caller-supplied non-zero cache key are kept for the
+// most recent epochs, so repeating a propagation is free; a hit also needs
+// the same input arrays, so a key shared by different star sets is safe.
+class EpochPropagator
+{
+public:
+    static void propagate(const AstrometricArrays& input,
+                          const EpochPropagationOptions& options,
+                          QVector<double>& raOut,
+                          QVector<double>& decOut,
+                          quint64 cacheKey = 0);
+
+    // Barycentric Earth position (AU) and velocity (AU/day), equatorial J2000
+    static void earthState(double julianYear, double position[3], double velocity[3]);
+
+    static void clearCache();
+};
+
+#endif // EPOCH_PROPAGATOR_H
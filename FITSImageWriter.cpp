@@ -0,0 +1,222 @@
+// FITSImageWriter.cpp - Fast FITS export of float image planes
+#include "FITSImageWriter.h"
+#include "ImageKeywords.h"
+#include "ImageReader.h"
+#include "ParallelFor.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QSaveFile>
+#include <QSet>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+const int kBlockSize = 2880;                  // FITS logical record
+const size_t kChunkSamples = size_t(1) << 21; // 8 MiB of 32-bit samples per buffer
+
+QByteArray card(const QString& name, const QString& value, const QString& comment = QString())
+{
+    QString text = QString("%1= %2").arg(name, -8).arg(value, 20);
+    if (!comment.isEmpty()) text += " / " + comment;
+    return text.left(80).leftJustified(80, ' ').toLatin1();
+}
+
+// Counter-based uniform in [0, 1): independent of chunking and thread count
+inline float ditherNoise(quint64 seed, quint64 index)
+{
+    quint64 z = seed * 0x9E3779B97F4A7C15ULL + index;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return float(z >> 40) * (1.0f / 16777216.0f);
+}
+
+void convertFloat(const float* in, uchar* out, size_t count)
+{
+    quint32* words = reinterpret_cast<quint32*>(out);
+    for (size_t i = 0; i < count; ++i) {
+        quint32 bits;
+        std::memcpy(&bits, in + i, sizeof(bits));
+        words[i] = qToBigEndian(bits);
+    }
+}
+
+template <typename Stored>
+void convertScaled(const float* in, uchar* out, size_t count, quint64 firstIndex,
+                   double zero, double inverseScale, bool dither, quint64 seed)
+{
+    // Single precision cannot hold every 32-bit integer
+    using Unsigned = typename std::make_unsigned<Stored>::type;
+    using Real = typename std::conditional<sizeof(Stored) <= 2, float, double>::type;
+    const Real blank = Real(std::numeric_limits<Stored>::min());
+    const Real low = blank + 1;
+    const Real high = Real(std::numeric_limits<Stored>::max());
+    const Real z = Real(zero);
+    const Real k = Real(inverseScale);
+
+    Unsigned* words = reinterpret_cast<Unsigned*>(out);
+    for (size_t i = 0; i < count; ++i) {
+        Real v = in[i];
+        Real scaled = (v - z) * k + (dither ? Real(ditherNoise(seed, firstIndex + i)) : Real(0.5));
+        scaled = std::floor(scaled);
+        scaled = scaled < low ? low : (scaled > high ? high : scaled);
+        Stored s = std::isnan(v) ? Stored(blank) : Stored(scaled);
+        words[i] = qToBigEndian(Unsigned(s));
+    }
+}
+
+} // namespace
+
+bool FITSImageWriter::write(const QString& filePath,
+                            const float* pixels, int width, int height, int channels,
+                            const FITSWriteOptions& options,
+                            const ImageKeywordStore* keywords,
+                            QString* errorMessage)
+{
+    auto fail = [&](const QString& message) {
+        qDebug() << "❌ FITS export:" << message;
+        if (errorMessage) *errorMessage = message;
+        return false;
+    };
+
+    if (!pixels || width <= 0 || height <= 0 || channels <= 0) {
+        return fail("No image data");
+    }
+    if (options.bitpix != 16 && options.bitpix != 32 && options.bitpix != -32) {
+        return fail(QString("Unsupported BITPIX %1").arg(options.bitpix));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const bool integer = options.bitpix > 0;
+    const int bytesPerSample = std::abs(options.bitpix) / 8;
+    const quint64 sampleCount = quint64(width) * height * channels;
+
+    // Integer mapping: dataMin -> lowest non-BLANK value, dataMax -> highest
+    double scale = 1.0, zero = 0.0;
+    if (integer) {
+        double half = options.bitpix == 16 ? 32767.0 : 2147483647.0;
+        double range = options.dataMax - options.dataMin;
+        if (!(range > 0.0)) range = 1.0;
+        scale = range / (2.0 * half);
+        zero = options.dataMin + scale * half;
+    }
+
+    // Header
+    QByteArray header;
+    header += card("SIMPLE", "T", "Conforms to FITS standard");
+    header += card("BITPIX", QString::number(options.bitpix), "Bits per data sample");
+    header += card("NAXIS", QString::number(channels > 1 ? 3 : 2), "Number of axes");
+    header += card("NAXIS1", QString::number(width), "Image width");
+    header += card("NAXIS2", QString::number(height), "Image height");
+    if (channels > 1) {
+        header += card("NAXIS3", QString::number(channels), "Number of channels");
+    }
+    if (integer) {
+        header += card("BZERO", QString::number(zero, 'g', 17), "Physical = BZERO + BSCALE * stored");
+        header += card("BSCALE", QString::number(scale, 'g', 17));
+        header += card("BLANK", QString::number(options.bitpix == 16 ? -32768LL : -2147483648LL),
+                       "Undefined (NaN) samples");
+        if (options.dither) {
+            header += QByteArray("COMMENT Samples were dithered before quantisation").leftJustified(80, ' ');
+        }
+    }
+
+    if (keywords) {
+        // Checksums describe the source HDU and would be wrong for this one
+        static const QSet<QString> structural = {
+            "SIMPLE", "BITPIX", "NAXIS", "NAXIS1", "NAXIS2", "NAXIS3", "EXTEND",
+            "BZERO", "BSCALE", "BLANK", "CHECKSUM", "DATASUM", "END"
+        };
+        for (const ImageKeyword& keyword : keywords->keywords()) {
+            if (structural.contains(keyword.name.toUpper()) || keyword.card.isEmpty()) continue;
+            header += keyword.card.left(80).leftJustified(80, ' ').toLatin1();
+        }
+    }
+    header += QByteArray("END").leftJustified(80, ' ');
+    header += QByteArray((kBlockSize - header.size() % kBlockSize) % kBlockSize, ' ');
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        return fail(QString("Cannot create %1: %2").arg(filePath, file.errorString()));
+    }
+    if (file.write(header) != header.size()) {
+        return fail(QString("Write error: %1").arg(file.errorString()));
+    }
+
+    // Convert chunk k into one buffer while chunk k-1 is written from the other
+    std::vector<uchar> buffers[2];
+    buffers[0].resize(kChunkSamples * bytesPerSample);
+    buffers[1].resize(kChunkSamples * bytesPerSample);
+    QFuture<bool> pending;
+    bool hasPending = false;
+    bool writeOk = true;
+
+    for (quint64 first = 0, chunk = 0; first < sampleCount; first += kChunkSamples, ++chunk) {
+        const size_t count = size_t(std::min<quint64>(kChunkSamples, sampleCount - first));
+        uchar* out = buffers[chunk % 2].data();
+        const float* in = pixels + first;
+
+        Parallel::forRange(count, [&](size_t begin, size_t end) {
+            uchar* target = out + begin * bytesPerSample;
+            switch (options.bitpix) {
+            case 16:
+                convertScaled<qint16>(in + begin, target, end - begin, first + begin,
+                                      zero, 1.0 / scale, options.dither, options.ditherSeed);
+                break;
+            case 32:
+                convertScaled<qint32>(in + begin, target, end - begin, first + begin,
+                                      zero, 1.0 / scale, options.dither, options.ditherSeed);
+                break;
+            default:
+                convertFloat(in + begin, target, end - begin);
+                break;
+            }
+        }, 65536);
+
+        if (hasPending) writeOk = pending.result() && writeOk;
+        if (!writeOk) break;
+
+        const qint64 bytes = qint64(count) * bytesPerSample;
+        pending = QtConcurrent::run([&file, out, bytes]() {
+            return file.write(reinterpret_cast<const char*>(out), bytes) == bytes;
+        });
+        hasPending = true;
+    }
+    if (hasPending) writeOk = pending.result() && writeOk;
+
+    // Data padding to a whole record
+    const qint64 dataBytes = qint64(sampleCount) * bytesPerSample;
+    QByteArray padding((kBlockSize - dataBytes % kBlockSize) % kBlockSize, '\0');
+    if (!writeOk || file.write(padding) != padding.size()) {
+        file.cancelWriting();
+        return fail(QString("Write error: %1").arg(file.errorString()));
+    }
+    if (!file.commit()) {
+        return fail(QString("Cannot finish %1: %2").arg(filePath, file.errorString()));
+    }
+
+    double megabytes = (header.size() + dataBytes + padding.size()) / (1024.0 * 1024.0);
+    qDebug() << QString("💾 Wrote %1 (%2x%3x%4, BITPIX %5, %6 MB) in %7 ms")
+                .arg(filePath).arg(width).arg(height).arg(channels).arg(options.bitpix)
+                .arg(megabytes, 0, 'f', 1).arg(timer.elapsed());
+    return true;
+}
+
+bool FITSImageWriter::write(const QString& filePath, const ImageData& image,
+                            const FITSWriteOptions& options, QString* errorMessage)
+{
+    return write(filePath, image.pixels.constData(), image.width, image.height, image.channels,
+                 options, &image.keywords, errorMessage);
+}
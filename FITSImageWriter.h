@@ -0,0 +1,45 @@
+// FITSImageWriter.h - Fast FITS export of float image planes
+#ifndef FITS_IMAGE_WRITER_H
+#define FITS_IMAGE_WRITER_H
+
+#include <QString>
+#include <QtGlobal>
+
+struct ImageData;
+class ImageKeywordStore;
+
+struct FITSWriteOptions {
+    int bitpix = -32;               // 16, 32 (scaled integers) or -32 (IEEE float)
+
+    // Integer output: [dataMin, dataMax] spans the full integer range and
+    // BZERO/BSCALE restore the original values. The most negative integer
+    // is BLANK (NaN input).
+    double dataMin = 0.0;
+    double dataMax = 1.0;
+
+    // Integer output: add uniform noise of one quantisation step before
+    // rounding, which removes banding in smooth gradients. The sequence is
+    // a function of seed and sample index only, so output is reproducible.
+    bool dither = false;
+    quint32 ditherSeed = 1;
+};
+
+// Writes a primary-HDU FITS image (NAXIS3 = channels for planar colour data).
+// Samples are converted and byte-swapped in parallel chunks into one buffer
+// while the previous chunk is written from another, so export runs at disk
+// speed. The file is replaced atomically.
+class FITSImageWriter
+{
+public:
+    static bool write(const QString& filePath,
+                      const float* pixels, int width, int height, int channels,
+                      const FITSWriteOptions& options = FITSWriteOptions(),
+                      const ImageKeywordStore* keywords = nullptr,
+                      QString* errorMessage = nullptr);
+
+    static bool write(const QString& filePath, const ImageData& image,
+                      const FITSWriteOptions& options = FITSWriteOptions(),
+                      QString* errorMessage = nullptr);
+};
+
+#endif // FITS_IMAGE_WRITER_H
@@ -0,0 +1,321 @@
+// FrameIndex.cpp - Compact on-disk index of frame headers for batch planning
+#include "FrameIndex.h"
+#include "ImageReader.h"
+#include "ParallelFor.h"
+#include "integration/OriginMetadataExtractor.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtMath>
+
+#include <cmath>
+
+namespace {
+
+const quint32 kIndexMagic = 0x46494458;    // "FIDX"
+const quint32 kIndexVersion = 1;
+const qint64 kHashBlockSize = 64 * 1024;
+
+QDataStream& operator<<(QDataStream& out, const ImageKeyword& k)
+{
+    return out << k.name << static_cast<qint32>(k.type) << k.number << k.text
+               << k.boolean << k.comment << k.card;
+}
+
+QDataStream& operator>>(QDataStream& in, ImageKeyword& k)
+{
+    qint32 type = 0;
+    in >> k.name >> type >> k.number >> k.text >> k.boolean >> k.comment >> k.card;
+    k.type = static_cast<ImageKeyword::Type>(type);
+    return in;
+}
+
+QDataStream& operator<<(QDataStream& out, const FrameIndexEntry& e)
+{
+    out << e.filePath << e.fileSize << e.lastModified << e.quickHash
+        << e.format << qint32(e.width) << qint32(e.height) << qint32(e.channels)
+        << e.hasPointing << e.ra << e.dec << e.exposure << e.dateObs;
+
+    out << qint32(e.keywords.size());
+    for (const ImageKeyword& k : e.keywords) out << k;
+
+    const FrameOriginInfo& o = e.origin;
+    out << o.valid << o.objectName << o.centerRA << o.centerDec
+        << o.fieldOfViewX << o.fieldOfViewY << o.exposure
+        << qint32(o.stackedDepth) << o.dateTime;
+    return out;
+}
+
+QDataStream& operator>>(QDataStream& in, FrameIndexEntry& e)
+{
+    qint32 width = 0, height = 0, channels = 0, keywordCount = 0, stackedDepth = 0;
+    in >> e.filePath >> e.fileSize >> e.lastModified >> e.quickHash
+       >> e.format >> width >> height >> channels
+       >> e.hasPointing >> e.ra >> e.dec >> e.exposure >> e.dateObs;
+    e.width = width;
+    e.height = height;
+    e.channels = channels;
+
+    in >> keywordCount;
+    e.keywords.clear();
+    for (qint32 i = 0; i < keywordCount && in.status() == QDataStream::Ok; ++i) {
+        ImageKeyword k;
+        in >> k;
+        e.keywords.append(k);
+    }
+
+    FrameOriginInfo& o = e.origin;
+    in >> o.valid >> o.objectName >> o.centerRA >> o.centerDec
+       >> o.fieldOfViewX >> o.fieldOfViewY >> o.exposure
+       >> stackedDepth >> o.dateTime;
+    o.stackedDepth = stackedDepth;
+    return in;
+}
+
+double angularSeparationDegrees(double ra1, double dec1, double ra2, double dec2)
+{
+    // Haversine form, stable for small separations
+    double d1 = qDegreesToRadians(dec1), d2 = qDegreesToRadians(dec2);
+    double dRa = qDegreesToRadians(ra2 - ra1);
+    double sinDDec = std::sin((d2 - d1) / 2.0);
+    double sinDRa = std::sin(dRa / 2.0);
+    double a = sinDDec * sinDDec + std::cos(d1) * std::cos(d2) * sinDRa * sinDRa;
+    return qRadiansToDegrees(2.0 * std::asin(std::min(1.0, std::sqrt(a))));
+}
+
+} // namespace
+
+QStringList FrameIndex::imageFileFilters()
+{
+    return {"*.xisf", "*.fits", "*.fit", "*.fts", "*.tiff", "*.tif"};
+}
+
+QByteArray FrameIndex::computeQuickHash(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    // Size plus the first and last blocks: headers and trailing data both
+    // change when a frame is rewritten, without reading whole files
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    qint64 size = file.size();
+    hash.addData(QByteArray::number(size));
+    hash.addData(file.read(kHashBlockSize));
+    if (size > 2 * kHashBlockSize) {
+        file.seek(size - kHashBlockSize);
+        hash.addData(file.read(kHashBlockSize));
+    }
+    return hash.result();
+}
+
+bool FrameIndex::indexFile(const QString& filePath, FrameIndexEntry& entry, QString* error)
+{
+    QFileInfo info(filePath);
+    entry = FrameIndexEntry();
+    entry.filePath = info.absoluteFilePath();
+    entry.fileSize = info.size();
+    entry.lastModified = info.lastModified();
+    entry.quickHash = computeQuickHash(filePath);
+
+    ImageReader reader;
+    if (!reader.readHeader(filePath)) {
+        if (error) *error = QString("%1: %2").arg(filePath, reader.lastError());
+        return false;
+    }
+
+    const ImageData& header = reader.imageData();
+    entry.format = header.format;
+    entry.width = header.width;
+    entry.height = header.height;
+    entry.channels = header.channels;
+    entry.keywords = header.keywords.keywords();
+    entry.hasPointing = header.keywords.pointingHint(entry.ra, entry.dec);
+    entry.exposure = header.keywords.firstNumber({"EXPTIME", "EXPOSURE", "OBSERVATION:EXPOSURETIME"});
+    entry.dateObs = header.keywords.string("DATE-OBS");
+
+    if (entry.format == "TIFF") {
+        OriginMetadataExtractor extractor;
+        if (extractor.extractFromTIFFFile(filePath.toStdString()) && extractor.hasValidMetadata()) {
+            const OriginTelescopeMetadata& m = extractor.getMetadata();
+            FrameOriginInfo& o = entry.origin;
+            o.valid = true;
+            o.objectName = QString::fromStdString(m.objectName);
+            o.centerRA = m.centerRA;
+            o.centerDec = m.centerDec;
+            o.fieldOfViewX = m.fieldOfViewX;
+            o.fieldOfViewY = m.fieldOfViewY;
+            o.exposure = m.getExposurePerFrame();
+            o.stackedDepth = m.stackedDepth;
+            o.dateTime = QString::fromStdString(m.dateTime);
+
+            if (!entry.hasPointing) {
+                entry.hasPointing = true;
+                entry.ra = o.centerRA;
+                entry.dec = o.centerDec;
+            }
+            if (entry.exposure <= 0.0) entry.exposure = o.exposure;
+            if (entry.dateObs.isEmpty()) entry.dateObs = o.dateTime;
+        }
+    }
+
+    return true;
+}
+
+FrameIndex FrameIndex::build(const QString& directory,
+                             bool recursive,
+                             const FrameIndex* previous,
+                             ProgressCallback progress,
+                             const std::atomic<bool>* cancel)
+{
+    QStringList files;
+    QDirIterator it(directory, imageFileFilters(), QDir::Files,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) {
+        files.append(it.next());
+    }
+
+    const int total = files.size();
+    QVector<FrameIndexEntry> entries(total);
+    QVector<bool> ok(total, false);
+    QVector<QString> errors(total);
+    std::atomic<int> done(0);
+
+    // One file per work item; header opens are I/O bound and independent
+    Parallel::forChunks(total, Parallel::chunkCount(total, 1), [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (cancel && cancel->load()) return;
+
+            const QString& path = files[i];
+            QFileInfo info(path);
+            const FrameIndexEntry* cached = previous ? previous->find(info.absoluteFilePath()) : nullptr;
+
+            if (cached && cached->fileSize == info.size() && cached->lastModified == info.lastModified()) {
+                entries[i] = *cached;
+                ok[i] = true;
+            } else {
+                ok[i] = indexFile(path, entries[i], &errors[i]);
+            }
+
+            int count = ++done;
+            if (progress) progress(count, total);
+        }
+    });
+
+    FrameIndex index;
+    for (int i = 0; i < total; ++i) {
+        if (ok[i]) {
+            index.m_entries.append(entries[i]);
+        } else if (!errors[i].isEmpty()) {
+            index.m_errors.append(errors[i]);
+        }
+    }
+    index.rebuildLookup();
+
+    qDebug() << "Indexed" << index.size() << "of" << total << "frames in" << directory;
+    return index;
+}
+
+bool FrameIndex::save(const QString& indexPath) const
+{
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write frame index:" << indexPath;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kIndexMagic << kIndexVersion << qint32(m_entries.size());
+    for (const FrameIndexEntry& entry : m_entries) {
+        out << entry;
+    }
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool FrameIndex::load(const QString& indexPath)
+{
+    clear();
+
+    QFile file(indexPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    qint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != kIndexMagic || version != kIndexVersion || count < 0) {
+        qDebug() << "Not a frame index (or unsupported version):" << indexPath;
+        return false;
+    }
+
+    m_entries.reserve(count);
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        FrameIndexEntry entry;
+        in >> entry;
+        m_entries.append(entry);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        clear();
+        return false;
+    }
+
+    rebuildLookup();
+    return true;
+}
+
+const FrameIndexEntry* FrameIndex::find(const QString& filePath) const
+{
+    auto it = m_byPath.constFind(filePath);
+    return it == m_byPath.constEnd() ? nullptr : &m_entries[it.value()];
+}
+
+const FrameIndexEntry* FrameIndex::findByHash(const QByteArray& quickHash) const
+{
+    auto it = m_byHash.constFind(quickHash);
+    return it == m_byHash.constEnd() ? nullptr : &m_entries[it.value()];
+}
+
+QVector<FrameIndexEntry> FrameIndex::framesNear(double ra, double dec, double radiusDegrees) const
+{
+    QVector<FrameIndexEntry> result;
+    for (const FrameIndexEntry& entry : m_entries) {
+        if (entry.hasPointing &&
+            angularSeparationDegrees(ra, dec, entry.ra, entry.dec) <= radiusDegrees) {
+            result.append(entry);
+        }
+    }
+    return result;
+}
+
+void FrameIndex::clear()
+{
+    m_entries.clear();
+    m_byPath.clear();
+    m_byHash.clear();
+    m_errors.clear();
+}
+
+void FrameIndex::rebuildLookup()
+{
+    m_byPath.clear();
+    m_byHash.clear();
+    for (int i = 0; i < m_entries.size(); ++i) {
+        m_byPath.insert(m_entries[i].filePath, i);
+        if (!m_entries[i].quickHash.isEmpty()) {
+            m_byHash.insert(m_entries[i].quickHash, i);
+        }
+    }
+}
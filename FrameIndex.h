@@ -0,0 +1,97 @@
+// FrameIndex.h - Compact on-disk index of frame headers for batch planning
+#ifndef FRAME_INDEX_H
+#define FRAME_INDEX_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <functional>
+
+#include "ImageKeywords.h"
+
+// Origin telescope metadata carried by Origin TIFF files
+struct FrameOriginInfo {
+    bool valid = false;
+    QString objectName;
+    double centerRA = 0.0;          // degrees
+    double centerDec = 0.0;         // degrees
+    double fieldOfViewX = 0.0;      // degrees
+    double fieldOfViewY = 0.0;      // degrees
+    double exposure = 0.0;          // seconds
+    int stackedDepth = 0;
+    QString dateTime;
+};
+
+// Everything the batch tools need to know about one frame, gathered from a
+// header-only open
+struct FrameIndexEntry {
+    QString filePath;
+    qint64 fileSize = 0;
+    QDateTime lastModified;
+    QByteArray quickHash;           // SHA-1 of size + first and last 64 KiB
+
+    QString format;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    // Pointing and exposure resolved from keywords or Origin metadata
+    bool hasPointing = false;
+    double ra = 0.0;                // degrees
+    double dec = 0.0;               // degrees
+    double exposure = 0.0;          // seconds
+    QString dateObs;
+
+    QList<ImageKeyword> keywords;
+    FrameOriginInfo origin;
+};
+
+class FrameIndex
+{
+public:
+    using ProgressCallback = std::function<void(int done, int total)>;
+
+    // Crawl a directory on the thread pool with header-only opens. Entries of
+    // `previous` whose size and modification time are unchanged are reused
+    // without touching the file.
+    static FrameIndex build(const QString& directory,
+                            bool recursive = true,
+                            const FrameIndex* previous = nullptr,
+                            ProgressCallback progress = ProgressCallback(),
+                            const std::atomic<bool>* cancel = nullptr);
+
+    // Index a single file (header-only); returns false if it is unreadable
+    static bool indexFile(const QString& filePath, FrameIndexEntry& entry, QString* error = nullptr);
+    static QByteArray computeQuickHash(const QString& filePath);
+
+    // Binary index file
+    bool save(const QString& indexPath) const;
+    bool load(const QString& indexPath);
+
+    // Queries
+    const QVector<FrameIndexEntry>& entries() const { return m_entries; }
+    const FrameIndexEntry* find(const QString& filePath) const;
+    const FrameIndexEntry* findByHash(const QByteArray& quickHash) const;
+    QVector<FrameIndexEntry> framesNear(double ra, double dec, double radiusDegrees) const;
+
+    QStringList errors() const { return m_errors; }
+    int size() const { return m_entries.size(); }
+    bool isEmpty() const { return m_entries.isEmpty(); }
+    void clear();
+
+    static QStringList imageFileFilters();
+
+private:
+    void rebuildLookup();
+
+    QVector<FrameIndexEntry> m_entries;
+    QHash<QString, int> m_byPath;
+    QHash<QByteArray, int> m_byHash;
+    QStringList m_errors;
+};
+
+#endif // FRAME_INDEX_H
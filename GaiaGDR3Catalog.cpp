@@ -1,4 +1,7 @@
 #include "GaiaGDR3Catalog.h"
+#include "EpochPropagator.h"
+#include "GaiaMagnitudeSummary.h"
+#include "GaiaQuadIndex.h"
 
 // Initialize PCL Mock API before including PCL headers
 #include "PCLMockAPI.h"
@@ -11,6 +14,11 @@
 
 #include <QMutexLocker>
 #include <QApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QStandardPaths>
+#include <QStringList>
 #include <cmath>
 #include <algorithm>
 
@@ -19,12 +27,35 @@ QString GaiaGDR3Catalog::s_catalogPath;
 std::unique_ptr<pcl::GaiaDatabaseFile> GaiaGDR3Catalog::s_database;
 QMutex GaiaGDR3Catalog::s_databaseMutex;
 bool GaiaGDR3Catalog::s_isInitialized = false;
+GaiaMagnitudeSummary GaiaGDR3Catalog::s_summary;
+bool GaiaGDR3Catalog::s_summaryLoaded = false;
+bool GaiaGDR3Catalog::s_summaryDirty = false;
+
+namespace {
+
+// Tile sampling: stars down to this magnitude are counted over the whole
+// tile, fainter ones in a small cone at its centre
+const double kSummarySplitMagnitude = 12.0;
+const double kSummaryDeepRadius = 0.15;
+
+double coneAreaDegrees(double radiusDegrees)
+{
+    const double degreesPerRadian = 180.0 / M_PI;
+    return 2.0 * M_PI * (1.0 - std::cos(radiusDegrees / degreesPerRadian)) * degreesPerRadian * degreesPerRadian;
+}
+
+} // namespace
 
 void GaiaGDR3Catalog::setCatalogPath(const QString& path)
 {
     QMutexLocker locker(&s_databaseMutex);
+    if (s_summaryDirty) {
+        saveSummaryLocked();
+    }
     s_catalogPath = path;
     s_isInitialized = false;
+    s_summaryLoaded = false;
+    s_summary.clear();
     
     // Close existing database
     if (s_database) {
@@ -135,16 +166,34 @@ bool GaiaGDR3Catalog::initializeDatabase()
 QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::queryRegion(const SearchParameters& params)
 {
     QMutexLocker locker(&s_databaseMutex);
-    QVector<Star> stars;
     
     if (!initializeDatabase()) {
         qDebug() << "❌ Failed to initialize Gaia database";
-        return stars;
+        return QVector<Star>();
     }
     
-    qDebug() << QString("🔍 Querying Gaia GDR3: RA=%1° Dec=%2° radius=%3° mag≤%4")
-                .arg(params.centerRA).arg(params.centerDec)
-                .arg(params.radiusDegrees).arg(params.maxMagnitude);
+    QVector<Star> stars = params.targetCount > 0 ? queryTargetCountLocked(params)
+                                                 : searchLocked(params, true);
+    
+    // Epoch propagation needs no database access
+    QString catalogPath = s_catalogPath;
+    locker.unlock();
+    propagateToEpoch(stars, params, catalogPath);
+    return stars;
+}
+
+QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::searchLocked(const SearchParameters& params, bool verbose,
+                                                            bool* failed, bool* truncated)
+{
+    QVector<Star> stars;
+    if (failed) *failed = true;
+    if (truncated) *truncated = false;
+    
+    if (verbose) {
+        qDebug() << QString("🔍 Querying Gaia GDR3: RA=%1° Dec=%2° radius=%3° mag≤%4")
+                    .arg(params.centerRA).arg(params.centerDec)
+                    .arg(params.radiusDegrees).arg(params.maxMagnitude);
+    }
     
     auto startTime = QTime::currentTime();
     
@@ -168,13 +217,17 @@ QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::queryRegion(const SearchParamete
         
         // Perform the search
         s_database->Search(searchData);
+        if (failed) *failed = false;
+        if (truncated) *truncated = searchData.stars.Length() >= size_t(params.maxResults);
         
-        qDebug() << QString("📊 Gaia search completed in %1 ms")
-                    .arg(searchData.timeTotal * 1000.0);
-        qDebug() << QString("📊 Decode time: %1 ms")
-                    .arg(searchData.timeDecode * 1000.0);
-        qDebug() << QString("📊 Raw results: %1 stars")
-                    .arg(searchData.stars.Length());
+        if (verbose) {
+            qDebug() << QString("📊 Gaia search completed in %1 ms")
+                        .arg(searchData.timeTotal * 1000.0);
+            qDebug() << QString("📊 Decode time: %1 ms")
+                        .arg(searchData.timeDecode * 1000.0);
+            qDebug() << QString("📊 Raw results: %1 stars")
+                        .arg(searchData.stars.Length());
+        }
         
         // Convert PCL results to our format
         stars.reserve(searchData.stars.Length());
@@ -200,11 +253,6 @@ QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::queryRegion(const SearchParamete
             // Derive spectral class from colors
             star.spectralClass = deriveSpectralClass(star.magBP, star.magRP, star.magnitude);
             
-            // Apply proper motion correction if requested
-            if (params.useProperMotion && params.epochYear != 2016.0) {
-                applyProperMotion(star, params.epochYear);
-            }
-            
             // Apply quality filters
             if (params.requireSpectrum && !star.hasSpectrum) {
                 continue;
@@ -220,10 +268,12 @@ QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::queryRegion(const SearchParamete
         
         auto elapsed = startTime.msecsTo(QTime::currentTime());
         
-        qDebug() << QString("✅ Gaia query completed in %1ms").arg(elapsed);
-        qDebug() << QString("📈 Final results: %1 stars").arg(stars.size());
+        if (verbose) {
+            qDebug() << QString("✅ Gaia query completed in %1ms").arg(elapsed);
+            qDebug() << QString("📈 Final results: %1 stars").arg(stars.size());
+        }
         
-        if (!stars.isEmpty()) {
+        if (verbose && !stars.isEmpty()) {
             double brightestMag = stars[0].magnitude;
             double faintestMag = stars[0].magnitude;
             int withSpectra = 0;
@@ -256,6 +306,287 @@ QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::queryRegion(const SearchParamete
     return stars;
 }
 
+QString GaiaGDR3Catalog::summaryPath()
+{
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(directory);
+    return QDir(directory).filePath(QFileInfo(s_catalogPath).completeBaseName() + ".gmhs");
+}
+
+void GaiaGDR3Catalog::loadSummaryLocked()
+{
+    if (s_summaryLoaded) {
+        return;
+    }
+    s_summaryLoaded = true;
+    s_summaryDirty = false;
+    if (s_summary.load(summaryPath())) {
+        qDebug() << "📊 Magnitude summary:" << s_summary.sampledTileCount() << "tiles sampled";
+    }
+}
+
+void GaiaGDR3Catalog::saveSummaryLocked()
+{
+    if (s_summary.save(summaryPath())) {
+        s_summaryDirty = false;
+    }
+}
+
+bool GaiaGDR3Catalog::sampleTileLocked(int tile)
+{
+    double tileRA, tileDec, tileRadius;
+    GaiaMagnitudeSummary::tileCircle(tile, tileRA, tileDec, tileRadius);
+    
+    QVector<float> density(GaiaMagnitudeSummary::BinCount, 0.0f);
+    
+    // Bright end: every star in the tile's circle
+    SearchParameters wide(tileRA, tileDec, tileRadius, kSummarySplitMagnitude);
+    wide.maxResults = 1000000;
+    bool failed, truncated;
+    QVector<Star> bright = searchLocked(wide, false, &failed, &truncated);
+    if (failed || truncated) {
+        qDebug() << "❌ Magnitude summary: bright sample of tile" << tile << (failed ? "failed" : "truncated");
+        return false;
+    }
+    float wideWeight = static_cast<float>(1.0 / coneAreaDegrees(tileRadius));
+    for (const Star& star : bright) {
+        density[GaiaMagnitudeSummary::binForMagnitude(star.magnitude)] += wideWeight;
+    }
+    
+    // Faint end: a small cone scaled up to the density per square degree
+    SearchParameters deep(tileRA, tileDec, kSummaryDeepRadius, s_database->MagnitudeHigh());
+    deep.minMagnitude = kSummarySplitMagnitude;
+    deep.maxResults = 2000000;
+    QVector<Star> faint = searchLocked(deep, false, &failed, &truncated);
+    if (failed || truncated) {
+        qDebug() << "❌ Magnitude summary: faint sample of tile" << tile << (failed ? "failed" : "truncated");
+        return false;
+    }
+    float deepWeight = static_cast<float>(1.0 / coneAreaDegrees(kSummaryDeepRadius));
+    for (const Star& star : faint) {
+        if (star.magnitude > kSummarySplitMagnitude) {
+            density[GaiaMagnitudeSummary::binForMagnitude(star.magnitude)] += deepWeight;
+        }
+    }
+    
+    // Only complete samples are stored; a failed tile is tried again next time
+    s_summary.setTile(tile, density);
+    s_summaryDirty = true;
+    return true;
+}
+
+bool GaiaGDR3Catalog::buildMagnitudeSummary(std::function<void(int done, int total)> progress,
+                                            const std::atomic<bool>* cancel)
+{
+    QMutexLocker locker(&s_databaseMutex);
+    
+    if (!initializeDatabase()) {
+        return false;
+    }
+    loadSummaryLocked();
+    
+    const int total = GaiaMagnitudeSummary::tileCount();
+    for (int tile = 0; tile < total; ++tile) {
+        if (cancel && cancel->load()) {
+            break;
+        }
+        if (!s_summary.hasTile(tile)) {
+            sampleTileLocked(tile);
+        }
+        if (progress) {
+            progress(tile + 1, total);
+        }
+    }
+    
+    saveSummaryLocked();
+    return s_summary.sampledTileCount() == total;
+}
+
+QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::queryTargetCountLocked(const SearchParameters& params)
+{
+    QElapsedTimer timer;
+    timer.start();
+    loadSummaryLocked();
+    
+    // Area of the cone falling in each tile, from a grid on the tangent plane
+    const int grid = 32;
+    const double radiusArcsec = params.radiusDegrees * 3600.0;
+    QMap<int, QVector<QPointF>> gridPoints;
+    int gridTotal = 0;
+    for (int i = 0; i < grid; ++i) {
+        for (int j = 0; j < grid; ++j) {
+            QPointF plane(((i + 0.5) / grid * 2.0 - 1.0) * radiusArcsec,
+                          ((j + 0.5) / grid * 2.0 - 1.0) * radiusArcsec);
+            if (std::hypot(plane.x(), plane.y()) > radiusArcsec) continue;
+            double ra, dec;
+            GaiaQuadIndex::deprojectGnomonic(plane, params.centerRA, params.centerDec, ra, dec);
+            gridPoints[GaiaMagnitudeSummary::tileForPosition(ra, dec)].append(plane);
+            ++gridTotal;
+        }
+    }
+    const double gridHalfDiagonal = radiusArcsec / grid * std::sqrt(2.0);
+    
+    struct TilePlan {
+        int tile;
+        double area;
+        double quota;
+        double magnitude;
+        double ra, dec, radius;     // Circle around the tile's part of the field
+    };
+    const double coneArea = coneAreaDegrees(params.radiusDegrees);
+    const double wanted = params.targetCount * 1.1;  // Margin for histogram noise
+    QVector<TilePlan> plans;
+    for (auto it = gridPoints.constBegin(); it != gridPoints.constEnd(); ++it) {
+        if (!s_summary.hasTile(it.key())) {
+            sampleTileLocked(it.key());
+        }
+        
+        // Query only tile ∩ field: the circle around the tile's grid cells,
+        // unless the tile's own circle is smaller
+        const QVector<QPointF>& points = it.value();
+        QPointF centre;
+        for (const QPointF& point : points) centre += point;
+        centre /= points.size();
+        double reach = 0.0;
+        for (const QPointF& point : points) {
+            reach = std::max(reach, std::hypot(point.x() - centre.x(), point.y() - centre.y()));
+        }
+        
+        TilePlan plan{it.key(), coneArea * points.size() / gridTotal, 0.0, params.maxMagnitude, 0.0, 0.0, 0.0};
+        GaiaQuadIndex::deprojectGnomonic(centre, params.centerRA, params.centerDec, plan.ra, plan.dec);
+        plan.radius = (reach + gridHalfDiagonal) / 3600.0;
+        
+        double tileRA, tileDec, tileRadius;
+        GaiaMagnitudeSummary::tileCircle(plan.tile, tileRA, tileDec, tileRadius);
+        if (tileRadius < plan.radius) {
+            plan.ra = tileRA;
+            plan.dec = tileDec;
+            plan.radius = tileRadius;
+        }
+        plans.append(plan);
+    }
+    
+    if (params.uniformTiles) {
+        for (TilePlan& plan : plans) {
+            plan.quota = wanted * plan.area / coneArea;
+            plan.magnitude = s_summary.magnitudeForCount(plan.tile, plan.area, plan.quota, params.maxMagnitude);
+        }
+    } else {
+        // One limit for the whole field: bisect on the expected total
+        double low = params.minMagnitude, high = params.maxMagnitude;
+        for (int iteration = 0; iteration < 30; ++iteration) {
+            double middle = 0.5 * (low + high), expected = 0.0;
+            for (const TilePlan& plan : plans) {
+                expected += s_summary.expectedCount(plan.tile, plan.area, middle);
+            }
+            if (expected < wanted) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        for (TilePlan& plan : plans) {
+            plan.magnitude = high;
+            plan.quota = std::max(1.0, s_summary.expectedCount(plan.tile, plan.area, high));
+        }
+    }
+    
+    // Query tile by tile; the source limit stops decoding once a tile has
+    // clearly passed its quota, and the limit is corrected if the summary
+    // was off. A result that hits the source limit is an arbitrary subset,
+    // so it is never used: the limit is tightened until the query completes
+    QVector<Star> stars;
+    int queries = 0;
+    bool failed = false;
+    for (const TilePlan& plan : plans) {
+        SearchParameters sub = params;
+        sub.targetCount = 0;
+        sub.centerRA = plan.ra;
+        sub.centerDec = plan.dec;
+        sub.radiusDegrees = plan.radius;
+        // The query circle also holds stars of neighbouring tiles
+        double overlap = std::max(1.0, coneAreaDegrees(plan.radius) / std::max(plan.area, 1e-9));
+        sub.maxResults = std::max(500, static_cast<int>(4.0 * plan.quota * overlap));
+        
+        double magnitude = plan.magnitude;
+        bool tightened = false, complete = false;
+        int widenings = 0;
+        QVector<Star> kept;
+        for (int attempt = 0; attempt < 24 && !complete; ++attempt) {
+            sub.maxMagnitude = magnitude;
+            bool searchFailed, truncated;
+            QVector<Star> found = searchLocked(sub, false, &searchFailed, &truncated);
+            ++queries;
+            if (searchFailed) {
+                break;
+            }
+            
+            if (truncated) {
+                tightened = true;
+                if (magnitude - 0.5 >= params.minMagnitude) {
+                    magnitude -= 0.5;
+                } else {
+                    sub.maxResults *= 2;
+                }
+                continue;
+            }
+            
+            kept.clear();
+            for (const Star& star : found) {
+                if (GaiaMagnitudeSummary::tileForPosition(star.ra, star.dec) == plan.tile &&
+                    calculateAngularSeparation(params.centerRA, params.centerDec, star.ra, star.dec) <=
+                        params.radiusDegrees) {
+                    kept.append(star);
+                }
+            }
+            
+            // Too few: go deeper, unless a deeper query already overflowed
+            if (!tightened && kept.size() < 0.8 * plan.quota &&
+                magnitude < params.maxMagnitude && widenings < 3) {
+                magnitude = std::min(params.maxMagnitude, magnitude + 1.0);
+                ++widenings;
+                continue;
+            }
+            complete = true;
+        }
+        
+        if (!complete) {
+            qDebug() << "❌ Target-count query: tile" << plan.tile << "did not complete";
+            failed = true;
+            break;
+        }
+        
+        // Brightest first (searchLocked sorts); uniform mode keeps the quota
+        if (params.uniformTiles && kept.size() > std::ceil(plan.quota)) {
+            kept.resize(static_cast<int>(std::ceil(plan.quota)));
+        }
+        stars += kept;
+    }
+    
+    if (failed) {
+        if (s_summaryDirty) {
+            saveSummaryLocked();
+        }
+        return QVector<Star>();
+    }
+    
+    std::sort(stars.begin(), stars.end(), [](const Star& a, const Star& b) {
+        return a.magnitude < b.magnitude;
+    });
+    if (stars.size() > params.targetCount) {
+        stars.resize(params.targetCount);
+    }
+    
+    if (s_summaryDirty) {
+        saveSummaryLocked();
+    }
+    
+    qDebug() << QString("🎯 Target-count query: %1 of %2 stars from %3 tiles (%4 searches) in %5ms")
+                .arg(stars.size()).arg(params.targetCount).arg(plans.size())
+                .arg(queries).arg(timer.elapsed());
+    return stars;
+}
+
 QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::queryRegion(double centerRA, double centerDec, 
                                                            double radiusDegrees, double maxMagnitude)
 {
@@ -266,8 +597,11 @@ QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::queryRegion(double centerRA, dou
 QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::findBrightestStars(double centerRA, double centerDec,
                                                                   double radiusDegrees, int count)
 {
+    // Let the magnitude summary pick the limit instead of decoding the
+    // whole field down to 20th magnitude
     SearchParameters params(centerRA, centerDec, radiusDegrees, 20.0);
-    params.maxResults = count * 5; // Search more to ensure we get the brightest
+    params.targetCount = count;
+    params.uniformTiles = false;
     
     QVector<Star> allStars = queryRegion(params);
     
@@ -287,6 +621,88 @@ QVector<GaiaGDR3Catalog::Star> GaiaGDR3Catalog::findStarsWithSpectra(double cent
     return queryRegion(params);
 }
 
+GaiaGDR3Catalog::SpectrumGrid GaiaGDR3Catalog::spectrumGrid()
+{
+    QMutexLocker locker(&s_databaseMutex);
+    SpectrumGrid grid;
+    
+    if (initializeDatabase() && s_database->HasMeanSpectrumData()) {
+        grid.startNm = s_database->SpectrumStart();
+        grid.stepNm = s_database->SpectrumStep();
+        grid.count = s_database->SpectrumCount();
+    }
+    return grid;
+}
+
+QVector<QVector<float>> GaiaGDR3Catalog::fetchSpectra(const QVector<QPointF>& positions, double radiusArcsec,
+                                                     const QVector<double>& magnitudes,
+                                                     double maxMagnitudeDifference)
+{
+    QMutexLocker locker(&s_databaseMutex);
+    QVector<QVector<float>> spectra(positions.size());
+    
+    if (!initializeDatabase() || !s_database->HasMeanSpectrumData()) {
+        return spectra;
+    }
+    
+    auto startTime = QTime::currentTime();
+    int found = 0;
+    
+    for (int i = 0; i < positions.size(); ++i) {
+        try {
+            // A search this small decodes only the records of the star itself
+            pcl::GaiaSearchData searchData;
+            searchData.centerRA = positions[i].x();
+            searchData.centerDec = positions[i].y();
+            searchData.radius = radiusArcsec / 3600.0;
+            searchData.magnitudeLow = -2.0;
+            searchData.magnitudeHigh = 99.0;
+            searchData.sourceLimit = 16;
+            searchData.normalizeSpectrum = true;
+            searchData.photonFluxUnits = false;
+            
+            s_database->Search(searchData);
+            
+            // The counterpart is the nearest star whether or not it has a
+            // spectrum; a neighbour's spectrum would give the wrong colour
+            int nearest = -1;
+            double nearestDistance = 0.0;
+            for (size_t k = 0; k < searchData.stars.Length(); ++k) {
+                const auto& pclStar = searchData.stars[k];
+                double distance = calculateAngularSeparation(positions[i].x(), positions[i].y(),
+                                                             pclStar.ra, pclStar.dec);
+                if (nearest < 0 || distance < nearestDistance) {
+                    nearest = int(k);
+                    nearestDistance = distance;
+                }
+            }
+            
+            if (nearest >= 0 && i < magnitudes.size() &&
+                std::abs(searchData.stars[nearest].magG - magnitudes[i]) > maxMagnitudeDifference) {
+                nearest = -1;
+            }
+            
+            if (nearest >= 0 && !searchData.stars[nearest].flux.IsEmpty()) {
+                const auto& flux = searchData.stars[nearest].flux;
+                QVector<float>& spectrum = spectra[i];
+                spectrum.resize(int(flux.Length()));
+                for (size_t k = 0; k < flux.Length(); ++k) {
+                    spectrum[int(k)] = flux[k];
+                }
+                ++found;
+            }
+        } catch (const pcl::Exception& e) {
+            qDebug() << "❌ PCL Exception fetching spectrum:" << e.Message().c_str();
+        } catch (...) {
+            qDebug() << "❌ Unknown exception fetching spectrum";
+        }
+    }
+    
+    qDebug() << QString("🌈 Fetched %1 of %2 BP/RP spectra in %3ms")
+                .arg(found).arg(positions.size()).arg(startTime.msecsTo(QTime::currentTime()));
+    return spectra;
+}
+
 QString GaiaGDR3Catalog::deriveSpectralClass(double bpMag, double rpMag, double gMag)
 {
     // Simplified spectral classification based on BP-RP color
@@ -306,32 +722,44 @@ QString GaiaGDR3Catalog::deriveSpectralClass(double bpMag, double rpMag, double
     else return "M";
 }
 
-void GaiaGDR3Catalog::applyProperMotion(Star& star, double targetEpoch)
+void GaiaGDR3Catalog::propagateToEpoch(QVector<Star>& stars, const SearchParameters& params,
+                                       const QString& catalogPath)
 {
-    // Gaia DR3 epoch is 2016.0
-    const double gaiaEpoch = 2016.0;
-    double deltaYears = targetEpoch - gaiaEpoch;
-    
-    if (std::abs(deltaYears) < 0.01) {
-        return; // No significant time difference
+    EpochPropagationOptions options;
+    options.referenceEpoch = 2016.0;    // Gaia DR3 epoch
+    options.targetEpoch = params.useProperMotion ? params.epochYear : options.referenceEpoch;
+    options.observationEpoch = params.epochYear;
+    options.applyParallax = params.applyParallax;
+    options.applyAberration = params.applyAberration;
+    
+    if (stars.isEmpty() || options.isIdentity()) {
+        return;
     }
     
-    // Apply proper motion correction
-    // Convert proper motion from mas/year to degrees/year
-    double pmRA_deg = star.pmRA / (3600.0 * 1000.0);  // mas to degrees
-    double pmDec_deg = star.pmDec / (3600.0 * 1000.0);
+    AstrometricArrays arrays;
+    arrays.resize(stars.size());
+    for (int i = 0; i < stars.size(); ++i) {
+        arrays.ra[i] = stars[i].ra;
+        arrays.dec[i] = stars[i].dec;
+        arrays.pmRA[i] = stars[i].pmRA;
+        arrays.pmDec[i] = stars[i].pmDec;
+        arrays.parallax[i] = stars[i].parallax;
+    }
     
-    // Apply proper motion with cos(declination) correction for RA
-    double cosDec = std::cos(star.dec * M_PI / 180.0);
-    star.ra += (pmRA_deg * deltaYears) / cosDec;
-    star.dec += pmDec_deg * deltaYears;
+    // Key on the stars themselves: truncated and target-count queries can
+    // return different sets for the same parameters
+    size_t key = qHash(catalogPath);
+    for (const QVector<double>* values : {&arrays.ra, &arrays.dec, &arrays.pmRA, &arrays.pmDec, &arrays.parallax}) {
+        key = qHashBits(values->constData(), size_t(values->size()) * sizeof(double), key);
+    }
     
-    // Normalize RA to [0, 360)
-    while (star.ra < 0) star.ra += 360.0;
-    while (star.ra >= 360) star.ra -= 360.0;
+    QVector<double> ra, dec;
+    EpochPropagator::propagate(arrays, options, ra, dec, quint64(key) | 1);
     
-    // Clamp declination to [-90, 90]
-    star.dec = std::max(-90.0, std::min(90.0, star.dec));
+    for (int i = 0; i < stars.size(); ++i) {
+        stars[i].ra = ra[i];
+        stars[i].dec = dec[i];
+    }
 }
 
 bool GaiaGDR3Catalog::hasGoodAstrometry(const Star& star)
@@ -429,6 +857,9 @@ bool GaiaGDR3Catalog::validateDatabase()
 
 void GaiaGDR3Catalog::cleanupDatabase()
 {
+    if (s_summaryDirty) {
+        saveSummaryLocked();
+    }
     if (s_database) {
         s_database.reset();
         s_isInitialized = false;
@@ -7,6 +7,9 @@
 #include <QTime>
 #include <QFileInfo>
 #include <QMutex>
+#include <QPointF>
+#include <atomic>
+#include <functional>
 #include <memory>
 
 // Forward declare PCL classes to avoid including in header
@@ -14,6 +17,7 @@ namespace pcl {
     class GaiaDatabaseFile;
     struct GaiaSearchData;
 }
+class GaiaMagnitudeSummary;
 
 class GaiaGDR3Catalog
 {
@@ -49,9 +53,18 @@ public:
         bool requireSpectrum = false;
         bool useProperMotion = false;    // Apply proper motion to current epoch
         double epochYear = 2025.5;       // Target epoch for proper motion
+        bool applyParallax = false;      // Geocentric positions at epochYear
+        bool applyAberration = false;    // Apparent positions at epochYear
         uint32_t requiredFlags = 0;      // Quality flag requirements
         uint32_t exclusionFlags = 0;     // Quality flags to exclude
         
+        // When > 0 the magnitude limit is chosen from the per-tile magnitude
+        // summary so that about this many stars are returned; maxMagnitude
+        // becomes the faintest limit allowed. With uniformTiles the count is
+        // shared out by area, otherwise the brightest stars overall are kept.
+        int targetCount = 0;
+        bool uniformTiles = true;
+        
         SearchParameters() = default;
         SearchParameters(double ra, double dec, double radius, double magLimit = 20.0)
             : centerRA(ra), centerDec(dec), radiusDegrees(radius), maxMagnitude(magLimit) {}
@@ -62,12 +75,25 @@ private:
     static std::unique_ptr<pcl::GaiaDatabaseFile> s_database;
     static QMutex s_databaseMutex;
     static bool s_isInitialized;
+    static GaiaMagnitudeSummary s_summary;
+    static bool s_summaryLoaded;
+    static bool s_summaryDirty;
     
     // Internal methods
     static bool initializeDatabase();
     static void cleanupDatabase();
     static QString deriveSpectralClass(double bpMag, double rpMag, double gMag);
-    static void applyProperMotion(Star& star, double targetEpoch);
+    static void propagateToEpoch(QVector<Star>& stars, const SearchParameters& params,
+                                 const QString& catalogPath);
+    // failed: the search threw; truncated: it stopped at maxResults, so the
+    // result is an arbitrary subset of the matching stars
+    static QVector<Star> searchLocked(const SearchParameters& params, bool verbose,
+                                      bool* failed = nullptr, bool* truncated = nullptr);
+    static QVector<Star> queryTargetCountLocked(const SearchParameters& params);
+    static QString summaryPath();
+    static void loadSummaryLocked();
+    static void saveSummaryLocked();
+    static bool sampleTileLocked(int tile);
     
 public:
     // Static interface methods
@@ -88,6 +114,31 @@ public:
     static QVector<Star> findStarsWithSpectra(double centerRA, double centerDec,
                                             double radiusDegrees, double maxMagnitude = 15.0);
     
+    // BP/RP mean spectra, fetched on demand for individual stars rather than
+    // for whole regions. Flux samples are per nm on the grid below.
+    struct SpectrumGrid {
+        double startNm = 0.0;
+        double stepNm = 0.0;
+        int count = 0;
+        bool isValid() const { return count > 0 && stepNm > 0.0; }
+    };
+    static SpectrumGrid spectrumGrid();
+    
+    // Spectrum of the catalog star nearest each (RA, Dec) position within
+    // radiusArcsec; an empty vector where that star has no spectrum. With
+    // magnitudes (G, one per position) the nearest star must also agree
+    // within maxMagnitudeDifference, so a neighbour is never taken for the
+    // intended star
+    static QVector<QVector<float>> fetchSpectra(const QVector<QPointF>& positions,
+                                                double radiusArcsec = 3.0,
+                                                const QVector<double>& magnitudes = QVector<double>(),
+                                                double maxMagnitudeDifference = 1.0);
+    
+    // Sample every tile of the magnitude summary up front (otherwise tiles
+    // are sampled the first time a target-count query touches them)
+    static bool buildMagnitudeSummary(std::function<void(int done, int total)> progress = nullptr,
+                                      const std::atomic<bool>* cancel = nullptr);
+    
     // Utility methods
     static void testPerformance(double centerRA, double centerDec, double radius);
     static void printCatalogStatistics();
@@ -0,0 +1,377 @@
+// GaiaIndexBuilder.cpp - Builds custom quad indexes from the local Gaia database
+#include "GaiaIndexBuilder.h"
+#include "GaiaGDR3Catalog.h"
+#include "GaiaQuadIndex.h"
+#include "ParallelFor.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+extern "C" {
+#include "astrometry/healpix.h"
+}
+
+namespace {
+
+struct ScaleRange {
+    double minArcsec;
+    double maxArcsec;
+};
+
+ScaleRange quadScaleRange(const GaiaIndexBuildParameters& params)
+{
+    double side = std::min(params.fieldWidthDegrees, params.fieldHeightDegrees) * 3600.0;
+    return {side * params.quadMinFraction, side * params.quadMaxFraction};
+}
+
+// Finest cell resolution (a multiple of the tile nside) whose cells are still
+// at least half the largest quad across, so a cell and its neighbours hold
+// every star a quad centred in the cell can use.
+int chooseCellNside(const GaiaIndexBuildParameters& params)
+{
+    double halfQuadArcmin = quadScaleRange(params).maxArcsec / 60.0 / 2.0;
+    int nside = static_cast<int>(healpix_side_length_arcmin(1) / halfQuadArcmin);
+    nside = std::max(params.tileNside, nside - nside % params.tileNside);
+    return nside;
+}
+
+double targetRadius(const GaiaIndexBuildParameters& params)
+{
+    if (params.targetRadiusDegrees > 0.0) return params.targetRadiusDegrees;
+    return std::hypot(params.fieldWidthDegrees, params.fieldHeightDegrees);
+}
+
+bool nearTarget(const GaiaIndexBuildParameters& params, double ra, double dec, double margin)
+{
+    if (params.targets.isEmpty()) return true;
+    double limit = targetRadius(params) + margin;
+    for (const QPointF& target : params.targets) {
+        if (GaiaQuadIndex::angularDistance(ra, dec, target.x(), target.y()) <= limit) return true;
+    }
+    return false;
+}
+
+// Centre of a HEALPix cell and the radius of the circle through its corners
+void cellCircle(int hp, int nside, double& ra, double& dec, double& radius)
+{
+    healpix_to_radecdeg(hp, nside, 0.5, 0.5, &ra, &dec);
+    radius = 0.0;
+    for (double dx : {0.0, 1.0}) {
+        for (double dy : {0.0, 1.0}) {
+            double cornerRA, cornerDec;
+            healpix_to_radecdeg(hp, nside, dx, dy, &cornerRA, &cornerDec);
+            radius = std::max(radius, GaiaQuadIndex::angularDistance(ra, dec, cornerRA, cornerDec));
+        }
+    }
+}
+
+// Source limits for the catalog queries. PCL stops decoding at the limit
+// and returns whatever it has, so a full result is never trusted
+const int kTileSourceLimit = 2000000;
+const int kCellSourceLimit = 500000;
+
+// Stars of a cone; false when the source limit cut the result short
+bool queryComplete(double ra, double dec, double radius, double maxMagnitude, int limit,
+                   QVector<GaiaGDR3Catalog::Star>& stars)
+{
+    GaiaGDR3Catalog::SearchParameters search(ra, dec, radius, maxMagnitude);
+    search.maxResults = limit;
+    stars = GaiaGDR3Catalog::queryRegion(search);
+    return stars.size() < limit;
+}
+
+} // namespace
+
+QString GaiaIndexBuilder::tileFileName(const GaiaIndexBuildParameters& params, int tile)
+{
+    return QString("%1-n%2-%3.gqi")
+        .arg(params.baseName)
+        .arg(params.tileNside)
+        .arg(tile, 4, 10, QChar('0'));
+}
+
+GaiaIndexBuildResult GaiaIndexBuilder::build(const GaiaIndexBuildParameters& params,
+                                             ProgressCallback progress,
+                                             const std::atomic<bool>* cancel)
+{
+    GaiaIndexBuildResult result;
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!GaiaGDR3Catalog::isAvailable()) {
+        result.errors.append("Gaia catalog is not available");
+        return result;
+    }
+    if (params.outputDirectory.isEmpty() || !QDir().mkpath(params.outputDirectory)) {
+        result.errors.append(QString("Cannot create output directory: %1").arg(params.outputDirectory));
+        return result;
+    }
+    if (params.tileNside < 1 || params.fieldWidthDegrees <= 0.0 || params.fieldHeightDegrees <= 0.0) {
+        result.errors.append("Invalid tile resolution or field of view");
+        return result;
+    }
+
+    int cellNside = chooseCellNside(params);
+    ScaleRange scale = quadScaleRange(params);
+
+    // Tiles touching the requested targets
+    QVector<int> tiles;
+    int tileCount = 12 * params.tileNside * params.tileNside;
+    for (int tile = 0; tile < tileCount; ++tile) {
+        double ra, dec, radius;
+        cellCircle(tile, params.tileNside, ra, dec, radius);
+        if (nearTarget(params, ra, dec, radius)) tiles.append(tile);
+    }
+
+    qDebug() << "Building Gaia quad index:" << tiles.size() << "tiles at nside" << params.tileNside
+             << "cells at nside" << cellNside
+             << "quads" << scale.minArcsec << "-" << scale.maxArcsec << "arcsec";
+
+    QVector<QString> files(tiles.size()), errors(tiles.size());
+    QVector<int> starCounts(tiles.size(), 0), quadCounts(tiles.size(), 0);
+    QVector<bool> ok(tiles.size(), false);
+    std::atomic<int> done(0);
+
+    // One work item per tile. The catalog has a single database handle, so
+    // the queries themselves run one at a time; uniformisation and quad
+    // building of one tile overlap the next tile's query
+    Parallel::forChunks(tiles.size(), tiles.size(), [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (cancel && cancel->load()) return;
+            ok[i] = buildTile(params, tiles[i], cellNside, files[i], starCounts[i], quadCounts[i], errors[i]);
+            int count = ++done;
+            if (progress) progress(count, tiles.size());
+        }
+    });
+
+    for (int i = 0; i < tiles.size(); ++i) {
+        if (!ok[i]) {
+            if (!errors[i].isEmpty()) result.errors.append(errors[i]);
+            continue;
+        }
+        if (files[i].isEmpty()) continue;   // Tile produced no quads
+        result.files.append(files[i]);
+        result.tilesBuilt++;
+        result.totalStars += starCounts[i];
+        result.totalQuads += quadCounts[i];
+    }
+
+    result.elapsedMs = timer.elapsed();
+    result.success = result.errors.isEmpty() && !(cancel && cancel->load());
+
+    qDebug() << "Gaia quad index:" << result.tilesBuilt << "files," << result.totalStars << "stars,"
+             << result.totalQuads << "quads in" << result.elapsedMs << "ms";
+    return result;
+}
+
+bool GaiaIndexBuilder::buildTile(const GaiaIndexBuildParameters& params, int tile, int cellNside,
+                                 QString& filePath, int& starCount, int& quadCount, QString& error)
+{
+    const int tileNside = params.tileNside;
+    ScaleRange scale = quadScaleRange(params);
+
+    double tileRA, tileDec, tileRadius;
+    cellCircle(tile, tileNside, tileRA, tileDec, tileRadius);
+    double queryRadius = tileRadius + scale.maxArcsec / 3600.0 / 2.0;
+
+    // The whole tile in one query when it fits under the source limit;
+    // otherwise the cells of the tile and the ring around it one by one
+    QVector<GaiaGDR3Catalog::Star> catalog;
+    if (!queryComplete(tileRA, tileDec, queryRadius, params.maxMagnitude, kTileSourceLimit, catalog)) {
+        qDebug() << "Tile" << tile << "exceeds" << kTileSourceLimit << "stars, querying per cell";
+
+        int bigHp, tileX, tileY;
+        healpix_decompose_xy(tile, &bigHp, &tileX, &tileY, tileNside);
+        int cellsPerSide = cellNside / tileNside;
+
+        std::set<int> cells;
+        for (int x = tileX * cellsPerSide; x < (tileX + 1) * cellsPerSide; ++x) {
+            for (int y = tileY * cellsPerSide; y < (tileY + 1) * cellsPerSide; ++y) {
+                int cell = healpix_compose_xy(bigHp, x, y, cellNside);
+                cells.insert(cell);
+                int neighbours[8];
+                int neighbourCount = healpix_get_neighbours(cell, neighbours, cellNside);
+                cells.insert(neighbours, neighbours + neighbourCount);
+            }
+        }
+
+        catalog.clear();
+        QVector<GaiaGDR3Catalog::Star> found;
+        for (int cell : cells) {
+            double cellRA, cellDec, cellRadius;
+            cellCircle(cell, cellNside, cellRA, cellDec, cellRadius);
+            if (!nearTarget(params, cellRA, cellDec, 3.0 * cellRadius)) continue;   // Neighbours of near cells
+
+            if (!queryComplete(cellRA, cellDec, cellRadius, params.maxMagnitude, kCellSourceLimit, found)) {
+                error = QString("Tile %1: cell %2 has more than %3 stars to magnitude %4; lower the magnitude limit")
+                            .arg(tile).arg(cell).arg(kCellSourceLimit).arg(params.maxMagnitude);
+                return false;
+            }
+            // Cell circles overlap; keep each star in the cell that holds it
+            for (const GaiaGDR3Catalog::Star& star : found) {
+                if (radecdegtohealpix(star.ra, star.dec, cellNside) == cell) catalog.append(star);
+            }
+        }
+    }
+
+    // Uniformise: the brightest stars of every cell
+    QHash<int, QVector<int>> catalogByCell;
+    for (int i = 0; i < catalog.size(); ++i) {
+        if (!catalog[i].isValid) continue;
+        catalogByCell[radecdegtohealpix(catalog[i].ra, catalog[i].dec, cellNside)].append(i);
+    }
+
+    QVector<QuadIndexStar> stars;
+    QHash<int, QVector<int>> cellStars;
+    for (auto it = catalogByCell.begin(); it != catalogByCell.end(); ++it) {
+        QVector<int>& members = it.value();
+        std::sort(members.begin(), members.end(), [&](int l, int r) {
+            return catalog[l].magnitude < catalog[r].magnitude;
+        });
+        QVector<int>& kept = cellStars[it.key()];
+        for (int i = 0; i < std::min(params.starsPerCell, int(members.size())); ++i) {
+            const GaiaGDR3Catalog::Star& source = catalog[members[i]];
+            QuadIndexStar star;
+            star.ra = source.ra;
+            star.dec = source.dec;
+            star.magnitude = float(source.magnitude);
+            kept.append(stars.size());
+            stars.append(star);
+        }
+    }
+
+    // Quads for every cell of this tile
+    int bigHp, tileX, tileY;
+    healpix_decompose_xy(tile, &bigHp, &tileX, &tileY, tileNside);
+    int cellsPerSide = cellNside / tileNside;
+
+    QVector<int> reuse(stars.size(), 0);
+    std::set<std::array<quint32, 4>> seen;
+    QVector<std::array<quint32, 4>> quads;
+    QVector<QuadCode> codes;
+    const int maxCandidates = 24;
+
+    for (int x = tileX * cellsPerSide; x < (tileX + 1) * cellsPerSide; ++x) {
+        for (int y = tileY * cellsPerSide; y < (tileY + 1) * cellsPerSide; ++y) {
+            int cell = healpix_compose_xy(bigHp, x, y, cellNside);
+            double cellRA, cellDec, cellRadius;
+            cellCircle(cell, cellNside, cellRA, cellDec, cellRadius);
+            if (!nearTarget(params, cellRA, cellDec, cellRadius)) continue;
+
+            // Stars of the cell and its neighbours, brightest first
+            QVector<int> candidates = cellStars.value(cell);
+            int neighbours[8];
+            int neighbourCount = healpix_get_neighbours(cell, neighbours, cellNside);
+            for (int n = 0; n < neighbourCount; ++n) {
+                candidates += cellStars.value(neighbours[n]);
+            }
+            if (candidates.size() < 4) continue;
+
+            std::sort(candidates.begin(), candidates.end(), [&](int l, int r) {
+                return stars[l].magnitude < stars[r].magnitude;
+            });
+            if (candidates.size() > maxCandidates) candidates.resize(maxCandidates);
+
+            QVector<QPointF> plane(candidates.size());
+            for (int i = 0; i < candidates.size(); ++i) {
+                plane[i] = GaiaQuadIndex::projectGnomonic(stars[candidates[i]].ra, stars[candidates[i]].dec,
+                                                          cellRA, cellDec);
+            }
+
+            int made = 0;
+            for (int ia = 0; ia < candidates.size() && made < params.quadsPerCell; ++ia) {
+                if (reuse[candidates[ia]] >= params.maxStarReuse) continue;
+
+                for (int ib = ia + 1; ib < candidates.size() && made < params.quadsPerCell; ++ib) {
+                    if (reuse[candidates[ib]] >= params.maxStarReuse) continue;
+
+                    QPointF ab = plane[ib] - plane[ia];
+                    double length = std::hypot(ab.x(), ab.y());
+                    if (length < scale.minArcsec || length > scale.maxArcsec) continue;
+
+                    // Each quad belongs to the cell holding the midpoint of AB
+                    QPointF middle = (plane[ia] + plane[ib]) / 2.0;
+                    double midRA, midDec;
+                    GaiaQuadIndex::deprojectGnomonic(middle, cellRA, cellDec, midRA, midDec);
+                    if (radecdegtohealpix(midRA, midDec, cellNside) != cell) continue;
+
+                    // C and D: the brightest stars inside the circle on AB
+                    int picked[2], pickedCount = 0;
+                    for (int ic = 0; ic < candidates.size() && pickedCount < 2; ++ic) {
+                        if (ic == ia || ic == ib || reuse[candidates[ic]] >= params.maxStarReuse) continue;
+                        QPointF v = plane[ic] - middle;
+                        if (std::hypot(v.x(), v.y()) < length / 2.0) picked[pickedCount++] = ic;
+                    }
+                    if (pickedCount < 2) continue;
+
+                    int local[4] = {ia, ib, picked[0], picked[1]};
+                    QPointF points[4];
+                    for (int k = 0; k < 4; ++k) points[k] = plane[local[k]];
+
+                    QuadCode code;
+                    int order[4];
+                    if (!GaiaQuadIndex::computeCode(points, code, order)) continue;
+
+                    std::array<quint32, 4> quad;
+                    for (int k = 0; k < 4; ++k) quad[k] = quint32(candidates[local[order[k]]]);
+
+                    std::array<quint32, 4> key = quad;
+                    std::sort(key.begin(), key.end());
+                    if (!seen.insert(key).second) continue;
+
+                    quads.append(quad);
+                    codes.append(code);
+                    for (quint32 star : quad) reuse[star]++;
+                    made++;
+                }
+            }
+        }
+    }
+
+    quadCount = quads.size();
+    if (quads.isEmpty()) {
+        starCount = 0;
+        return true;
+    }
+
+    // Keep only the stars that belong to a quad
+    QVector<int> remap(stars.size(), -1);
+    QVector<QuadIndexStar> usedStars;
+    for (auto& quad : quads) {
+        for (quint32& star : quad) {
+            if (remap[star] < 0) {
+                remap[star] = usedStars.size();
+                usedStars.append(stars[star]);
+            }
+            star = quint32(remap[star]);
+        }
+    }
+    stars = usedStars;
+    starCount = stars.size();
+
+    GaiaQuadIndex index;
+    index.tile = tile;
+    index.tileNside = tileNside;
+    index.cellNside = cellNside;
+    index.quadMinArcsec = scale.minArcsec;
+    index.quadMaxArcsec = scale.maxArcsec;
+    index.maxMagnitude = params.maxMagnitude;
+    index.centerRA = tileRA;
+    index.centerDec = tileDec;
+    index.radiusDegrees = queryRadius;
+    index.setData(stars, quads, codes);
+
+    filePath = QDir(params.outputDirectory).filePath(tileFileName(params, tile));
+    if (!index.save(filePath)) {
+        error = QString("Failed to write %1").arg(filePath);
+        filePath.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+// GaiaIndexBuilder.h - Builds custom quad indexes from the local Gaia database
+#ifndef GAIA_INDEX_BUILDER_H
+#define GAIA_INDEX_BUILDER_H
+
+#include <QPointF>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <functional>
+
+struct GaiaIndexBuildParameters {
+    // Telescope field of view; quad sizes are derived from it
+    double fieldWidthDegrees = 1.27;
+    double fieldHeightDegrees = 0.85;
+    double quadMinFraction = 0.2;       // of the shorter field side
+    double quadMaxFraction = 0.9;       // of the shorter field side
+
+    double maxMagnitude = 16.0;
+    int starsPerCell = 10;              // Brightest stars kept per cell (uniformisation)
+    int quadsPerCell = 8;
+    int maxStarReuse = 8;               // Quads a single star may belong to
+
+    int tileNside = 2;                  // One index file per HEALPix tile (12 * nside^2 tiles)
+
+    // Restrict the index to these targets (RA, Dec in degrees). Empty means
+    // the whole sky. targetRadiusDegrees <= 0 uses the field diagonal.
+    QVector<QPointF> targets;
+    double targetRadiusDegrees = 0.0;
+
+    QString outputDirectory;
+    QString baseName = "gaia-quads";
+};
+
+struct GaiaIndexBuildResult {
+    bool success = false;
+    QStringList files;
+    QStringList errors;
+    int tilesBuilt = 0;
+    int totalStars = 0;
+    int totalQuads = 0;
+    qint64 elapsedMs = 0;
+};
+
+// Queries GaiaGDR3Catalog per HEALPix tile, keeps the brightest stars of
+// every cell, builds quads whose sizes match the field of view, and writes
+// one GaiaQuadIndex file per tile. Catalog queries are serialised on the
+// catalog's database handle; the per-tile quad building runs concurrently.
+class GaiaIndexBuilder
+{
+public:
+    using ProgressCallback = std::function<void(int done, int total)>;
+
+    static GaiaIndexBuildResult build(const GaiaIndexBuildParameters& params,
+                                      ProgressCallback progress = ProgressCallback(),
+                                      const std::atomic<bool>* cancel = nullptr);
+
+    // Index file name used for a tile
+    static QString tileFileName(const GaiaIndexBuildParameters& params, int tile);
+
+private:
+    static bool buildTile(const GaiaIndexBuildParameters& params, int tile, int cellNside,
+                          QString& filePath, int& stars, int& quads, QString& error);
+};
+
+#endif // GAIA_INDEX_BUILDER_H
@@ -0,0 +1,157 @@
+// GaiaMagnitudeSummary.cpp - Per-tile Gaia star density by magnitude
+#include "GaiaMagnitudeSummary.h"
+#include "GaiaQuadIndex.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cmath>
+
+extern "C" {
+#include "astrometry/healpix.h"
+}
+
+namespace {
+
+const quint32 kSummaryMagic = 0x474d4853;      // "GMHS"
+const quint32 kSummaryVersion = 1;
+
+} // namespace
+
+double GaiaMagnitudeSummary::tileAreaDegrees()
+{
+    const double skyDegrees = 4.0 * M_PI * (180.0 / M_PI) * (180.0 / M_PI);
+    return skyDegrees / tileCount();
+}
+
+int GaiaMagnitudeSummary::tileForPosition(double ra, double dec)
+{
+    return radecdegtohealpix(ra, dec, TileNside);
+}
+
+void GaiaMagnitudeSummary::tileCircle(int tile, double& ra, double& dec, double& radius)
+{
+    healpix_to_radecdeg(tile, TileNside, 0.5, 0.5, &ra, &dec);
+    radius = 0.0;
+    for (double dx : {0.0, 1.0}) {
+        for (double dy : {0.0, 1.0}) {
+            double cornerRA, cornerDec;
+            healpix_to_radecdeg(tile, TileNside, dx, dy, &cornerRA, &cornerDec);
+            radius = std::max(radius, GaiaQuadIndex::angularDistance(ra, dec, cornerRA, cornerDec));
+        }
+    }
+}
+
+int GaiaMagnitudeSummary::binForMagnitude(double magnitude)
+{
+    int bin = static_cast<int>(std::floor((magnitude - MagnitudeStart) / BinWidth));
+    return std::clamp(bin, 0, BinCount - 1);
+}
+
+double GaiaMagnitudeSummary::expectedCount(int tile, double areaDegrees, double magnitude) const
+{
+    auto it = m_density.constFind(tile);
+    if (it == m_density.constEnd() || magnitude < MagnitudeStart) {
+        return 0.0;
+    }
+
+    const QVector<float>& density = it.value();
+    double count = 0.0;
+    for (int bin = 0; bin < BinCount; ++bin) {
+        double upper = binUpperMagnitude(bin);
+        if (magnitude >= upper) {
+            count += density[bin];
+        } else {
+            count += density[bin] * (magnitude - (upper - BinWidth)) / BinWidth;
+            break;
+        }
+    }
+    return count * areaDegrees;
+}
+
+double GaiaMagnitudeSummary::magnitudeForCount(int tile, double areaDegrees, double count,
+                                               double maxMagnitude) const
+{
+    auto it = m_density.constFind(tile);
+    if (it == m_density.constEnd()) {
+        return maxMagnitude;
+    }
+
+    const QVector<float>& density = it.value();
+    double cumulative = 0.0;
+    for (int bin = 0; bin < BinCount; ++bin) {
+        double inBin = density[bin] * areaDegrees;
+        double upper = binUpperMagnitude(bin);
+        if (cumulative + inBin >= count && inBin > 0.0) {
+            double magnitude = upper - BinWidth + BinWidth * (count - cumulative) / inBin;
+            return std::min(magnitude, maxMagnitude);
+        }
+        cumulative += inBin;
+        if (upper >= maxMagnitude) break;
+    }
+    return maxMagnitude;
+}
+
+bool GaiaMagnitudeSummary::save(const QString& filePath) const
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write magnitude summary:" << filePath;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    out << kSummaryMagic << kSummaryVersion << qint32(TileNside) << qint32(BinCount)
+        << qint32(m_density.size());
+    for (auto it = m_density.constBegin(); it != m_density.constEnd(); ++it) {
+        out << qint32(it.key());
+        for (float value : it.value()) out << value;
+    }
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool GaiaMagnitudeSummary::load(const QString& filePath)
+{
+    m_density.clear();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic = 0, version = 0;
+    qint32 nside = 0, bins = 0, tiles = 0;
+    in >> magic >> version >> nside >> bins >> tiles;
+    if (magic != kSummaryMagic || version != kSummaryVersion || nside != TileNside || bins != BinCount ||
+        tiles < 0 || tiles > tileCount()) {
+        qDebug() << "Not a magnitude summary (or unsupported layout):" << filePath;
+        return false;
+    }
+
+    for (int t = 0; t < tiles; ++t) {
+        qint32 tile = 0;
+        QVector<float> density(BinCount);
+        in >> tile;
+        for (float& value : density) in >> value;
+        m_density.insert(tile, density);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        m_density.clear();
+        return false;
+    }
+    return true;
+}
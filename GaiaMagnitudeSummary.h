@@ -0,0 +1,52 @@
+// GaiaMagnitudeSummary.h - Per-tile Gaia star density by magnitude
+#ifndef GAIA_MAGNITUDE_SUMMARY_H
+#define GAIA_MAGNITUDE_SUMMARY_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Star density histograms (stars per square degree in 0.25 mag bins) for
+// the HEALPix tiles (XY ordering, nside 16, ~13 deg^2 each) of the Gaia
+// catalog. Used to pick the magnitude limit that yields a wanted number of
+// stars before decoding any of them. Tiles are filled in as they are
+// sampled and persisted per catalog file.
+class GaiaMagnitudeSummary
+{
+public:
+    static constexpr int TileNside = 16;
+    static constexpr double MagnitudeStart = 3.0;   // Brighter stars share the first bin
+    static constexpr double BinWidth = 0.25;
+    static constexpr int BinCount = 72;             // Up to magnitude 21
+
+    static int tileCount() { return 12 * TileNside * TileNside; }
+    static double tileAreaDegrees();
+    static int tileForPosition(double ra, double dec);
+
+    // Centre of a tile and the radius of the circle through its corners
+    static void tileCircle(int tile, double& ra, double& dec, double& radius);
+
+    static int binForMagnitude(double magnitude);
+    static double binUpperMagnitude(int bin) { return MagnitudeStart + (bin + 1) * BinWidth; }
+
+    bool hasTile(int tile) const { return m_density.contains(tile); }
+    int sampledTileCount() const { return m_density.size(); }
+    void setTile(int tile, const QVector<float>& densityPerBin) { m_density.insert(tile, densityPerBin); }
+    void clear() { m_density.clear(); }
+
+    // Expected number of stars down to `magnitude` in `areaDegrees` of a
+    // tile (interpolated within the bin); 0 for unsampled tiles
+    double expectedCount(int tile, double areaDegrees, double magnitude) const;
+
+    // Faintest magnitude (clamped to maxMagnitude) at which the expected
+    // count in `areaDegrees` of the tile stays at or below `count`
+    double magnitudeForCount(int tile, double areaDegrees, double count, double maxMagnitude) const;
+
+    bool save(const QString& filePath) const;
+    bool load(const QString& filePath);
+
+private:
+    QHash<int, QVector<float>> m_density;
+};
+
+#endif // GAIA_MAGNITUDE_SUMMARY_H
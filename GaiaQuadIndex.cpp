@@ -0,0 +1,345 @@
+// GaiaQuadIndex.cpp - Compact quad index over one HEALPix tile of Gaia stars
+#include "GaiaQuadIndex.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+const quint32 kQuadIndexMagic = 0x47514958;    // "GQIX"
+const quint32 kQuadIndexVersion = 1;
+const int kLeafSize = 8;
+const double kArcsecPerRadian = 206264.80624709636;
+
+} // namespace
+
+bool GaiaQuadIndex::computeCode(const QPointF points[4], QuadCode& code, int order[4])
+{
+    // A and B: the most widely separated pair
+    int a = 0, b = 1;
+    double widest = -1.0;
+    for (int i = 0; i < 4; ++i) {
+        for (int j = i + 1; j < 4; ++j) {
+            QPointF d = points[j] - points[i];
+            double distSq = d.x() * d.x() + d.y() * d.y();
+            if (distSq > widest) {
+                widest = distSq;
+                a = i;
+                b = j;
+            }
+        }
+    }
+    if (widest <= 0.0) return false;
+
+    int others[2], n = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (i != a && i != b) others[n++] = i;
+    }
+
+    // Similarity taking A to (0,0) and B to (1,1): z -> (z - A) / (B - A) * (1 + i)
+    auto frame = [&](int from, int to, const QPointF& p) {
+        QPointF ab = points[to] - points[from];
+        QPointF v = p - points[from];
+        double scale = ab.x() * ab.x() + ab.y() * ab.y();
+        double re = (v.x() * ab.x() + v.y() * ab.y()) / scale;
+        double im = (v.y() * ab.x() - v.x() * ab.y()) / scale;
+        return QPointF(re - im, re + im);
+    };
+
+    QPointF c = frame(a, b, points[others[0]]);
+    QPointF d = frame(a, b, points[others[1]]);
+
+    // C and D must lie in the circle with diameter AB
+    for (const QPointF& p : {c, d}) {
+        double dx = p.x() - 0.5, dy = p.y() - 0.5;
+        if (dx * dx + dy * dy > 0.5) return false;
+    }
+
+    // Break the A/B symmetry, then the C/D one
+    if (c.x() + d.x() > 1.0) {
+        std::swap(a, b);
+        c = QPointF(1.0 - c.x(), 1.0 - c.y());
+        d = QPointF(1.0 - d.x(), 1.0 - d.y());
+    }
+    if (c.x() > d.x()) {
+        std::swap(c, d);
+        std::swap(others[0], others[1]);
+    }
+
+    code = {float(c.x()), float(c.y()), float(d.x()), float(d.y())};
+    order[0] = a;
+    order[1] = b;
+    order[2] = others[0];
+    order[3] = others[1];
+    return true;
+}
+
+QPointF GaiaQuadIndex::projectGnomonic(double ra, double dec, double ra0, double dec0)
+{
+    double a = qDegreesToRadians(ra), d = qDegreesToRadians(dec);
+    double a0 = qDegreesToRadians(ra0), d0 = qDegreesToRadians(dec0);
+    double cosDA = std::cos(a - a0);
+    double cosC = std::sin(d0) * std::sin(d) + std::cos(d0) * std::cos(d) * cosDA;
+
+    double xi = std::cos(d) * std::sin(a - a0) / cosC;
+    double eta = (std::cos(d0) * std::sin(d) - std::sin(d0) * std::cos(d) * cosDA) / cosC;
+    return QPointF(xi * kArcsecPerRadian, eta * kArcsecPerRadian);
+}
+
+void GaiaQuadIndex::deprojectGnomonic(const QPointF& plane, double ra0, double dec0,
+                                      double& ra, double& dec)
+{
+    double xi = plane.x() / kArcsecPerRadian, eta = plane.y() / kArcsecPerRadian;
+    double a0 = qDegreesToRadians(ra0), d0 = qDegreesToRadians(dec0);
+
+    double denominator = std::cos(d0) - eta * std::sin(d0);
+    double a = a0 + std::atan2(xi, denominator);
+    double d = std::atan2(std::sin(d0) + eta * std::cos(d0), std::hypot(xi, denominator));
+
+    ra = std::fmod(qRadiansToDegrees(a) + 360.0, 360.0);
+    dec = qRadiansToDegrees(d);
+}
+
+double GaiaQuadIndex::angularDistance(double ra1, double dec1, double ra2, double dec2)
+{
+    double d1 = qDegreesToRadians(dec1), d2 = qDegreesToRadians(dec2);
+    double sinDDec = std::sin((d2 - d1) / 2.0);
+    double sinDRa = std::sin(qDegreesToRadians(ra2 - ra1) / 2.0);
+    double h = sinDDec * sinDDec + std::cos(d1) * std::cos(d2) * sinDRa * sinDRa;
+    return qRadiansToDegrees(2.0 * std::asin(std::min(1.0, std::sqrt(h))));
+}
+
+void GaiaQuadIndex::setData(const QVector<QuadIndexStar>& stars,
+                            const QVector<std::array<quint32, 4>>& quads,
+                            const QVector<QuadCode>& codes)
+{
+    m_stars = stars;
+    m_codes = codes;
+
+    QVector<int> order(codes.size());
+    std::iota(order.begin(), order.end(), 0);
+    buildTree(0, order.size(), 0, order);
+
+    m_quads.resize(order.size());
+    for (int i = 0; i < order.size(); ++i) {
+        m_quads[i] = quads[order[i]];
+        m_codes[i] = codes[order[i]];
+    }
+    buildStarBands();
+}
+
+void GaiaQuadIndex::buildStarBands()
+{
+    m_bandStars.clear();
+    m_bandStart.clear();
+    if (m_stars.isEmpty()) return;
+
+    // About 64 bands over the tile's declination extent
+    double decMin = 90.0, decMax = -90.0;
+    for (const QuadIndexStar& star : m_stars) {
+        decMin = std::min(decMin, star.dec);
+        decMax = std::max(decMax, star.dec);
+    }
+    m_bandDecMin = decMin;
+    m_bandHeight = std::max((decMax - decMin) / 64.0, 1e-3);
+    int bands = static_cast<int>((decMax - decMin) / m_bandHeight) + 1;
+
+    auto bandOf = [this, bands](double dec) {
+        return std::clamp(static_cast<int>((dec - m_bandDecMin) / m_bandHeight), 0, bands - 1);
+    };
+
+    m_bandStars.resize(m_stars.size());
+    std::iota(m_bandStars.begin(), m_bandStars.end(), 0);
+    std::sort(m_bandStars.begin(), m_bandStars.end(), [&](int l, int r) {
+        int bl = bandOf(m_stars[l].dec), br = bandOf(m_stars[r].dec);
+        return bl != br ? bl < br : m_stars[l].ra < m_stars[r].ra;
+    });
+
+    m_bandStart.fill(0, bands + 1);
+    for (int star : m_bandStars) ++m_bandStart[bandOf(m_stars[star].dec) + 1];
+    std::partial_sum(m_bandStart.begin(), m_bandStart.end(), m_bandStart.begin());
+}
+
+void GaiaQuadIndex::appendBandRange(int band, double raMin, double raMax, QVector<int>& result) const
+{
+    auto first = m_bandStars.begin() + m_bandStart[band];
+    auto last = m_bandStars.begin() + m_bandStart[band + 1];
+    auto lo = std::lower_bound(first, last, raMin, [this](int star, double ra) { return m_stars[star].ra < ra; });
+    auto hi = std::upper_bound(lo, last, raMax, [this](double ra, int star) { return ra < m_stars[star].ra; });
+    for (auto it = lo; it != hi; ++it) result.append(*it);
+}
+
+void GaiaQuadIndex::findStars(double ra, double dec, double radius, QVector<int>& starIndices) const
+{
+    starIndices.clear();
+    if (m_bandStart.isEmpty()) return;
+
+    const int bands = m_bandStart.size() - 1;
+    int firstBand = std::max(0, static_cast<int>(std::floor((dec - radius - m_bandDecMin) / m_bandHeight)));
+    int lastBand = std::min(bands - 1, static_cast<int>(std::floor((dec + radius - m_bandDecMin) / m_bandHeight)));
+    if (firstBand > lastBand) return;
+
+    // RA half-width of the cone at its widest declination; near a pole
+    // every RA is in range
+    double maxAbsDec = std::max(std::abs(dec - radius), std::abs(dec + radius));
+    double halfWidth = 180.0;
+    if (maxAbsDec < 90.0) {
+        double ratio = std::sin(qDegreesToRadians(radius)) / std::cos(qDegreesToRadians(maxAbsDec));
+        if (ratio < 1.0) halfWidth = qRadiansToDegrees(std::asin(ratio));
+    }
+
+    for (int band = firstBand; band <= lastBand; ++band) {
+        if (halfWidth >= 180.0) {
+            appendBandRange(band, -1.0, 361.0, starIndices);
+            continue;
+        }
+        double raMin = ra - halfWidth, raMax = ra + halfWidth;
+        if (raMin < 0.0) {
+            appendBandRange(band, raMin + 360.0, 360.0, starIndices);
+            raMin = 0.0;
+        }
+        if (raMax >= 360.0) {
+            appendBandRange(band, 0.0, raMax - 360.0, starIndices);
+            raMax = 360.0;
+        }
+        appendBandRange(band, raMin, raMax, starIndices);
+    }
+}
+
+void GaiaQuadIndex::buildTree(int begin, int end, int depth, QVector<int>& order) const
+{
+    if (end - begin <= kLeafSize) return;
+
+    int mid = (begin + end) / 2;
+    int dim = depth % 4;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                     [&](int l, int r) { return m_codes[l][dim] < m_codes[r][dim]; });
+
+    buildTree(begin, mid, depth + 1, order);
+    buildTree(mid + 1, end, depth + 1, order);
+}
+
+void GaiaQuadIndex::findCodes(const QuadCode& code, float tolerance, QVector<int>& quadIndices) const
+{
+    quadIndices.clear();
+    search(0, m_codes.size(), 0, code, tolerance * tolerance, tolerance, quadIndices);
+}
+
+void GaiaQuadIndex::search(int begin, int end, int depth, const QuadCode& code,
+                           float toleranceSq, float tolerance, QVector<int>& result) const
+{
+    auto test = [&](int i) {
+        float distSq = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+            float d = m_codes[i][k] - code[k];
+            distSq += d * d;
+        }
+        if (distSq <= toleranceSq) result.append(i);
+    };
+
+    if (end - begin <= kLeafSize) {
+        for (int i = begin; i < end; ++i) test(i);
+        return;
+    }
+
+    int mid = (begin + end) / 2;
+    int dim = depth % 4;
+    float split = m_codes[mid][dim];
+
+    if (code[dim] - tolerance <= split) search(begin, mid, depth + 1, code, toleranceSq, tolerance, result);
+    test(mid);
+    if (code[dim] + tolerance >= split) search(mid + 1, end, depth + 1, code, toleranceSq, tolerance, result);
+}
+
+bool GaiaQuadIndex::save(const QString& filePath) const
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write quad index:" << filePath;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    out << kQuadIndexMagic << kQuadIndexVersion
+        << qint32(tile) << qint32(tileNside) << qint32(cellNside)
+        << quadMinArcsec << quadMaxArcsec << maxMagnitude
+        << centerRA << centerDec << radiusDegrees
+        << qint32(m_stars.size()) << qint32(m_quads.size());
+
+    // Positions at double precision, magnitudes and codes at single precision
+    for (const QuadIndexStar& star : m_stars) out << star.ra << star.dec;
+
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    for (const QuadIndexStar& star : m_stars) out << star.magnitude;
+    for (const auto& quad : m_quads) out << quad[0] << quad[1] << quad[2] << quad[3];
+    for (const QuadCode& code : m_codes) out << code[0] << code[1] << code[2] << code[3];
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool GaiaQuadIndex::load(const QString& filePath)
+{
+    m_stars.clear();
+    m_quads.clear();
+    m_codes.clear();
+    m_bandStars.clear();
+    m_bandStart.clear();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 magic = 0, version = 0;
+    qint32 tileValue = 0, tileNsideValue = 0, cellNsideValue = 0, starCount = 0, quadCount = 0;
+    in >> magic >> version;
+    if (magic != kQuadIndexMagic || version != kQuadIndexVersion) {
+        qDebug() << "Not a quad index (or unsupported version):" << filePath;
+        return false;
+    }
+
+    in >> tileValue >> tileNsideValue >> cellNsideValue
+       >> quadMinArcsec >> quadMaxArcsec >> maxMagnitude
+       >> centerRA >> centerDec >> radiusDegrees
+       >> starCount >> quadCount;
+    if (in.status() != QDataStream::Ok || starCount < 0 || quadCount < 0) {
+        return false;
+    }
+    tile = tileValue;
+    tileNside = tileNsideValue;
+    cellNside = cellNsideValue;
+
+    m_stars.resize(starCount);
+    for (QuadIndexStar& star : m_stars) in >> star.ra >> star.dec;
+
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    for (QuadIndexStar& star : m_stars) in >> star.magnitude;
+
+    m_quads.resize(quadCount);
+    for (auto& quad : m_quads) in >> quad[0] >> quad[1] >> quad[2] >> quad[3];
+    m_codes.resize(quadCount);
+    for (QuadCode& code : m_codes) in >> code[0] >> code[1] >> code[2] >> code[3];
+
+    if (in.status() != QDataStream::Ok) {
+        m_stars.clear();
+        m_quads.clear();
+        m_codes.clear();
+        return false;
+    }
+    buildStarBands();
+    return true;
+}
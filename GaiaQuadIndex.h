@@ -0,0 +1,92 @@
+// GaiaQuadIndex.h - Compact quad index over one HEALPix tile of Gaia stars
+#ifndef GAIA_QUAD_INDEX_H
+#define GAIA_QUAD_INDEX_H
+
+#include <QPointF>
+#include <QString>
+#include <QVector>
+#include <array>
+
+struct QuadIndexStar {
+    double ra = 0.0;            // degrees
+    double dec = 0.0;           // degrees
+    float magnitude = 0.0f;
+};
+
+// Geometric hash of a four-star asterism, as in astrometry.net: the two most
+// widely separated stars A and B define a frame with A at (0,0) and B at
+// (1,1); the code is the position of C and D in that frame. The code is
+// invariant to translation, rotation and scale. A mirrored image (flipped
+// parity) gives the code with x and y exchanged.
+using QuadCode = std::array<float, 4>;
+
+// Stars, quads and a k-d tree over code space for one tile. The tree is
+// implicit: quads are stored in tree order and every node splits its range
+// at the middle element on dimension (depth % 4).
+class GaiaQuadIndex
+{
+public:
+    bool save(const QString& filePath) const;
+    bool load(const QString& filePath);
+
+    // Replace the content; the quads are reordered into tree order
+    void setData(const QVector<QuadIndexStar>& stars,
+                 const QVector<std::array<quint32, 4>>& quads,
+                 const QVector<QuadCode>& codes);
+
+    // Quads whose code lies within `tolerance` (Euclidean) of `code`
+    void findCodes(const QuadCode& code, float tolerance, QVector<int>& quadIndices) const;
+
+    // Stars possibly within `radius` degrees of (ra, dec): a superset from
+    // the declination bands, to be filtered with angularDistance()
+    void findStars(double ra, double dec, double radius, QVector<int>& starIndices) const;
+
+    const QVector<QuadIndexStar>& stars() const { return m_stars; }
+    const std::array<quint32, 4>& quad(int index) const { return m_quads[index]; }
+    const QuadCode& code(int index) const { return m_codes[index]; }
+    int quadCount() const { return m_quads.size(); }
+    bool isEmpty() const { return m_quads.isEmpty(); }
+
+    // Tile and scale information
+    int tile = -1;              // HEALPix (XY ordering) at tileNside
+    int tileNside = 0;
+    int cellNside = 0;          // Uniformisation / quad cell resolution
+    double quadMinArcsec = 0.0;
+    double quadMaxArcsec = 0.0;
+    double maxMagnitude = 0.0;
+    double centerRA = 0.0;      // Tile centre, degrees
+    double centerDec = 0.0;
+    double radiusDegrees = 0.0; // Radius covering every star in the tile
+
+    // Canonical code of four points in a plane. On success `order` holds
+    // the input indices as A, B, C, D. Fails if C or D lie outside the
+    // circle with diameter AB.
+    static bool computeCode(const QPointF points[4], QuadCode& code, int order[4]);
+
+    // Gnomonic projection about (ra0, dec0); plane coordinates in arcsec
+    static QPointF projectGnomonic(double ra, double dec, double ra0, double dec0);
+    static void deprojectGnomonic(const QPointF& plane, double ra0, double dec0,
+                                  double& ra, double& dec);
+
+    // Great-circle distance in degrees
+    static double angularDistance(double ra1, double dec1, double ra2, double dec2);
+
+private:
+    void buildTree(int begin, int end, int depth, QVector<int>& order) const;
+    void search(int begin, int end, int depth, const QuadCode& code,
+                float toleranceSq, float tolerance, QVector<int>& result) const;
+    void buildStarBands();
+    void appendBandRange(int band, double raMin, double raMax, QVector<int>& result) const;
+
+    QVector<QuadIndexStar> m_stars;
+    QVector<std::array<quint32, 4>> m_quads;
+    QVector<QuadCode> m_codes;
+
+    // Star indices in declination bands, sorted by RA within each band
+    QVector<int> m_bandStars;
+    QVector<int> m_bandStart;       // Offset of each band in m_bandStars, plus an end marker
+    double m_bandDecMin = 0.0;
+    double m_bandHeight = 1.0;
+};
+
+#endif // GAIA_QUAD_INDEX_H
@@ -1,6 +1,7 @@
 #include "ImageDisplayWidget.h"
 #include "ImageReader.h"
-#include "ImageStatistics.h"
+#include "ImagePlaneCache.h"
+#include "GaiaQuadIndex.h"
 
 #include <QPixmap>
 #include <QImage>
@@ -100,6 +101,13 @@ void ImageDisplayWidget::setupUI()
     connect(m_showMagnitudeLegendCheck, &QCheckBox::toggled, this, &ImageDisplayWidget::onShowMagnitudeLegendToggled);
     m_controlLayout->addWidget(m_showMagnitudeLegendCheck);
     
+    m_showGridCheck = new QCheckBox("Show RA/Dec Grid");
+    m_showGridCheck->setChecked(m_showGrid);
+    m_showGridCheck->setToolTip("Toggle equatorial coordinate grid (needs a WCS solution)");
+    m_showGridCheck->setEnabled(false);
+    connect(m_showGridCheck, &QCheckBox::toggled, this, &ImageDisplayWidget::onShowGridToggled);
+    m_controlLayout->addWidget(m_showGridCheck);
+    
     // Add another separator
     auto* separator2 = new QFrame();
     separator2->setFrameShape(QFrame::VLine);
@@ -257,7 +265,12 @@ void ImageDisplayWidget::drawOverlays(QPixmap& pixmap)
     double xScale = double(pixmap.width()) / m_imageData->width;
     double yScale = double(pixmap.height()) / m_imageData->height;
     
-    // Draw overlays in order: catalog stars (bottom), detected stars (middle), validation matches (top)
+    // Draw overlays in order: coordinate grid and catalog stars (bottom),
+    // detected stars (middle), validation matches (top)
+    
+    if (m_showGrid && hasSkyTransform()) {
+        drawCoordinateGrid(painter, xScale, yScale);
+    }
     
     if (m_showCatalog && m_validationResults) {
         drawCatalogOverlay(painter, xScale, yScale);
@@ -417,20 +430,21 @@ void ImageDisplayWidget::setImageData(const ImageData& imageData)
 {
     m_ownedImageData = std::make_unique<ImageData>(imageData);
     m_imageData = m_ownedImageData.get();
+    clearSkyTransform();  // A solution belongs to the image it was solved on
     
     if (!imageData.isValid()) {
         clearImage();
         return;
     }
     
-    // Calculate image statistics
-    ImageStatistics stats;
-    stats.calculate(imageData.pixels.constData(), imageData.pixels.size());
+    // Image statistics come from the derived-plane cache shared with the
+    // copy we hold, so other stages reuse them instead of recomputing
+    ChannelStatistics stats = m_ownedImageData->derived()->combinedStatistics();
     
-    m_imageMin = stats.minimum();
-    m_imageMax = stats.maximum();
-    m_imageMean = stats.mean();
-    m_imageStdDev = stats.standardDeviation();
+    m_imageMin = stats.minimum;
+    m_imageMax = stats.maximum;
+    m_imageMean = stats.mean;
+    m_imageStdDev = stats.stdDev;
     
     // Set default stretch limits
     if (m_autoStretchEnabled) {
@@ -453,6 +467,7 @@ void ImageDisplayWidget::clearImage()
     m_imageData = nullptr;
     m_currentPixmap = QPixmap();
     m_imageLabel->setPixmap(QPixmap());
+    clearSkyTransform();
     m_imageLabel->setText("No image loaded");
     
     m_imageMin = 0.0;
@@ -734,7 +749,24 @@ void ImageDisplayWidget::mousePressEvent(QMouseEvent* event)
 void ImageDisplayWidget::setWCSData(const WCSData& wcs)
 {
     m_wcsData = wcs;
-    update(); // Trigger repaint
+    ++m_wcsGeneration;
+    m_showGridCheck->setEnabled(hasSkyTransform());
+    if (m_showGrid) {
+        updateDisplay();
+    } else {
+        update(); // Trigger repaint
+    }
+}
+
+void ImageDisplayWidget::setAstrometricSolution(const pcl::AstrometricMetadata& astrometry)
+{
+    m_astrometry = astrometry;
+    m_hasAstrometry = astrometry.IsValid();
+    ++m_wcsGeneration;
+    m_showGridCheck->setEnabled(hasSkyTransform());
+    if (m_showGrid) {
+        updateDisplay();
+    }
 }
 
 void ImageDisplayWidget::setWCSOverlayEnabled(bool enabled)
@@ -743,6 +775,118 @@ void ImageDisplayWidget::setWCSOverlayEnabled(bool enabled)
     update(); // Trigger repaint
 }
 
+void ImageDisplayWidget::setCoordinateGridVisible(bool visible)
+{
+    if (m_showGrid != visible) {
+        m_showGrid = visible;
+        m_showGridCheck->setChecked(visible);
+        updateDisplay();
+    }
+}
+
+void ImageDisplayWidget::onShowGridToggled(bool show)
+{
+    m_showGrid = show;
+    updateDisplay();
+    emit coordinateGridToggled(show);
+}
+
+void ImageDisplayWidget::clearSkyTransform()
+{
+    m_wcsData = WCSData();
+    m_astrometry = pcl::AstrometricMetadata();
+    m_hasAstrometry = false;
+    ++m_wcsGeneration;
+    m_coordinateGrid.clear();
+    m_showGridCheck->setEnabled(false);
+}
+
+bool ImageDisplayWidget::hasSkyTransform() const
+{
+    return m_hasAstrometry ||
+           (m_wcsData.isValid && (m_wcsData.cd11 * m_wcsData.cd22 - m_wcsData.cd12 * m_wcsData.cd21) != 0.0);
+}
+
+bool ImageDisplayWidget::skyToImage(double ra, double dec, QPointF& pixel) const
+{
+    if (m_hasAstrometry) {
+        try {
+            pcl::DPoint image;
+            if (!m_astrometry.CelestialToImage(image, pcl::DPoint(ra, dec))) return false;
+            pixel = QPointF(image.x, image.y);
+            return true;
+        } catch (const pcl::Error&) {
+            return false;
+        }
+    }
+
+    // Linear TAN from the CD matrix; CRPIX is 1-based
+    const WCSData& w = m_wcsData;
+    if (GaiaQuadIndex::angularDistance(ra, dec, w.crval1, w.crval2) >= 89.0) return false;
+    const QPointF plane = GaiaQuadIndex::projectGnomonic(ra, dec, w.crval1, w.crval2) / 3600.0;
+    const double det = w.cd11 * w.cd22 - w.cd12 * w.cd21;
+    pixel = QPointF(( w.cd22 * plane.x() - w.cd12 * plane.y()) / det + w.crpix1 - 1.0,
+                    (-w.cd21 * plane.x() + w.cd11 * plane.y()) / det + w.crpix2 - 1.0);
+    return true;
+}
+
+bool ImageDisplayWidget::imageToSky(double x, double y, double& ra, double& dec) const
+{
+    if (m_hasAstrometry) {
+        try {
+            pcl::DPoint world;
+            if (!m_astrometry.ImageToCelestial(world, pcl::DPoint(x, y))) return false;
+            ra = world.x;
+            dec = world.y;
+            return true;
+        } catch (const pcl::Error&) {
+            return false;
+        }
+    }
+
+    const WCSData& w = m_wcsData;
+    const double dx = x - (w.crpix1 - 1.0);
+    const double dy = y - (w.crpix2 - 1.0);
+    const QPointF plane((w.cd11 * dx + w.cd12 * dy) * 3600.0, (w.cd21 * dx + w.cd22 * dy) * 3600.0);
+    GaiaQuadIndex::deprojectGnomonic(plane, w.crval1, w.crval2, ra, dec);
+    return true;
+}
+
+void ImageDisplayWidget::drawCoordinateGrid(QPainter& painter, double xScale, double yScale)
+{
+    if (!m_imageData) return;
+    
+    // Tessellation depends on the WCS and the display scale only
+    if (!m_coordinateGrid.isCurrent(m_wcsGeneration, xScale, yScale)) {
+        m_coordinateGrid.build(m_wcsGeneration, m_imageData->width, m_imageData->height, xScale, yScale,
+                               [this](double ra, double dec, QPointF& p) { return skyToImage(ra, dec, p); },
+                               [this](double x, double y, double& ra, double& dec) {
+                                   return imageToSky(x, y, ra, dec);
+                               });
+    }
+    
+    painter.save();
+    painter.setBrush(Qt::NoBrush);
+    QFont labelFont = painter.font();
+    labelFont.setPointSize(9);
+    painter.setFont(labelFont);
+    
+    const QPen raPen(QColor(120, 200, 255, 170), 1);
+    const QPen decPen(QColor(255, 180, 120, 170), 1);
+    for (const CoordinateGridLine& line : m_coordinateGrid.lines()) {
+        painter.setPen(line.isRA ? raPen : decPen);
+        painter.drawPath(line.path);
+    }
+    
+    for (const CoordinateGridLine& line : m_coordinateGrid.lines()) {
+        if (!line.hasLabel) continue;
+        painter.setPen(line.isRA ? QColor(160, 220, 255) : QColor(255, 200, 150));
+        painter.drawText(line.labelPosition, line.label);
+    }
+    
+    painter.restore();
+}
+
 void ImageDisplayWidget::clearStarOverlays()
 {
     m_starOverlays.clear();
@@ -13,6 +13,7 @@
 #include <QFrame>
 #include <QPixmap>
 #include "StarCatalogValidator.h"
+#include "CoordinateGrid.h"
 
 struct ImageData;
 struct ValidationResult;
@@ -69,6 +70,12 @@ public:
     const ValidationResult* getValidationResults() const { return m_validationResults; }
     void setMagnitudeLegendVisible(bool visible);
     bool isMagnitudeLegendVisible() const { return m_showMagnitudeLegend; }
+    
+    // Full astrometric solution (distortion included) for the RA/Dec grid;
+    // without one the grid follows the linear WCS from setWCSData()
+    void setAstrometricSolution(const pcl::AstrometricMetadata& astrometry);
+    void setCoordinateGridVisible(bool visible);
+    bool isCoordinateGridVisible() const { return m_showGrid; }
 
 signals:
     void imageClicked(int x, int y, float value);
@@ -77,6 +84,7 @@ signals:
     void catalogOverlayToggled(bool visible);
     void validationOverlayToggled(bool visible);
     void magnitudeLegendToggled(bool visible);  // ADD THIS NEW SIGNAL
+    void coordinateGridToggled(bool visible);
 
 protected:
     void wheelEvent(QWheelEvent* event) override;
@@ -91,6 +99,7 @@ private slots:
     void onShowCatalogToggled(bool show);
     void onShowValidationToggled(bool show);
     void onShowMagnitudeLegendToggled(bool show);  // ADD THIS NEW SLOT
+    void onShowGridToggled(bool show);
 
 private:
     void setupUI();
@@ -104,6 +113,11 @@ private:
     void drawValidationOverlay(QPainter& painter, double xScale, double yScale);
     void drawFieldReference(QPainter& painter, double xScale, double yScale);
     void drawMagnitudeLegend(QPainter& painter, double xScale, double yScale);
+    void drawCoordinateGrid(QPainter& painter, double xScale, double yScale);
+    void clearSkyTransform();
+    bool hasSkyTransform() const;
+    bool skyToImage(double ra, double dec, QPointF& pixel) const;
+    bool imageToSky(double x, double y, double& ra, double& dec) const;
 
     QCheckBox* m_showMagnitudeLegendCheck;
     bool m_showMagnitudeLegend = false;
@@ -111,6 +125,14 @@ private:
     bool m_wcsOverlayEnabled = false;
     QVector<StarOverlay> m_starOverlays;
     
+    // RA/Dec grid, rebuilt only when the WCS or the display scale changes
+    QCheckBox* m_showGridCheck;
+    bool m_showGrid = false;
+    pcl::AstrometricMetadata m_astrometry;
+    bool m_hasAstrometry = false;
+    quint64 m_wcsGeneration = 0;
+    CoordinateGrid m_coordinateGrid;
+    
     // UI components
     QVBoxLayout* m_mainLayout;
     QHBoxLayout* m_controlLayout;
@@ -0,0 +1,206 @@
+// ImageKeywords.h - Typed, hashed FITS/XISF keyword store attached to ImageData
+#ifndef IMAGE_KEYWORDS_H
+#define IMAGE_KEYWORDS_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <cmath>
+
+// One header keyword with its value decoded once at load time
+struct ImageKeyword {
+    enum class Type {
+        None,       // Keyword present without a value (e.g. COMMENT)
+        Numeric,
+        String,
+        Boolean
+    };
+
+    QString name;
+    Type type = Type::None;
+    double number = 0.0;
+    QString text;               // Unquoted string value (or raw text for other types)
+    bool boolean = false;
+    QString comment;
+    QString card;               // Original "NAME = value / comment" card
+
+    bool isNumeric() const { return type == Type::Numeric; }
+    bool isString() const { return type == Type::String; }
+    bool isBoolean() const { return type == Type::Boolean; }
+};
+
+// Keyword map keyed by upper-case name. Insertion order is preserved for
+// display; repeated names keep the first value, like FITS readers do.
+class ImageKeywordStore
+{
+public:
+    // Decode a FITS-style raw value: 'quoted' strings, T/F logicals, numbers
+    void insertRaw(const QString& name, const QString& rawValue, const QString& comment = QString())
+    {
+        ImageKeyword keyword;
+        keyword.name = name.trimmed().toUpper();
+        keyword.comment = comment.trimmed();
+
+        QString value = rawValue.trimmed();
+        keyword.card = QString("%1= %2").arg(keyword.name, -8).arg(value);
+        if (!keyword.comment.isEmpty()) {
+            keyword.card += QString(" / %1").arg(keyword.comment);
+        }
+
+        if (value.isEmpty()) {
+            keyword.type = ImageKeyword::Type::None;
+        } else if (value.startsWith('\'')) {
+            int end = value.lastIndexOf('\'');
+            QString inner = end > 0 ? value.mid(1, end - 1) : value.mid(1);
+            keyword.type = ImageKeyword::Type::String;
+            keyword.text = inner.replace("''", "'").trimmed();
+        } else if (value == "T" || value == "F") {
+            keyword.type = ImageKeyword::Type::Boolean;
+            keyword.boolean = (value == "T");
+            keyword.text = value;
+        } else {
+            setParsedValue(keyword, value);
+        }
+
+        insert(keyword);
+    }
+
+    // Decode an untyped value (XISF property text, legacy metadata lines)
+    void insertText(const QString& name, const QString& value, const QString& comment = QString())
+    {
+        ImageKeyword keyword;
+        keyword.name = name.trimmed().toUpper();
+        keyword.comment = comment.trimmed();
+        keyword.card = QString("%1= %2").arg(keyword.name, -8).arg(value.trimmed());
+        setParsedValue(keyword, value.trimmed());
+        insert(keyword);
+    }
+
+    void insert(const ImageKeyword& keyword)
+    {
+        if (keyword.name.isEmpty() || m_keywords.contains(keyword.name)) {
+            return;
+        }
+        m_keywords.insert(keyword.name, keyword);
+        m_order.append(keyword.name);
+    }
+
+    bool contains(const QString& name) const { return m_keywords.contains(name); }
+    const ImageKeyword* find(const QString& name) const
+    {
+        auto it = m_keywords.constFind(name);
+        return it == m_keywords.constEnd() ? nullptr : &it.value();
+    }
+
+    double number(const QString& name, double defaultValue = 0.0, bool* ok = nullptr) const
+    {
+        const ImageKeyword* keyword = find(name);
+        bool found = keyword && keyword->isNumeric();
+        if (ok) *ok = found;
+        return found ? keyword->number : defaultValue;
+    }
+
+    QString string(const QString& name, const QString& defaultValue = QString()) const
+    {
+        const ImageKeyword* keyword = find(name);
+        return keyword && keyword->type != ImageKeyword::Type::None ? keyword->text : defaultValue;
+    }
+
+    bool boolean(const QString& name, bool defaultValue = false) const
+    {
+        const ImageKeyword* keyword = find(name);
+        return keyword && keyword->isBoolean() ? keyword->boolean : defaultValue;
+    }
+
+    // First numeric value among several alternative keyword names
+    double firstNumber(const QStringList& names, double defaultValue = 0.0, bool* ok = nullptr) const
+    {
+        for (const QString& name : names) {
+            bool found = false;
+            double value = number(name, 0.0, &found);
+            if (found) {
+                if (ok) *ok = true;
+                return value;
+            }
+        }
+        if (ok) *ok = false;
+        return defaultValue;
+    }
+
+    // Telescope pointing in degrees from CRVAL, RA/DEC, the XISF
+    // Observation:Center properties or sexagesimal OBJCTRA/OBJCTDEC
+    bool pointingHint(double& ra, double& dec) const
+    {
+        bool raOk = false, decOk = false;
+        ra = firstNumber({"CRVAL1", "RA", "OBSERVATION:CENTER:RA", "OBJCTRA"}, 0.0, &raOk);
+        dec = firstNumber({"CRVAL2", "DEC", "OBSERVATION:CENTER:DEC", "OBJCTDEC"}, 0.0, &decOk);
+
+        if (!raOk) raOk = parseSexagesimal(string("OBJCTRA"), ra, 15.0);
+        if (!decOk) decOk = parseSexagesimal(string("OBJCTDEC"), dec, 1.0);
+        return raOk && decOk;
+    }
+
+    QList<ImageKeyword> keywords() const
+    {
+        QList<ImageKeyword> ordered;
+        ordered.reserve(m_order.size());
+        for (const QString& name : m_order) ordered.append(m_keywords.value(name));
+        return ordered;
+    }
+
+    int size() const { return m_keywords.size(); }
+    bool isEmpty() const { return m_keywords.isEmpty(); }
+    void clear() { m_keywords.clear(); m_order.clear(); }
+
+private:
+    static void setParsedValue(ImageKeyword& keyword, const QString& value)
+    {
+        keyword.text = value;
+        if (value.isEmpty()) {
+            keyword.type = ImageKeyword::Type::None;
+            return;
+        }
+
+        bool ok = false;
+        double number = value.toDouble(&ok);
+        if (ok) {
+            keyword.type = ImageKeyword::Type::Numeric;
+            keyword.number = number;
+        } else if (value.compare("true", Qt::CaseInsensitive) == 0 ||
+                   value.compare("false", Qt::CaseInsensitive) == 0) {
+            keyword.type = ImageKeyword::Type::Boolean;
+            keyword.boolean = value.compare("true", Qt::CaseInsensitive) == 0;
+        } else {
+            keyword.type = ImageKeyword::Type::String;
+        }
+    }
+
+    // "12 34 56.7" or "12:34:56.7" scaled to degrees (15 for hours)
+    static bool parseSexagesimal(const QString& text, double& degrees, double scale)
+    {
+        QString cleaned = text.trimmed();
+        cleaned.replace(':', ' ');
+        QStringList parts = cleaned.split(' ', Qt::SkipEmptyParts);
+        if (parts.isEmpty() || parts.size() > 3) return false;
+
+        bool negative = parts[0].startsWith('-');
+        double value = 0.0;
+        double divisor = 1.0;
+        for (const QString& part : parts) {
+            bool ok = false;
+            double component = std::abs(part.toDouble(&ok));
+            if (!ok) return false;
+            value += component / divisor;
+            divisor *= 60.0;
+        }
+
+        degrees = (negative ? -value : value) * scale;
+        return true;
+    }
+
+    QHash<QString, ImageKeyword> m_keywords;
+    QStringList m_order;
+};
+
+#endif // IMAGE_KEYWORDS_H
@@ -0,0 +1,505 @@
+// ImagePlaneCache.cpp - Lazily computed, shared products derived from ImageData pixels
+#include "ImagePlaneCache.h"
+#include "ParallelFor.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+std::atomic<quint64> s_nextPixelGeneration{1};
+}
+
+void ImageData::invalidateDerived()
+{
+    derivedCache.reset();
+    pixelGeneration = s_nextPixelGeneration.fetch_add(1);
+}
+
+std::shared_ptr<const ImagePlaneCache> ImageData::derived() const
+{
+    // Serializes replacement of the pointer itself; products have their own lock
+    static QMutex cacheMutex;
+    QMutexLocker locker(&cacheMutex);
+
+    if (!derivedCache || !derivedCache->matches(*this)) {
+        derivedCache = std::make_shared<ImagePlaneCache>(*this);
+    }
+    return derivedCache;
+}
+
+ImagePlaneCache::ImagePlaneCache(const ImageData& imageData)
+    : m_pixelData(imageData.pixels.constData())
+    , m_pixelCount(imageData.pixels.size())
+    , m_generation(imageData.pixelGeneration)
+    , m_width(imageData.width)
+    , m_height(imageData.height)
+    , m_channels(imageData.channels)
+    , m_planeSize(static_cast<size_t>(std::max(0, imageData.width)) * std::max(0, imageData.height))
+{
+    m_channelStats.resize(std::max(0, m_channels));
+    m_channelStatsReady.fill(false, std::max(0, m_channels));
+    m_pyramid.resize(1);
+}
+
+bool ImagePlaneCache::matches(const ImageData& imageData) const
+{
+    return m_pixelData == imageData.pixels.constData()
+        && m_pixelCount == imageData.pixels.size()
+        && m_generation == imageData.pixelGeneration
+        && m_width == imageData.width
+        && m_height == imageData.height
+        && m_channels == imageData.channels;
+}
+
+const float* ImagePlaneCache::channelPlane(int channel) const
+{
+    if (channel < 0 || channel >= m_channels) return nullptr;
+    if (static_cast<size_t>(m_pixelCount) < (channel + 1) * m_planeSize) return nullptr;
+    return m_pixelData + channel * m_planeSize;
+}
+
+QVector<float> ImagePlaneCache::luminance(const QVector<double>& weights) const
+{
+    QVector<double> w = weights;
+    if (w.size() < 3) {
+        w = {0.299, 0.587, 0.114}; // Standard RGB to luminance conversion
+    }
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_luminance.constFind(w);
+    if (it != m_luminance.constEnd()) {
+        return it.value();
+    }
+
+    QVector<float> lum(static_cast<int>(m_planeSize));
+    int used = std::min(m_channels, 3);
+
+    if (used == 1 && channelPlane(0)) {
+        std::copy(channelPlane(0), channelPlane(0) + m_planeSize, lum.begin());
+    } else if (used == 3 && channelPlane(2)) {
+        // Fused three-plane kernel; contiguous, branch-free, auto-vectorized
+        const float* __restrict r = channelPlane(0);
+        const float* __restrict g = channelPlane(1);
+        const float* __restrict b = channelPlane(2);
+        float* __restrict out = lum.data();
+        const float wr = static_cast<float>(w[0]);
+        const float wg = static_cast<float>(w[1]);
+        const float wb = static_cast<float>(w[2]);
+
+        Parallel::forRange(m_planeSize, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = wr * r[i] + wg * g[i] + wb * b[i];
+            }
+        });
+    } else {
+        float* out = lum.data();
+        std::fill(out, out + m_planeSize, 0.0f);
+        for (int ch = 0; ch < used; ++ch) {
+            const float* plane = channelPlane(ch);
+            if (!plane) break;
+            const float wc = static_cast<float>(w[ch]);
+            Parallel::forRange(m_planeSize, [=](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    out[i] += wc * plane[i];
+                }
+            });
+        }
+    }
+
+    m_luminance.insert(w, lum);
+    return lum;
+}
+
+ChannelStatistics ImagePlaneCache::channelStatistics(int channel) const
+{
+    if (channel < 0 || channel >= m_channels) return ChannelStatistics();
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_channelStatsReady[channel]) {
+        m_channelStats[channel] = computeChannelStatistics(channel);
+        m_channelStatsReady[channel] = true;
+    }
+    return m_channelStats[channel];
+}
+
+ChannelStatistics ImagePlaneCache::computeChannelStatistics(int channel) const
+{
+    ChannelStatistics stats;
+    const float* plane = channelPlane(channel);
+    if (!plane || m_planeSize == 0) return stats;
+
+    // Shifted sums keep the single-pass variance well conditioned
+    const double shift = std::isfinite(plane[0]) ? plane[0] : 0.0;
+
+    struct Partial {
+        size_t count = 0;
+        double sum = 0.0;
+        double sumSq = 0.0;
+        float minimum = std::numeric_limits<float>::max();
+        float maximum = std::numeric_limits<float>::lowest();
+    };
+
+    int chunks = Parallel::chunkCount(m_planeSize);
+    std::vector<Partial> partials(chunks);
+
+    Parallel::forChunks(m_planeSize, chunks, [&](int c, size_t begin, size_t end) {
+        Partial p;
+        for (size_t i = begin; i < end; ++i) {
+            float v = plane[i];
+            if (!std::isfinite(v)) continue;
+            double d = v - shift;
+            p.sum += d;
+            p.sumSq += d * d;
+            p.minimum = std::min(p.minimum, v);
+            p.maximum = std::max(p.maximum, v);
+            ++p.count;
+        }
+        partials[c] = p;
+    });
+
+    Partial total;
+    for (const Partial& p : partials) {
+        total.count += p.count;
+        total.sum += p.sum;
+        total.sumSq += p.sumSq;
+        total.minimum = std::min(total.minimum, p.minimum);
+        total.maximum = std::max(total.maximum, p.maximum);
+    }
+    if (total.count == 0) return stats;
+
+    stats.valid = true;
+    stats.count = total.count;
+    stats.minimum = total.minimum;
+    stats.maximum = total.maximum;
+    stats.mean = shift + total.sum / total.count;
+    stats.sumSquares = std::max(0.0, total.sumSq - total.sum * total.sum / total.count);
+    stats.stdDev = std::sqrt(stats.sumSquares / total.count);
+
+    // Quantiles by successive selection on one scratch copy
+    std::vector<float> scratch;
+    scratch.reserve(total.count);
+    for (size_t i = 0; i < m_planeSize; ++i) {
+        if (std::isfinite(plane[i])) scratch.push_back(plane[i]);
+    }
+
+    size_t n = scratch.size();
+    size_t k10 = n / 10, k25 = n / 4, k50 = n / 2, k75 = 3 * n / 4;
+    auto first = scratch.begin();
+    std::nth_element(first, first + k10, scratch.end());
+    std::nth_element(first + k10, first + k25, scratch.end());
+    std::nth_element(first + k25, first + k50, scratch.end());
+    std::nth_element(first + k50, first + k75, scratch.end());
+
+    stats.percentile10 = scratch[k10];
+    stats.quartile1 = scratch[k25];
+    stats.median = scratch[k50];
+    stats.quartile3 = scratch[k75];
+
+    return stats;
+}
+
+ChannelStatistics ImagePlaneCache::combinedStatistics() const
+{
+    ChannelStatistics combined;
+    double weightedMean = 0.0;
+
+    QVector<ChannelStatistics> perChannel;
+    for (int ch = 0; ch < m_channels; ++ch) {
+        ChannelStatistics s = channelStatistics(ch);
+        if (!s.valid) continue;
+        perChannel.append(s);
+
+        if (!combined.valid) {
+            combined.minimum = s.minimum;
+            combined.maximum = s.maximum;
+            combined.valid = true;
+        }
+        combined.minimum = std::min(combined.minimum, s.minimum);
+        combined.maximum = std::max(combined.maximum, s.maximum);
+        combined.count += s.count;
+        weightedMean += s.mean * s.count;
+    }
+    if (!combined.valid) return combined;
+
+    combined.mean = weightedMean / combined.count;
+    for (const ChannelStatistics& s : perChannel) {
+        double d = s.mean - combined.mean;
+        combined.sumSquares += s.sumSquares + s.count * d * d;
+    }
+    combined.stdDev = std::sqrt(combined.sumSquares / combined.count);
+    return combined;
+}
+
+ChannelCovariance ImagePlaneCache::channelCovariance(const QVector<uchar>& mask) const
+{
+    if (m_channels < 1) return ChannelCovariance();
+
+    // Per-channel statistics first (they take the lock themselves); their
+    // means are used as shifts so the cross products stay well conditioned
+    for (int ch = 0; ch < m_channels; ++ch) {
+        channelStatistics(ch);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (mask.isEmpty()) {
+        if (!m_covariance.valid) {
+            m_covariance = computeChannelCovariance(mask);
+        }
+        return m_covariance;
+    }
+    return computeChannelCovariance(mask);
+}
+
+ChannelCovariance ImagePlaneCache::computeChannelCovariance(const QVector<uchar>& mask) const
+{
+    ChannelCovariance result;
+    const int n = m_channels;
+    const bool useMask = !mask.isEmpty();
+    if (useMask && static_cast<size_t>(mask.size()) < m_planeSize) return result;
+
+    std::vector<const float*> planes(n);
+    std::vector<double> shift(n);
+    for (int ch = 0; ch < n; ++ch) {
+        planes[ch] = channelPlane(ch);
+        if (!planes[ch]) return result;
+        shift[ch] = m_channelStats[ch].valid ? m_channelStats[ch].mean : 0.0;
+    }
+
+    // Upper triangle of the cross-product matrix, row-major packed
+    const int pairs = n * (n + 1) / 2;
+    const int terms = n + pairs;            // linear sums, then cross products
+    const size_t block = 4096;              // inner blocks summed plainly...
+    const uchar* maskData = useMask ? mask.constData() : nullptr;
+
+    struct Partial {
+        size_t count = 0;
+        std::vector<double> sum;            // ...then folded in with Neumaier
+        std::vector<double> compensation;
+    };
+
+    auto neumaierAdd = [](double& sum, double& comp, double value) {
+        double t = sum + value;
+        if (std::abs(sum) >= std::abs(value)) comp += (sum - t) + value;
+        else comp += (value - t) + sum;
+        sum = t;
+    };
+
+    int chunks = Parallel::chunkCount(m_planeSize);
+    std::vector<Partial> partials(chunks);
+
+    Parallel::forChunks(m_planeSize, chunks, [&](int c, size_t begin, size_t end) {
+        Partial& p = partials[c];
+        p.sum.assign(terms, 0.0);
+        p.compensation.assign(terms, 0.0);
+
+        // Block-local shifted planes; rejected pixels are zeroed so every
+        // reduction below is a contiguous, branch-free loop
+        std::vector<double> d(static_cast<size_t>(n) * block);
+        std::vector<double> weight(block);
+
+        for (size_t blockBegin = begin; blockBegin < end; blockBegin += block) {
+            const size_t len = std::min(end, blockBegin + block) - blockBegin;
+
+            for (size_t i = 0; i < len; ++i) {
+                bool use = !maskData || maskData[blockBegin + i];
+                for (int a = 0; a < n; ++a) {
+                    use = use && std::isfinite(planes[a][blockBegin + i]);
+                }
+                weight[i] = use ? 1.0 : 0.0;
+            }
+
+            for (int a = 0; a < n; ++a) {
+                const float* __restrict src = planes[a] + blockBegin;
+                const double* __restrict w = weight.data();
+                double* __restrict da = d.data() + a * block;
+                const double sa = shift[a];
+                for (size_t i = 0; i < len; ++i) {
+                    da[i] = w[i] != 0.0 ? (src[i] - sa) : 0.0;
+                }
+            }
+
+            double blockCount = 0.0;
+            for (size_t i = 0; i < len; ++i) blockCount += weight[i];
+            p.count += static_cast<size_t>(blockCount);
+
+            int k = n;
+            for (int a = 0; a < n; ++a) {
+                const double* __restrict da = d.data() + a * block;
+                double linear = 0.0;
+                for (size_t i = 0; i < len; ++i) linear += da[i];
+                neumaierAdd(p.sum[a], p.compensation[a], linear);
+
+                for (int b = a; b < n; ++b, ++k) {
+                    const double* __restrict db = d.data() + b * block;
+                    double cross = 0.0;
+                    for (size_t i = 0; i < len; ++i) cross += da[i] * db[i];
+                    neumaierAdd(p.sum[k], p.compensation[k], cross);
+                }
+            }
+        }
+    });
+
+    size_t count = 0;
+    std::vector<double> total(terms, 0.0), totalComp(terms, 0.0);
+    for (const Partial& p : partials) {
+        count += p.count;
+        for (int t = 0; t < terms; ++t) {
+            neumaierAdd(total[t], totalComp[t], p.sum[t]);
+            totalComp[t] += p.compensation[t];
+        }
+    }
+    if (count < 2) return result;
+
+    result.valid = true;
+    result.channels = n;
+    result.count = count;
+    result.means.resize(n);
+    result.covariance.fill(0.0, n * n);
+    result.correlation.fill(0.0, n * n);
+
+    std::vector<double> s(terms);
+    for (int t = 0; t < terms; ++t) s[t] = total[t] + totalComp[t];
+
+    for (int a = 0; a < n; ++a) {
+        result.means[a] = shift[a] + s[a] / count;
+    }
+
+    int k = n;
+    for (int a = 0; a < n; ++a) {
+        for (int b = a; b < n; ++b, ++k) {
+            double cov = (s[k] - s[a] * s[b] / count) / count;
+            result.covariance[a * n + b] = cov;
+            result.covariance[b * n + a] = cov;
+        }
+    }
+
+    for (int a = 0; a < n; ++a) {
+        for (int b = 0; b < n; ++b) {
+            double va = result.covariance[a * n + a];
+            double vb = result.covariance[b * n + b];
+            result.correlation[a * n + b] = (va > 0.0 && vb > 0.0)
+                ? result.covariance[a * n + b] / std::sqrt(va * vb)
+                : (a == b ? 1.0 : 0.0);
+        }
+    }
+
+    return result;
+}
+
+QVector<quint32> ImagePlaneCache::histogram(int channel, int bins) const
+{
+    if (bins <= 0) return QVector<quint32>();
+
+    ChannelStatistics stats = channelStatistics(channel);
+    if (!stats.valid) return QVector<quint32>();
+
+    QMutexLocker locker(&m_mutex);
+    const QPair<int, int> key(channel, bins);
+    auto it = m_histograms.constFind(key);
+    if (it != m_histograms.constEnd()) {
+        return it.value();
+    }
+
+    const float* plane = channelPlane(channel);
+    const double lo = stats.minimum;
+    const double range = stats.maximum - stats.minimum;
+    const double scale = range > 0.0 ? bins / range : 0.0;
+
+    int chunks = Parallel::chunkCount(m_planeSize);
+    std::vector<std::vector<quint32>> partials(chunks, std::vector<quint32>(bins, 0));
+
+    Parallel::forChunks(m_planeSize, chunks, [&](int c, size_t begin, size_t end) {
+        quint32* h = partials[c].data();
+        for (size_t i = begin; i < end; ++i) {
+            float v = plane[i];
+            if (!std::isfinite(v)) continue;
+            int bin = static_cast<int>((v - lo) * scale);
+            h[std::clamp(bin, 0, bins - 1)]++;
+        }
+    });
+
+    QVector<quint32> result(bins, 0);
+    for (const auto& p : partials) {
+        for (int b = 0; b < bins; ++b) result[b] += p[b];
+    }
+
+    m_histograms.insert(key, result);
+    return result;
+}
+
+ImageData ImagePlaneCache::pyramidLevel(int level) const
+{
+    QMutexLocker locker(&m_mutex);
+    return computePyramidLevel(std::max(0, level));
+}
+
+ImageData ImagePlaneCache::computePyramidLevel(int level) const
+{
+    if (level == 0) {
+        // The cache does not own the source buffer, so level 0 is a copy
+        ImageData base;
+        base.width = m_width;
+        base.height = m_height;
+        base.channels = m_channels;
+        base.pixels = QVector<float>(m_pixelData, m_pixelData + m_pixelCount);
+        return base;
+    }
+
+    if (level < m_pyramid.size() && m_pyramid[level].isValid()) {
+        return m_pyramid[level];
+    }
+
+    // Level 1 bins the source buffer directly, deeper levels their parent
+    ImageData parent;
+    const float* src = m_pixelData;
+    int srcWidth = m_width, srcHeight = m_height, channels = m_channels;
+    if (level > 1) {
+        parent = computePyramidLevel(level - 1);
+        src = parent.pixels.constData();
+        srcWidth = parent.width;
+        srcHeight = parent.height;
+    }
+    if (srcWidth < 2 || srcHeight < 2) {
+        return level > 1 ? parent : computePyramidLevel(0);
+    }
+
+    ImageData binned;
+    binned.width = srcWidth / 2;
+    binned.height = srcHeight / 2;
+    binned.channels = channels;
+    binned.pixels.resize(binned.width * binned.height * binned.channels);
+
+    const int srcW = srcWidth;
+    const size_t srcPlane = static_cast<size_t>(srcWidth) * srcHeight;
+    const size_t dstPlane = static_cast<size_t>(binned.width) * binned.height;
+    const int dstW = binned.width;
+    const size_t dstH = binned.height;
+    float* dst = binned.pixels.data();
+    const size_t rows = static_cast<size_t>(binned.height) * binned.channels;
+
+    // 2x2 box average; one output row reads two contiguous input rows
+    Parallel::forRange(rows, [=](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            size_t ch = r / dstH;
+            size_t y = r % dstH;
+            const float* row0 = src + ch * srcPlane + (2 * y) * srcW;
+            const float* row1 = row0 + srcW;
+            float* out = dst + ch * dstPlane + y * dstW;
+            for (int x = 0; x < dstW; ++x) {
+                out[x] = 0.25f * (row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1]);
+            }
+        }
+    }, 16);
+
+    if (m_pyramid.size() <= level) {
+        m_pyramid.resize(level + 1);
+    }
+    m_pyramid[level] = binned;
+    return binned;
+}
@@ -0,0 +1,105 @@
+// ImagePlaneCache.h - Lazily computed, shared products derived from ImageData pixels
+#ifndef IMAGE_PLANE_CACHE_H
+#define IMAGE_PLANE_CACHE_H
+
+#include <QMap>
+#include <QMutex>
+#include <QVector>
+#include <memory>
+
+#include "ImageReader.h"
+
+// Per-channel statistics computed in a single fused pass plus one
+// selection pass for the quantiles. Non-finite samples are ignored.
+struct ChannelStatistics {
+    bool valid = false;
+    size_t count = 0;           // Finite samples
+    double minimum = 0.0;
+    double maximum = 0.0;
+    double mean = 0.0;
+    double stdDev = 0.0;
+    double sumSquares = 0.0;    // Sum of squared deviations from the mean
+
+    // Quantiles (only for per-channel statistics, not combined ones)
+    double percentile10 = 0.0;
+    double quartile1 = 0.0;
+    double median = 0.0;
+    double quartile3 = 0.0;
+};
+
+// Full channel covariance and correlation matrices (row-major, channels x channels)
+struct ChannelCovariance {
+    bool valid = false;
+    int channels = 0;
+    size_t count = 0;               // Pixels that contributed (all channels finite, in mask)
+    QVector<double> means;
+    QVector<double> covariance;
+    QVector<double> correlation;
+
+    double covarianceBetween(int a, int b) const { return covariance[a * channels + b]; }
+    double correlationBetween(int a, int b) const { return correlation[a * channels + b]; }
+};
+
+// Cache of products derived from an ImageData's pixels. Every product is
+// computed once on first request and then shared read-only by every copy of
+// the ImageData that still refers to the same pixel buffer. Entries are
+// keyed on the buffer and ImageData::pixelGeneration but do not keep the
+// buffer alive, so writing the pixels never copies them: plane views are
+// valid only while the ImageData is alive and unedited. Obtain it with
+// ImageData::derived(); do not hold on to it across pixel edits.
+class ImagePlaneCache
+{
+public:
+    explicit ImagePlaneCache(const ImageData& imageData);
+
+    // True while the cache still describes the given image's pixel buffer
+    bool matches(const ImageData& imageData) const;
+
+    // Zero-copy view of one channel plane (nullptr if out of range)
+    const float* channelPlane(int channel) const;
+    size_t planeSize() const { return m_planeSize; }
+
+    // Weighted luminance plane. Uses Rec.601 weights when fewer than three
+    // weights are given; single-channel images return channel 0 unchanged.
+    QVector<float> luminance(const QVector<double>& weights = QVector<double>()) const;
+
+    // Statistics for one channel, or for all samples together (moments only)
+    ChannelStatistics channelStatistics(int channel) const;
+    ChannelStatistics combinedStatistics() const;
+
+    // Covariance of all channel pairs in one pass at full resolution. When a
+    // mask (one byte per pixel, non-zero = use) is given only those pixels
+    // contribute; the unmasked result is cached.
+    ChannelCovariance channelCovariance(const QVector<uchar>& mask = QVector<uchar>()) const;
+
+    // Histogram of one channel over its [minimum, maximum] range
+    QVector<quint32> histogram(int channel, int bins = 1024) const;
+
+    // Binned copy of the image: level 0 is a copy of the full image, level n
+    // is averaged over 2^n x 2^n blocks. Stops once either side reaches 1 pixel.
+    ImageData pyramidLevel(int level) const;
+
+private:
+    ChannelStatistics computeChannelStatistics(int channel) const;
+    ChannelCovariance computeChannelCovariance(const QVector<uchar>& mask) const;
+    ImageData computePyramidLevel(int level) const;
+
+    // Key identifying the pixel buffer the products were derived from
+    const float* m_pixelData = nullptr;
+    int m_pixelCount = 0;
+    quint64 m_generation = 0;
+    int m_width = 0;
+    int m_height = 0;
+    int m_channels = 0;
+    size_t m_planeSize = 0;
+
+    mutable QMutex m_mutex;
+    mutable QMap<QVector<double>, QVector<float>> m_luminance;
+    mutable QVector<ChannelStatistics> m_channelStats;
+    mutable QVector<bool> m_channelStatsReady;
+    mutable QMap<QPair<int, int>, QVector<quint32>> m_histograms;
+    mutable ChannelCovariance m_covariance;
+    mutable QVector<ImageData> m_pyramid;   // Index 0 unused (level 0 is the image)
+};
+
+#endif // IMAGE_PLANE_CACHE_H
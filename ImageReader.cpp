@@ -1,4 +1,5 @@
 #include "ImageReader.h"
+#include "TIFFBlockDecoder.h"
 
 // Initialize mock PCL API before including PCL headers
 #include "PCLMockAPI.h"
@@ -19,6 +20,10 @@
 // Qt includes
 #include <QDebug>
 #include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <cstring>
 
 class ImageReaderPrivate
 {
@@ -26,8 +31,14 @@ public:
     ImageData imageData;
     QString lastError;
     bool mockInitialized = false;
+    XISFChecksumPolicy checksumPolicy = XISFChecksumPolicy::Verify;
+    QFuture<bool> deferredChecksum;
     
     void initializePCLMock() {
+        // The API interface is process-wide; readers may run on pool threads
+        static QMutex initMutex;
+        QMutexLocker locker(&initMutex);
+        
         if (!mockInitialized) {
             qDebug() << "Initializing PCL Mock API...";
             
@@ -45,6 +56,156 @@ public:
         }
     }
     
+    // Decode keywords once into the typed store and keep display lines
+    void appendFITSKeywords(const pcl::FITSKeywordArray& keywords) {
+        for (const auto& keyword : keywords) {
+            QString name = QString::fromUtf8(keyword.name.c_str());
+            QString value = QString::fromUtf8(keyword.value.c_str());
+            QString comment = QString::fromUtf8(keyword.comment.c_str());
+            
+            if (!name.isEmpty()) {
+                imageData.keywords.insertRaw(name, value, comment);
+                
+                QString entry = QString("%1: %2").arg(name, value.isEmpty() ? "(empty)" : value);
+                if (!comment.isEmpty()) {
+                    entry += QString(" (%1)").arg(comment);
+                }
+                imageData.metadata.append(entry);
+            }
+        }
+    }
+    
+    // FITS keywords embedded in an XISF header plus the image properties,
+    // all decoded into the same typed store
+    void appendXISFKeywords(pcl::XISFReader& reader) {
+        try {
+            appendFITSKeywords(reader.ReadFITSKeywords());
+        } catch (...) {
+            imageData.metadata.append("FITS Keywords: (unable to read)");
+        }
+        
+        try {
+            pcl::PropertyArray properties = reader.ReadImageProperties();
+            for (const auto& prop : properties) {
+                QString propName = QString::fromUtf8(prop.Id().c_str());
+                QString propValue;
+                try {
+                    propValue = QString::fromUtf8(prop.Value().ToIsoString().c_str());
+                } catch (...) {
+                    // Vector/matrix properties have no scalar text form
+                }
+                imageData.keywords.insertText(propName, propValue);
+                imageData.metadata.append(QString("Property: %1").arg(propName) +
+                                          (propValue.isEmpty() ? QString() : QString(" = %1").arg(propValue)));
+            }
+        } catch (...) {
+            // If property reading fails, just continue
+            imageData.metadata.append("Properties: (unable to read)");
+        }
+    }
+    
+    void setGeometry(int width, int height, int channels, const QString& format) {
+        imageData.width = width;
+        imageData.height = height;
+        imageData.channels = channels;
+        imageData.format = format;
+        
+        if (channels == 1) {
+            imageData.colorSpace = "Grayscale";
+        } else if (channels == 3) {
+            imageData.colorSpace = "RGB";
+        } else {
+            imageData.colorSpace = QString("Multi-channel (%1)").arg(channels);
+        }
+        
+        imageData.metadata.append(QString("Dimensions: %1 × %2 × %3")
+                                .arg(width).arg(height).arg(channels));
+    }
+    
+    // Header-only opens: PCL's Open() parses headers and image descriptions
+    // without decoding any pixel data, so these never touch the data blocks.
+    bool readXISFHeader(const QString& filePath) {
+        initializePCLMock();
+        
+        try {
+            pcl::XISFReader reader;
+            reader.Open(pcl::String(filePath.toUtf8().constData()));
+            
+            if (reader.NumberOfImages() == 0) {
+                lastError = "No images found in XISF file";
+                return false;
+            }
+            
+            pcl::ImageInfo info = reader.ImageInfo();
+            setGeometry(info.width, info.height, info.numberOfChannels, "XISF");
+            appendXISFKeywords(reader);
+            
+            reader.Close();
+            imageData.headerOnly = true;
+            return true;
+            
+        } catch (const pcl::Error& e) {
+            lastError = QString("PCL XISF Error: %1").arg(e.Message().c_str());
+            return false;
+        } catch (const std::exception& e) {
+            lastError = QString("XISF Error: %1").arg(e.what());
+            return false;
+        }
+    }
+    
+    bool readFITSHeader(const QString& filePath) {
+        initializePCLMock();
+        
+        try {
+            pcl::FITSReader reader;
+            reader.Open(pcl::String(filePath.toUtf8().constData()));
+            
+            const pcl::ImageInfo& info = reader.Info();
+            setGeometry(info.width, info.height, info.numberOfChannels, "FITS");
+            appendFITSKeywords(reader.ReadFITSKeywords());
+            
+            reader.Close();
+            imageData.headerOnly = true;
+            return true;
+            
+        } catch (const pcl::Error& e) {
+            lastError = QString("PCL FITS Error: %1").arg(e.Message().c_str());
+            return false;
+        } catch (const std::exception& e) {
+            lastError = QString("FITS Error: %1").arg(e.what());
+            return false;
+        } catch (...) {
+            lastError = QString("Unknown error reading FITS header: %1").arg(filePath);
+            return false;
+        }
+    }
+    
+    bool readTIFFHeader(const QString& filePath) {
+        initializePCLMock();
+        
+        try {
+            pcl::TIFFReader reader;
+            reader.Open(pcl::String(filePath.toStdString().c_str()));
+            
+            const pcl::ImageInfo& info = reader.Info();
+            setGeometry(info.width, info.height, info.numberOfChannels, "TIFF");
+            
+            reader.Close();
+            imageData.headerOnly = true;
+            return true;
+            
+        } catch (const pcl::Exception& e) {
+            lastError = QString("TIFF header read failed: %1").arg(e.Message().c_str());
+            return false;
+        } catch (const std::exception& e) {
+            lastError = QString("TIFF Error: %1").arg(e.what());
+            return false;
+        } catch (...) {
+            lastError = QString("Unknown error reading TIFF header: %1").arg(filePath);
+            return false;
+        }
+    }
+    
     bool readXISF(const QString& filePath) {
         initializePCLMock();
         
@@ -59,15 +220,44 @@ public:
                 return false;
             }
             
-            // Read the first image
-            pcl::Image pclImage;
-	    //	    reader.Setindex(0);
-            reader.ReadImage(pclImage);
+            // Attached blocks (compressed or not) decode natively in parallel;
+            // anything else goes through PCL
+            XISFDecodedImage decoded;
+            QString decodeError;
+            XISFBlockDecoder::Status status =
+                XISFBlockDecoder::decodeFirstImage(filePath, checksumPolicy, decoded, &decodeError);
+            if (status == XISFBlockDecoder::Failed) {
+                lastError = QString("XISF Error: %1").arg(decodeError);
+                return false;
+            }
             
-            // Extract image dimensions and format info
-            imageData.width = pclImage.Width();
-            imageData.height = pclImage.Height();
-            imageData.channels = pclImage.NumberOfChannels();
+            if (status == XISFBlockDecoder::Decoded) {
+                imageData.width = decoded.width;
+                imageData.height = decoded.height;
+                imageData.channels = decoded.channels;
+                imageData.pixels = std::move(decoded.pixels);
+                deferredChecksum = decoded.checksum;
+                if (!decoded.codec.isEmpty()) {
+                    imageData.metadata.append(QString("Compression: %1 (%2 sub-blocks)")
+                                            .arg(decoded.codec).arg(decoded.subBlocks));
+                }
+            } else {
+                // Read the first image
+                pcl::Image pclImage;
+                reader.ReadImage(pclImage);
+                
+                imageData.width = pclImage.Width();
+                imageData.height = pclImage.Height();
+                imageData.channels = pclImage.NumberOfChannels();
+                
+                // Copy pixel data, one plane at a time
+                const size_t planeSize = static_cast<size_t>(imageData.width) * imageData.height;
+                imageData.pixels.resize(planeSize * imageData.channels);
+                for (int c = 0; c < imageData.channels; ++c) {
+                    std::memcpy(imageData.pixels.data() + c * planeSize, pclImage.PixelData(c),
+                                planeSize * sizeof(float));
+                }
+            }
             imageData.format = "XISF";
             
             // Determine color space
@@ -79,19 +269,6 @@ public:
                 imageData.colorSpace = QString("Multi-channel (%1)").arg(imageData.channels);
             }
             
-            // Copy pixel data
-            size_t totalPixels = static_cast<size_t>(imageData.width) * imageData.height * imageData.channels;
-            imageData.pixels.resize(totalPixels);
-            
-            float* dst = imageData.pixels.data();
-            for (int c = 0; c < imageData.channels; ++c) {
-                for (int y = 0; y < imageData.height; ++y) {
-                    for (int x = 0; x < imageData.width; ++x) {
-                        *dst++ = static_cast<float>(pclImage.Pixel(x, y, c));
-                    }
-                }
-            }
-            
             // Extract metadata
             imageData.metadata.append(QString("Dimensions: %1 × %2 × %3")
                                     .arg(imageData.width).arg(imageData.height).arg(imageData.channels));
@@ -99,18 +276,7 @@ public:
             // Get XISF-specific metadata (simplified approach)
             imageData.metadata.append(QString("Format: XISF"));
             
-            // Try to read some common properties (simplified)
-            try {
-                pcl::PropertyArray properties = reader.ReadImageProperties();
-                for (const auto& prop : properties) {
-                    QString propName = QString::fromUtf8(prop.Id().c_str());
-                    // Just show the property name for now, since the value access API varies
-                    imageData.metadata.append(QString("Property: %1").arg(propName));
-                }
-            } catch (...) {
-                // If property reading fails, just continue
-                imageData.metadata.append("Properties: (unable to read)");
-            }
+            appendXISFKeywords(reader);
             
             reader.Close();
             qDebug() << "Successfully read XISF file:" << filePath;
@@ -129,6 +295,26 @@ public:
 
     bool readTIFF(const QString& filePath)
     {
+        // Strips/tiles decode in parallel straight into the planes; PCL
+        // handles the sample layouts the block decoder does not
+        TIFFDecodedImage decoded;
+        QString decodeError;
+        TIFFBlockDecoder::Status status = TIFFBlockDecoder::decode(filePath, decoded, &decodeError);
+        if (status == TIFFBlockDecoder::Failed) {
+            lastError = QString("TIFF Error: %1").arg(decodeError);
+            return false;
+        }
+        if (status == TIFFBlockDecoder::Decoded) {
+            setGeometry(decoded.width, decoded.height, decoded.channels, "TIFF");
+            imageData.pixels = std::move(decoded.pixels);
+            imageData.metadata.append(QString("Sample format: %1-bit %2")
+                                    .arg(decoded.bitsPerSample)
+                                    .arg(decoded.floatingPoint ? "float" : "unsigned"));
+            return true;
+        }
+
+	initializePCLMock();
+
 	try {
 	    pcl::TIFFReader reader;
 	    reader.Open(pcl::String(filePath.toStdString().c_str()));
@@ -140,22 +326,26 @@ public:
 	    int height = pclImage.Height();
 	    int channels = pclImage.NumberOfChannels();
 
-	    imageData.width = width;
-	    imageData.height = height;
-	    imageData.channels = channels;
-	    imageData.pixels.resize(width * height * channels);
+	    setGeometry(width, height, channels, "TIFF");
+	    const size_t planeSize = static_cast<size_t>(width) * height;
+	    imageData.pixels.resize(planeSize * channels);
 
 	    for (int c = 0; c < channels; ++c) {
-		const float* plane = pclImage.PixelData(c);
-		for (int i = 0; i < width * height; ++i) {
-		    imageData.pixels[i + c * width * height] = plane[i];
-		}
+		std::memcpy(imageData.pixels.data() + c * planeSize, pclImage.PixelData(c),
+			    planeSize * sizeof(float));
 	    }
 
 	    return true;
 
 	} catch (const pcl::Exception& e) {
 	    qWarning() << "TIFF load failed:" << e.Message().c_str();
+	    lastError = QString("PCL TIFF Error: %1").arg(e.Message().c_str());
+	    return false;
+	} catch (const std::exception& e) {
+	    lastError = QString("TIFF Error: %1").arg(e.what());
+	    return false;
+	} catch (...) {
+	    lastError = QString("Unknown error reading TIFF file: %1").arg(filePath);
 	    return false;
 	}
     }
@@ -238,19 +428,7 @@ public:
                 pcl::FITSKeywordArray keywords = reader.ReadFITSKeywords();
                 qDebug() << "Found" << keywords.Length() << "FITS keywords";
                 
-                for (const auto& keyword : keywords) {
-                    QString name = QString::fromUtf8(keyword.name.c_str());
-                    QString value = QString::fromUtf8(keyword.value.c_str());
-                    QString comment = QString::fromUtf8(keyword.comment.c_str());
-                    
-                    if (!name.isEmpty()) {
-                        QString entry = QString("%1: %2").arg(name, value.isEmpty() ? "(empty)" : value);
-                        if (!comment.isEmpty()) {
-                            entry += QString(" (%1)").arg(comment);
-                        }
-                        imageData.metadata.append(entry);
-                    }
-                }
+                appendFITSKeywords(keywords);
             } catch (const pcl::Error& e) {
                 qDebug() << "Error reading FITS keywords:" << e.Message().c_str();
                 imageData.metadata.append(QString("FITS Keywords: Error - %1").arg(e.Message().c_str()));
@@ -293,6 +471,7 @@ bool ImageReader::readFile(const QString& filePath)
 {
     d->imageData.clear();
     d->lastError.clear();
+    d->deferredChecksum = QFuture<bool>();
     
     if (filePath.isEmpty()) {
         d->lastError = "Empty file path";
@@ -320,6 +499,35 @@ bool ImageReader::readFile(const QString& filePath)
     }
 }
 
+bool ImageReader::readHeader(const QString& filePath)
+{
+    d->imageData.clear();
+    d->lastError.clear();
+    
+    if (filePath.isEmpty()) {
+        d->lastError = "Empty file path";
+        return false;
+    }
+    
+    if (!QFileInfo::exists(filePath)) {
+        d->lastError = QString("File does not exist: %1").arg(filePath);
+        return false;
+    }
+    
+    QString fileType = detectFileType(filePath);
+    
+    if (fileType == "XISF") {
+        return d->readXISFHeader(filePath);
+    } else if (fileType == "FITS") {
+        return d->readFITSHeader(filePath);
+    } else if (fileType == "TIFF") {
+        return d->readTIFFHeader(filePath);
+    } else {
+        d->lastError = QString("Unsupported file format: %1").arg(fileType);
+        return false;
+    }
+}
+
 const ImageData& ImageReader::imageData() const
 {
     return d->imageData;
@@ -347,6 +555,16 @@ QString ImageReader::lastError() const
     return d->lastError;
 }
 
+void ImageReader::setXISFChecksumPolicy(XISFChecksumPolicy policy)
+{
+    d->checksumPolicy = policy;
+}
+
+QFuture<bool> ImageReader::deferredChecksum() const
+{
+    return d->deferredChecksum;
+}
+
 QStringList ImageReader::supportedFormats()
 {
   return {"XISF", "FITS", "TIFF"};
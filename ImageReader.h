@@ -6,8 +6,12 @@
 #include <QStringList>
 #include <memory>
 
+#include "ImageKeywords.h"
+#include "XISFBlockDecoder.h"
+
 // Forward declarations
 class ImageReaderPrivate;
+class ImagePlaneCache;
 
 struct ImageData {
     int width = 0;
@@ -16,18 +20,34 @@ struct ImageData {
     QVector<float> pixels;
     QString colorSpace;
     QString format;
-    QStringList metadata;
+    QStringList metadata;           // Human-readable lines for display
+    ImageKeywordStore keywords;     // Typed FITS keywords / XISF properties
+    bool headerOnly = false;        // Opened with readHeader(): no pixel data
+    
+    // Lazily computed derived products (luminance, statistics, histograms,
+    // pyramid levels) shared by copies of this image. Stale entries are
+    // detected from the pixel buffer and generation and rebuilt on the next
+    // access; call invalidateDerived() after editing pixels in place.
+    mutable std::shared_ptr<ImagePlaneCache> derivedCache;
+    quint64 pixelGeneration = 0;
     
     bool isValid() const { 
         return width > 0 && height > 0 && channels > 0 && !pixels.isEmpty(); 
     }
     
+    // Defined in ImagePlaneCache.cpp
+    std::shared_ptr<const ImagePlaneCache> derived() const;
+    void invalidateDerived();
+    
     void clear() {
         width = height = channels = 0;
+        headerOnly = false;
         pixels.clear();
         colorSpace.clear();
         format.clear();
         metadata.clear();
+        keywords.clear();
+        invalidateDerived();
     }
 };
 
@@ -40,6 +60,9 @@ public:
     // File reading
     bool readFile(const QString& filePath);
     
+    // Header-only open: dimensions, format and keywords, no pixel data
+    bool readHeader(const QString& filePath);
+    
     // Data access
     const ImageData& imageData() const;
     bool hasImage() const;
@@ -49,6 +72,11 @@ public:
     // Error handling
     QString lastError() const;
     
+    // XISF block checksums: verified while decompressing by default. With
+    // Defer the read returns at once and deferredChecksum() reports later.
+    void setXISFChecksumPolicy(XISFChecksumPolicy policy);
+    QFuture<bool> deferredChecksum() const;
+    
     // Supported formats
     static QStringList supportedFormats();
     static QString formatFilter();
@@ -0,0 +1,349 @@
+// IncrementalBackgroundFit.cpp - Polynomial background refit with rank-one Cholesky updates
+#include "IncrementalBackgroundFit.h"
+#include "ParallelFor.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Keeps R'R positive definite with fewer samples than terms; negligible
+// next to a single sample's contribution (basis values are O(1))
+const double kRidge = 1e-6;
+
+// Rounding accumulates over up/downdate cycles; start over periodically
+const int kDowndatesPerRefactorization = 256;
+
+int termsForOrder(int order)
+{
+    return (order + 1) * (order + 2) / 2;
+}
+
+} // namespace
+
+void IncrementalBackgroundFit::reset(const ImageData& image, int order, int sampleRadius)
+{
+    m_image = image;
+    m_sampleRadius = std::max(0, sampleRadius);
+    m_samples.clear();
+    m_order = std::clamp(order, 1, 3);
+    m_terms = termsForOrder(m_order);
+    refactorize();
+}
+
+void IncrementalBackgroundFit::clear()
+{
+    m_samples.clear();
+    refactorize();
+}
+
+void IncrementalBackgroundFit::setOrder(int order)
+{
+    order = std::clamp(order, 1, 3);
+    if (order == m_order) return;
+    m_order = order;
+    m_terms = termsForOrder(m_order);
+    refactorize();
+}
+
+// Monomials x^px y^py, py outer and px inner as in the worker's fit, on
+// coordinates centred to [-1, 1] for better conditioning
+void IncrementalBackgroundFit::basis(double x, double y, double* out) const
+{
+    const double nx = m_image.width > 1 ? 2.0 * x / (m_image.width - 1) - 1.0 : 0.0;
+    const double ny = m_image.height > 1 ? 2.0 * y / (m_image.height - 1) - 1.0 : 0.0;
+
+    double yPower = 1.0;
+    int t = 0;
+    for (int py = 0; py <= m_order; ++py) {
+        double xPower = 1.0;
+        for (int px = 0; px <= m_order - py; ++px) {
+            out[t++] = xPower * yPower;
+            xPower *= nx;
+        }
+        yPower *= ny;
+    }
+}
+
+int IncrementalBackgroundFit::addSample(const QPoint& position)
+{
+    if (!isValid() || position.x() < 0 || position.y() < 0 ||
+        position.x() >= m_image.width || position.y() >= m_image.height) {
+        return -1;
+    }
+
+    // Median of a small box per channel, so a click on noise or a faint
+    // star does not pull the model
+    IncrementalSample sample;
+    sample.position = position;
+    const int x0 = std::max(0, position.x() - m_sampleRadius);
+    const int x1 = std::min(m_image.width - 1, position.x() + m_sampleRadius);
+    const int y0 = std::max(0, position.y() - m_sampleRadius);
+    const int y1 = std::min(m_image.height - 1, position.y() + m_sampleRadius);
+    const size_t plane = size_t(m_image.width) * m_image.height;
+
+    QVector<float> box;
+    for (int c = 0; c < m_image.channels; ++c) {
+        box.clear();
+        const float* pixels = m_image.pixels.constData() + c * plane;
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) box.append(pixels[size_t(y) * m_image.width + x]);
+        }
+        std::nth_element(box.begin(), box.begin() + box.size() / 2, box.end());
+        sample.values.append(box[box.size() / 2]);
+    }
+
+    QVector<double> v(m_terms);
+    basis(position.x(), position.y(), v.data());
+    for (int c = 0; c < m_image.channels; ++c) {
+        for (int t = 0; t < m_terms; ++t) m_rhs[c][t] += v[t] * sample.values[c];
+    }
+    rankOneUpdate(v);
+
+    m_samples.append(sample);
+    solve();
+    return m_samples.size() - 1;
+}
+
+bool IncrementalBackgroundFit::removeSample(int index)
+{
+    if (index < 0 || index >= m_samples.size()) return false;
+
+    const IncrementalSample sample = m_samples.takeAt(index);
+    QVector<double> v(m_terms);
+    basis(sample.position.x(), sample.position.y(), v.data());
+
+    if (++m_downdates >= kDowndatesPerRefactorization || !rankOneDowndate(v)) {
+        refactorize();
+    } else {
+        for (int c = 0; c < m_image.channels; ++c) {
+            for (int t = 0; t < m_terms; ++t) m_rhs[c][t] -= v[t] * sample.values[c];
+        }
+    }
+
+    solve();
+    return true;
+}
+
+int IncrementalBackgroundFit::nearestSample(const QPoint& position, double maxDistance) const
+{
+    int best = -1;
+    double bestDistance = maxDistance * maxDistance;
+    for (int i = 0; i < m_samples.size(); ++i) {
+        const QPoint d = m_samples[i].position - position;
+        const double distance = double(d.x()) * d.x() + double(d.y()) * d.y();
+        if (distance <= bestDistance) {
+            bestDistance = distance;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// R'R + v v' (LINPACK dchud): one Givens rotation per row
+void IncrementalBackgroundFit::rankOneUpdate(QVector<double> v)
+{
+    const int n = m_terms;
+    double* R = m_factor.data();
+    for (int k = 0; k < n; ++k) {
+        const double rkk = R[k * n + k];
+        const double r = std::hypot(rkk, v[k]);
+        const double c = r / rkk;
+        const double s = v[k] / rkk;
+        R[k * n + k] = r;
+        for (int j = k + 1; j < n; ++j) {
+            R[k * n + j] = (R[k * n + j] + s * v[j]) / c;
+            v[j] = c * v[j] - s * R[k * n + j];
+        }
+    }
+}
+
+// R'R - v v'; false when the result would not be positive definite, in
+// which case the factor is left to be rebuilt
+bool IncrementalBackgroundFit::rankOneDowndate(QVector<double> v)
+{
+    const int n = m_terms;
+    QVector<double> factor = m_factor;
+    double* R = factor.data();
+    for (int k = 0; k < n; ++k) {
+        const double rkk = R[k * n + k];
+        const double r2 = rkk * rkk - v[k] * v[k];
+        if (r2 <= kRidge * 1e-3) return false;
+        const double r = std::sqrt(r2);
+        const double c = r / rkk;
+        const double s = v[k] / rkk;
+        R[k * n + k] = r;
+        for (int j = k + 1; j < n; ++j) {
+            R[k * n + j] = (R[k * n + j] - s * v[j]) / c;
+            v[j] = c * v[j] - s * R[k * n + j];
+        }
+    }
+    m_factor = factor;
+    return true;
+}
+
+void IncrementalBackgroundFit::refactorize()
+{
+    const int n = m_terms;
+    const int channels = std::max(0, m_image.channels);
+    m_downdates = 0;
+    ++m_refactorizations;
+
+    // Normal matrix and right-hand sides from the stored samples
+    QVector<double> normal(n * n, 0.0);
+    m_rhs = QVector<QVector<double>>(channels, QVector<double>(n, 0.0));
+    QVector<double> v(n);
+    for (const IncrementalSample& sample : m_samples) {
+        basis(sample.position.x(), sample.position.y(), v.data());
+        for (int i = 0; i < n; ++i) {
+            for (int j = i; j < n; ++j) normal[i * n + j] += v[i] * v[j];
+        }
+        for (int c = 0; c < channels; ++c) {
+            for (int t = 0; t < n; ++t) m_rhs[c][t] += v[t] * sample.values[c];
+        }
+    }
+    for (int i = 0; i < n; ++i) normal[i * n + i] += kRidge;
+
+    // Upper Cholesky: R'R = normal
+    m_factor.fill(0.0, n * n);
+    double* R = m_factor.data();
+    for (int i = 0; i < n; ++i) {
+        double diagonal = normal[i * n + i];
+        for (int k = 0; k < i; ++k) diagonal -= R[k * n + i] * R[k * n + i];
+        R[i * n + i] = std::sqrt(std::max(diagonal, kRidge));
+        for (int j = i + 1; j < n; ++j) {
+            double value = normal[i * n + j];
+            for (int k = 0; k < i; ++k) value -= R[k * n + i] * R[k * n + j];
+            R[i * n + j] = value / R[i * n + i];
+        }
+    }
+
+    solve();
+}
+
+// R'z = A'b forward, then R c = z back
+void IncrementalBackgroundFit::solve()
+{
+    const int n = m_terms;
+    const double* R = m_factor.constData();
+    m_coefficients.resize(m_rhs.size());
+    for (int c = 0; c < m_rhs.size(); ++c) {
+        QVector<double> z(n);
+        for (int i = 0; i < n; ++i) {
+            double value = m_rhs[c][i];
+            for (int k = 0; k < i; ++k) value -= R[k * n + i] * z[k];
+            z[i] = value / R[i * n + i];
+        }
+        QVector<double>& x = m_coefficients[c];
+        x.resize(n);
+        for (int i = n - 1; i >= 0; --i) {
+            double value = z[i];
+            for (int k = i + 1; k < n; ++k) value -= R[i * n + k] * x[k];
+            x[i] = value / R[i * n + i];
+        }
+    }
+}
+
+double IncrementalBackgroundFit::evaluate(int channel, double x, double y) const
+{
+    if (channel < 0 || channel >= m_coefficients.size()) return 0.0;
+    double v[10];
+    basis(x, y, v);
+    double value = 0.0;
+    for (int t = 0; t < m_terms; ++t) value += m_coefficients[channel][t] * v[t];
+    return value;
+}
+
+double IncrementalBackgroundFit::rmsResidual() const
+{
+    double sum = 0.0;
+    int count = 0;
+    for (const IncrementalSample& sample : m_samples) {
+        for (int c = 0; c < sample.values.size(); ++c) {
+            const double r = sample.values[c] - evaluate(c, sample.position.x(), sample.position.y());
+            sum += r * r;
+            ++count;
+        }
+    }
+    return count > 0 ? std::sqrt(sum / count) : 0.0;
+}
+
+int IncrementalBackgroundFit::previewLevel(int maxSize) const
+{
+    int level = 0;
+    while ((std::max(m_image.width, m_image.height) >> level) > maxSize) ++level;
+    return level;
+}
+
+ImageData IncrementalBackgroundFit::renderPreview(int level) const
+{
+    ImageData preview;
+    if (!isValid()) return preview;
+
+    preview.width = std::max(1, m_image.width >> level);
+    preview.height = std::max(1, m_image.height >> level);
+    preview.channels = m_image.channels;
+    preview.colorSpace = m_image.colorSpace;
+    preview.format = "Background Model Preview";
+    preview.pixels.resize(preview.width * preview.height * preview.channels);
+    render(level, preview.width, preview.height, preview.pixels.data());
+    return preview;
+}
+
+QVector<float> IncrementalBackgroundFit::renderFull() const
+{
+    QVector<float> model;
+    if (!isValid()) return model;
+    model.resize(m_image.width * m_image.height * m_image.channels);
+    render(0, m_image.width, m_image.height, model.data());
+    return model;
+}
+
+// Separable evaluation: x powers once per column, y powers once per row
+void IncrementalBackgroundFit::render(int level, int width, int height, float* out) const
+{
+    const double binning = double(1 << level);
+    const double offset = (binning - 1.0) * 0.5;    // Centre of each binned pixel
+    const int order = m_order;
+    const int channels = m_coefficients.size();
+    const size_t plane = size_t(width) * height;
+
+    const double sx = m_image.width > 1 ? 2.0 / (m_image.width - 1) : 0.0;
+    const double sy = m_image.height > 1 ? 2.0 / (m_image.height - 1) : 0.0;
+
+    QVector<double> xPowers(width * (order + 1));
+    for (int x = 0; x < width; ++x) {
+        const double nx = m_image.width > 1 ? (x * binning + offset) * sx - 1.0 : 0.0;
+        double p = 1.0;
+        for (int k = 0; k <= order; ++k, p *= nx) xPowers[x * (order + 1) + k] = p;
+    }
+
+    Parallel::forRange(height, [&](size_t begin, size_t end) {
+        QVector<double> rowTerms(m_terms);
+        for (size_t y = begin; y < end; ++y) {
+            const double ny = m_image.height > 1 ? (y * binning + offset) * sy - 1.0 : 0.0;
+            for (int c = 0; c < channels; ++c) {
+                // Fold the y powers into the coefficients once per row
+                const QVector<double>& coefficients = m_coefficients[c];
+                double yPower = 1.0;
+                int t = 0;
+                for (int py = 0; py <= order; ++py, yPower *= ny) {
+                    for (int px = 0; px <= order - py; ++px, ++t) rowTerms[t] = coefficients[t] * yPower;
+                }
+
+                float* row = out + c * plane + y * width;
+                for (int x = 0; x < width; ++x) {
+                    const double* powers = xPowers.constData() + x * (order + 1);
+                    double value = 0.0;
+                    t = 0;
+                    for (int py = 0; py <= order; ++py) {
+                        for (int px = 0; px <= order - py; ++px, ++t) value += rowTerms[t] * powers[px];
+                    }
+                    row[x] = float(value);
+                }
+            }
+        }
+    }, 16);
+}
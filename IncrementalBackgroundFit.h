@@ -0,0 +1,79 @@
+// IncrementalBackgroundFit.h - Polynomial background refit with rank-one Cholesky updates
+#ifndef INCREMENTAL_BACKGROUND_FIT_H
+#define INCREMENTAL_BACKGROUND_FIT_H
+
+#include <QPoint>
+#include <QVector>
+
+#include "ImageReader.h"
+
+struct IncrementalSample {
+    QPoint position;
+    QVector<float> values;          // Per channel, median of a small box
+};
+
+// Interactive counterpart of BackgroundExtractionWorker's polynomial fit.
+// The normal equations A'A c = A'b are kept as their Cholesky factor R
+// (R'R = A'A + ridge * I) together with A'b per channel, so adding a
+// sample is a rank-one update and removing one a rank-one downdate: O(n^2)
+// in the number of terms instead of a refit over every sample. A downdate
+// that loses positive definiteness falls back to refactorising from the
+// stored samples.
+//
+// Models are rendered at a pyramid level for the per-click preview; the
+// full-resolution render is left to renderFull() when the edit is kept.
+class IncrementalBackgroundFit
+{
+public:
+    // Shares the image's pixel buffer; polynomial order 1-3 as in
+    // BackgroundExtractionSettings (Linear, Polynomial2, Polynomial3)
+    void reset(const ImageData& image, int order, int sampleRadius = 2);
+    void clear();
+    bool isValid() const { return m_image.isValid(); }
+
+    int order() const { return m_order; }
+    void setOrder(int order);
+    int termCount() const { return m_terms; }
+
+    // Returns the index of the new sample, or -1 outside the image
+    int addSample(const QPoint& position);
+    bool removeSample(int index);
+    int nearestSample(const QPoint& position, double maxDistance) const;
+    const QVector<IncrementalSample>& samples() const { return m_samples; }
+
+    // Enough samples for the polynomial to be constrained by data alone
+    bool isDetermined() const { return m_samples.size() >= m_terms; }
+    const QVector<double>& coefficients(int channel) const { return m_coefficients[channel]; }
+    double evaluate(int channel, double x, double y) const;
+    double rmsResidual() const;
+    int refactorizations() const { return m_refactorizations; }
+
+    // Pyramid level whose longer side is at most maxSize pixels
+    int previewLevel(int maxSize = 1024) const;
+    // Model on the binned grid of `level` (level 0 is full resolution),
+    // planar like ImageData
+    ImageData renderPreview(int level) const;
+    QVector<float> renderFull() const;
+
+private:
+    void basis(double x, double y, double* out) const;
+    void rankOneUpdate(QVector<double> v);
+    bool rankOneDowndate(QVector<double> v);
+    void refactorize();
+    void solve();
+    void render(int level, int width, int height, float* out) const;
+
+    ImageData m_image;
+    int m_order = 2;
+    int m_terms = 6;
+    int m_sampleRadius = 2;
+    int m_downdates = 0;
+    int m_refactorizations = 0;
+
+    QVector<double> m_factor;                   // Upper triangular R, row-major terms x terms
+    QVector<QVector<double>> m_rhs;             // A'b per channel
+    QVector<QVector<double>> m_coefficients;    // Solution per channel
+    QVector<IncrementalSample> m_samples;
+};
+
+#endif // INCREMENTAL_BACKGROUND_FIT_H
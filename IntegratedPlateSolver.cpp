@@ -10,7 +10,7 @@
 #include <cmath>
 #include <algorithm>
 #include "PCLMockAPI.h"
-#include "AstrometryDirectSolver.h"
+#include "NativeQuadSolver.h"
 
 // WCSData conversion implementation
 WCSData PlatesolveResult::toWCSData(int imageWidth, int imageHeight) const
@@ -41,90 +41,181 @@ WCSData PlatesolveResult::toWCSData(int imageWidth, int imageHeight) const
 
 // SolverWorker Implementation (runs in separate thread)
 
+engine_t* SolverWorker::s_engine = nullptr;
+bool SolverWorker::s_engineInitialized = false;
+QMutex SolverWorker::s_engineMutex;
+int SolverWorker::s_workerCount = 0;
+
 SolverWorker::SolverWorker(QObject* parent)
     : QObject(parent)
-    , m_engine(nullptr)
-    , m_engineInitialized(false)
+    , m_cancelRequested(false)
+    , m_requestId(-1)
 {
-    // Initialize GSL and logging like the starlist solver does
-    gslutils_use_error_system();
-    loginit();
-    errors_log_to(stderr);
+    QMutexLocker locker(&s_engineMutex);
+    if (s_workerCount++ == 0) {
+        // Initialize GSL and logging like the starlist solver does
+        gslutils_use_error_system();
+        loginit();
+        errors_log_to(stderr);
+    }
 }
 
 SolverWorker::~SolverWorker()
 {
-    cleanupEngine();
+    bool last;
+    {
+        QMutexLocker locker(&s_engineMutex);
+        last = (--s_workerCount == 0);
+    }
+    if (last) {
+        cleanupEngine();
+    }
 }
 
-void SolverWorker::solvePlate(const QVector<SolveDetectedStar>& stars, const SolveOptions& options)
+void SolverWorker::requestCancel()
 {
-    emit solveProgress("Initializing astrometry engine...");
+    m_cancelRequested = true;
+    
+    QMutexLocker locker(&m_jobMutex);
+    if (m_activeJob) {
+        m_activeJob->bp.solver.quit_now = TRUE;
+    }
+}
+
+void SolverWorker::solvePlate(int requestId, const QVector<SolveDetectedStar>& stars, const SolveOptions& options)
+{
+    m_requestId = requestId;
+
+    if (options.useNativeSolver) {
+        emit solveRunning(m_requestId);
+        solveNative(stars, options);
+        return;
+    }
+
+    emit solveProgress(m_requestId, "Waiting for astrometry engine...");
+    
+    // Held from initialisation until the job is freed: the engine and its
+    // indexes are shared with the other workers
+    QMutexLocker locker(&s_engineMutex);
+    
+    if (m_cancelRequested) {
+        emit solveFailed(m_requestId, "Solve cancelled");
+        return;
+    }
+    
+    // The time limit counts from here, not from the wait for the engine
+    emit solveRunning(m_requestId);
     
     // Initialize engine if needed
-    if (!m_engineInitialized) {
+    if (!s_engineInitialized) {
+        emit solveProgress(m_requestId, "Initializing astrometry engine...");
         if (!initializeEngine(options)) {
-            emit solveFailed("Failed to initialize astrometry engine");
+            emit solveFailed(m_requestId, "Failed to initialize astrometry engine");
             return;
         }
     }
     
     if (stars.isEmpty()) {
-        emit solveFailed("No stars provided for solving");
+        emit solveFailed(m_requestId, "No stars provided for solving");
         return;
     }
     
-    emit solveProgress(QString("Creating job with %1 stars...").arg(stars.size()));
+    emit solveProgress(m_requestId, QString("Creating job with %1 stars...").arg(stars.size()));
     
     // Create job directly from stars (like your starlist solver)
     job_t* job = createJobFromStars(stars, options);
     if (!job) {
-        emit solveFailed("Failed to create job from star data");
+        emit solveFailed(m_requestId, "Failed to create job from star data");
         return;
     }
     
-    emit solveProgress("Running astrometry engine...");
+    emit solveProgress(m_requestId, "Running astrometry engine...");
     
-    QMutexLocker locker(&m_engineMutex);
+    {
+        QMutexLocker jobLocker(&m_jobMutex);
+        m_activeJob = job;
+        if (m_cancelRequested) {
+            job->bp.solver.quit_now = TRUE;
+        }
+    }
     
     // Run the job using the engine (this is the core solving from your starlist solver)
-    int solve_result = engine_run_job(m_engine, job);
+    int solve_result = engine_run_job(s_engine, job);
+    
+    {
+        QMutexLocker jobLocker(&m_jobMutex);
+        m_activeJob = nullptr;
+    }
     
     PlatesolveResult result;
     
-    if (solve_result == 0) {
+    if (m_cancelRequested) {
+        // Preempted or timed out: whatever the engine found is discarded
+        emit solveFailed(m_requestId, "Solve cancelled");
+    } else if (solve_result == 0) {
         // Success - extract WCS solution
         result = extractResultFromJob(job);
         if (result.solved) {
-            emit solveComplete(result);
+            emit solveComplete(m_requestId, result);
         } else {
-            emit solveFailed("Failed to extract WCS solution from job");
+            emit solveFailed(m_requestId, "Failed to extract WCS solution from job");
         }
     } else {
         result.solved = false;
         result.errorMessage = "Engine failed to find solution";
-        emit solveFailed(result.errorMessage);
+        emit solveFailed(m_requestId, result.errorMessage);
     }
     
     // Clean up job
     job_free(job);
 }
 
+void SolverWorker::solveNative(const QVector<SolveDetectedStar>& stars, const SolveOptions& options)
+{
+    emit solveProgress(m_requestId, "Loading native quad indexes...");
+
+    if (!m_nativeSolver) {
+        m_nativeSolver = std::make_unique<NativeQuadSolver>();
+    }
+
+    QString indexPath = options.nativeIndexPath.isEmpty() ? options.indexPath : options.nativeIndexPath;
+    if (!m_nativeSolver->loadIndexes(indexPath)) {
+        emit solveFailed(m_requestId, QString("No native quad indexes found in %1").arg(indexPath));
+        return;
+    }
+
+    if (stars.isEmpty()) {
+        emit solveFailed(m_requestId, "No stars provided for solving");
+        return;
+    }
+
+    emit solveProgress(m_requestId, QString("Solving %1 stars against %2 quad indexes...")
+                       .arg(stars.size()).arg(m_nativeSolver->indexCount()));
+
+    PlatesolveResult result = m_nativeSolver->solve(stars, options, &m_cancelRequested,
+                                                    [this](const QString& status) { emit solveProgress(m_requestId, status); });
+    if (result.solved) {
+        emit solveComplete(m_requestId, result);
+    } else {
+        emit solveFailed(m_requestId, result.errorMessage);
+    }
+}
+
 bool SolverWorker::initializeEngine(const SolveOptions& options)
 {
-    if (m_engineInitialized) {
+    if (s_engineInitialized) {
         return true;
     }
     
     // Create engine exactly like your starlist solver does
-    m_engine = engine_new();
-    if (!m_engine) {
+    s_engine = engine_new();
+    if (!s_engine) {
         qDebug() << "Failed to create astrometry engine";
         return false;
     }
     
     // Set CPU limit
-    m_engine->cpulimit = options.cpuLimit;
+    s_engine->cpulimit = options.cpuLimit;
     
     if (options.verbose) {
         qDebug() << "Loading configuration and indexes...";
@@ -137,49 +228,49 @@ bool SolverWorker::initializeEngine(const SolveOptions& options)
     }
     
     if (configFile != "none" && !configFile.isEmpty()) {
-        if (engine_parse_config_file(m_engine, configFile.toLocal8Bit().data())) {
+        if (engine_parse_config_file(s_engine, configFile.toLocal8Bit().data())) {
             qDebug() << "Failed to parse config file:" << configFile;
-            engine_free(m_engine);
-            m_engine = nullptr;
+            engine_free(s_engine);
+            s_engine = nullptr;
             return false;
         }
     }
     
     // Add index files from the specified directory
     if (!options.indexPath.isEmpty()) {
-        engine_add_search_path(m_engine, options.indexPath.toLocal8Bit().data());
+        engine_add_search_path(s_engine, options.indexPath.toLocal8Bit().data());
     }
     
     // Load indexes
-    engine_autoindex_search_paths(m_engine);
+    engine_autoindex_search_paths(s_engine);
     
     if (options.verbose) {
-        qDebug() << "Loaded" << pl_size(m_engine->indexes) << "index files";
+        qDebug() << "Loaded" << pl_size(s_engine->indexes) << "index files";
     }
     
     // Set default field width constraints (from starlist solver)
-    if (m_engine->minwidth <= 0.0) m_engine->minwidth = 0.1;
-    if (m_engine->maxwidth <= 0.0) m_engine->maxwidth = 180.0;
+    if (s_engine->minwidth <= 0.0) s_engine->minwidth = 0.1;
+    if (s_engine->maxwidth <= 0.0) s_engine->maxwidth = 180.0;
     
     // Set default depths if not specified in config
-    if (!il_size(m_engine->default_depths)) {
+    if (!il_size(s_engine->default_depths)) {
         for (int depth : options.depths) {
-            il_append(m_engine->default_depths, depth);
+            il_append(s_engine->default_depths, depth);
         }
     }
     
-    m_engineInitialized = true;
+    s_engineInitialized = true;
     return true;
 }
 
 void SolverWorker::cleanupEngine()
 {
-    QMutexLocker locker(&m_engineMutex);
-    if (m_engine) {
-        engine_free(m_engine);
-        m_engine = nullptr;
+    QMutexLocker locker(&s_engineMutex);
+    if (s_engine) {
+        engine_free(s_engine);
+        s_engine = nullptr;
     }
-    m_engineInitialized = false;
+    s_engineInitialized = false;
 }
 
 QString SolverWorker::findDefaultConfigFile()
@@ -249,8 +340,8 @@ job_t* SolverWorker::createJobFromStars(const QVector<SolveDetectedStar>& stars,
     setupOnefieldSolver(job, options);
     
     // Add indexes from the engine to the onefield
-    for (int i = 0; i < (int)pl_size(m_engine->indexes); i++) {
-        index_t* index = (index_t*)pl_get(m_engine->indexes, i);
+    for (int i = 0; i < (int)pl_size(s_engine->indexes); i++) {
+        index_t* index = (index_t*)pl_get(s_engine->indexes, i);
         onefield_add_loaded_index(&job->bp, index);
     }
     
@@ -409,8 +500,8 @@ PlatesolveResult SolverWorker::extractResultFromJob(job_t* job)
 IntegratedPlateSolver::IntegratedPlateSolver(QObject* parent)
     : QObject(parent)
     , m_solving(false)
-    , m_solverThread(nullptr)
-    , m_solverWorker(nullptr)
+    , m_currentRequestId(-1)
+    , m_nextRequestId(1)
 {
     // Initialize default options (matching your starlist solver defaults)
     m_options.indexPath = "/opt/homebrew/share/astrometry";
@@ -426,11 +517,6 @@ IntegratedPlateSolver::IntegratedPlateSolver(QObject* parent)
     m_options.depths = {10, 20, 30, 40, 50, 60, 70, 80, 90, 100};
     m_options.cpuLimit = 60.0;
     
-    // Setup timeout timer
-    m_timeoutTimer = new QTimer(this);
-    m_timeoutTimer->setSingleShot(true);
-    connect(m_timeoutTimer, &QTimer::timeout, this, &IntegratedPlateSolver::onSolverTimeout);
-    
     initializeSolver();
     
     qDebug() << "IntegratedPlateSolver initialized with internal starlist engine";
@@ -443,21 +529,8 @@ IntegratedPlateSolver::~IntegratedPlateSolver()
 
 void IntegratedPlateSolver::initializeSolver()
 {
-    // Create solver thread and worker
-    m_solverThread = new QThread(this);
-    m_solverWorker = new SolverWorker();
-    m_solverWorker->moveToThread(m_solverThread);
-    
-    // Connect worker signals
-    connect(m_solverWorker, &SolverWorker::solveComplete,
-            this, &IntegratedPlateSolver::onWorkerSolveComplete);
-    connect(m_solverWorker, &SolverWorker::solveFailed,
-            this, &IntegratedPlateSolver::onWorkerSolveFailed);
-    connect(m_solverWorker, &SolverWorker::solveProgress,
-            this, &IntegratedPlateSolver::onWorkerSolveProgress);
-    
-    // Start thread
-    m_solverThread->start();
+    // Two workers let an interactive solve start while a batch solve runs
+    setWorkerCount(2);
 }
 
 void IntegratedPlateSolver::cleanupSolver()
@@ -465,13 +538,82 @@ void IntegratedPlateSolver::cleanupSolver()
     if (m_solving) {
         cancelSolve();
     }
+    m_queue.clear();
     
-    if (m_solverThread) {
-        m_solverThread->quit();
-        m_solverThread->wait(3000);
-        delete m_solverWorker;
-        m_solverWorker = nullptr;
+    for (WorkerSlot& slot : m_workers) {
+        slot.worker->requestCancel();
+        slot.thread->quit();
     }
+    for (WorkerSlot& slot : m_workers) {
+        slot.thread->wait(3000);
+        delete slot.worker;
+        slot.worker = nullptr;
+    }
+    m_workers.clear();
+}
+
+void IntegratedPlateSolver::addWorker()
+{
+    int index = m_workers.size();
+    
+    WorkerSlot slot;
+    slot.thread = new QThread(this);
+    slot.worker = new SolverWorker();
+    slot.worker->moveToThread(slot.thread);
+    slot.timeout = new QTimer(this);
+    slot.timeout->setSingleShot(true);
+    
+    // Worker signals carry the request ID; the slot index tells us which worker
+    connect(slot.worker, &SolverWorker::solveComplete, this,
+            [this, index](int requestId, const PlatesolveResult& result) {
+                onWorkerSolveComplete(index, requestId, result);
+            });
+    connect(slot.worker, &SolverWorker::solveFailed, this,
+            [this, index](int requestId, const QString& error) {
+                onWorkerSolveFailed(index, requestId, error);
+            });
+    connect(slot.worker, &SolverWorker::solveRunning, this,
+            [this, index](int requestId) { onWorkerSolveRunning(index, requestId); });
+    connect(slot.worker, &SolverWorker::solveProgress, this,
+            [this, index](int requestId, const QString& status) {
+                onWorkerSolveProgress(index, requestId, status);
+            });
+    connect(slot.timeout, &QTimer::timeout, this, [this, index]() { onRequestTimeout(index); });
+    
+    slot.thread->start();
+    m_workers.append(slot);
+}
+
+void IntegratedPlateSolver::setWorkerCount(int count)
+{
+    count = std::max(1, count);
+    while (m_workers.size() < count) {
+        addWorker();
+    }
+    
+    // Only idle workers at the end can be retired; busy ones stay until a
+    // later call finds them idle
+    while (m_workers.size() > count && !m_workers.last().busy) {
+        WorkerSlot slot = m_workers.takeLast();
+        slot.thread->quit();
+        slot.thread->wait();
+        delete slot.worker;
+        delete slot.timeout;
+        delete slot.thread;
+    }
+    
+    dispatch();
+}
+
+int IntegratedPlateSolver::activeRequestCount() const
+{
+    int active = 0;
+    for (const WorkerSlot& slot : m_workers) {
+        if (slot.busy && !slot.cancelled) {
+            ++active;
+        }
+    }
+    return active;
 }
 
 // Configuration methods
@@ -528,15 +670,32 @@ void IntegratedPlateSolver::setVerbose(bool verbose)
     m_options.verbose = verbose;
 }
 
+void IntegratedPlateSolver::setNativeSolverEnabled(bool enabled, const QString& indexDirectory)
+{
+    m_options.useNativeSolver = enabled;
+    if (!indexDirectory.isEmpty()) {
+        m_options.nativeIndexPath = indexDirectory;
+    }
+}
+
 // Main solving methods
 
 void IntegratedPlateSolver::solveFromStarMask(const QVector<QPoint>& starCenters,
                                              const QVector<float>& starFluxes,
                                              const ImageData* imageData)
 {
-    std::vector<StarPosition> stars;
-    stars.reserve(starCenters.size());
+    QVector<QPointF> centroids;
+    centroids.reserve(starCenters.size());
+    for (const QPoint& center : starCenters) {
+        centroids.append(center);
+    }
+    solveFromStarMask(centroids, starFluxes, imageData);
+}
 
+void IntegratedPlateSolver::solveFromStarMask(const QVector<QPointF>& starCenters,
+                                             const QVector<float>& starFluxes,
+                                             const ImageData* imageData)
+{
     if (m_solving) {
         emit solveFailed("Solver is already running");
         return;
@@ -547,40 +706,34 @@ void IntegratedPlateSolver::solveFromStarMask(const QVector<QPoint>& starCenters
         return;
     }
 
-    /*    */
     qDebug() << "Starting plate solve with" << starCenters.size() << "stars";
-    xylist_t* xyls = xylist_open("../examples/FinalStackedMaster.axy");
-    starxy_t* field = xylist_read_field_num(xyls, 1, nullptr);
-    std::cout << "Read field with " << field->N << " stars" << std::endl;
-    
-    // Convert to our StarPosition format
-    stars.reserve(field->N);
-    for (int i = 0; i < field->N; i++) {
-        double flux = (field->flux && field->flux[i] > 0) ? field->flux[i] : 1000.0;
-	qDebug() << field->x[i] << field->y[i] << flux;
-	//        stars.emplace_back(field->x[i], field->y[i], flux);
-    }
-    
-    std::cout << "Loaded " << stars.size() << " stars from xylist file" << std::endl;
-    /*    */
-    
+
+    QVector<SolveDetectedStar> stars;
+    stars.reserve(starCenters.size());
     for (int i = 0; i < starCenters.size(); ++i) {
-        const QPoint& center = starCenters[i];
         float flux = (i < starFluxes.size()) ? starFluxes[i] : 1000.0f;
-	qDebug() << center.x() << center.y() << flux;
-        stars.emplace_back(center.x(), center.y(), flux);
+        stars.append(SolveDetectedStar(starCenters[i].x(), starCenters[i].y(), flux));
     }
     
-    astrometry_direct(stars);
-    
-    // Convert to SolveDetectedStar format
-    //    QVector<SolveDetectedStar> stars = convertStarsFromMask(starCenters, starFluxes);
+    // Per-request options: the image size and header hint belong to this
+    // image only and must not carry over to the next one
+    SolveOptions options = m_options;
+    options.imageWidth = imageData->width;
+    options.imageHeight = imageData->height;
+    
+    // Use the header pointing as a field-centre guess when none was set
+    double raHint = 0.0, decHint = 0.0;
+    if (!options.hasGuess && imageData->keywords.pointingHint(raHint, decHint)) {
+        options.hasGuess = true;
+        options.raGuess = raHint;
+        options.decGuess = decHint;
+        qDebug() << "Using header pointing hint RA:" << raHint << "Dec:" << decHint;
+    }
     
-    // Update image dimensions
-    m_options.imageWidth = imageData->width;
-    m_options.imageHeight = imageData->height;
+    m_solving = true;
+    emit solveStarted();
     
-    // solveFromDetectedStars(stars, imageData->width, imageData->height);
+    m_currentRequestId = submitSolve(stars, options, SolvePriority::Interactive);
 }
 
 void IntegratedPlateSolver::solveFromDetectedStars(const QVector<SolveDetectedStar>& stars,
@@ -599,32 +752,172 @@ void IntegratedPlateSolver::solveFromDetectedStars(const QVector<SolveDetectedSt
     m_solving = true;
     emit solveStarted();
     
+    m_currentRequestId = submitSolve(stars, imageWidth, imageHeight, SolvePriority::Interactive);
+}
+
+int IntegratedPlateSolver::submitSolve(const QVector<SolveDetectedStar>& stars, int imageWidth, int imageHeight,
+                                       SolvePriority priority)
+{
     // Update image dimensions
     m_options.imageWidth = imageWidth;
     m_options.imageHeight = imageHeight;
     
+    return submitSolve(stars, m_options, priority);
+}
+
+int IntegratedPlateSolver::submitSolve(const QVector<SolveDetectedStar>& stars, const SolveOptions& options,
+                                       SolvePriority priority)
+{
+    SolveRequest request;
+    request.id = m_nextRequestId++;
+    request.priority = priority;
+    request.options = options;
+    request.stars = stars;
+    
     // Limit number of stars if necessary
-    QVector<SolveDetectedStar> limitedStars = stars;
-    if (limitedStars.size() > m_options.maxStars) {
+    if (request.stars.size() > options.maxStars) {
         // Sort by flux (brightest first) and take top N
-        std::sort(limitedStars.begin(), limitedStars.end(), 
+        std::sort(request.stars.begin(), request.stars.end(), 
                   [](const SolveDetectedStar& a, const SolveDetectedStar& b) {
                       return a.flux > b.flux;
                   });
-        limitedStars.resize(m_options.maxStars);
-        qDebug() << "Limited to" << m_options.maxStars << "brightest stars";
+        request.stars.resize(options.maxStars);
+        qDebug() << "Limited to" << options.maxStars << "brightest stars";
+    }
+    
+    qDebug() << "Queued solve request" << request.id << "with" << request.stars.size()
+             << "stars, image size:" << options.imageWidth << "x" << options.imageHeight
+             << (priority == SolvePriority::Interactive ? "(interactive)" : "(batch)");
+    
+    enqueue(request);
+    dispatch();
+    return request.id;
+}
+
+bool IntegratedPlateSolver::cancelRequest(int requestId)
+{
+    for (int i = 0; i < m_queue.size(); ++i) {
+        if (m_queue[i].id == requestId) {
+            m_queue.removeAt(i);
+            reportFailed(requestId, "Solve cancelled by user");
+            return true;
+        }
+    }
+    
+    for (WorkerSlot& slot : m_workers) {
+        if (slot.busy && slot.request.id == requestId && !slot.cancelled) {
+            // The worker stops at its next cancel check; any result it
+            // still returns is dropped and the slot is reused afterwards
+            slot.cancelled = true;
+            slot.timeout->stop();
+            slot.worker->requestCancel();
+            reportFailed(requestId, "Solve cancelled by user");
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void IntegratedPlateSolver::enqueue(const SolveRequest& request)
+{
+    // Higher priority first, then submission order (preempted requests keep
+    // their place ahead of later ones)
+    auto position = std::find_if(m_queue.begin(), m_queue.end(), [&](const SolveRequest& queued) {
+        return queued.priority < request.priority ||
+               (queued.priority == request.priority && queued.id > request.id);
+    });
+    m_queue.insert(position, request);
+}
+
+void IntegratedPlateSolver::dispatch()
+{
+    // The astrometry engine runs one job at a time; a second engine request
+    // would only sit on the engine lock, so it stays queued instead
+    bool engineBusy = false;
+    for (const WorkerSlot& slot : m_workers) {
+        if (slot.busy && !slot.request.options.useNativeSolver) {
+            engineBusy = true;
+        }
+    }
+    
+    for (int i = 0; i < m_workers.size() && !m_queue.isEmpty(); ++i) {
+        WorkerSlot& slot = m_workers[i];
+        if (slot.busy) {
+            continue;
+        }
+        
+        // Highest-priority request that can start now
+        int next = -1;
+        for (int q = 0; q < m_queue.size() && next < 0; ++q) {
+            if (m_queue[q].options.useNativeSolver || !engineBusy) {
+                next = q;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        
+        slot.request = m_queue.takeAt(next);
+        slot.busy = true;
+        slot.preempted = false;
+        slot.cancelled = false;
+        slot.worker->resetCancel();
+        if (!slot.request.options.useNativeSolver) {
+            engineBusy = true;
+        }
+        
+        emit requestStarted(slot.request.id);
+        
+        // Trigger solve in worker thread
+        QMetaObject::invokeMethod(slot.worker, "solvePlate", Qt::QueuedConnection,
+                                  Q_ARG(int, slot.request.id),
+                                  Q_ARG(QVector<SolveDetectedStar>, slot.request.stars),
+                                  Q_ARG(SolveOptions, slot.request.options));
     }
     
-    qDebug() << "Solving with" << limitedStars.size() << "stars, image size:" 
-             << imageWidth << "x" << imageHeight;
+    if (!m_queue.isEmpty()) {
+        preemptFor(m_queue.first());
+    }
+}
+
+void IntegratedPlateSolver::preemptFor(const SolveRequest& waiting)
+{
+    // One preemption at a time; the freed worker picks up the head of the queue
+    for (const WorkerSlot& slot : m_workers) {
+        if (slot.preempted) {
+            return;
+        }
+    }
     
-    // Start timeout timer
-    m_timeoutTimer->start(static_cast<int>(m_options.cpuLimit * 1000));
+    // An engine request waiting on a busy engine can only be helped by
+    // stopping the request that holds it; otherwise the newest
+    // lower-priority request yields its worker
+    bool needsEngine = false;
+    if (!waiting.options.useNativeSolver) {
+        for (const WorkerSlot& slot : m_workers) {
+            needsEngine = needsEngine || (slot.busy && !slot.request.options.useNativeSolver);
+        }
+    }
+    int victim = -1;
+    for (int i = 0; i < m_workers.size(); ++i) {
+        const WorkerSlot& slot = m_workers[i];
+        if (!slot.busy || slot.cancelled || slot.request.priority >= waiting.priority) {
+            continue;
+        }
+        if (needsEngine && slot.request.options.useNativeSolver) {
+            continue;
+        }
+        if (victim < 0 || slot.request.id > m_workers[victim].request.id) {
+            victim = i;
+        }
+    }
     
-    // Trigger solve in worker thread
-    QMetaObject::invokeMethod(m_solverWorker, "solvePlate", Qt::QueuedConnection,
-                              Q_ARG(QVector<SolveDetectedStar>, limitedStars),
-                              Q_ARG(SolveOptions, m_options));
+    if (victim >= 0) {
+        qDebug() << "Preempting solve request" << m_workers[victim].request.id;
+        m_workers[victim].preempted = true;
+        m_workers[victim].worker->requestCancel();
+    }
 }
 
 void IntegratedPlateSolver::solveWithValidation(const QVector<QPoint>& starCenters,
@@ -644,53 +937,131 @@ void IntegratedPlateSolver::cancelSolve()
 {
     if (m_solving) {
         qDebug() << "Canceling plate solve";
-        m_timeoutTimer->stop();
-        m_solving = false;
         
-        // Note: The actual astrometry engine doesn't have a clean way to cancel
-        // mid-solve, so we just mark as not solving and let it complete
-        
-        emit solveFailed("Solve cancelled by user");
+        // The native solver checks the cancel flag between hypotheses, the
+        // astrometry engine its quit flag; a result that still arrives is
+        // dropped
+        cancelRequest(m_currentRequestId);
     }
 }
 
-// Slot implementations
-
-void IntegratedPlateSolver::onWorkerSolveComplete(const PlatesolveResult& result)
+void IntegratedPlateSolver::reportComplete(int requestId, const PlatesolveResult& result)
 {
-    m_timeoutTimer->stop();
-    m_solving = false;
-    m_lastResult = result;
-    
-    qDebug() << "Plate solve completed successfully!";
+    qDebug() << "Plate solve" << requestId << "completed successfully!";
     qDebug() << "  RA:" << result.ra_center << "degrees";
     qDebug() << "  Dec:" << result.dec_center << "degrees";
     qDebug() << "  Pixel scale:" << result.pixscale << "arcsec/pixel";
     qDebug() << "  Orientation:" << result.orientation << "degrees";
     
-    emit solveComplete(result);
+    emit requestComplete(requestId, result);
+    
+    if (m_solving && requestId == m_currentRequestId) {
+        m_solving = false;
+        m_currentRequestId = -1;
+        m_lastResult = result;
+        emit solveComplete(result);
+    }
 }
 
-void IntegratedPlateSolver::onWorkerSolveFailed(const QString& error)
+void IntegratedPlateSolver::reportFailed(int requestId, const QString& error)
 {
-    m_timeoutTimer->stop();
-    m_solving = false;
+    qDebug() << "Plate solve" << requestId << "failed:" << error;
     
-    qDebug() << "Plate solve failed:" << error;
-    emit solveFailed(error);
+    emit requestFailed(requestId, error);
+    
+    if (m_solving && requestId == m_currentRequestId) {
+        m_solving = false;
+        m_currentRequestId = -1;
+        emit solveFailed(error);
+    }
 }
 
-void IntegratedPlateSolver::onWorkerSolveProgress(const QString& status)
+bool IntegratedPlateSolver::releaseWorker(int slotIndex, int requestId, SolveRequest& request,
+                                          bool& preempted, bool& cancelled)
 {
-    emit solveProgress(status);
+    if (slotIndex >= m_workers.size()) {
+        return false;
+    }
+    
+    WorkerSlot& slot = m_workers[slotIndex];
+    if (!slot.busy || slot.request.id != requestId) {
+        return false;
+    }
+    
+    slot.timeout->stop();
+    request = slot.request;
+    preempted = slot.preempted;
+    cancelled = slot.cancelled;
+    slot.busy = false;
+    slot.preempted = false;
+    slot.cancelled = false;
+    slot.request = SolveRequest();
+    return true;
 }
 
-void IntegratedPlateSolver::onSolverTimeout()
+// Worker callbacks
+
+void IntegratedPlateSolver::onWorkerSolveComplete(int slot, int requestId, const PlatesolveResult& result)
 {
-    if (m_solving) {
-        qDebug() << "Plate solve timeout after" << m_options.cpuLimit << "seconds";
-        m_solving = false;
-        emit solveFailed("Plate solve timeout");
+    SolveRequest request;
+    bool preempted, cancelled;
+    if (!releaseWorker(slot, requestId, request, preempted, cancelled)) {
+        return;
+    }
+    
+    // A preempted request that finished anyway still counts
+    if (!cancelled) {
+        reportComplete(requestId, result);
+    }
+    dispatch();
+}
+
+void IntegratedPlateSolver::onWorkerSolveFailed(int slot, int requestId, const QString& error)
+{
+    SolveRequest request;
+    bool preempted, cancelled;
+    if (!releaseWorker(slot, requestId, request, preempted, cancelled)) {
+        return;
+    }
+    
+    if (preempted && !cancelled) {
+        qDebug() << "Requeueing preempted solve request" << requestId;
+        enqueue(request);
+    } else if (!cancelled) {
+        reportFailed(requestId, error);
+    }
+    dispatch();
+}
+
+void IntegratedPlateSolver::onWorkerSolveRunning(int slotIndex, int requestId)
+{
+    if (slotIndex >= m_workers.size()) {
+        return;
+    }
+    WorkerSlot& slot = m_workers[slotIndex];
+    if (slot.busy && slot.request.id == requestId && !slot.cancelled) {
+        slot.timeout->start(static_cast<int>(slot.request.options.cpuLimit * 1000));
+    }
+}
+
+void IntegratedPlateSolver::onWorkerSolveProgress(int slot, int requestId, const QString& status)
+{
+    Q_UNUSED(slot)
+    
+    emit requestProgress(requestId, status);
+    if (m_solving && requestId == m_currentRequestId) {
+        emit solveProgress(status);
+    }
+}
+
+void IntegratedPlateSolver::onRequestTimeout(int slotIndex)
+{
+    WorkerSlot& slot = m_workers[slotIndex];
+    if (slot.busy && !slot.cancelled) {
+        qDebug() << "Plate solve timeout after" << slot.request.options.cpuLimit << "seconds";
+        slot.cancelled = true;
+        slot.worker->requestCancel();
+        reportFailed(slot.request.id, "Plate solve timeout");
     }
 }
 
@@ -735,6 +1106,19 @@ void ExtractStarsWithPlateSolve::extractStarsAndSolve(const ImageData* imageData
                                                      const QVector<QPoint>& starCenters,
                                                      const QVector<float>& starFluxes,
                                                      const QVector<float>& starRadii)
+{
+    QVector<QPointF> centroids;
+    centroids.reserve(starCenters.size());
+    for (const QPoint& center : starCenters) {
+        centroids.append(center);
+    }
+    extractStarsAndSolve(imageData, centroids, starFluxes, starRadii);
+}
+
+void ExtractStarsWithPlateSolve::extractStarsAndSolve(const ImageData* imageData,
+                                                     const QVector<QPointF>& starCenters,
+                                                     const QVector<float>& starFluxes,
+                                                     const QVector<float>& starRadii)
 {
     Q_UNUSED(starRadii)  // Not used in current implementation
     
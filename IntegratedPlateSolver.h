@@ -10,12 +10,15 @@
 #include <QDebug>
 #include <QThread>
 #include <QMutex>
+#include <atomic>
+#include <memory>
 #include "PCLMockAPI.h"
 #include "structuredefinitions.h"
 
 // Forward declarations
 class ImageData;
 class StarCatalogValidator;
+class NativeQuadSolver;
 
 // C++ wrapper for the astrometry starlist solver
 extern "C" {
@@ -73,6 +76,11 @@ struct SolveOptions {
     
     // CPU time limit in seconds
     float cpuLimit = 60.0;
+
+    // Solve in-process against GaiaIndexBuilder quad indexes instead of
+    // the astrometry.net engine
+    bool useNativeSolver = false;
+    QString nativeIndexPath;
 };
 
 // Thread worker for running the solver engine
@@ -84,21 +92,38 @@ public:
     SolverWorker(QObject* parent = nullptr);
     ~SolverWorker();
 
+    // Thread-safe; the native solver stops between hypotheses, the
+    // astrometry engine at its next quit check
+    void requestCancel();
+    void resetCancel() { m_cancelRequested = false; }
+
 public slots:
-    void solvePlate(const QVector<SolveDetectedStar>& stars, const SolveOptions& options);
+    void solvePlate(int requestId, const QVector<SolveDetectedStar>& stars, const SolveOptions& options);
 
 signals:
-    void solveComplete(const PlatesolveResult& result);
-    void solveFailed(const QString& error);
-    void solveProgress(const QString& status);
+    // The request has its solver (and the engine lock) and is now running
+    void solveRunning(int requestId);
+    void solveComplete(int requestId, const PlatesolveResult& result);
+    void solveFailed(int requestId, const QString& error);
+    void solveProgress(int requestId, const QString& status);
 
 private:
-    engine_t* m_engine;
-    bool m_engineInitialized;
-    QMutex m_engineMutex;
+    // One astrometry engine (and one copy of its indexes) is shared by all
+    // workers; engine_run_job is not reentrant, so jobs on it are serialised
+    static engine_t* s_engine;
+    static bool s_engineInitialized;
+    static QMutex s_engineMutex;
+    static int s_workerCount;
+
+    std::unique_ptr<NativeQuadSolver> m_nativeSolver;
+    std::atomic<bool> m_cancelRequested;
+    int m_requestId;
+    QMutex m_jobMutex;              // Guards m_activeJob against requestCancel()
+    job_t* m_activeJob = nullptr;   // Engine job being run, for cancellation
     
+    void solveNative(const QVector<SolveDetectedStar>& stars, const SolveOptions& options);
     bool initializeEngine(const SolveOptions& options);
-    void cleanupEngine();
+    static void cleanupEngine();
     QString findDefaultConfigFile();
     job_t* createJobFromStars(const QVector<SolveDetectedStar>& stars, const SolveOptions& options);
     bool createInMemoryXylist(job_t* job, const QVector<SolveDetectedStar>& stars, const SolveOptions& options);
@@ -106,6 +131,14 @@ private:
     PlatesolveResult extractResultFromJob(job_t* job);
 };
 
+// Interactive requests are dispatched before any queued batch request and
+// may preempt a running batch solve, including the one holding the
+// astrometry engine
+enum class SolvePriority {
+    Batch = 0,
+    Interactive = 1
+};
+
 class IntegratedPlateSolver : public QObject
 {
     Q_OBJECT
@@ -125,15 +158,32 @@ public:
     void setMaxStars(int count);
     void setLogOddsThreshold(double threshold);
     void setVerbose(bool verbose);
+    void setNativeSolverEnabled(bool enabled, const QString& indexDirectory = QString());
     
     // Main solving interface - integrates with your star extraction
     void solveFromStarMask(const QVector<QPoint>& starCenters,
                           const QVector<float>& starFluxes,
                           const ImageData* imageData);
+    // Sub-pixel centres, e.g. StarMaskResult::starCentroids
+    void solveFromStarMask(const QVector<QPointF>& starCentroids,
+                          const QVector<float>& starFluxes,
+                          const ImageData* imageData);
     
     void solveFromDetectedStars(const QVector<SolveDetectedStar>& stars,
                                int imageWidth, int imageHeight);
 
+    // Queued solving: returns a request ID that tags the request* signals.
+    // Requests run on setWorkerCount() workers, highest priority first.
+    int submitSolve(const QVector<SolveDetectedStar>& stars, int imageWidth, int imageHeight,
+                    SolvePriority priority = SolvePriority::Batch);
+    int submitSolve(const QVector<SolveDetectedStar>& stars, const SolveOptions& options,
+                    SolvePriority priority = SolvePriority::Batch);
+    bool cancelRequest(int requestId);
+    void setWorkerCount(int count);
+    int workerCount() const { return m_workers.size(); }
+    int pendingRequestCount() const { return m_queue.size(); }
+    int activeRequestCount() const;
+
     // Advanced solving with validation
     void solveWithValidation(const QVector<QPoint>& starCenters,
                             const QVector<float>& starFluxes,
@@ -141,7 +191,7 @@ public:
                             StarCatalogValidator* validator);
 
     // Status and results
-    bool isSolving() const { return m_solving; }
+    bool isSolving() const { return m_solving; }  // The solveFrom*() request
     PlatesolveResult getLastResult() const { return m_lastResult; }
     void cancelSolve();
 
@@ -151,25 +201,54 @@ signals:
     void solveComplete(const PlatesolveResult& result);
     void solveFailed(const QString& error);
 
-private slots:
-    void onWorkerSolveComplete(const PlatesolveResult& result);
-    void onWorkerSolveFailed(const QString& error);
-    void onWorkerSolveProgress(const QString& status);
-    void onSolverTimeout();
+    void requestStarted(int requestId);
+    void requestProgress(int requestId, const QString& status);
+    void requestComplete(int requestId, const PlatesolveResult& result);
+    void requestFailed(int requestId, const QString& error);
 
 private:
+    struct SolveRequest {
+        int id = -1;
+        SolvePriority priority = SolvePriority::Batch;
+        QVector<SolveDetectedStar> stars;
+        SolveOptions options;
+    };
+
+    struct WorkerSlot {
+        QThread* thread = nullptr;
+        SolverWorker* worker = nullptr;
+        QTimer* timeout = nullptr;  // Started once the worker is running the request
+        SolveRequest request;       // Valid while busy
+        bool busy = false;
+        bool preempted = false;     // Requeue instead of reporting the result
+        bool cancelled = false;     // Drop the result when it arrives
+    };
+
     // Configuration parameters (matching starlist solver)
     SolveOptions m_options;
     bool m_solving;
+    int m_currentRequestId;         // Request behind the legacy solve* signals
     PlatesolveResult m_lastResult;
     
-    // Threading for non-blocking solve
-    QThread* m_solverThread;
-    SolverWorker* m_solverWorker;
-    QTimer* m_timeoutTimer;
+    // Request queue (sorted by priority, then ID) and worker threads
+    QList<SolveRequest> m_queue;
+    QVector<WorkerSlot> m_workers;
+    int m_nextRequestId;
     
     void initializeSolver();
     void cleanupSolver();
+    void addWorker();
+    void enqueue(const SolveRequest& request);
+    void dispatch();
+    void preemptFor(const SolveRequest& waiting);
+    bool releaseWorker(int slotIndex, int requestId, SolveRequest& request, bool& preempted, bool& cancelled);
+    void reportComplete(int requestId, const PlatesolveResult& result);
+    void reportFailed(int requestId, const QString& error);
+    void onWorkerSolveComplete(int slot, int requestId, const PlatesolveResult& result);
+    void onWorkerSolveFailed(int slot, int requestId, const QString& error);
+    void onWorkerSolveRunning(int slot, int requestId);
+    void onWorkerSolveProgress(int slot, int requestId, const QString& status);
+    void onRequestTimeout(int slotIndex);
   /*
     QVector<SolveDetectedStar> convertStarsFromMask(const QVector<QPoint>& starCenters,
                                                const QVector<float>& starFluxes);
@@ -189,6 +268,10 @@ public:
                              const QVector<QPoint>& starCenters,
                              const QVector<float>& starFluxes = QVector<float>(),
                              const QVector<float>& starRadii = QVector<float>());
+    void extractStarsAndSolve(const ImageData* imageData,
+                             const QVector<QPointF>& starCentroids,
+                             const QVector<float>& starFluxes = QVector<float>(),
+                             const QVector<float>& starRadii = QVector<float>());
 
     // Configuration (maps to starlist solver configuration)
     void configurePlateSolver(const QString& astrometryPath,
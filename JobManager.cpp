@@ -0,0 +1,193 @@
+// JobManager.cpp - Background jobs for long-running GUI actions
+#include "JobManager.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMetaObject>
+
+#include <algorithm>
+#include <exception>
+
+void JobContext::setProgress(int done, int total, const QString& text)
+{
+    JobManager* manager = m_manager;
+    int jobId = m_jobId;
+    QMetaObject::invokeMethod(manager, [manager, jobId, done, total, text]() {
+        emit manager->jobProgress(jobId, done, total, text);
+    }, Qt::QueuedConnection);
+}
+
+JobManager::JobManager(QObject* parent, int maxThreads)
+    : QObject(parent)
+    , m_nextJobId(1)
+{
+    m_pool.setMaxThreadCount(std::max(1, maxThreads));
+}
+
+JobManager::~JobManager()
+{
+    // No completions during teardown: flag everything and let work unwind
+    for (const Job& job : m_jobs) {
+        job.cancelled->store(true);
+    }
+    m_pool.waitForDone();
+}
+
+int JobManager::submit(const QString& name, Work work, Completion completion,
+                       const QList<int>& dependencies)
+{
+    Job job;
+    job.id = m_nextJobId++;
+    job.name = name;
+    job.work = std::move(work);
+    job.completion = std::move(completion);
+    job.cancelled = std::make_shared<std::atomic<bool>>(false);
+    for (int dependency : dependencies) {
+        if (dependency > 0) job.dependencies.append(dependency);
+    }
+
+    const int jobId = job.id;
+    m_jobs.insert(jobId, job);
+    emit activeJobCountChanged(m_jobs.size());
+
+    startReadyJobs();
+    return jobId;
+}
+
+void JobManager::startReadyJobs()
+{
+    // Completions can submit or cancel jobs, so work from a snapshot of IDs
+    QList<int> waiting;
+    for (auto it = m_jobs.constBegin(); it != m_jobs.constEnd(); ++it) {
+        if (it->state == State::Waiting) waiting.append(it.key());
+    }
+    std::sort(waiting.begin(), waiting.end());
+
+    for (int jobId : waiting) {
+        auto it = m_jobs.find(jobId);
+        if (it == m_jobs.end() || it->state != State::Waiting) continue;
+
+        bool ready = true;
+        int failedDependency = 0;
+        for (int dependency : it->dependencies) {
+            if (m_jobs.contains(dependency)) {
+                ready = false;
+            } else if (m_finished.value(dependency, State::Succeeded) != State::Succeeded) {
+                failedDependency = dependency;
+                break;
+            }
+        }
+
+        if (failedDependency != 0) {
+            finish(jobId, State::Cancelled, QString("Job %1 did not complete").arg(failedDependency));
+        } else if (ready) {
+            start(*it);
+        }
+    }
+}
+
+void JobManager::start(Job& job)
+{
+    job.state = State::Running;
+
+    // Copies: slots connected to jobStarted may submit and rehash m_jobs
+    const int jobId = job.id;
+    const QString name = job.name;
+    Work work = job.work;
+    std::shared_ptr<std::atomic<bool>> cancelled = job.cancelled;
+
+    m_pool.start([this, jobId, name, work, cancelled]() {
+        State state = State::Succeeded;
+        QString error;
+        QElapsedTimer timer;
+        timer.start();
+
+        if (cancelled->load()) {
+            state = State::Cancelled;
+        } else {
+            JobContext context(this, jobId, cancelled);
+            try {
+                work(context);
+            } catch (const std::exception& e) {
+                state = State::Failed;
+                error = QString::fromUtf8(e.what());
+            } catch (...) {
+                state = State::Failed;
+                error = "Unknown error";
+            }
+            if (state == State::Succeeded && cancelled->load()) {
+                state = State::Cancelled;
+            }
+        }
+
+        qDebug() << QString("⚙️ Job %1 (%2) finished in %3 ms").arg(jobId).arg(name).arg(timer.elapsed());
+
+        QMetaObject::invokeMethod(this, [this, jobId, state, error]() {
+            finish(jobId, state, error);
+        }, Qt::QueuedConnection);
+    });
+
+    emit jobStarted(jobId, name);
+}
+
+void JobManager::finish(int jobId, State state, const QString& error)
+{
+    auto it = m_jobs.find(jobId);
+    if (it == m_jobs.end()) {
+        return;
+    }
+
+    Job job = it.value();
+    m_jobs.erase(it);
+    m_finished.insert(jobId, state);
+
+    if (state == State::Failed) {
+        qDebug() << QString("❌ Job %1 (%2) failed: %3").arg(jobId).arg(job.name).arg(error);
+    }
+
+    emit jobFinished(jobId, job.name, state, error);
+    if (job.completion) {
+        job.completion(state, error);
+    }
+    emit activeJobCountChanged(m_jobs.size());
+
+    // Dependents of this job can now start, or are cancelled with it
+    startReadyJobs();
+}
+
+void JobManager::cancel(int jobId)
+{
+    auto it = m_jobs.find(jobId);
+    if (it == m_jobs.end()) {
+        return;
+    }
+
+    it->cancelled->store(true);
+    if (it->state == State::Waiting) {
+        finish(jobId, State::Cancelled, "Cancelled");
+    }
+    // Running jobs report Cancelled when their work returns
+}
+
+void JobManager::cancelAll()
+{
+    const QList<int> jobIds = m_jobs.keys();
+    for (int jobId : jobIds) {
+        cancel(jobId);
+    }
+}
+
+bool JobManager::isActive(int jobId) const
+{
+    return m_jobs.contains(jobId);
+}
+
+int JobManager::activeJobCount() const
+{
+    return m_jobs.size();
+}
+
+void JobManager::waitForDone()
+{
+    m_pool.waitForDone();
+}
@@ -0,0 +1,120 @@
+// JobManager.h - Background jobs for long-running GUI actions
+#ifndef JOB_MANAGER_H
+#define JOB_MANAGER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class JobManager;
+
+// Handed to the work function on the worker thread. Work should poll
+// isCancelled() between steps and return early when it is set.
+class JobContext
+{
+public:
+    bool isCancelled() const { return m_cancelled->load(); }
+    const std::atomic<bool>* cancelFlag() const { return m_cancelled.get(); }
+
+    // Thread-safe; delivered to the GUI thread through jobProgress
+    void setProgress(int done, int total, const QString& text = QString());
+
+private:
+    friend class JobManager;
+    JobContext(JobManager* manager, int jobId, std::shared_ptr<std::atomic<bool>> cancelled)
+        : m_manager(manager), m_jobId(jobId), m_cancelled(std::move(cancelled)) {}
+
+    JobManager* m_manager;
+    int m_jobId;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+// Runs work on a private thread pool (so compute inside a job can still use
+// the global pool through ParallelFor) and calls completions on the thread
+// that owns the manager, normally the GUI thread. A job may depend on
+// earlier jobs: it starts once they have all succeeded and is cancelled if
+// any of them fails or is cancelled.
+class JobManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class State { Waiting, Running, Succeeded, Failed, Cancelled };
+
+    using Work = std::function<void(JobContext&)>;
+    using Completion = std::function<void(State state, const QString& error)>;
+
+    explicit JobManager(QObject* parent = nullptr, int maxThreads = 2);
+    ~JobManager();
+
+    // Returns the job ID. Work exceptions (std::exception) fail the job.
+    int submit(const QString& name, Work work, Completion completion = nullptr,
+               const QList<int>& dependencies = QList<int>());
+
+    // Work returns a value that the completion receives on the GUI thread;
+    // the completion is called only on success
+    template <typename Result>
+    int submitTask(const QString& name,
+                   std::function<Result(JobContext&)> work,
+                   std::function<void(const Result&)> onSuccess,
+                   std::function<void(State, const QString&)> onFailure = nullptr,
+                   const QList<int>& dependencies = QList<int>())
+    {
+        auto result = std::make_shared<Result>();
+        return submit(name,
+                      [work, result](JobContext& context) { *result = work(context); },
+                      [onSuccess, onFailure, result](State state, const QString& error) {
+                          if (state == State::Succeeded) {
+                              if (onSuccess) onSuccess(*result);
+                          } else if (onFailure) {
+                              onFailure(state, error);
+                          }
+                      },
+                      dependencies);
+    }
+
+    // Cancels the job and everything that depends on it
+    void cancel(int jobId);
+    void cancelAll();
+
+    // True while the job is waiting or running
+    bool isActive(int jobId) const;
+    int activeJobCount() const;
+
+    // Blocks until running work has returned; only for shutdown
+    void waitForDone();
+
+signals:
+    void jobStarted(int jobId, const QString& name);
+    void jobProgress(int jobId, int done, int total, const QString& text);
+    void jobFinished(int jobId, const QString& name, JobManager::State state, const QString& error);
+    void activeJobCountChanged(int count);
+
+private:
+    struct Job {
+        int id = 0;
+        QString name;
+        Work work;
+        Completion completion;
+        QList<int> dependencies;
+        State state = State::Waiting;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+
+    void startReadyJobs();
+    void start(Job& job);
+    void finish(int jobId, State state, const QString& error);
+
+    QThreadPool m_pool;
+    QHash<int, Job> m_jobs;         // Waiting and running jobs
+    QHash<int, State> m_finished;   // Outcome of completed jobs, for late dependents
+    int m_nextJobId;
+};
+
+#endif // JOB_MANAGER_H
@@ -0,0 +1,511 @@
+// LightCurveEngine.cpp - Differential photometry light curves across frame sequences
+#include "LightCurveEngine.h"
+#include "GaiaQuadIndex.h"
+#include "ImageReader.h"
+#include "ParallelFor.h"
+#include "RGBPhotometryAnalyzer.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QTimeZone>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double kNaN = std::numeric_limits<double>::quiet_NaN();
+const double kMaxFieldRadius = 45.0;       // degrees; the tangent plane degrades beyond
+const int kEnsembleIterations = 3;
+
+// Linear TAN WCS from CRVAL/CRPIX and a CD matrix (or CDELT with PC/CROTA2)
+struct FrameWCS {
+    double crval1 = 0.0, crval2 = 0.0;
+    double crpix1 = 0.0, crpix2 = 0.0;
+    double inv11 = 0.0, inv12 = 0.0, inv21 = 0.0, inv22 = 0.0;
+    bool valid = false;
+
+    static FrameWCS fromKeywords(const ImageKeywordStore& keywords, int width, int height)
+    {
+        FrameWCS wcs;
+        bool raOk = false, decOk = false;
+        wcs.crval1 = keywords.number("CRVAL1", 0.0, &raOk);
+        wcs.crval2 = keywords.number("CRVAL2", 0.0, &decOk);
+        wcs.crpix1 = keywords.number("CRPIX1", width / 2.0 + 1.0);
+        wcs.crpix2 = keywords.number("CRPIX2", height / 2.0 + 1.0);
+        if (!raOk || !decOk) return wcs;
+
+        double cd11 = keywords.number("CD1_1");
+        double cd12 = keywords.number("CD1_2");
+        double cd21 = keywords.number("CD2_1");
+        double cd22 = keywords.number("CD2_2");
+
+        if (cd11 == 0.0 && cd12 == 0.0 && cd21 == 0.0 && cd22 == 0.0) {
+            const double cdelt1 = keywords.number("CDELT1");
+            const double cdelt2 = keywords.number("CDELT2");
+            bool hasPC = false;
+            double pc11 = keywords.number("PC1_1", 1.0, &hasPC);
+            double pc12 = keywords.number("PC1_2");
+            double pc21 = keywords.number("PC2_1");
+            double pc22 = keywords.number("PC2_2", 1.0);
+            if (!hasPC) {
+                const double rot = qDegreesToRadians(keywords.number("CROTA2"));
+                pc11 = std::cos(rot);
+                pc12 = -std::sin(rot) * cdelt2 / (cdelt1 != 0.0 ? cdelt1 : 1.0);
+                pc21 = std::sin(rot) * cdelt1 / (cdelt2 != 0.0 ? cdelt2 : 1.0);
+                pc22 = std::cos(rot);
+            }
+            cd11 = cdelt1 * pc11;
+            cd12 = cdelt1 * pc12;
+            cd21 = cdelt2 * pc21;
+            cd22 = cdelt2 * pc22;
+        }
+
+        const double det = cd11 * cd22 - cd12 * cd21;
+        if (det == 0.0 || !std::isfinite(det)) return wcs;
+
+        wcs.inv11 = cd22 / det;
+        wcs.inv12 = -cd12 / det;
+        wcs.inv21 = -cd21 / det;
+        wcs.inv22 = cd11 / det;
+        wcs.valid = true;
+        return wcs;
+    }
+
+    // 0-based pixel position; false for positions behind the tangent plane
+    bool skyToPixel(double ra, double dec, QPointF& pixel) const
+    {
+        if (!valid || GaiaQuadIndex::angularDistance(ra, dec, crval1, crval2) > kMaxFieldRadius) {
+            return false;
+        }
+        const QPointF plane = GaiaQuadIndex::projectGnomonic(ra, dec, crval1, crval2) / 3600.0;
+        pixel = QPointF(inv11 * plane.x() + inv12 * plane.y() + crpix1 - 1.0,
+                        inv21 * plane.x() + inv22 * plane.y() + crpix2 - 1.0);
+        return true;
+    }
+};
+
+double exposureSeconds(const ImageKeywordStore& keywords)
+{
+    return keywords.firstNumber({"EXPTIME", "EXPOSURE", "OBSERVATION:EXPOSURETIME"});
+}
+
+// Mid-exposure MJD (UTC) from MJD/JD keywords or DATE-OBS; NaN if absent
+double midExposureMJD(const ImageKeywordStore& keywords, double exposure)
+{
+    bool ok = false;
+    const double mjdAvg = keywords.firstNumber({"MJD-AVG", "MJD-MID"}, 0.0, &ok);
+    if (ok) return mjdAvg;
+
+    const double halfExposure = exposure / 2.0 / 86400.0;
+    const double mjd = keywords.firstNumber({"MJD-OBS", "MJD_OBS"}, 0.0, &ok);
+    if (ok) return mjd + halfExposure;
+
+    const double jd = keywords.firstNumber({"JD", "JD-OBS", "JD_OBS"}, 0.0, &ok);
+    if (ok) return jd - 2400000.5 + halfExposure;
+
+    QString date = keywords.string("DATE-OBS");
+    if (date.isEmpty()) date = keywords.string("OBSERVATION:TIME:START");
+    QDateTime time = QDateTime::fromString(date, Qt::ISODateWithMs);
+    if (!time.isValid()) return kNaN;
+    time.setTimeZone(QTimeZone::utc());
+
+    // Julian day number 2400001 starts at MJD 0 (midnight UTC)
+    const double dayFraction = time.time().msecsSinceStartOfDay() / 86400000.0;
+    return double(time.date().toJulianDay() - 2400001) + dayFraction + halfExposure;
+}
+
+double median(QVector<double> values)
+{
+    if (values.isEmpty()) return kNaN;
+    auto mid = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), mid, values.end());
+    return *mid;
+}
+
+// 1.4826 * MAD
+double robustSigma(const QVector<double>& values)
+{
+    if (values.size() < 3) return kNaN;
+    const double center = median(values);
+    QVector<double> deviations(values.size());
+    for (int i = 0; i < values.size(); ++i) deviations[i] = std::abs(values[i] - center);
+    return 1.4826 * median(deviations);
+}
+
+} // namespace
+
+void LightCurveTable::reset(const QVector<LightCurveStar>& starList, const QStringList& frames)
+{
+    stars = starList;
+    frameCount = frames.size();
+
+    framePath = frames;
+    mjd.fill(kNaN, frameCount);
+    exposure.fill(0.0, frameCount);
+    frameValid.fill(0, frameCount);
+    frameError = QStringList();
+    for (int f = 0; f < frameCount; ++f) frameError.append(QString());
+
+    const int cells = stars.size() * frameCount;
+    flux.fill(kNaN, cells);
+    fluxError.fill(kNaN, cells);
+    background.fill(kNaN, cells);
+    x.fill(std::numeric_limits<float>::quiet_NaN(), cells);
+    y.fill(std::numeric_limits<float>::quiet_NaN(), cells);
+    valid.fill(0, cells);
+    relativeFlux.fill(kNaN, cells);
+    relativeFluxError.fill(kNaN, cells);
+
+    comparisonWeight.fill(0.0, stars.size());
+    scatter.fill(kNaN, stars.size());
+}
+
+bool LightCurveTable::exportCSV(const QString& filePath) const
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qDebug() << "Cannot write light curve:" << filePath;
+        return false;
+    }
+
+    // One row per frame, five columns per star
+    QTextStream out(&file);
+    out << "frame,mjd,exposure";
+    for (const LightCurveStar& star : stars) {
+        const QString name = QString(star.name).replace(',', '_');
+        out << ',' << name << "_flux," << name << "_flux_err,"
+            << name << "_rel," << name << "_rel_err," << name << "_valid";
+    }
+    out << '\n';
+
+    out.setRealNumberPrecision(10);
+    for (int f = 0; f < frameCount; ++f) {
+        if (!frameValid[f]) continue;
+        out << QString(framePath[f]).replace(',', '_') << ',' << mjd[f] << ',' << exposure[f];
+        for (int s = 0; s < stars.size(); ++s) {
+            const int i = index(s, f);
+            out << ',' << flux[i] << ',' << fluxError[i] << ',' << relativeFlux[i]
+                << ',' << relativeFluxError[i] << ',' << int(valid[i]);
+        }
+        out << '\n';
+    }
+
+    return out.status() == QTextStream::Ok && file.commit();
+}
+
+QVector<LightCurveStar> LightCurveEngine::selectComparisons(const QString& referenceFrame, QString* error) const
+{
+    QVector<LightCurveStar> comparisons;
+
+    ImageReader reader;
+    if (!reader.readHeader(referenceFrame)) {
+        if (error) *error = QString("%1: %2").arg(referenceFrame, reader.lastError());
+        return comparisons;
+    }
+    const ImageData& header = reader.imageData();
+    const FrameWCS wcs = FrameWCS::fromKeywords(header.keywords, header.width, header.height);
+    if (!wcs.valid) {
+        if (error) *error = QString("%1: no WCS solution in header").arg(referenceFrame);
+        return comparisons;
+    }
+
+    // Candidates whose aperture and annulus fall well inside the frame
+    const double margin = m_options.annulusOuter + 2.0;
+    QVector<int> inFrame;
+    for (int i = 0; i < m_candidates.size(); ++i) {
+        const CatalogStar& star = m_candidates[i];
+        QPointF p;
+        if (!star.isValid || star.magnitude == 0.0 || !wcs.skyToPixel(star.ra, star.dec, p)) continue;
+        if (p.x() < margin || p.y() < margin ||
+            p.x() > header.width - 1 - margin || p.y() > header.height - 1 - margin) continue;
+        inFrame.append(i);
+    }
+
+    // Isolation: no neighbour within 2.5 mag (sweep over declination)
+    // and no target inside the radius
+    const double radiusDeg = m_options.isolationRadius / 3600.0;
+    QVector<int> byDec = inFrame;
+    std::sort(byDec.begin(), byDec.end(), [this](int a, int b) {
+        return m_candidates[a].dec < m_candidates[b].dec;
+    });
+
+    QVector<int> isolated;
+    for (int k = 0; k < byDec.size(); ++k) {
+        const CatalogStar& star = m_candidates[byDec[k]];
+        bool crowded = false;
+        for (int dir = -1; dir <= 1 && !crowded; dir += 2) {
+            for (int j = k + dir; j >= 0 && j < byDec.size(); j += dir) {
+                const CatalogStar& other = m_candidates[byDec[j]];
+                if (std::abs(other.dec - star.dec) > radiusDeg) break;
+                if (other.magnitude < star.magnitude + 2.5 &&
+                    GaiaQuadIndex::angularDistance(star.ra, star.dec, other.ra, other.dec) < radiusDeg) {
+                    crowded = true;
+                    break;
+                }
+            }
+        }
+        for (const LightCurveStar& target : m_targets) {
+            if (GaiaQuadIndex::angularDistance(star.ra, star.dec, target.ra, target.dec) < radiusDeg) {
+                crowded = true;
+            }
+        }
+        if (!crowded) isolated.append(byDec[k]);
+    }
+
+    // Closest in brightness to the targets
+    QVector<double> targetMags;
+    for (const LightCurveStar& target : m_targets) {
+        if (target.magnitude != 0.0) targetMags.append(target.magnitude);
+    }
+    QVector<double> candidateMags;
+    for (int i : isolated) candidateMags.append(m_candidates[i].magnitude);
+    const double reference = targetMags.isEmpty() ? median(candidateMags) : median(targetMags);
+
+    QVector<QPair<double, int>> ranked;
+    for (int i : isolated) {
+        const double difference = std::abs(m_candidates[i].magnitude - reference);
+        if (targetMags.isEmpty() || difference <= m_options.comparisonMagnitudeRange) {
+            ranked.append(qMakePair(difference, i));
+        }
+    }
+    std::sort(ranked.begin(), ranked.end());
+
+    for (int k = 0; k < ranked.size() && k < m_options.comparisonCount; ++k) {
+        const CatalogStar& star = m_candidates[ranked[k].second];
+        LightCurveStar comparison;
+        comparison.name = star.id.isEmpty() ? QString("C%1").arg(k + 1) : star.id;
+        comparison.ra = star.ra;
+        comparison.dec = star.dec;
+        comparison.magnitude = star.magnitude;
+        comparison.isComparison = true;
+        comparisons.append(comparison);
+    }
+
+    qDebug() << "📈 Comparison selection:" << inFrame.size() << "in frame," << isolated.size()
+             << "isolated," << comparisons.size() << "chosen around mag" << reference;
+    if (comparisons.isEmpty() && error) {
+        *error = "No isolated comparison stars of similar brightness in the reference frame";
+    }
+    return comparisons;
+}
+
+bool LightCurveEngine::measureFrame(const QString& filePath, int frame, LightCurveTable& table) const
+{
+    ImageReader reader;
+    reader.setXISFChecksumPolicy(XISFChecksumPolicy::Skip);
+    if (!reader.readFile(filePath)) {
+        table.frameError[frame] = reader.lastError();
+        return false;
+    }
+
+    const ImageData& image = reader.imageData();
+    const FrameWCS wcs = FrameWCS::fromKeywords(image.keywords, image.width, image.height);
+    if (!wcs.valid) {
+        table.frameError[frame] = "No WCS solution in header";
+        return false;
+    }
+
+    table.exposure[frame] = exposureSeconds(image.keywords);
+    table.mjd[frame] = midExposureMJD(image.keywords, table.exposure[frame]);
+
+    // Off-frame or unprojectable stars get a position the analyser skips
+    QVector<CatalogStar> positions(table.stars.size());
+    for (int s = 0; s < table.stars.size(); ++s) {
+        const LightCurveStar& star = table.stars[s];
+        CatalogStar& p = positions[s];
+        p.id = star.name;
+        p.ra = star.ra;
+        p.dec = star.dec;
+        p.magnitude = star.magnitude;
+        p.isValid = wcs.skyToPixel(star.ra, star.dec, p.pixelPos);
+        if (!p.isValid) p.pixelPos = QPointF(-1, -1);
+    }
+
+    RGBPhotometryAnalyzer analyzer;
+    analyzer.setApertureRadius(m_options.apertureRadius);
+    analyzer.setBackgroundAnnulus(m_options.annulusInner, m_options.annulusOuter);
+    const QVector<ForcedPhotometryResult> results = analyzer.measureForcedPhotometry(&image, positions);
+
+    const int firstChannel = m_options.channel >= 0 ? std::min(m_options.channel, image.channels - 1) : 0;
+    const int lastChannel = m_options.channel >= 0 ? firstChannel : image.channels - 1;
+
+    for (const ForcedPhotometryResult& result : results) {
+        const int i = table.index(result.catalogIndex, frame);
+        table.x[i] = float(result.predictedPosition.x());
+        table.y[i] = float(result.predictedPosition.y());
+        if (!result.isValid || result.annulusPixels == 0) continue;
+
+        // Aperture noise plus the uncertainty of the subtracted background,
+        // and source shot noise when the gain is known
+        const double nAp = result.aperturePixels;
+        const double backgroundTerm = nAp * (1.0 + nAp / result.annulusPixels);
+        double sum = 0.0, variance = 0.0, sky = 0.0;
+        for (int c = firstChannel; c <= lastChannel && c < result.flux.size(); ++c) {
+            const double sigma = result.backgroundSigma[c];
+            sum += result.flux[c];
+            sky += result.background[c];
+            variance += sigma * sigma * backgroundTerm;
+            if (m_options.gain > 0.0) variance += std::max(0.0, result.flux[c]) / m_options.gain;
+        }
+
+        const double error = std::sqrt(variance);
+        table.flux[i] = sum;
+        table.fluxError[i] = error;
+        table.background[i] = sky;
+        table.valid[i] = sum > 0.0 && error > 0.0 && sum / error >= m_options.minimumSNR;
+    }
+
+    return true;
+}
+
+const LightCurveTable& LightCurveEngine::run(const QStringList& framePaths,
+                                             ProgressCallback progress,
+                                             const std::atomic<bool>* cancel)
+{
+    QVector<LightCurveStar> comparisons = m_comparisons;
+    if (comparisons.isEmpty() && !framePaths.isEmpty()) {
+        QString error;
+        comparisons = selectComparisons(framePaths.first(), &error);
+        if (comparisons.isEmpty()) qDebug() << "Light curve comparison selection failed:" << error;
+    }
+    for (LightCurveStar& comparison : comparisons) comparison.isComparison = true;
+
+    QVector<LightCurveStar> stars = m_targets;
+    for (LightCurveStar& target : stars) target.isComparison = false;
+    stars += comparisons;
+    m_table.reset(stars, framePaths);
+
+    // Whole frames per work item, a few at a time: each decode and
+    // measurement is already parallel, and full frames are large
+    const int total = framePaths.size();
+    const int workers = std::max(1, std::min(total, m_options.maxConcurrentFrames));
+    std::atomic<int> next(0);
+    std::atomic<int> done(0);
+
+    Parallel::forChunks(workers, workers, [&](int, size_t, size_t) {
+        for (int f = next++; f < total; f = next++) {
+            if (cancel && cancel->load()) return;
+
+            m_table.frameValid[f] = measureFrame(framePaths[f], f, m_table);
+            if (!m_table.frameValid[f]) {
+                qDebug() << "Light curve skipped" << framePaths[f] << ":" << m_table.frameError[f];
+            }
+
+            int count = ++done;
+            if (progress) progress(count, total);
+        }
+    });
+
+    normalise(m_table);
+
+    const int measured = std::count(m_table.frameValid.begin(), m_table.frameValid.end(), quint8(1));
+    qDebug() << "📈 Light curves for" << m_targets.size() << "targets with" << comparisons.size()
+             << "comparisons over" << measured << "of" << total << "frames";
+    return m_table;
+}
+
+void LightCurveEngine::normalise(LightCurveTable& table) const
+{
+    const int frames = table.frameCount;
+    QVector<int> comparisons;
+    for (int s = 0; s < table.stars.size(); ++s) {
+        if (table.stars[s].isComparison) comparisons.append(s);
+    }
+
+    // Each comparison's flux relative to its own median
+    QVector<double> level(table.stars.size(), kNaN);
+    for (int s : comparisons) {
+        QVector<double> values;
+        for (int f = 0; f < frames; ++f) {
+            const int i = table.index(s, f);
+            if (table.frameValid[f] && table.valid[i]) values.append(table.flux[i]);
+        }
+        level[s] = median(values);
+    }
+
+    QVector<double>& weight = table.comparisonWeight;
+    for (int s : comparisons) weight[s] = std::isfinite(level[s]) && level[s] > 0.0 ? 1.0 : 0.0;
+
+    // Weighted ensemble of normalised comparison fluxes at frame f,
+    // optionally without one star (a comparison's own light curve)
+    auto ensemble = [&](int f, int exclude, double& value, double& error) {
+        double sumW = 0.0, sum = 0.0, variance = 0.0;
+        for (int s : comparisons) {
+            const int i = table.index(s, f);
+            if (s == exclude || weight[s] <= 0.0 || !table.valid[i]) continue;
+            const double w = weight[s];
+            sumW += w;
+            sum += w * table.flux[i] / level[s];
+            variance += w * w * (table.fluxError[i] / level[s]) * (table.fluxError[i] / level[s]);
+        }
+        if (sumW <= 0.0) return false;
+        value = sum / sumW;
+        error = std::sqrt(variance) / sumW;
+        return value > 0.0;
+    };
+
+    // Relative light curve of star s normalised to its median
+    auto relativeCurve = [&](int s) {
+        const int exclude = table.stars[s].isComparison ? s : -1;
+        QVector<double> values;
+        for (int f = 0; f < frames; ++f) {
+            const int i = table.index(s, f);
+            table.relativeFlux[i] = kNaN;
+            table.relativeFluxError[i] = kNaN;
+            double e = 0.0, eError = 0.0;
+            if (!table.frameValid[f] || !table.valid[i] || !ensemble(f, exclude, e, eError)) continue;
+
+            const double r = table.flux[i] / e;
+            table.relativeFlux[i] = r;
+            table.relativeFluxError[i] = r * std::hypot(table.fluxError[i] / table.flux[i], eError / e);
+            values.append(r);
+        }
+
+        const double center = median(values);
+        if (!(center > 0.0)) return;
+        for (int f = 0; f < frames; ++f) {
+            const int i = table.index(s, f);
+            table.relativeFlux[i] /= center;
+            table.relativeFluxError[i] /= center;
+        }
+        for (double& v : values) v /= center;
+        table.scatter[s] = robustSigma(values);
+    };
+
+    // Reweight comparisons by 1/scatter^2 of their leave-one-out curves and
+    // drop the ones far noisier than the rest (variables, blends, defects)
+    for (int iteration = 0; iteration < kEnsembleIterations && comparisons.size() > 1; ++iteration) {
+        QVector<double> scatters;
+        for (int s : comparisons) {
+            if (weight[s] <= 0.0) continue;
+            relativeCurve(s);
+            if (std::isfinite(table.scatter[s]) && table.scatter[s] > 0.0) scatters.append(table.scatter[s]);
+        }
+        const double typical = median(scatters);
+        if (!(typical > 0.0)) break;
+
+        int rejected = 0;
+        for (int s : comparisons) {
+            if (weight[s] <= 0.0) continue;
+            const double sigma = std::isfinite(table.scatter[s]) ? std::max(table.scatter[s], typical * 0.1) : kNaN;
+            if (!std::isfinite(sigma) || sigma > m_options.comparisonClipSigma * typical) {
+                weight[s] = 0.0;
+                ++rejected;
+                qDebug() << "Comparison" << table.stars[s].name << "rejected, scatter" << table.scatter[s];
+            } else {
+                weight[s] = 1.0 / (sigma * sigma);
+            }
+        }
+        if (rejected == 0 && iteration > 0) break;
+    }
+
+    for (int s = 0; s < table.stars.size(); ++s) {
+        relativeCurve(s);
+        if (!table.stars[s].isComparison) table.comparisonWeight[s] = 0.0;
+    }
+}
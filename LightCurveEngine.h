@@ -0,0 +1,116 @@
+// LightCurveEngine.h - Differential photometry light curves across frame sequences
+#ifndef LIGHT_CURVE_ENGINE_H
+#define LIGHT_CURVE_ENGINE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <functional>
+
+#include "StarCatalogValidator.h"
+
+// A star followed through the sequence at a fixed sky position
+struct LightCurveStar {
+    QString name;
+    double ra = 0.0;                // degrees
+    double dec = 0.0;               // degrees
+    double magnitude = 0.0;         // Catalog magnitude, 0 if unknown
+    bool isComparison = false;
+};
+
+struct LightCurveOptions {
+    double apertureRadius = 6.0;        // pixels
+    double annulusInner = 10.0;         // pixels
+    double annulusOuter = 15.0;         // pixels
+    int channel = -1;                   // Channel to measure; -1 sums all channels
+    double gain = 0.0;                  // Electrons per (normalised) data unit; 0 = background-limited errors
+
+    // Automatic comparison selection from the candidate catalog
+    int comparisonCount = 8;
+    double comparisonMagnitudeRange = 1.5;  // Max |m - m_target|
+    double isolationRadius = 20.0;          // arcsec free of neighbours within 2.5 mag
+    double comparisonClipSigma = 3.0;       // Drop comparisons scattering this far above the median
+
+    double minimumSNR = 5.0;            // Points below are kept but flagged invalid
+    int maxConcurrentFrames = 4;        // Frames decoded at once (each is itself parallel)
+};
+
+// Columnar results. Frame columns have one entry per frame; star columns
+// are star-major, entry (star, frame) at star * frameCount + frame, so one
+// star's light curve is contiguous. Frames fill their own entries as they
+// finish, in any order.
+struct LightCurveTable {
+    QVector<LightCurveStar> stars;      // Targets first, then comparisons
+    int frameCount = 0;
+
+    // Per frame
+    QStringList framePath;
+    QVector<double> mjd;                // Mid-exposure, UTC
+    QVector<double> exposure;           // seconds
+    QVector<quint8> frameValid;
+    QStringList frameError;
+
+    // Per star and frame
+    QVector<double> flux;               // Background-subtracted aperture sum
+    QVector<double> fluxError;
+    QVector<double> background;         // Annulus median per pixel
+    QVector<float> x;                   // Projected position (pixels)
+    QVector<float> y;
+    QVector<quint8> valid;
+
+    // Ensemble-normalised curves, same layout. Comparisons are normalised
+    // against the ensemble of the other comparisons.
+    QVector<double> relativeFlux;
+    QVector<double> relativeFluxError;
+
+    // Per star: ensemble weight (0 for targets and rejected comparisons)
+    QVector<double> comparisonWeight;
+    QVector<double> scatter;            // Robust sigma of relativeFlux
+
+    int index(int star, int frame) const { return star * frameCount + frame; }
+    void reset(const QVector<LightCurveStar>& starList, const QStringList& frames);
+    bool exportCSV(const QString& filePath) const;
+};
+
+// Forced aperture photometry of targets and comparison stars at fixed
+// RA/Dec through each frame's own WCS (header keywords), then ensemble
+// differential normalisation. Frames are decoded and measured in parallel
+// and stream into the table; normalisation runs once all frames are in.
+class LightCurveEngine
+{
+public:
+    using ProgressCallback = std::function<void(int done, int total)>;
+
+    void setOptions(const LightCurveOptions& options) { m_options = options; }
+    const LightCurveOptions& options() const { return m_options; }
+
+    void setTargets(const QVector<LightCurveStar>& targets) { m_targets = targets; }
+
+    // Catalog stars (e.g. a Gaia cone over the field) from which
+    // comparisons are picked on the first frame; ignored when explicit
+    // comparison stars are set
+    void setComparisonCandidates(const QVector<CatalogStar>& candidates) { m_candidates = candidates; }
+    void setComparisonStars(const QVector<LightCurveStar>& comparisons) { m_comparisons = comparisons; }
+
+    const LightCurveTable& run(const QStringList& framePaths,
+                               ProgressCallback progress = ProgressCallback(),
+                               const std::atomic<bool>* cancel = nullptr);
+
+    const LightCurveTable& table() const { return m_table; }
+
+    // Stages
+    QVector<LightCurveStar> selectComparisons(const QString& referenceFrame, QString* error = nullptr) const;
+    void normalise(LightCurveTable& table) const;
+
+private:
+    bool measureFrame(const QString& filePath, int frame, LightCurveTable& table) const;
+
+    LightCurveOptions m_options;
+    QVector<LightCurveStar> m_targets;
+    QVector<LightCurveStar> m_comparisons;
+    QVector<CatalogStar> m_candidates;
+    LightCurveTable m_table;
+};
+
+#endif // LIGHT_CURVE_ENGINE_H
@@ -24,6 +24,7 @@
 #include "GaiaGDR3Catalog.h"
 #include "PlatesolverSettingsDialog.h"
 #include "StarStatisticsChartDialog.h"
+#include "RGBPhotometryAnalyzer.h"
 
 // Add these method implementations to your MainWindow.cpp to fix the compilation errors:
 
@@ -41,9 +42,13 @@ void MainWindow::initializePlatesolveIntegration()
     m_maxScale = 60.0;
     m_platesolveTimeout = 300;
     m_maxStarsForSolving = 200;
+    m_inProcessSolving = false;
+    m_nativeSolving = false;
+    m_quadIndexPath = QDir::homePath() + "/.gaia_quad_indexes";
     
     // Configure plate solver
     m_platesolveIntegration->configurePlateSolver(m_astrometryPath, m_indexPath, m_minScale, m_maxScale);
+    m_platesolveIntegration->setTimeout(m_platesolveTimeout);
     
     // Connect to your existing StarCatalogValidator if available
     if (m_catalogValidator) {
@@ -121,20 +126,51 @@ void MainWindow::onExtractStarsWithPlatesolve()
         return;
     }
 
-    /*    
-    // Run star detection first if we don't have stars
-    if (m_lastStarMask.starCenters.isEmpty()) {
-        // Use your existing detection method
-        onDetectStars(); // This calls your existing star detection
-    }
-    */
-    
-    // Now trigger plate solving
     if (!m_lastStarMask.starCenters.isEmpty()) {
         triggerPlatesolveWithCurrentStars();
-    } else {
-        QMessageBox::information(this, "Plate Solve", "No stars detected for plate solving.");
+        return;
+    }
+    
+    if (m_jobManager->isActive(m_detectJobId)) {
+        m_statusLabel->setText("Star detection already running...");
+        return;
     }
+    
+    // Without earlier detections, run the fast solve-oriented extraction in
+    // the background: detect on a binned level and re-centroid only the
+    // stars we will use, then solve with those centroids
+    ImageData image = m_imageReader->imageData();
+    qint64 pixels = qint64(image.width) * image.height;
+    int binLevel = pixels > 16000000 ? 2 : (pixels > 4000000 ? 1 : 0);
+    int maxStars = m_maxStarsForSolving;
+    auto detection = std::make_shared<StarMaskResult>();
+    m_pendingDetection = detection;
+    
+    m_statusLabel->setText("Extracting stars for plate solving...");
+    
+    m_detectJobId = m_jobManager->submit("Extracting stars for plate solving",
+        [image, detection, maxStars, binLevel](JobContext&) {
+            *detection = StarMaskGenerator::detectStarsForSolving(image, maxStars, binLevel);
+        },
+        [this, detection](JobManager::State state, const QString&) {
+            if (m_pendingDetection == detection) m_pendingDetection.reset();
+            if (state != JobManager::State::Succeeded) {
+                return;
+            }
+            
+            m_lastStarMask = *detection;
+            m_imageDisplayWidget->setStarOverlay(m_lastStarMask.starCenters, m_lastStarMask.starRadii);
+            m_starsDetected = !m_lastStarMask.starCenters.isEmpty();
+            updateValidationControls();
+            
+            if (m_starsDetected) {
+                triggerPlatesolveWithCurrentStars();
+            } else {
+                QMessageBox::information(this, "Plate Solve", "No stars detected for plate solving.");
+            }
+        });
+    
+    updateValidationControls();
 }
 
 void MainWindow::triggerPlatesolveWithCurrentStars()
@@ -144,11 +180,15 @@ void MainWindow::triggerPlatesolveWithCurrentStars()
         return;
     }
     
-    // Create flux estimates - simple approach based on radius
+    // Measured fluxes when the detector provided them, otherwise a simple
+    // estimate based on radius
     QVector<float> starFluxes;
     starFluxes.reserve(m_lastStarMask.starCenters.size());
+    if (m_lastStarMask.starFluxes.size() == m_lastStarMask.starCenters.size()) {
+        starFluxes = m_lastStarMask.starFluxes;
+    }
     
-    for (int i = 0; i < m_lastStarMask.starCenters.size(); ++i) {
+    for (int i = starFluxes.size(); i < m_lastStarMask.starCenters.size(); ++i) {
         float radius = (i < m_lastStarMask.starRadii.size()) ? m_lastStarMask.starRadii[i] : 3.0f;
         // Simple flux estimate: larger stars are brighter
         float estimatedFlux = radius * radius * 100.0f;
@@ -158,13 +198,23 @@ void MainWindow::triggerPlatesolveWithCurrentStars()
     // Get ImageData pointer correctly
     const ImageData* imageDataPtr = &(m_imageReader->imageData());
     
-    // Trigger plate solving
-    m_platesolveIntegration->extractStarsAndSolve(
-        imageDataPtr,
-        m_lastStarMask.starCenters,
-        starFluxes,
-        m_lastStarMask.starRadii
-    );
+    // Trigger plate solving, with the sub-pixel centroids when the
+    // detector measured them
+    if (m_lastStarMask.starCentroids.size() == m_lastStarMask.starCenters.size()) {
+        m_platesolveIntegration->extractStarsAndSolve(
+            imageDataPtr,
+            m_lastStarMask.starCentroids,
+            starFluxes,
+            m_lastStarMask.starRadii
+        );
+    } else {
+        m_platesolveIntegration->extractStarsAndSolve(
+            imageDataPtr,
+            m_lastStarMask.starCenters,
+            starFluxes,
+            m_lastStarMask.starRadii
+        );
+    }
 }
 
 void MainWindow::onPlatesolveStarted()
@@ -174,6 +224,8 @@ void MainWindow::onPlatesolveStarted()
     m_platesolveProgressDialog = new QProgressDialog("Plate solving in progress...", "Cancel", 0, 0, this);
     m_platesolveProgressDialog->setModal(true);
     m_platesolveProgressDialog->setMinimumDuration(1000);
+    connect(m_platesolveProgressDialog, &QProgressDialog::canceled,
+            m_platesolveIntegration, &SimplePlatesolver::cancelSolve);
     m_platesolveProgressDialog->show();
     
     m_statusLabel->setText("Plate solving...");
@@ -227,10 +279,11 @@ void MainWindow::onPlatesolveComplete(const pcl::AstrometricMetadata & result, c
 
 void MainWindow::onPlatesolveFailed(const QString& error)
 {
-    // Hide progress dialog
+    // Hide progress dialog; a cancel arrives from inside its canceled()
+    // signal, so it cannot be deleted immediately
     if (m_platesolveProgressDialog) {
         m_platesolveProgressDialog->hide();
-        delete m_platesolveProgressDialog;
+        m_platesolveProgressDialog->deleteLater();
         m_platesolveProgressDialog = nullptr;
     }
     
@@ -263,6 +316,9 @@ void MainWindow::configurePlatesolverSettings()
     dialog.setScaleRange(m_minScale, m_maxScale);
     dialog.setTimeout(m_platesolveTimeout);
     dialog.setMaxStars(m_maxStarsForSolving);
+    dialog.setInProcessSolving(m_inProcessSolving);
+    dialog.setNativeSolving(m_nativeSolving);
+    dialog.setQuadIndexPath(m_quadIndexPath);
     
     if (dialog.exec() == QDialog::Accepted) {
         // Get new values
@@ -272,10 +328,16 @@ void MainWindow::configurePlatesolverSettings()
         m_maxScale = dialog.getMaxScale();
         m_platesolveTimeout = dialog.getTimeout();
         m_maxStarsForSolving = dialog.getMaxStars();
+        m_inProcessSolving = dialog.getInProcessSolving();
+        m_nativeSolving = dialog.getNativeSolving();
+        m_quadIndexPath = dialog.getQuadIndexPath();
         
         // Update configuration
         m_platesolveIntegration->configurePlateSolver(
             m_astrometryPath, m_indexPath, m_minScale, m_maxScale);
+        m_platesolveIntegration->setTimeout(m_platesolveTimeout);
+        m_platesolveIntegration->setInProcessSolverEnabled(m_inProcessSolving);
+        m_platesolveIntegration->setNativeSolverEnabled(m_nativeSolving, m_quadIndexPath);
         
         m_statusLabel->setText("Plate solver settings updated");
     }
@@ -755,7 +817,10 @@ void MainWindow::setupEnhancedMatchingControls()
 
 void MainWindow::onValidateStars()
 {
-    if (!m_starsDetected) {
+    // Validation can be queued behind a detection that is still running
+    bool detectionPending = m_jobManager->isActive(m_detectJobId) && m_pendingDetection;
+    
+    if (!m_starsDetected && !detectionPending) {
         QMessageBox::information(this, "Enhanced Validation", "Please detect stars first.");
         return;
     }
@@ -770,56 +835,79 @@ void MainWindow::onValidateStars()
         return;
     }
     
+    if (m_jobManager->isActive(m_validateJobId)) {
+        m_statusLabel->setText("Enhanced validation already running...");
+        return;
+    }
+    
     m_statusLabel->setText("Performing enhanced star validation...");
     m_matchingProgressBar->setVisible(true);
     m_matchingProgressBar->setRange(0, 0); // Indeterminate
-    QApplication::processEvents();
-    
-    try {
-        // Get matching parameters from UI
-        StarMatchingParameters params = getMatchingParametersFromUI();
-        
-        // Estimate star magnitudes from detection data (rough approximation)
-        QVector<float> estimatedMagnitudes;
-        for (int i = 0; i < m_lastStarMask.starRadii.size(); ++i) {
-            // Very rough magnitude estimation from star radius
-            float radius = m_lastStarMask.starRadii[i];
-            float estimatedMag = 12.0 - 2.5 * log10(radius * radius / 4.0);
-            estimatedMagnitudes.append(estimatedMag);
-        }
-        
-        qDebug() <<  "Starting enhanced validation with parameters:";
-        qDebug() <<  "  Max pixel distance:" << params.maxPixelDistance;
-        qDebug() <<  "  Triangle matching:" << params.useTriangleMatching;
-        qDebug() <<  "  Min confidence:" << params.minMatchConfidence;
-        
-        // Perform enhanced validation
-        m_lastEnhancedValidation = m_catalogValidator->validateStarsAdvanced(
-            m_lastStarMask.starCenters, estimatedMagnitudes, params);
-        
-        m_enhancedValidationComplete = m_lastEnhancedValidation.isValid;
-        
-        // Display results
-        displayEnhancedResults(m_lastEnhancedValidation);
-        
-        // Update image display with enhanced results
-        m_imageDisplayWidget->setValidationResults(m_lastEnhancedValidation);
-        
-        // Update status
-        QString statusText = QString("Enhanced validation: %1/%2 matches (%3%% confidence)")
-                            .arg(m_lastEnhancedValidation.totalMatches)
-                            .arg(m_lastEnhancedValidation.totalDetected)
-                            .arg(m_lastEnhancedValidation.matchingConfidence);
-        m_statusLabel->setText(statusText);
-        
-    } catch (const std::exception& e) {
-        QString errorMsg = QString("Enhanced validation error: %1").arg(e.what());
-        m_statusLabel->setText(errorMsg);
-        QMessageBox::warning(this, "Enhanced Validation Error", errorMsg);
-    }
     
-    m_matchingProgressBar->setVisible(false);
-    updateEnhancedMatchingControls();
+    // Get matching parameters from UI
+    StarMatchingParameters params = getMatchingParametersFromUI();
+    
+    qDebug() <<  "Starting enhanced validation with parameters:";
+    qDebug() <<  "  Max pixel distance:" << params.maxPixelDistance;
+    qDebug() <<  "  Triangle matching:" << params.useTriangleMatching;
+    qDebug() <<  "  Min confidence:" << params.minMatchConfidence;
+    
+    // Read by the job only once the detection it depends on has finished
+    std::shared_ptr<StarMaskResult> stars = detectionPending
+        ? m_pendingDetection : std::make_shared<StarMaskResult>(m_lastStarMask);
+    QList<int> dependencies;
+    if (detectionPending) dependencies.append(m_detectJobId);
+    
+    // The job works on its own copy of the catalog and solution, and its own
+    // matcher: the GUI thread may requery or replace the solution meanwhile
+    QVector<CatalogStar> catalog = m_catalogValidator->catalogStars();
+    pcl::AstrometricMetadata astrometry = m_catalogValidator->astrometricMetadata();
+    
+    m_validateJobId = m_jobManager->submitTask<EnhancedValidationResult>("Enhanced star validation",
+        [catalog, astrometry, stars, params](JobContext&) {
+            // Estimate star magnitudes from detection data (rough approximation)
+            QVector<float> estimatedMagnitudes;
+            for (int i = 0; i < stars->starRadii.size(); ++i) {
+                // Very rough magnitude estimation from star radius
+                float radius = stars->starRadii[i];
+                float estimatedMag = 12.0 - 2.5 * log10(radius * radius / 4.0);
+                estimatedMagnitudes.append(estimatedMag);
+            }
+            
+            // Perform enhanced validation
+            EnhancedStarMatcher matcher(params);
+            return matcher.matchStarsAdvanced(stars->starCenters, estimatedMagnitudes, catalog, astrometry);
+        },
+        [this](const EnhancedValidationResult& result) {
+            m_lastEnhancedValidation = result;
+            m_enhancedValidationComplete = m_lastEnhancedValidation.isValid;
+            
+            // Display results
+            displayEnhancedResults(m_lastEnhancedValidation);
+            
+            // Update image display with enhanced results
+            m_imageDisplayWidget->setValidationResults(m_lastEnhancedValidation);
+            
+            // Update status
+            QString statusText = QString("Enhanced validation: %1/%2 matches (%3%% confidence)")
+                                .arg(m_lastEnhancedValidation.totalMatches)
+                                .arg(m_lastEnhancedValidation.totalDetected)
+                                .arg(m_lastEnhancedValidation.matchingConfidence);
+            m_statusLabel->setText(statusText);
+            
+            m_matchingProgressBar->setVisible(false);
+            updateEnhancedMatchingControls();
+        },
+        [this](JobManager::State state, const QString& error) {
+            if (state == JobManager::State::Failed) {
+                QString errorMsg = QString("Enhanced validation error: %1").arg(error);
+                m_statusLabel->setText(errorMsg);
+                QMessageBox::warning(this, "Enhanced Validation Error", errorMsg);
+            }
+            m_matchingProgressBar->setVisible(false);
+            updateEnhancedMatchingControls();
+        },
+        dependencies);
 }
 
 StarMatchingParameters MainWindow::getMatchingParametersFromUI()
@@ -1247,9 +1335,13 @@ void MainWindow::onDetectStarsAdvanced()
         m_statusLabel->setText("No image loaded.");
         return;
     }
+    
+    if (m_jobManager->isActive(m_detectJobId)) {
+        m_statusLabel->setText("Star detection already running...");
+        return;
+    }
 
     m_statusLabel->setText("Detecting stars with PCL StarDetector...");
-    QApplication::processEvents();
 
     // Get parameters from UI controls
     float sensitivity = m_sensitivitySlider->value() / 100.0f;
@@ -1267,17 +1359,52 @@ void MainWindow::onDetectStarsAdvanced()
     qDebug() <<  "  Max distortion:" << maxDistortion;
     qDebug() <<  "  PSF fitting:" << enablePSFFitting;
 
-    // Use our advanced StarMaskGenerator method
-    m_lastStarMask = StarMaskGenerator::detectStarsAdvanced(
-        m_imageReader->imageData(),
-        sensitivity,
-        structureLayers,
-        noiseLayers,
-        peakResponse,
-        maxDistortion,
-        enablePSFFitting
-    );
+    QString paramSummary = QString("PCL StarDetector Parameters:\n"
+                                  "  Sensitivity: %1\n"
+                                  "  Structure Layers: %2\n"
+                                  "  Noise Layers: %3\n"
+                                  "  Peak Response: %4\n"
+                                  "  Max Distortion: %5\n"
+                                  "  PSF Fitting: %6\n\n")
+                          .arg(sensitivity, 0, 'f', 2)
+                          .arg(structureLayers)
+                          .arg(noiseLayers)
+                          .arg(peakResponse, 0, 'f', 2)
+                          .arg(maxDistortion, 0, 'f', 2)
+                          .arg(enablePSFFitting ? "Enabled" : "Disabled");
+
+    // The copy shares the pixel buffer, so loading another image while
+    // detection runs cannot pull it out from under the job
+    ImageData image = m_imageReader->imageData();
+    auto detection = std::make_shared<StarMaskResult>();
+    m_pendingDetection = detection;
+    
+    m_detectJobId = m_jobManager->submit("Detecting stars",
+        [=](JobContext&) {
+            // Use our advanced StarMaskGenerator method
+            *detection = StarMaskGenerator::detectStarsAdvanced(
+                image,
+                sensitivity,
+                structureLayers,
+                noiseLayers,
+                peakResponse,
+                maxDistortion,
+                enablePSFFitting
+            );
+        },
+        [this, detection, paramSummary](JobManager::State state, const QString&) {
+            if (m_pendingDetection == detection) m_pendingDetection.reset();
+            if (state == JobManager::State::Succeeded) {
+                applyStarDetection(*detection, paramSummary);
+            }
+        });
+    
+    updateValidationControls();
+}
 
+void MainWindow::applyStarDetection(const StarMaskResult& result, const QString& paramSummary)
+{
+    m_lastStarMask = result;
     m_imageDisplayWidget->setStarOverlay(m_lastStarMask.starCenters, m_lastStarMask.starRadii);
     m_starsDetected = !m_lastStarMask.starCenters.isEmpty();
     
@@ -1287,23 +1414,8 @@ void MainWindow::onDetectStarsAdvanced()
         statusText += " - Use checkboxes to toggle display";
         
         // Add parameter summary to results text
-        QString paramSummary = QString("PCL StarDetector Parameters:\n"
-                                      "  Sensitivity: %1\n"
-                                      "  Structure Layers: %2\n"
-                                      "  Noise Layers: %3\n"
-                                      "  Peak Response: %4\n"
-                                      "  Max Distortion: %5\n"
-                                      "  PSF Fitting: %6\n\n"
-                                      "Results: %7 stars detected")
-                              .arg(sensitivity, 0, 'f', 2)
-                              .arg(structureLayers)
-                              .arg(noiseLayers)
-                              .arg(peakResponse, 0, 'f', 2)
-                              .arg(maxDistortion, 0, 'f', 2)
-                              .arg(enablePSFFitting ? "Enabled" : "Disabled")
-                              .arg(m_lastStarMask.starCenters.size());
-        
-        m_resultsText->setPlainText(paramSummary);
+        m_resultsText->setPlainText(paramSummary + QString("Results: %1 stars detected")
+                                    .arg(m_lastStarMask.starCenters.size()));
     }
     m_statusLabel->setText(statusText);
     
@@ -1446,6 +1558,12 @@ void MainWindow::setupUI()
 // Update your onLoadImage method to enable star detection controls
 void MainWindow::onLoadImage()
 {
+    // Validation runs against the validator's WCS, which loading replaces
+    if (m_jobManager->isActive(m_validateJobId)) {
+        m_statusLabel->setText("Validation still running - wait or cancel before loading");
+        return;
+    }
+    
     QString filePath = QFileDialog::getOpenFileName(
         this,
         "Open Image File",
@@ -1456,6 +1574,9 @@ void MainWindow::onLoadImage()
     if (filePath.isEmpty())
         return;
 
+    // Results still being computed belong to the previous image
+    m_jobManager->cancelAll();
+
     if (!m_imageReader->readFile(filePath)) {
         m_statusLabel->setText("Failed to load image: " + m_imageReader->lastError());
         QMessageBox::warning(this, "Load Error", m_imageReader->lastError());
@@ -1723,52 +1844,131 @@ void MainWindow::testGaiaPerformance()
         QMessageBox::information(this, "Performance Test", "Load an image with WCS first");
         return;
     }
+    if (m_jobManager->isActive(m_gaiaTestJobId)) {
+        m_statusLabel->setText("Gaia performance test already running...");
+        return;
+    }
     double crval1, crval2;
     m_catalogValidator->getCenter(crval1, crval2);
    
-    double testRadius = 2.0; // 2 degree radius for performance test
-    
-    qDebug() << "\n=== GAIA GDR3 PERFORMANCE COMPARISON ===";
-    qDebug() << QString("Test query: RA=%1° Dec=%2° radius=%3°")
-      .arg(crval1).arg(crval2).arg(testRadius);
-    
-    // Test different magnitude limits
-    QVector<double> magLimits = {12.0, 15.0, 18.0, 20.0};
-    
-    for (double magLimit : magLimits) {
-        auto start = QTime::currentTime();
+    m_gaiaTestJobId = m_jobManager->submit("Gaia performance test", [crval1, crval2](JobContext& job) {
+        double testRadius = 2.0; // 2 degree radius for performance test
+        
+        qDebug() << "\n=== GAIA GDR3 PERFORMANCE COMPARISON ===";
+        qDebug() << QString("Test query: RA=%1° Dec=%2° radius=%3°")
+          .arg(crval1).arg(crval2).arg(testRadius);
+        
+        // Test different magnitude limits
+        QVector<double> magLimits = {12.0, 15.0, 18.0, 20.0};
+        QVector<int> targets = {200, 2000};
+        const int steps = magLimits.size() + targets.size() + 1;
+        int step = 0;
+        
+        for (double magLimit : magLimits) {
+            if (job.isCancelled()) return;
+            job.setProgress(step++, steps, QString("Gaia performance test: mag ≤ %1").arg(magLimit));
+            auto start = QTime::currentTime();
+            
+            GaiaGDR3Catalog::SearchParameters params(crval1, crval2, testRadius, magLimit);
+            auto stars = GaiaGDR3Catalog::queryRegion(params);
+            
+            auto elapsed = start.msecsTo(QTime::currentTime());
+            
+            qDebug() << QString("🚀 Mag ≤ %1: %2 stars in %3ms (%4 stars/sec)")
+                        .arg(magLimit).arg(stars.size()).arg(elapsed)
+              .arg(stars.size() * 1000.0 / elapsed);
+        }
         
-        GaiaGDR3Catalog::SearchParameters params(crval1, crval2, testRadius, magLimit);
-        auto stars = GaiaGDR3Catalog::queryRegion(params);
+        // Target-count queries: the magnitude limit comes from the tile summary
+        for (int target : targets) {
+            if (job.isCancelled()) return;
+            job.setProgress(step++, steps, QString("Gaia performance test: target %1 stars").arg(target));
+            auto start = QTime::currentTime();
+            
+            GaiaGDR3Catalog::SearchParameters params(crval1, crval2, testRadius, 20.0);
+            params.targetCount = target;
+            auto stars = GaiaGDR3Catalog::queryRegion(params);
+            
+            auto elapsed = start.msecsTo(QTime::currentTime());
+            double faintest = stars.isEmpty() ? 0.0 : stars.last().magnitude;
+            
+            qDebug() << QString("🎯 Target %1: %2 stars down to mag %3 in %4ms")
+                        .arg(target).arg(stars.size()).arg(faintest, 0, 'f', 2).arg(elapsed);
+        }
         
+        // Test spectrum search
+        if (job.isCancelled()) return;
+        job.setProgress(step++, steps, "Gaia performance test: BP/RP spectra");
+        auto start = QTime::currentTime();
+        auto specStars = GaiaGDR3Catalog::findStarsWithSpectra(crval1, crval2, testRadius, 15.0);
         auto elapsed = start.msecsTo(QTime::currentTime());
-        
-        qDebug() << QString("🚀 Mag ≤ %1: %2 stars in %3ms (%4 stars/sec)")
-                    .arg(magLimit).arg(stars.size()).arg(elapsed)
-	  .arg(stars.size() * 1000.0 / elapsed);
-    }
-    
-    // Test spectrum search
-    auto start = QTime::currentTime();
-    auto specStars = GaiaGDR3Catalog::findStarsWithSpectra(crval1, crval2, testRadius, 15.0);
-    auto elapsed = start.msecsTo(QTime::currentTime());
-    qDebug() << QString("🌈 BP/RP spectra search: %1 stars in %2ms")
-      .arg(specStars.size()).arg(elapsed);
-    qDebug() << "📊 Gaia GDR3 provides:";
-    qDebug() << "   - Precise astrometry (positions, proper motions, parallax)";
-    qDebug() << "   - Multi-band photometry (G, BP, RP)";
-    qDebug() << "   - BP/RP low-resolution spectra for many stars";
-    qDebug() << "   - Quality flags and error estimates";
-    qDebug() << "   - Proper motion corrections to current epoch";
+        qDebug() << QString("🌈 BP/RP spectra search: %1 stars in %2ms")
+          .arg(specStars.size()).arg(elapsed);
+        qDebug() << "📊 Gaia GDR3 provides:";
+        qDebug() << "   - Precise astrometry (positions, proper motions, parallax)";
+        qDebug() << "   - Multi-band photometry (G, BP, RP)";
+        qDebug() << "   - BP/RP low-resolution spectra for many stars";
+        qDebug() << "   - Quality flags and error estimates";
+        qDebug() << "   - Proper motion corrections to current epoch";
+        job.setProgress(steps, steps);
+    },
+    [this](JobManager::State state, const QString&) {
+        if (state == JobManager::State::Succeeded) {
+            m_statusLabel->setText("Gaia performance test complete - see log for timings");
+        }
+    });
 }
 
 // Update the destructor to clean up Gaia resources:
 MainWindow::~MainWindow() 
 {
+    // Background work may still be querying the catalog
+    m_jobManager.reset();
+    
     // Clean up Gaia catalog resources
     GaiaGDR3Catalog::shutdown();
 }
 
+void MainWindow::setupJobManager()
+{
+    m_jobProgressBar = new QProgressBar;
+    m_jobProgressBar->setMaximumWidth(200);
+    m_jobProgressBar->setVisible(false);
+    m_cancelJobsButton = new QPushButton("Cancel");
+    m_cancelJobsButton->setToolTip("Cancel running background jobs");
+    m_cancelJobsButton->setVisible(false);
+    m_buttonLayout->addWidget(m_jobProgressBar);
+    m_buttonLayout->addWidget(m_cancelJobsButton);
+    
+    connect(m_cancelJobsButton, &QPushButton::clicked, this, [this]() {
+        m_jobManager->cancelAll();
+        m_statusLabel->setText("Cancelling background jobs...");
+    });
+    connect(m_jobManager.get(), &JobManager::jobStarted, this, [this](int, const QString& name) {
+        m_statusLabel->setText(QString("%1...").arg(name));
+        m_jobProgressBar->setRange(0, 0); // Indeterminate until the job reports
+    });
+    connect(m_jobManager.get(), &JobManager::jobProgress, this,
+            [this](int, int done, int total, const QString& text) {
+        m_jobProgressBar->setRange(0, total);
+        m_jobProgressBar->setValue(done);
+        if (!text.isEmpty()) m_statusLabel->setText(text);
+    });
+    connect(m_jobManager.get(), &JobManager::jobFinished, this,
+            [this](int, const QString& name, JobManager::State state, const QString& error) {
+        if (state == JobManager::State::Failed) {
+            m_statusLabel->setText(QString("%1 failed: %2").arg(name, error));
+        } else if (state == JobManager::State::Cancelled) {
+            m_statusLabel->setText(QString("%1 cancelled").arg(name));
+        }
+    });
+    connect(m_jobManager.get(), &JobManager::activeJobCountChanged, this, [this](int count) {
+        m_jobProgressBar->setVisible(count > 0);
+        m_cancelJobsButton->setVisible(count > 0);
+        updateValidationControls();
+    });
+}
+
 // Test function you can add to MainWindow or run separately
 void testGaiaGDR3Integration()
 {
@@ -2058,6 +2258,14 @@ MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
     , m_imageReader(std::make_unique<ImageReader>())
     , m_catalogValidator(std::make_unique<StarCatalogValidator>(this))
+    , m_jobManager(std::make_unique<JobManager>())
+    , m_jobProgressBar(nullptr)
+    , m_cancelJobsButton(nullptr)
+    , m_detectJobId(0)
+    , m_validateJobId(0)
+    , m_catalogPlotJobId(0)
+    , m_photometryJobId(0)
+    , m_gaiaTestJobId(0)
     , m_imageData(nullptr)
     , m_hasWCS(false)
     , m_starsDetected(false)
@@ -2066,6 +2274,7 @@ MainWindow::MainWindow(QWidget* parent)
     , m_catalogPlotted(false)
 {
     setupUI();
+    setupJobManager();
     setupGaiaDR3Catalog();  // Add this line
     setupCatalogMenu();   // Add this line
     setupDebuggingMenu();
@@ -2159,14 +2368,28 @@ void MainWindow::onPlotCatalogStars()
 
 void MainWindow::onDebugStarCorrelation()
 {
-    QVector<CatalogStar> catalogStars = m_catalogValidator->getCatalogStars();
-    StarMaskGenerator::dumpcat(catalogStars);
+    correlateCatalogStars(m_catalogValidator->getCatalogStars());
+}
+
+void MainWindow::correlateCatalogStars(const QVector<CatalogStar>& catalogStars)
+{
+    // Correlation and the CSV export run on a job; the generator's
+    // correlator is locked against a detection running alongside, and each
+    // dump waits for the previous one so the exports do not interleave
+    QList<int> dependencies;
+    if (m_jobManager->isActive(m_catalogPlotJobId)) dependencies.append(m_catalogPlotJobId);
+    m_catalogPlotJobId = m_jobManager->submit("Correlating catalog stars",
+        [catalogStars](JobContext&) mutable {
+            StarMaskGenerator::dumpcat(catalogStars);
+        },
+        nullptr, dependencies);
 }
 
 void MainWindow::plotCatalogStarsDirectly()
 {
     QVector<CatalogStar> catalogStars = m_catalogValidator->getCatalogStars();
-    StarMaskGenerator::dumpcat(catalogStars);
+    correlateCatalogStars(catalogStars);
+    
     // Create a validation result just for display purposes
     ValidationResult plotResult;
     plotResult.catalogStars = catalogStars;
@@ -2260,6 +2483,11 @@ void MainWindow::extractWCSFromImage()
         }
     }
     
+    // The display drops the previous image's solution on load
+    if (m_hasWCS) {
+        updateImageDisplayWithWCS(m_catalogValidator->getWCSData());
+    }
+    
     qDebug() << "PCL WCS extraction completed, valid:" << m_hasWCS;
 }
 
@@ -2423,6 +2651,8 @@ void MainWindow::onValidationOverlayToggled(bool visible)
 
 void MainWindow::updateValidationControls()
 {
+    // Actions whose job is still queued or running stay disabled
+    m_detectAdvancedButton->setEnabled(!m_jobManager->isActive(m_detectJobId));
 }
 
 void MainWindow::updateStatusDisplay()
@@ -2760,6 +2990,9 @@ void MainWindow::updateImageDisplayWithWCS(const WCSData& wcs)
     // Enable WCS overlay on your image display
     m_imageDisplayWidget->setWCSData(wcs);
     m_imageDisplayWidget->setWCSOverlayEnabled(true);
+    if (m_catalogValidator && m_catalogValidator->astrometricMetadata().IsValid()) {
+        m_imageDisplayWidget->setAstrometricSolution(m_catalogValidator->astrometricMetadata());
+    }
     m_imageDisplayWidget->update();
     
     // Update any coordinate display panels
@@ -2954,6 +3187,9 @@ void MainWindow::onWCSDataReceived(const WCSData& wcs)
     if (m_imageDisplayWidget) {
         m_imageDisplayWidget->setWCSData(wcs);
         m_imageDisplayWidget->setWCSOverlayEnabled(true);
+        if (m_catalogValidator && m_catalogValidator->astrometricMetadata().IsValid()) {
+            m_imageDisplayWidget->setAstrometricSolution(m_catalogValidator->astrometricMetadata());
+        }
     }
     
     // Update coordinate display
@@ -3276,8 +3512,51 @@ void MainWindow::onPhotometryAnalysis()
         return;
     }
     
-    auto* dialog = new StarStatisticsChartDialog(m_imageData, catalogStars, m_lastStarMask, this);
-    dialog->show();
+    if (m_jobManager->isActive(m_photometryJobId)) {
+        m_statusLabel->setText("Photometry analysis already running...");
+        return;
+    }
+    
+    // Colour photometry (including any Gaia XP spectrum lookups) runs in the
+    // background; the dialog opens with the summary once it is done
+    ImageData image = *m_imageData;
+    StarMaskResult stars = m_lastStarMask;
+    
+    struct PhotometryOutcome {
+        QVector<StarColorData> colors;
+        QString summary;
+    };
+    
+    m_photometryJobId = m_jobManager->submitTask<PhotometryOutcome>("Photometry analysis",
+        [image, stars, catalogStars](JobContext&) {
+            PhotometryOutcome outcome;
+            if (image.channels < 3) {
+                outcome.summary = "Single-channel image: colour photometry skipped";
+                return outcome;
+            }
+            RGBPhotometryAnalyzer analyzer;
+            analyzer.setStarCatalogData(catalogStars);
+            // Keep neighbouring stars and their halos out of the sky annuli
+            analyzer.setBackgroundExclusionMask(StarMaskGenerator::grownStarMask(stars));
+            analyzer.analyzeStarColors(&image, stars.starCenters, stars.starRadii);
+            outcome.colors = analyzer.getStarColorData();
+            
+            int matched = 0, synthetic = 0;
+            for (const StarColorData& star : outcome.colors) {
+                if (star.hasValidCatalogColor) matched++;
+                if (star.hasSyntheticColor) synthetic++;
+            }
+            outcome.summary = QString("Colour photometry: %1 stars measured, %2 matched to catalog (%3 with Gaia XP colours)")
+                              .arg(outcome.colors.size()).arg(matched).arg(synthetic);
+            return outcome;
+        },
+        [this, catalogStars, stars](const PhotometryOutcome& outcome) {
+            m_statusLabel->setText(outcome.summary);
+            // The dialog shows the job's measurements rather than redoing them
+            auto* dialog = new StarStatisticsChartDialog(m_imageData, catalogStars, stars, this);
+            dialog->setColorPhotometry(outcome.colors, outcome.summary);
+            dialog->show();
+        });
 }
 
 void MainWindow::setupBackgroundNeutralizationControls()
@@ -3452,6 +3731,7 @@ void MainWindow::onBackgroundExtractionFinished(bool success, const QString& err
         // Create new image data with corrected background
         ImageData correctedImageData = *m_imageData;
         correctedImageData.pixels = result.correctedData;
+        correctedImageData.invalidateDerived();
         correctedImageData.format = m_imageData->format + " (Background Neutralized)";
         
         // Update the image reader with corrected data
@@ -3460,6 +3740,10 @@ void MainWindow::onBackgroundExtractionFinished(bool success, const QString& err
         // Update the display
         if (m_imageDisplayWidget) {
             m_imageDisplayWidget->setImageData(correctedImageData);
+            // Same geometry, so the solution still applies
+            if (m_hasWCS) {
+                updateImageDisplayWithWCS(m_catalogValidator->getWCSData());
+            }
         }
         
         // Show detailed results
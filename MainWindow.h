@@ -31,6 +31,7 @@
 #include "StarMaskGenerator.h"
 #include "PixelMatchingDebugger.h" // Include the debugger header
 #include "BackgroundExtractor.h"
+#include "JobManager.h"
 
 class MainWindow : public QMainWindow
 {
@@ -136,6 +137,7 @@ private:
     void runStarDetection();
     void performValidation();
     void plotCatalogStarsDirectly();      // NEW: Direct catalog plotting
+    void correlateCatalogStars(const QVector<CatalogStar>& catalogStars);
     void debugCatalogQuery();
     void addDebugButton();
     void setupGaiaDR3Catalog();
@@ -154,6 +156,8 @@ private:
     void displayEnhancedResults(const EnhancedValidationResult& result);
     void visualizeTrianglePatterns(const EnhancedValidationResult& result);
     void setupDebuggingMenu();
+    void setupJobManager();
+    void applyStarDetection(const StarMaskResult& result, const QString& paramSummary);
   //    void showPixelDebugDialog();
     void showWCSDebugInfo();
     void testWCSTransformations();
@@ -191,6 +195,9 @@ private:
     double m_maxScale;
     int m_platesolveTimeout;
     int m_maxStarsForSolving;
+    bool m_inProcessSolving;
+    bool m_nativeSolving;
+    QString m_quadIndexPath;
     
     //    ExtractStarsWithPlateSolve* m_platesolveIntegration;
     //    QProgressDialog* m_platesolveProgressDialog;
@@ -233,6 +240,17 @@ private:
     // Core components
     std::unique_ptr<ImageReader> m_imageReader;
     std::unique_ptr<StarCatalogValidator> m_catalogValidator;
+    
+    // Background jobs: compute off the GUI thread, results applied on it
+    std::unique_ptr<JobManager> m_jobManager;
+    QProgressBar* m_jobProgressBar;
+    QPushButton* m_cancelJobsButton;
+    int m_detectJobId;
+    int m_validateJobId;
+    int m_catalogPlotJobId;
+    int m_photometryJobId;
+    int m_gaiaTestJobId;
+    std::shared_ptr<StarMaskResult> m_pendingDetection;  // Filled by the running detect job
     //    ImageDisplayWidget* m_imageDisplayWidget;
     
     // Data
@@ -0,0 +1,407 @@
+// NativeQuadSolver.cpp - In-process blind plate solver over GaiaQuadIndex files
+#include "NativeQuadSolver.h"
+#include "ParallelFor.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Loaded index directories, shared by every solver instance
+QMutex s_indexCacheMutex;
+QHash<QString, QVector<std::shared_ptr<const GaiaQuadIndex>>> s_indexCache;
+QHash<QString, QStringList> s_indexNameCache;
+
+// Mean direction of a set of stars
+void meanDirection(const QVector<QuadIndexStar>& stars, const std::array<quint32, 4>& members,
+                   double& ra, double& dec)
+{
+    double x = 0, y = 0, z = 0;
+    for (quint32 member : members) {
+        double a = qDegreesToRadians(stars[member].ra), d = qDegreesToRadians(stars[member].dec);
+        x += std::cos(d) * std::cos(a);
+        y += std::cos(d) * std::sin(a);
+        z += std::sin(d);
+    }
+    ra = std::fmod(qRadiansToDegrees(std::atan2(y, x)) + 360.0, 360.0);
+    dec = qRadiansToDegrees(std::atan2(z, std::hypot(x, y)));
+}
+
+} // namespace
+
+bool NativeQuadSolver::loadIndexes(const QString& directory)
+{
+    QString key = QDir(directory).absolutePath();
+    if (key == m_indexDirectory && !m_indexes.isEmpty()) {
+        return true;
+    }
+
+    QMutexLocker locker(&s_indexCacheMutex);
+    if (!s_indexCache.contains(key)) {
+        QVector<std::shared_ptr<const GaiaQuadIndex>> indexes;
+        QStringList names;
+        QFileInfoList files = QDir(key).entryInfoList({"*.gqi"}, QDir::Files, QDir::Name);
+        for (const QFileInfo& file : files) {
+            auto index = std::make_shared<GaiaQuadIndex>();
+            if (index->load(file.absoluteFilePath()) && !index->isEmpty()) {
+                indexes.append(index);
+                names.append(file.fileName());
+            } else {
+                qDebug() << "Skipping unreadable quad index:" << file.absoluteFilePath();
+            }
+        }
+        s_indexCache.insert(key, indexes);
+        s_indexNameCache.insert(key, names);
+        qDebug() << "Loaded" << indexes.size() << "quad indexes from" << key;
+    }
+
+    m_indexDirectory = key;
+    m_indexes = s_indexCache.value(key);
+    m_indexNames = s_indexNameCache.value(key);
+    return !m_indexes.isEmpty();
+}
+
+QVector<NativeQuadSolver::FieldQuad> NativeQuadSolver::buildFieldQuads(const QVector<QPointF>& field,
+                                                                       int previousDepth, int depth,
+                                                                       double minArcsec, double maxArcsec,
+                                                                       const SolveOptions& options) const
+{
+    const int maxInside = 8;
+    QVector<FieldQuad> quads;
+
+    for (int b = 1; b < depth; ++b) {
+        for (int a = 0; a < b; ++a) {
+            QPointF ab = field[b] - field[a];
+            double length = std::hypot(ab.x(), ab.y());
+            if (length * options.maxScale < minArcsec || length * options.minScale > maxArcsec) continue;
+
+            // C and D candidates: the brightest stars inside the circle on AB
+            QPointF middle = (field[a] + field[b]) / 2.0;
+            int inside[maxInside], insideCount = 0;
+            for (int k = 0; k < depth && insideCount < maxInside; ++k) {
+                if (k == a || k == b) continue;
+                QPointF v = field[k] - middle;
+                if (std::hypot(v.x(), v.y()) < length / 2.0) inside[insideCount++] = k;
+            }
+
+            for (int ci = 0; ci < insideCount; ++ci) {
+                for (int di = ci + 1; di < insideCount; ++di) {
+                    int members[4] = {a, b, inside[ci], inside[di]};
+                    if (*std::max_element(members, members + 4) < previousDepth) continue;
+
+                    // Both parities: a mirrored image exchanges the code axes
+                    for (double mirror : {1.0, -1.0}) {
+                        QPointF points[4];
+                        for (int k = 0; k < 4; ++k) {
+                            points[k] = QPointF(mirror * field[members[k]].x(), field[members[k]].y());
+                        }
+
+                        FieldQuad quad;
+                        int order[4];
+                        if (!GaiaQuadIndex::computeCode(points, quad.code, order)) continue;
+                        for (int k = 0; k < 4; ++k) quad.stars[k] = members[order[k]];
+                        quad.lengthPixels = length;
+                        quads.append(quad);
+                    }
+                }
+            }
+        }
+    }
+
+    return quads;
+}
+
+bool NativeQuadSolver::testHypothesis(const GaiaQuadIndex& index, int indexNumber, int quad,
+                                      const FieldQuad& fieldQuad, const QVector<QPointF>& field,
+                                      const StarGeometry::PointGrid& fieldGrid, const SolveOptions& options,
+                                      Solution& solution) const
+{
+    const QVector<QuadIndexStar>& stars = index.stars();
+    const std::array<quint32, 4>& members = index.quad(quad);
+
+    // Pixel -> tangent plane (arcsec) from the four correspondences
+    double tangentRA, tangentDec;
+    meanDirection(stars, members, tangentRA, tangentDec);
+
+    QVector<QPointF> src(4), dst(4);
+    for (int k = 0; k < 4; ++k) {
+        src[k] = field[fieldQuad.stars[k]];
+        dst[k] = GaiaQuadIndex::projectGnomonic(stars[members[k]].ra, stars[members[k]].dec,
+                                                tangentRA, tangentDec);
+    }
+
+    StarGeometry::AffineTransform toPlane, toPixel;
+    if (!StarGeometry::fitAffine(src, dst, toPlane) || !toPlane.inverted(toPixel)) return false;
+
+    // Plausible optics: scale in range, square pixels, no shear
+    double scale = std::sqrt(std::abs(toPlane.determinant()));
+    if (scale < options.minScale || scale > options.maxScale) return false;
+    double sx = std::hypot(toPlane.a, toPlane.d), sy = std::hypot(toPlane.b, toPlane.e);
+    if (std::abs(sx / sy - 1.0) > 0.1) return false;
+    if (std::abs(toPlane.a * toPlane.b + toPlane.d * toPlane.e) / (sx * sy) > 0.1) return false;
+
+    const double width = options.imageWidth, height = options.imageHeight;
+    double centerRA, centerDec;
+    GaiaQuadIndex::deprojectGnomonic(toPlane.map(QPointF(width / 2.0, height / 2.0)),
+                                     tangentRA, tangentDec, centerRA, centerDec);
+    if (options.hasGuess &&
+        GaiaQuadIndex::angularDistance(centerRA, centerDec, options.raGuess, options.decGuess) > options.searchRadius) {
+        return false;
+    }
+
+    // Index stars that land on the image, brightest first (quad stars excluded)
+    double fieldRadius = std::hypot(width, height) / 2.0 * scale / 3600.0;
+    struct Reference { float magnitude; int star; QPointF pixel; };
+    QVector<Reference> references;
+    QVector<int> nearby;
+    index.findStars(centerRA, centerDec, fieldRadius, nearby);
+    for (int i : nearby) {
+        if (std::find(members.begin(), members.end(), quint32(i)) != members.end()) continue;
+        if (GaiaQuadIndex::angularDistance(centerRA, centerDec, stars[i].ra, stars[i].dec) > fieldRadius) continue;
+
+        QPointF pixel = toPixel.map(GaiaQuadIndex::projectGnomonic(stars[i].ra, stars[i].dec,
+                                                                   tangentRA, tangentDec));
+        if (pixel.x() < 0 || pixel.y() < 0 || pixel.x() >= width || pixel.y() >= height) continue;
+        references.append({stars[i].magnitude, i, pixel});
+    }
+    std::sort(references.begin(), references.end(),
+              [](const Reference& l, const Reference& r) { return l.magnitude < r.magnitude; });
+    if (references.size() > field.size()) references.resize(field.size());
+
+    // Log-odds that the hypothesis is right rather than a chance alignment:
+    // each reference star either has a field star nearby (Gaussian
+    // foreground vs uniform background) or counts as missing. A field star
+    // pairs with one reference star at most, so matched ones leave the
+    // search rather than shadowing a free neighbour.
+    double sigma = std::max(m_positionSigma, 0.002 * std::hypot(width, height));
+    double matchRadius = 3.0 * sigma;
+    double foreground = (1.0 - m_distractorFraction) * width * height / (2.0 * M_PI * sigma * sigma);
+    double missing = std::log(m_distractorFraction);
+
+    QVector<bool> used(field.size(), false);
+    for (int k = 0; k < 4; ++k) used[fieldQuad.stars[k]] = true;
+
+    QVector<int> matchedField, matchedIndex;
+    double logOdds = 0.0;
+    for (const Reference& reference : references) {
+        double distance = 0.0;
+        int j = fieldGrid.nearest(reference.pixel, matchRadius, &distance, &used);
+        if (j >= 0) {
+            used[j] = true;
+            logOdds += std::log(foreground * std::exp(-distance * distance / (2.0 * sigma * sigma)) +
+                                m_distractorFraction);
+            matchedField.append(j);
+            matchedIndex.append(reference.star);
+        } else {
+            logOdds += missing;
+        }
+        if (logOdds < -20.0) return false;
+    }
+
+    if (logOdds < options.logOddsThreshold) return false;
+
+    solution.found = true;
+    solution.logOdds = logOdds;
+    solution.indexNumber = indexNumber;
+    solution.tangentRA = centerRA;
+    solution.tangentDec = centerDec;
+    solution.fieldStars = matchedField;
+    solution.indexStars = matchedIndex;
+    for (int k = 0; k < 4; ++k) {
+        solution.fieldStars.append(fieldQuad.stars[k]);
+        solution.indexStars.append(int(members[k]));
+    }
+    return true;
+}
+
+PlatesolveResult NativeQuadSolver::finishSolution(const Solution& solution, const QVector<QPointF>& field,
+                                                  const SolveOptions& options) const
+{
+    PlatesolveResult result;
+    const QVector<QuadIndexStar>& stars = m_indexes[solution.indexNumber]->stars();
+
+    // TAN fit with the reference pixel at the image centre (FITS 1-based);
+    // the constant term moves the tangent point until it sits on CRPIX
+    double crpix1 = options.imageWidth / 2.0 + 1.0;
+    double crpix2 = options.imageHeight / 2.0 + 1.0;
+    double crval1 = solution.tangentRA, crval2 = solution.tangentDec;
+
+    StarGeometry::AffineTransform cd;
+    QVector<QPointF> src, dst;
+    for (int iteration = 0; iteration < 3; ++iteration) {
+        src.clear();
+        dst.clear();
+        for (int i = 0; i < solution.fieldStars.size(); ++i) {
+            const QPointF& pixel = field[solution.fieldStars[i]];
+            const QuadIndexStar& star = stars[solution.indexStars[i]];
+            src.append(QPointF(pixel.x() + 1.0 - crpix1, pixel.y() + 1.0 - crpix2));
+            dst.append(GaiaQuadIndex::projectGnomonic(star.ra, star.dec, crval1, crval2) / 3600.0);
+        }
+        if (!StarGeometry::fitAffine(src, dst, cd)) break;
+
+        GaiaQuadIndex::deprojectGnomonic(QPointF(cd.c, cd.f) * 3600.0, crval1, crval2, crval1, crval2);
+    }
+
+    double sumSq = 0.0;
+    for (int i = 0; i < src.size(); ++i) {
+        QPointF r = cd.map(src[i]) - dst[i];
+        sumSq += r.x() * r.x() + r.y() * r.y();
+    }
+    double rmsArcsec = src.isEmpty() ? 0.0 : std::sqrt(sumSq / src.size()) * 3600.0;
+
+    result.solved = true;
+    result.indexUsed = m_indexNames.value(solution.indexNumber);
+    result.ra_center = crval1;
+    result.dec_center = crval2;
+    result.crpix1 = crpix1;
+    result.crpix2 = crpix2;
+    result.cd11 = cd.a;
+    result.cd12 = cd.b;
+    result.cd21 = cd.d;
+    result.cd22 = cd.e;
+
+    // Same conventions as the astrometry.net path
+    result.pixscale = std::sqrt(result.cd11 * result.cd11 + result.cd12 * result.cd12) * 3600.0;
+    result.orientation = std::atan2(result.cd12, result.cd11) * 180.0 / M_PI;
+    if (result.orientation < 0) result.orientation += 360.0;
+    result.fieldWidth = options.imageWidth * result.pixscale / 60.0;
+    result.fieldHeight = options.imageHeight * result.pixscale / 60.0;
+    result.parity_positive = (cd.determinant() < 0.0);
+    result.ra_error = rmsArcsec;
+    result.dec_error = rmsArcsec;
+    result.matched_stars = solution.fieldStars.size();
+
+    result.wcs.crval[0] = crval1;
+    result.wcs.crval[1] = crval2;
+    result.wcs.crpix[0] = crpix1;
+    result.wcs.crpix[1] = crpix2;
+    result.wcs.cd[0][0] = cd.a;
+    result.wcs.cd[0][1] = cd.b;
+    result.wcs.cd[1][0] = cd.d;
+    result.wcs.cd[1][1] = cd.e;
+    result.wcs.imagew = options.imageWidth;
+    result.wcs.imageh = options.imageHeight;
+    result.wcs.sin = 0;
+
+    return result;
+}
+
+PlatesolveResult NativeQuadSolver::solve(const QVector<SolveDetectedStar>& stars,
+                                         const SolveOptions& options,
+                                         const std::atomic<bool>* cancel,
+                                         ProgressCallback progress)
+{
+    PlatesolveResult result;
+    QElapsedTimer timer;
+    timer.start();
+
+    if (m_indexes.isEmpty()) {
+        result.errorMessage = "No native quad indexes loaded";
+        return result;
+    }
+    if (stars.size() < 4) {
+        result.errorMessage = "At least four stars are needed to solve";
+        return result;
+    }
+
+    // Brightest stars first
+    QVector<SolveDetectedStar> sorted = stars;
+    std::sort(sorted.begin(), sorted.end(), [](const SolveDetectedStar& a, const SolveDetectedStar& b) {
+        return a.flux > b.flux;
+    });
+    if (sorted.size() > options.maxStars) sorted.resize(options.maxStars);
+
+    QVector<QPointF> field;
+    field.reserve(sorted.size());
+    for (const SolveDetectedStar& star : sorted) field.append(QPointF(star.x, star.y));
+    StarGeometry::PointGrid fieldGrid(field, 16.0);
+
+    // Indexes near the guess (all of them for a blind solve)
+    QVector<int> candidates;
+    double minArcsec = 1e300, maxArcsec = 0.0;
+    for (int i = 0; i < m_indexes.size(); ++i) {
+        const GaiaQuadIndex& index = *m_indexes[i];
+        if (options.hasGuess &&
+            GaiaQuadIndex::angularDistance(options.raGuess, options.decGuess, index.centerRA, index.centerDec) >
+                index.radiusDegrees + options.searchRadius) {
+            continue;
+        }
+        candidates.append(i);
+        minArcsec = std::min(minArcsec, index.quadMinArcsec);
+        maxArcsec = std::max(maxArcsec, index.quadMaxArcsec);
+    }
+    if (candidates.isEmpty()) {
+        result.errorMessage = "No quad index covers the search area";
+        return result;
+    }
+
+    const qint64 timeLimitMs = static_cast<qint64>(options.cpuLimit * 1000.0);
+    std::atomic<bool> found(false);
+    QMutex solutionMutex;
+    Solution best;
+
+    int previousDepth = 0;
+    for (int depth : options.depths) {
+        depth = std::min(depth, int(field.size()));
+        if (depth <= previousDepth) continue;
+
+        QVector<FieldQuad> quads = buildFieldQuads(field, previousDepth, depth, minArcsec, maxArcsec, options);
+        if (progress) {
+            progress(QString("Native solver: depth %1, %2 field quads, %3 indexes")
+                     .arg(depth).arg(quads.size()).arg(candidates.size()));
+        }
+
+        Parallel::forRange(quads.size(), [&](size_t begin, size_t end) {
+            QVector<int> matches;
+            for (size_t q = begin; q < end; ++q) {
+                if (found.load() || (cancel && cancel->load()) || timer.elapsed() > timeLimitMs) return;
+
+                const FieldQuad& fieldQuad = quads[q];
+                for (int n : candidates) {
+                    const GaiaQuadIndex& index = *m_indexes[n];
+                    double lo = fieldQuad.lengthPixels * options.minScale;
+                    double hi = fieldQuad.lengthPixels * options.maxScale;
+                    if (hi < index.quadMinArcsec || lo > index.quadMaxArcsec) continue;
+
+                    index.findCodes(fieldQuad.code, m_codeTolerance, matches);
+                    for (int match : matches) {
+                        Solution local;
+                        if (!testHypothesis(index, n, match, fieldQuad, field, fieldGrid, options, local)) continue;
+
+                        QMutexLocker locker(&solutionMutex);
+                        if (!best.found || local.logOdds > best.logOdds) best = local;
+                        found = true;
+                        return;
+                    }
+                }
+            }
+        }, 16);
+
+        if (found.load() || (cancel && cancel->load()) || timer.elapsed() > timeLimitMs) break;
+        previousDepth = depth;
+    }
+
+    if (!best.found) {
+        result.errorMessage = (cancel && cancel->load()) ? "Solve cancelled"
+                            : timer.elapsed() > timeLimitMs ? "Native solver time limit reached"
+                            : "No solution found";
+        return result;
+    }
+
+    result = finishSolution(best, field, options);
+    result.solve_time = timer.elapsed() / 1000.0;
+
+    qDebug() << "Native solve: RA" << result.ra_center << "Dec" << result.dec_center
+             << "scale" << result.pixscale << "arcsec/px, log-odds" << best.logOdds
+             << "matches" << result.matched_stars << "in" << result.solve_time << "s";
+    return result;
+}
@@ -0,0 +1,80 @@
+// NativeQuadSolver.h - In-process blind plate solver over GaiaQuadIndex files
+#ifndef NATIVE_QUAD_SOLVER_H
+#define NATIVE_QUAD_SOLVER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "GaiaQuadIndex.h"
+#include "IntegratedPlateSolver.h"
+#include "StarGeometry.h"
+
+// Blind solver in the style of astrometry.net, built on the quad indexes
+// written by GaiaIndexBuilder. Field quads from the brightest detected stars
+// are looked up in each index's code-space k-d tree; every code match gives
+// a TAN hypothesis that is verified against the index stars with a grid
+// matcher and a log-odds score. Field quads are tested in parallel and the
+// first hypothesis above SolveOptions::logOddsThreshold wins.
+class NativeQuadSolver
+{
+public:
+    using ProgressCallback = std::function<void(const QString& status)>;
+
+    // Load every *.gqi file in a directory. Loaded directories are cached
+    // process-wide, so switching back and forth is cheap.
+    bool loadIndexes(const QString& directory);
+    int indexCount() const { return m_indexes.size(); }
+
+    PlatesolveResult solve(const QVector<SolveDetectedStar>& stars,
+                           const SolveOptions& options,
+                           const std::atomic<bool>* cancel = nullptr,
+                           ProgressCallback progress = ProgressCallback());
+
+    // Tuning
+    void setCodeTolerance(float tolerance) { m_codeTolerance = tolerance; }
+    void setPositionSigma(double pixels) { m_positionSigma = pixels; }
+    void setDistractorFraction(double fraction) { m_distractorFraction = fraction; }
+
+private:
+    struct FieldQuad {
+        int stars[4];               // Field star indices in A, B, C, D order
+        QuadCode code;
+        double lengthPixels;        // |AB|
+    };
+
+    struct Solution {
+        bool found = false;
+        double logOdds = -1e300;
+        int indexNumber = -1;
+        double tangentRA = 0.0;
+        double tangentDec = 0.0;
+        QVector<int> fieldStars;    // Matched field star per reference star
+        QVector<int> indexStars;
+    };
+
+    QVector<FieldQuad> buildFieldQuads(const QVector<QPointF>& field, int previousDepth, int depth,
+                                       double minArcsec, double maxArcsec,
+                                       const SolveOptions& options) const;
+
+    bool testHypothesis(const GaiaQuadIndex& index, int indexNumber, int quad,
+                        const FieldQuad& fieldQuad, const QVector<QPointF>& field,
+                        const StarGeometry::PointGrid& fieldGrid, const SolveOptions& options,
+                        Solution& solution) const;
+
+    PlatesolveResult finishSolution(const Solution& solution, const QVector<QPointF>& field,
+                                    const SolveOptions& options) const;
+
+    QString m_indexDirectory;
+    QVector<std::shared_ptr<const GaiaQuadIndex>> m_indexes;
+    QStringList m_indexNames;
+
+    float m_codeTolerance = 0.01f;
+    double m_positionSigma = 1.5;       // pixels
+    double m_distractorFraction = 0.25;
+};
+
+#endif // NATIVE_QUAD_SOLVER_H
@@ -0,0 +1,61 @@
+// ParallelFor.h - Chunked data-parallel loops on the global Qt thread pool
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace Parallel {
+
+// Number of chunks to split `count` items into, never producing chunks
+// smaller than `minChunk` items.
+inline int chunkCount(size_t count, size_t minChunk = 16384)
+{
+    if (count == 0) return 0;
+    int threads = std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+    size_t byGrain = (count + minChunk - 1) / std::max<size_t>(1, minChunk);
+    return static_cast<int>(std::max<size_t>(1, std::min<size_t>(byGrain, size_t(threads) * 4)));
+}
+
+// Invoke body(chunkIndex, begin, end) for contiguous ranges covering [0, count).
+// Runs inline when there is a single chunk or the pool has one thread.
+template <typename Body>
+void forChunks(size_t count, int chunks, Body&& body)
+{
+    if (chunks <= 0) return;
+
+    if (chunks == 1 || QThreadPool::globalInstance()->maxThreadCount() <= 1) {
+        for (int c = 0; c < chunks; ++c) {
+            size_t begin = count * c / chunks;
+            size_t end = count * (c + 1) / chunks;
+            body(c, begin, end);
+        }
+        return;
+    }
+
+    QVector<int> indices(chunks);
+    for (int c = 0; c < chunks; ++c) indices[c] = c;
+
+    QtConcurrent::blockingMap(indices, [&](int c) {
+        size_t begin = count * c / chunks;
+        size_t end = count * (c + 1) / chunks;
+        body(c, begin, end);
+    });
+}
+
+// Convenience form: body(begin, end) over automatically sized chunks.
+template <typename Body>
+void forRange(size_t count, Body&& body, size_t minChunk = 16384)
+{
+    forChunks(count, chunkCount(count, minChunk),
+              [&](int, size_t begin, size_t end) { body(begin, end); });
+}
+
+} // namespace Parallel
+
+#endif // PARALLEL_FOR_H
@@ -21,6 +21,10 @@ void PlatesolverSettingsDialog::setupUI()
     auto* pathsGroup = new QGroupBox("Paths", this);
     auto* pathsLayout = new QFormLayout(pathsGroup);
     
+    // solve-field executable
+    m_astrometryPathEdit = new QLineEdit(this);
+    pathsLayout->addRow("solve-field:", m_astrometryPathEdit);
+    
     // Index path
     auto* indexLayout = new QHBoxLayout();
     m_indexPathEdit = new QLineEdit(this);
@@ -78,6 +82,21 @@ void PlatesolverSettingsDialog::setupUI()
     m_verboseCheckBox = new QCheckBox("Enable verbose output", this);
     optionsLayout->addRow("", m_verboseCheckBox);
     
+    m_inProcessCheckBox = new QCheckBox("Solve in-process (queued, cancellable)", this);
+    m_inProcessCheckBox->setToolTip("Run the astrometry engine on a worker thread instead of solve-field");
+    optionsLayout->addRow("", m_inProcessCheckBox);
+    
+    m_nativeCheckBox = new QCheckBox("Use native quad solver (Gaia indexes)", this);
+    m_nativeCheckBox->setToolTip("Solve in-process against indexes written by the Gaia index builder");
+    optionsLayout->addRow("", m_nativeCheckBox);
+    
+    auto* quadIndexLayout = new QHBoxLayout();
+    m_quadIndexPathEdit = new QLineEdit(this);
+    m_quadIndexPathBrowseButton = new QPushButton("Browse...", this);
+    quadIndexLayout->addWidget(m_quadIndexPathEdit);
+    quadIndexLayout->addWidget(m_quadIndexPathBrowseButton);
+    optionsLayout->addRow("Quad Index Path:", quadIndexLayout);
+    
     mainLayout->addWidget(optionsGroup);
     
     // Buttons
@@ -91,6 +110,10 @@ void PlatesolverSettingsDialog::setupUI()
             this, &PlatesolverSettingsDialog::browseIndexPath);
     connect(m_configFileBrowseButton, &QPushButton::clicked,
             this, &PlatesolverSettingsDialog::browseConfigFile);
+    connect(m_quadIndexPathBrowseButton, &QPushButton::clicked,
+            this, &PlatesolverSettingsDialog::browseQuadIndexPath);
+    connect(m_nativeCheckBox, &QCheckBox::toggled, m_quadIndexPathEdit, &QLineEdit::setEnabled);
+    connect(m_nativeCheckBox, &QCheckBox::toggled, m_quadIndexPathBrowseButton, &QPushButton::setEnabled);
     connect(m_buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
     connect(m_buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
     connect(m_buttonBox->button(QDialogButtonBox::RestoreDefaults), &QPushButton::clicked,
@@ -125,8 +148,23 @@ void PlatesolverSettingsDialog::browseConfigFile()
     }
 }
 
+void PlatesolverSettingsDialog::browseQuadIndexPath()
+{
+    QString dir = QFileDialog::getExistingDirectory(
+        this,
+        "Select Quad Index Directory",
+        m_quadIndexPathEdit->text(),
+        QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks
+    );
+    
+    if (!dir.isEmpty()) {
+        m_quadIndexPathEdit->setText(dir);
+    }
+}
+
 void PlatesolverSettingsDialog::resetToDefaults()
 {
+    m_astrometryPathEdit->setText("/opt/homebrew/bin/solve-field");
     m_indexPathEdit->setText("/opt/homebrew/share/astrometry");
     m_configFileEdit->setText(""); // Auto-detect
     m_minScaleSpinBox->setValue(0.1);
@@ -135,6 +173,10 @@ void PlatesolverSettingsDialog::resetToDefaults()
     m_maxStarsSpinBox->setValue(200);
     m_logOddsSpinBox->setValue(14.0);
     m_verboseCheckBox->setChecked(false);
+    m_inProcessCheckBox->setChecked(false);
+    m_nativeCheckBox->setChecked(false);
+    m_quadIndexPathEdit->setEnabled(false);
+    m_quadIndexPathBrowseButton->setEnabled(false);
 }
 
 // #include "PlatesolverSettingsDialog.moc"
@@ -33,6 +33,9 @@ public:
     int getMaxStars() const { return m_maxStarsSpinBox->value(); }
     double getLogOddsThreshold() const { return m_logOddsSpinBox->value(); }
     bool getVerbose() const { return m_verboseCheckBox->isChecked(); }
+    bool getInProcessSolving() const { return m_inProcessCheckBox->isChecked(); }
+    bool getNativeSolving() const { return m_nativeCheckBox->isChecked(); }
+    QString getQuadIndexPath() const { return m_quadIndexPathEdit->text(); }
 
     // Setters  
     void setAstrometryPath(const QString& path) { m_astrometryPathEdit->setText(path); }
@@ -46,10 +49,14 @@ public:
     void setMaxStars(int count) { m_maxStarsSpinBox->setValue(count); }
     void setLogOddsThreshold(double threshold) { m_logOddsSpinBox->setValue(threshold); }
     void setVerbose(bool verbose) { m_verboseCheckBox->setChecked(verbose); }
+    void setInProcessSolving(bool enabled) { m_inProcessCheckBox->setChecked(enabled); }
+    void setNativeSolving(bool enabled) { m_nativeCheckBox->setChecked(enabled); }
+    void setQuadIndexPath(const QString& path) { m_quadIndexPathEdit->setText(path); }
 
 private slots:
     void browseIndexPath();
     void browseConfigFile();
+    void browseQuadIndexPath();
     void resetToDefaults();
 
 private:
@@ -67,6 +74,10 @@ private:
     QSpinBox* m_maxStarsSpinBox;
     QDoubleSpinBox* m_logOddsSpinBox;
     QCheckBox* m_verboseCheckBox;
+    QCheckBox* m_inProcessCheckBox;
+    QCheckBox* m_nativeCheckBox;
+    QLineEdit* m_quadIndexPathEdit;
+    QPushButton* m_quadIndexPathBrowseButton;
     QDialogButtonBox* m_buttonBox;
 };
 
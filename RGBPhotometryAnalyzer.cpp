@@ -1,4 +1,10 @@
 #include "RGBPhotometryAnalyzer.h"
+#include "GaiaGDR3Catalog.h"
+#include "ImagePlaneCache.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
 
 // RGBPhotometryAnalyzer.cpp Implementation
 RGBPhotometryAnalyzer::RGBPhotometryAnalyzer(QObject *parent)
@@ -7,6 +13,7 @@ RGBPhotometryAnalyzer::RGBPhotometryAnalyzer(QObject *parent)
     , m_bgInnerRadius(12.0) 
     , m_bgOuterRadius(20.0)
     , m_colorIndexType("B-V")
+    , m_useSyntheticColors(true)
 {
 }
 
@@ -51,6 +58,12 @@ bool RGBPhotometryAnalyzer::analyzeStarColors(const ImageData* imageData,
         }
     }
     
+    // Replace spectral-type colours with synthetic camera-band colours where
+    // Gaia XP spectra exist; only the matched stars' spectra are fetched
+    if (m_useSyntheticColors && !m_catalogStars.isEmpty()) {
+        applySyntheticColors();
+    }
+    
     qDebug() << "Successfully analyzed" << validStars << "stars for color";
     
     emit colorAnalysisCompleted(validStars);
@@ -68,49 +81,21 @@ bool RGBPhotometryAnalyzer::extractPhotometry(const ImageData* imageData,
         return false; // Too close to edge
     }
     
-    // Calculate background levels
-    double bgRed, bgGreen, bgBlue;
-    if (!calculateBackgroundLevel(imageData, center, m_bgInnerRadius, m_bgOuterRadius,
-                                 bgRed, bgGreen, bgBlue)) {
-        // Use simple background estimate
-        bgRed = bgGreen = bgBlue = 0.0;
-    }
+    // Calculate background levels (simple zero estimate if the annulus is unusable)
+    QVector<double> background, sigma;
+    int annulusPixels = 0;
+    measureAnnulus(imageData, center, m_bgInnerRadius, m_bgOuterRadius,
+                   background, sigma, annulusPixels);
     
     // Sum pixels within aperture
-    double sumRed = 0, sumGreen = 0, sumBlue = 0;
-    int pixelCount = 0;
-    
-    int r = static_cast<int>(radius);
-    double radiusSquared = radius * radius;
-    
-    for (int dy = -r; dy <= r; ++dy) {
-        for (int dx = -r; dx <= r; ++dx) {
-            if (dx*dx + dy*dy <= radiusSquared) {
-                int x = center.x() + dx;
-                int y = center.y() + dy;
-                
-                if (x >= 0 && y >= 0 && x < imageData->width && y < imageData->height) {
-                    // ImageData format: [R_pixels, G_pixels, B_pixels]
-                    int pixelIdx = y * imageData->width + x;
-                    int redIdx = pixelIdx;
-                    int greenIdx = pixelIdx + imageData->width * imageData->height;
-                    int blueIdx = pixelIdx + 2 * imageData->width * imageData->height;
-                    
-                    sumRed += imageData->pixels[redIdx] - bgRed;
-                    sumGreen += imageData->pixels[greenIdx] - bgGreen; 
-                    sumBlue += imageData->pixels[blueIdx] - bgBlue;
-                    pixelCount++;
-                }
-            }
-        }
-    }
-    
+    QVector<double> sums;
+    int pixelCount = sumAperture(imageData, center, radius, background, sums);
     if (pixelCount == 0) return false;
     
     // Average values within aperture (background subtracted)
-    red = sumRed / pixelCount;
-    green = sumGreen / pixelCount;
-    blue = sumBlue / pixelCount;
+    red = sums[0] / pixelCount;
+    green = sums[1] / pixelCount;
+    blue = sums[2] / pixelCount;
     
     return true;
 }
@@ -121,42 +106,246 @@ bool RGBPhotometryAnalyzer::calculateBackgroundLevel(const ImageData* imageData,
                                                     double outerRadius,
                                                     double& bgRed, double& bgGreen, double& bgBlue)
 {
-    QVector<double> redValues, greenValues, blueValues;
+    QVector<double> level, sigma;
+    int pixelCount = 0;
+    if (!measureAnnulus(imageData, center, innerRadius, outerRadius, level, sigma, pixelCount)) {
+        return false;
+    }
+    
+    bgRed = level[0];
+    bgGreen = level[1];
+    bgBlue = level[2];
+    return true;
+}
+
+bool RGBPhotometryAnalyzer::measureAnnulus(const ImageData* imageData,
+                                          const QPointF& center,
+                                          double innerRadius,
+                                          double outerRadius,
+                                          QVector<double>& level,
+                                          QVector<double>& sigma,
+                                          int& pixelCount) const
+{
+    const int width = imageData->width;
+    const int height = imageData->height;
+    const int channels = imageData->channels;
+    auto derived = imageData->derived();
+    
+    level.fill(0.0, channels);
+    sigma.fill(0.0, channels);
+    pixelCount = 0;
     
-    int outerR = static_cast<int>(outerRadius);
     double innerRadSq = innerRadius * innerRadius;
     double outerRadSq = outerRadius * outerRadius;
-    
-    for (int dy = -outerR; dy <= outerR; ++dy) {
-        for (int dx = -outerR; dx <= outerR; ++dx) {
+    int x0 = std::max(0, static_cast<int>(std::floor(center.x() - outerRadius)));
+    int x1 = std::min(width - 1, static_cast<int>(std::ceil(center.x() + outerRadius)));
+    int y0 = std::max(0, static_cast<int>(std::floor(center.y() - outerRadius)));
+    int y1 = std::min(height - 1, static_cast<int>(std::ceil(center.y() + outerRadius)));
+    
+    // Annulus pixel offsets, gathered once and reused for every channel.
+    // Pixels under the exclusion mask are found by walking the row's spans.
+    const bool useMask = !m_exclusionMask.isEmpty() &&
+                         m_exclusionMask.width() == width && m_exclusionMask.height() == height;
+    const MaskSpan* maskSpans = m_exclusionMask.spans().constData();
+    QVector<size_t> offsets, excluded;
+    for (int y = y0; y <= y1; ++y) {
+        double dy = y - center.y();
+        int span = 0, spanEnd = 0;
+        if (useMask) m_exclusionMask.rowSpans(y, span, spanEnd);
+        for (int x = x0; x <= x1; ++x) {
+            double dx = x - center.x();
             double distSq = dx*dx + dy*dy;
             if (distSq >= innerRadSq && distSq <= outerRadSq) {
-                int x = center.x() + dx;
-                int y = center.y() + dy;
-                
-                if (x >= 0 && y >= 0 && x < imageData->width && y < imageData->height) {
-                    int pixelIdx = y * imageData->width + x;
-                    redValues.append(imageData->pixels[pixelIdx]);
-                    greenValues.append(imageData->pixels[pixelIdx + imageData->width * imageData->height]);
-                    blueValues.append(imageData->pixels[pixelIdx + 2 * imageData->width * imageData->height]);
-                }
+                while (span < spanEnd && maskSpans[span].x1 <= x) ++span;
+                bool masked = span < spanEnd && x >= maskSpans[span].x0;
+                (masked ? excluded : offsets).append(size_t(y) * width + x);
             }
         }
     }
     
-    if (redValues.size() < 10) return false;
+    // Crowded annulus: fall back to all of it rather than too little sky
+    if (offsets.size() < 10) offsets += excluded;
+    if (offsets.size() < 10) return false;
+    pixelCount = offsets.size();
+    
+    // Median for robust background estimation, MAD for its scatter
+    QVector<double> values(offsets.size());
+    int medianIdx = values.size() / 2;
+    for (int c = 0; c < channels; ++c) {
+        const float* plane = derived->channelPlane(c);
+        for (int i = 0; i < offsets.size(); ++i) {
+            values[i] = plane[offsets[i]];
+        }
+        
+        std::nth_element(values.begin(), values.begin() + medianIdx, values.end());
+        double median = values[medianIdx];
+        
+        for (double& v : values) v = std::abs(v - median);
+        std::nth_element(values.begin(), values.begin() + medianIdx, values.end());
+        
+        level[c] = median;
+        sigma[c] = 1.4826 * values[medianIdx];
+    }
     
-    // Use median for robust background estimation
-    std::sort(redValues.begin(), redValues.end());
-    std::sort(greenValues.begin(), greenValues.end());
-    std::sort(blueValues.begin(), blueValues.end());
+    return true;
+}
+
+int RGBPhotometryAnalyzer::sumAperture(const ImageData* imageData,
+                                      const QPointF& center,
+                                      double radius,
+                                      const QVector<double>& background,
+                                      QVector<double>& sums,
+                                      QPointF* centroid) const
+{
+    const int width = imageData->width;
+    const int height = imageData->height;
+    const int channels = imageData->channels;
+    auto derived = imageData->derived();
+    
+    // Channel planes are shared through the image's derived-product cache
+    QVector<const float*> planes(channels);
+    for (int c = 0; c < channels; ++c) {
+        planes[c] = derived->channelPlane(c);
+    }
     
-    int medianIdx = redValues.size() / 2;
-    bgRed = redValues[medianIdx];
-    bgGreen = greenValues[medianIdx];
-    bgBlue = blueValues[medianIdx];
+    sums.fill(0.0, channels);
     
-    return true;
+    double radiusSquared = radius * radius;
+    int x0 = std::max(0, static_cast<int>(std::floor(center.x() - radius)));
+    int x1 = std::min(width - 1, static_cast<int>(std::ceil(center.x() + radius)));
+    int y0 = std::max(0, static_cast<int>(std::floor(center.y() - radius)));
+    int y1 = std::min(height - 1, static_cast<int>(std::ceil(center.y() + radius)));
+    
+    int pixelCount = 0;
+    double weightSum = 0.0, weightX = 0.0, weightY = 0.0;
+    
+    for (int y = y0; y <= y1; ++y) {
+        double dy = y - center.y();
+        for (int x = x0; x <= x1; ++x) {
+            double dx = x - center.x();
+            if (dx*dx + dy*dy > radiusSquared) continue;
+            
+            size_t pixelIdx = size_t(y) * width + x;
+            double weight = 0.0;
+            for (int c = 0; c < channels; ++c) {
+                double value = planes[c][pixelIdx] - background[c];
+                sums[c] += value;
+                weight += value;
+            }
+            
+            if (weight > 0.0) {
+                weightSum += weight;
+                weightX += weight * x;
+                weightY += weight * y;
+            }
+            pixelCount++;
+        }
+    }
+    
+    if (centroid) {
+        *centroid = weightSum > 0.0 ? QPointF(weightX / weightSum, weightY / weightSum) : center;
+    }
+    
+    return pixelCount;
+}
+
+ForcedPhotometryResult RGBPhotometryAnalyzer::measureAtPosition(const ImageData* imageData,
+                                                               const QPointF& position) const
+{
+    ForcedPhotometryResult result;
+    result.predictedPosition = position;
+    result.centroid = position;
+    
+    double radius = m_apertureRadius;
+    if (position.x() < radius || position.y() < radius ||
+        position.x() >= imageData->width - radius ||
+        position.y() >= imageData->height - radius) {
+        return result; // Aperture leaves the image
+    }
+    
+    if (!measureAnnulus(imageData, position, m_bgInnerRadius, m_bgOuterRadius,
+                        result.background, result.backgroundSigma, result.annulusPixels)) {
+        return result;
+    }
+    
+    result.aperturePixels = sumAperture(imageData, position, radius, result.background,
+                                        result.flux, &result.centroid);
+    if (result.aperturePixels == 0) return result;
+    
+    result.centroidOffset = result.centroid - position;
+    
+    // Background-limited noise: aperture pixels plus the error of the annulus median
+    double apertureN = result.aperturePixels;
+    double noise = result.backgroundSigma[0] *
+                   std::sqrt(apertureN * (1.0 + apertureN / result.annulusPixels));
+    result.snr = noise > 0.0 ? result.flux[0] / noise : 0.0;
+    result.isValid = true;
+    
+    return result;
+}
+
+QVector<ForcedPhotometryResult> RGBPhotometryAnalyzer::measureForcedPhotometry(
+    const ImageData* imageData,
+    const QVector<CatalogStar>& catalogStars,
+    const StarCatalogValidator& validator)
+{
+    if (!validator.hasValidWCS()) {
+        qDebug() << "Forced photometry requires a valid WCS";
+        m_forcedResults.clear();
+        return m_forcedResults;
+    }
+    
+    // Projection is cheap next to the aperture work; keep it on this thread
+    QVector<CatalogStar> projected = catalogStars;
+    for (CatalogStar& star : projected) {
+        star.pixelPos = validator.skyToPixel(star.ra, star.dec);
+    }
+    
+    return measureForcedPhotometry(imageData, projected);
+}
+
+QVector<ForcedPhotometryResult> RGBPhotometryAnalyzer::measureForcedPhotometry(
+    const ImageData* imageData,
+    const QVector<CatalogStar>& catalogStars)
+{
+    m_forcedResults.clear();
+    if (!imageData || !imageData->isValid()) {
+        return m_forcedResults;
+    }
+    
+    // Only stars that land on the image
+    QVector<int> onImage;
+    for (int i = 0; i < catalogStars.size(); ++i) {
+        const QPointF& p = catalogStars[i].pixelPos;
+        if (p.x() >= 0 && p.y() >= 0 && p.x() < imageData->width && p.y() < imageData->height) {
+            onImage.append(i);
+        }
+    }
+    
+    qDebug() << "Forced photometry at" << onImage.size() << "of" << catalogStars.size()
+             << "catalog positions";
+    
+    QVector<ForcedPhotometryResult> results(onImage.size());
+    Parallel::forRange(onImage.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const CatalogStar& star = catalogStars[onImage[i]];
+            ForcedPhotometryResult& result = results[i];
+            result = measureAtPosition(imageData, star.pixelPos);
+            result.catalogIndex = onImage[i];
+            result.catalogId = star.id;
+            result.ra = star.ra;
+            result.dec = star.dec;
+            result.catalogMagnitude = star.magnitude;
+        }
+    }, 64);
+    
+    int measured = std::count_if(results.begin(), results.end(),
+                                 [](const ForcedPhotometryResult& r) { return r.isValid; });
+    qDebug() << "Forced photometry measured" << measured << "stars";
+    
+    m_forcedResults = results;
+    emit forcedPhotometryCompleted(measured);
+    return m_forcedResults;
 }
 
 void RGBPhotometryAnalyzer::calculateColorIndices(StarColorData& star)
@@ -199,6 +388,7 @@ bool RGBPhotometryAnalyzer::matchWithCatalog(StarColorData& star, const QVector<
     
     if (bestMatch >= 0) {
         const CatalogStar& catalogStar = catalog[bestMatch];
+        star.catalogIndex = bestMatch;
         star.magnitude = catalogStar.magnitude;
         star.spectralType = catalogStar.spectralType;
         
@@ -216,6 +406,50 @@ bool RGBPhotometryAnalyzer::matchWithCatalog(StarColorData& star, const QVector<
     return false;
 }
 
+int RGBPhotometryAnalyzer::applySyntheticColors()
+{
+    if (!GaiaGDR3Catalog::isAvailable()) {
+        return 0;
+    }
+    GaiaGDR3Catalog::SpectrumGrid grid = GaiaGDR3Catalog::spectrumGrid();
+    if (!grid.isValid()) {
+        return 0;
+    }
+    
+    QVector<int> matched;
+    QVector<QPointF> positions;
+    QVector<double> magnitudes;
+    for (int i = 0; i < m_starColors.size(); ++i) {
+        const StarColorData& star = m_starColors[i];
+        if (!star.hasValidCatalogColor || star.catalogIndex < 0) continue;
+        const CatalogStar& catalogStar = m_catalogStars[star.catalogIndex];
+        matched.append(i);
+        positions.append(QPointF(catalogStar.ra, catalogStar.dec));
+        magnitudes.append(catalogStar.magnitude);
+    }
+    if (matched.isEmpty()) {
+        return 0;
+    }
+    
+    QVector<QVector<float>> spectra = GaiaGDR3Catalog::fetchSpectra(positions, 3.0, magnitudes);
+    QVector<SyntheticPhotometry> colors = m_synthetic.compute(spectra, grid.startNm, grid.stepNm);
+    
+    int applied = 0;
+    for (int k = 0; k < matched.size(); ++k) {
+        if (!colors[k].isValid) continue;
+        StarColorData& star = m_starColors[matched[k]];
+        star.catalogBV = colors[k].blueGreen;
+        star.catalogVR = colors[k].greenRed;
+        star.bv_difference = star.bv_index - star.catalogBV;
+        star.colorError = std::sqrt(star.bv_difference * star.bv_difference);
+        star.hasSyntheticColor = true;
+        applied++;
+    }
+    
+    qDebug() << "Synthetic XP colours for" << applied << "of" << matched.size() << "matched stars";
+    return applied;
+}
+
 double RGBPhotometryAnalyzer::spectralTypeToColorIndex(const QString& spectralType)
 {
     // Standard B-V color indices for main sequence stars
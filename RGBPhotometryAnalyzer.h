@@ -8,7 +8,9 @@
 #include <QColor>
 #include <QDebug>
 #include "ImageReader.h" // Your existing ImageData structure
+#include "SparseMask.h"
 #include "StarCatalogValidator.h"
+#include "XPSyntheticPhotometry.h"
 
 struct StarColorData {
     int starIndex;
@@ -34,10 +36,37 @@ struct StarColorData {
     double bv_difference;  // Observed - Catalog
     double colorError;     // RMS color error
     bool hasValidCatalogColor;
+    bool hasSyntheticColor;     // Catalog colours from Gaia XP spectra
+    int catalogIndex;           // Matched entry in the catalog, -1 if none
     
     StarColorData() : starIndex(-1), redValue(0), greenValue(0), blueValue(0),
                      bv_index(0), vr_index(0), gr_index(0), catalogBV(0), catalogVR(0),
-                     magnitude(0), bv_difference(0), colorError(0), hasValidCatalogColor(false) {}
+                     magnitude(0), bv_difference(0), colorError(0), hasValidCatalogColor(false),
+                     hasSyntheticColor(false), catalogIndex(-1) {}
+};
+
+// Forced measurement at a catalog position projected through the WCS. No
+// detection is involved, so stars below the detection threshold are measured too.
+struct ForcedPhotometryResult {
+    int catalogIndex = -1;
+    QString catalogId;
+    double ra = 0.0;
+    double dec = 0.0;
+    double catalogMagnitude = 0.0;
+
+    QPointF predictedPosition;      // Catalog position projected through the WCS
+    QPointF centroid;               // Flux-weighted centroid within the aperture
+    QPointF centroidOffset;         // centroid - predictedPosition (pixels)
+
+    // Per channel
+    QVector<double> flux;           // Background-subtracted aperture sum
+    QVector<double> background;     // Annulus median (per pixel)
+    QVector<double> backgroundSigma;// Annulus robust sigma (per pixel)
+
+    int aperturePixels = 0;
+    int annulusPixels = 0;
+    double snr = 0.0;               // Background-limited S/N of channel 0
+    bool isValid = false;           // False when the aperture leaves the image
 };
 
 struct ColorCalibrationResult {
@@ -89,6 +118,17 @@ public:
     
     ColorCalibrationResult calculateColorCalibration();
     
+    // Forced photometry: project every catalog star through the validator's
+    // WCS and measure flux, local background and centroid offset at that
+    // position. Stars are measured in parallel; no star mask is needed.
+    QVector<ForcedPhotometryResult> measureForcedPhotometry(const ImageData* imageData,
+                                                            const QVector<CatalogStar>& catalogStars,
+                                                            const StarCatalogValidator& validator);
+    
+    // Same, for catalog stars whose pixelPos already holds the projected position
+    QVector<ForcedPhotometryResult> measureForcedPhotometry(const ImageData* imageData,
+                                                            const QVector<CatalogStar>& catalogStars);
+    
     // Configuration
     void setApertureRadius(double radius) { m_apertureRadius = radius; }
     void setBackgroundAnnulus(double inner, double outer) { 
@@ -96,10 +136,21 @@ public:
         m_bgOuterRadius = outer; 
     }
     void setColorIndexType(const QString& type) { m_colorIndexType = type; }
+    // Pixels excluded from background annuli, e.g. StarMaskGenerator::grownStarMask().
+    // Ignored when its size differs from the measured image.
+    void setBackgroundExclusionMask(const SparseMask& mask) { m_exclusionMask = mask; }
+    
+    // Camera R/G/B response used for Gaia XP synthetic colours (CSV:
+    // wavelength_nm, red, green, blue). A generic OSC CMOS is assumed otherwise.
+    bool loadResponseCurves(const QString& filePath) { return m_synthetic.loadResponseCurves(filePath); }
+    void setUseSyntheticColors(bool enabled) { m_useSyntheticColors = enabled; }
     
     // Results access
     QVector<StarColorData> getStarColorData() const { return m_starColors; }
+    // Results of an analysis run elsewhere (e.g. on a background job)
+    void setStarColorData(const QVector<StarColorData>& colors) { m_starColors = colors; }
     ColorCalibrationResult getLastCalibration() const { return m_lastCalibration; }
+    QVector<ForcedPhotometryResult> getForcedPhotometry() const { return m_forcedResults; }
     
     // Utility functions
     static double spectralTypeToColorIndex(const QString& spectralType);
@@ -108,6 +159,7 @@ public:
 signals:
     void colorAnalysisCompleted(int starsAnalyzed);
     void calibrationCompleted(const ColorCalibrationResult& result);
+    void forcedPhotometryCompleted(int starsMeasured);
     
 private:
     // Core photometry functions
@@ -122,8 +174,29 @@ private:
                                  double outerRadius,
                                  double& bgRed, double& bgGreen, double& bgBlue);
     
+    // Aperture primitives shared by detected-star and forced photometry.
+    // Both are const and safe to call concurrently.
+    bool measureAnnulus(const ImageData* imageData,
+                        const QPointF& center,
+                        double innerRadius,
+                        double outerRadius,
+                        QVector<double>& level,
+                        QVector<double>& sigma,
+                        int& pixelCount) const;
+    
+    int sumAperture(const ImageData* imageData,
+                    const QPointF& center,
+                    double radius,
+                    const QVector<double>& background,
+                    QVector<double>& sums,
+                    QPointF* centroid = nullptr) const;
+    
+    ForcedPhotometryResult measureAtPosition(const ImageData* imageData,
+                                             const QPointF& position) const;
+    
     void calculateColorIndices(StarColorData& star);
     bool matchWithCatalog(StarColorData& star, const QVector<CatalogStar>& catalog);
+    int applySyntheticColors();
     
     // Calibration analysis
     void analyzeSystematicErrors();
@@ -131,6 +204,7 @@ private:
     
     // Member variables
     QVector<StarColorData> m_starColors;
+    QVector<ForcedPhotometryResult> m_forcedResults;
     ColorCalibrationResult m_lastCalibration;
     
     // Analysis parameters
@@ -138,6 +212,9 @@ private:
     double m_bgInnerRadius;
     double m_bgOuterRadius;
     QString m_colorIndexType;
+    bool m_useSyntheticColors;
+    XPSyntheticPhotometry m_synthetic;
+    SparseMask m_exclusionMask;
     
     // Catalog data
     QVector<CatalogStar> m_catalogStars;
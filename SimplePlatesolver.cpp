@@ -1,5 +1,6 @@
 #include <unistd.h>
 #include "SimplePlatesolver.h"
+#include "IntegratedPlateSolver.h"
 
 extern "C" {
 #include "astrometry/xylist.h"
@@ -19,11 +20,26 @@ SimplePlatesolver::SimplePlatesolver(QObject* parent)
     , m_process(nullptr)
     , m_timeoutTimer(new QTimer(this))
     , m_tempDir(nullptr)
+    , m_inProcessSolver(new IntegratedPlateSolver(this))
+    , m_useInProcessSolver(false)
+    , m_useNativeSolver(false)
     , m_currentImageWidth(0)
     , m_currentImageHeight(0)
 {
     m_timeoutTimer->setSingleShot(true);
     connect(m_timeoutTimer, &QTimer::timeout, this, &SimplePlatesolver::onTimeout);
+    
+    connect(m_inProcessSolver, &IntegratedPlateSolver::solveStarted,
+            this, &SimplePlatesolver::platesolveStarted);
+    connect(m_inProcessSolver, &IntegratedPlateSolver::solveProgress,
+            this, &SimplePlatesolver::platesolveProgress);
+    connect(m_inProcessSolver, &IntegratedPlateSolver::solveComplete,
+            this, &SimplePlatesolver::onInProcessSolveComplete);
+    connect(m_inProcessSolver, &IntegratedPlateSolver::solveFailed,
+            this, &SimplePlatesolver::platesolveFailed);
+    m_inProcessSolver->setIndexPath(m_indexPath);
+    m_inProcessSolver->setScaleRange(m_minScale, m_maxScale);
+    m_inProcessSolver->setTimeout(m_timeoutSeconds);
 }
 
 void SimplePlatesolver::configurePlateSolver(const QString& astrometryPath,
@@ -35,12 +51,39 @@ void SimplePlatesolver::configurePlateSolver(const QString& astrometryPath,
     m_indexPath = indexPath;
     m_minScale = minScale;
     m_maxScale = maxScale;
+    m_inProcessSolver->setIndexPath(indexPath);
+    m_inProcessSolver->setScaleRange(minScale, maxScale);
+}
+
+void SimplePlatesolver::setNativeSolverEnabled(bool enabled, const QString& indexDirectory)
+{
+    m_useNativeSolver = enabled;
+    m_inProcessSolver->setNativeSolverEnabled(enabled, indexDirectory);
+}
+
+void SimplePlatesolver::setTimeout(int seconds)
+{
+    m_timeoutSeconds = seconds;
+    m_inProcessSolver->setTimeout(seconds);
 }
 
 void SimplePlatesolver::extractStarsAndSolve(const ImageData* imageData,
                                             const QVector<QPoint>& starCenters,
                                             const QVector<float>& starFluxes,
                                             const QVector<float>& starRadii)
+{
+    QVector<QPointF> centroids;
+    centroids.reserve(starCenters.size());
+    for (const QPoint& center : starCenters) {
+        centroids.append(center);
+    }
+    extractStarsAndSolve(imageData, centroids, starFluxes, starRadii);
+}
+
+void SimplePlatesolver::extractStarsAndSolve(const ImageData* imageData,
+                                            const QVector<QPointF>& starCenters,
+                                            const QVector<float>& starFluxes,
+                                            const QVector<float>& starRadii)
 {
     Q_UNUSED(starRadii)  // Not used in this implementation
     
@@ -54,15 +97,20 @@ void SimplePlatesolver::extractStarsAndSolve(const ImageData* imageData,
         return;
     }
     
+    // Store image dimensions
+    m_currentImageWidth = imageData->width;
+    m_currentImageHeight = imageData->height;
+    
+    if (m_useInProcessSolver || m_useNativeSolver) {
+        m_inProcessSolver->solveFromStarMask(starCenters, starFluxes, imageData);
+        return;
+    }
+    
     if (!QFileInfo::exists(m_solveFieldPath)) {
         emit platesolveFailed(QString("solve-field not found: %1").arg(m_solveFieldPath));
         return;
     }
     
-    // Store image dimensions
-    m_currentImageWidth = imageData->width;
-    m_currentImageHeight = imageData->height;
-    
     // Create temporary directory
     cleanup(); // Clean up any previous temp files
     m_tempDir = new QTemporaryDir();
@@ -110,11 +158,17 @@ void SimplePlatesolver::extractStarsAndSolve(const ImageData* imageData,
 
 bool SimplePlatesolver::isSolving() const
 {
-    return m_process && m_process->state() == QProcess::Running;
+    return (m_process && m_process->state() == QProcess::Running) || m_inProcessSolver->isSolving();
 }
 
 void SimplePlatesolver::cancelSolve()
 {
+    if (m_inProcessSolver->isSolving()) {
+        // Reported back through solveFailed
+        m_inProcessSolver->cancelSolve();
+        return;
+    }
+    
     if (isSolving()) {
         m_process->kill();
         m_timeoutTimer->stop();
@@ -123,7 +177,7 @@ void SimplePlatesolver::cancelSolve()
     }
 }
 
-QString SimplePlatesolver::createTempXYFile(const QVector<QPoint>& starCenters, 
+QString SimplePlatesolver::createTempXYFile(const QVector<QPointF>& starCenters, 
                                           const QVector<float>& starFluxes)
 {
   QString filepath;
@@ -191,7 +245,7 @@ QString SimplePlatesolver::createTempXYFile(const QVector<QPoint>& starCenters,
         
         // Write all star data
 	for (int i = 0; i < starCenters.size(); ++i) {
-	  const QPoint& center = starCenters[i];
+	  const QPointF& center = starCenters[i];
 	  float flux = (i < starFluxes.size()) ? starFluxes[i] : 1000.0f;
 	  if (xylist_write_one_row_data(ls, center.x()+1, center.y()+1, flux, 0.0)) {
                 qDebug() << "Failed to write star data";
@@ -318,6 +372,12 @@ void SimplePlatesolver::onProcessFinished(int exitCode, QProcess::ExitStatus exi
     // Parse the WCS solution
     pcl::AstrometricMetadata result = parseWCSOutput(wcsPath);
     
+    reportSolution(result);
+    cleanup();
+}
+
+void SimplePlatesolver::reportSolution(pcl::AstrometricMetadata& result)
+{
     if (result.IsValid()) {
         // Convert to WCS data for compatibility
         WCSData wcs;
@@ -379,8 +439,33 @@ void SimplePlatesolver::onProcessFinished(int exitCode, QProcess::ExitStatus exi
     } else {
         emit platesolveFailed("Failed to parse WCS solution");
     }
+}
+
+void SimplePlatesolver::onInProcessSolveComplete(const PlatesolveResult& result)
+{
+    // Same TAN keywords solve-field writes to its .wcs file
+    pcl::FITSKeywordArray keywords;
+    keywords.Add(pcl::FITSHeaderKeyword("CTYPE1", pcl::IsoString("'RA---TAN'"), "Coordinate type"));
+    keywords.Add(pcl::FITSHeaderKeyword("CTYPE2", pcl::IsoString("'DEC--TAN'"), "Coordinate type"));
+    keywords.Add(pcl::FITSHeaderKeyword("RADESYS", pcl::IsoString("'ICRS'"), "Coordinate reference system"));
+    keywords.Add(pcl::FITSHeaderKeyword("CRVAL1", result.wcs.crval[0], "RA of reference point"));
+    keywords.Add(pcl::FITSHeaderKeyword("CRVAL2", result.wcs.crval[1], "Dec of reference point"));
+    keywords.Add(pcl::FITSHeaderKeyword("CRPIX1", result.wcs.crpix[0], "X reference pixel"));
+    keywords.Add(pcl::FITSHeaderKeyword("CRPIX2", result.wcs.crpix[1], "Y reference pixel"));
+    keywords.Add(pcl::FITSHeaderKeyword("CD1_1", result.wcs.cd[0][0], "Transformation matrix"));
+    keywords.Add(pcl::FITSHeaderKeyword("CD1_2", result.wcs.cd[0][1], "Transformation matrix"));
+    keywords.Add(pcl::FITSHeaderKeyword("CD2_1", result.wcs.cd[1][0], "Transformation matrix"));
+    keywords.Add(pcl::FITSHeaderKeyword("CD2_2", result.wcs.cd[1][1], "Transformation matrix"));
+    
+    pcl::AstrometricMetadata astro;
+    try {
+        pcl::PropertyArray emptyProperties; // We're using FITS keywords only
+        astro.Build(emptyProperties, keywords, m_currentImageWidth, m_currentImageHeight);
+    } catch (const pcl::Error& e) {
+        qDebug() << "WCS build error" << e.Message().c_str();
+    }
     
-    cleanup();
+    reportSolution(astro);
 }
 
 void SimplePlatesolver::onProcessError(QProcess::ProcessError error)
@@ -9,10 +9,15 @@
 #include <QTemporaryDir>
 #include <QVector>
 #include <QPoint>
+#include <QPointF>
 #include <FITS/FITS.h>
 #include "structuredefinitions.h"
 
-// Simple wrapper that matches your existing interface
+class IntegratedPlateSolver;
+
+// Simple wrapper that matches your existing interface. Solves run through
+// solve-field by default; with setInProcessSolverEnabled() they are queued
+// on an IntegratedPlateSolver instead, as interactive requests.
 class SimplePlatesolver : public QObject
 {
     Q_OBJECT
@@ -26,13 +31,22 @@ public:
                              double minScale,
                              double maxScale);
     void setStarCatalogValidator(StarCatalogValidator* validator) { }
-    void setTimeout(int seconds) { m_timeoutSeconds = seconds; }
+    void setTimeout(int seconds);
+    void setInProcessSolverEnabled(bool enabled) { m_useInProcessSolver = enabled; }
+    bool isInProcessSolverEnabled() const { return m_useInProcessSolver; }
+    // Native quad solver over GaiaIndexBuilder indexes; always in-process
+    void setNativeSolverEnabled(bool enabled, const QString& indexDirectory = QString());
     
     // Main solving method (matches your existing interface)
     void extractStarsAndSolve(const ImageData* imageData,
                              const QVector<QPoint>& starCenters,
                              const QVector<float>& starFluxes,
                              const QVector<float>& starRadii = QVector<float>());
+    // Sub-pixel centres, e.g. StarMaskResult::starCentroids
+    void extractStarsAndSolve(const ImageData* imageData,
+                             const QVector<QPointF>& starCentroids,
+                             const QVector<float>& starFluxes,
+                             const QVector<float>& starRadii = QVector<float>());
     
     bool isSolving() const;
     void cancelSolve();
@@ -50,11 +64,13 @@ private slots:
     void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
     void onProcessError(QProcess::ProcessError error);
     void onTimeout();
+    void onInProcessSolveComplete(const PlatesolveResult& result);
 
 private:
-    QString createTempXYFile(const QVector<QPoint>& starCenters, const QVector<float>& starFluxes);
+    QString createTempXYFile(const QVector<QPointF>& starCenters, const QVector<float>& starFluxes);
     QStringList buildArguments(const QString& xyFilePath, int imageWidth, int imageHeight);
     pcl::AstrometricMetadata parseWCSOutput(const QString& outputPath);
+    void reportSolution(pcl::AstrometricMetadata& result);
     void cleanup();
     
     // Configuration
@@ -69,6 +85,11 @@ private:
     QTimer* m_timeoutTimer;
     QTemporaryDir* m_tempDir;
     
+    // In-process backend
+    IntegratedPlateSolver* m_inProcessSolver;
+    bool m_useInProcessSolver;
+    bool m_useNativeSolver;
+    
     // Current solve data
     int m_currentImageWidth;
     int m_currentImageHeight;
@@ -0,0 +1,340 @@
+// SparseMask.cpp - Run-length image masks with distance-transform morphology
+#include "SparseMask.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+
+const int kTileSize = 64;
+const double kFar = 1e20;           // "No feature" in the distance transform
+
+bool spanLess(const MaskSpan& a, const MaskSpan& b)
+{
+    return a.y != b.y ? a.y < b.y : a.x0 < b.x0;
+}
+
+// Merge overlapping or touching spans of sorted input in place
+void mergeSorted(QVector<MaskSpan>& spans)
+{
+    int out = 0;
+    for (int i = 0; i < spans.size(); ++i) {
+        const MaskSpan& s = spans[i];
+        if (out > 0 && spans[out - 1].y == s.y && s.x0 <= spans[out - 1].x1) {
+            spans[out - 1].x1 = std::max(spans[out - 1].x1, s.x1);
+        } else {
+            spans[out++] = s;
+        }
+    }
+    spans.resize(out);
+}
+
+// Felzenszwalb-Huttenlocher lower envelope of parabolas: d[q] = min_p (q - p)^2 + f[p]
+void distanceTransform1D(const double* f, int n, double* d, int* v, double* z)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -std::numeric_limits<double>::infinity();
+    z[1] = std::numeric_limits<double>::infinity();
+    for (int q = 1; q < n; ++q) {
+        double s = ((f[q] + double(q) * q) - (f[v[k]] + double(v[k]) * v[k])) / (2.0 * q - 2.0 * v[k]);
+        while (s <= z[k]) {
+            --k;
+            s = ((f[q] + double(q) * q) - (f[v[k]] + double(v[k]) * v[k])) / (2.0 * q - 2.0 * v[k]);
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = std::numeric_limits<double>::infinity();
+    }
+
+    k = 0;
+    for (int q = 0; q < n; ++q) {
+        while (z[k + 1] < q) ++k;
+        const double dq = q - v[k];
+        d[q] = dq * dq + f[v[k]];
+    }
+}
+
+} // namespace
+
+SparseMask::SparseMask(int width, int height)
+    : m_width(std::max(0, width))
+    , m_height(std::max(0, height))
+{
+    buildRowIndex();
+}
+
+SparseMask SparseMask::fromSpans(int width, int height, QVector<MaskSpan> spans)
+{
+    SparseMask mask(width, height);
+
+    int out = 0;
+    for (int i = 0; i < spans.size(); ++i) {
+        MaskSpan s = spans[i];
+        if (s.y < 0 || s.y >= mask.m_height) continue;
+        s.x0 = std::max(0, s.x0);
+        s.x1 = std::min(mask.m_width, s.x1);
+        if (s.x0 < s.x1) spans[out++] = s;
+    }
+    spans.resize(out);
+
+    std::sort(spans.begin(), spans.end(), spanLess);
+    mergeSorted(spans);
+
+    mask.m_spans = std::move(spans);
+    mask.buildRowIndex();
+    return mask;
+}
+
+SparseMask SparseMask::fromImage(const QImage& image, int threshold)
+{
+    const QImage gray = image.convertToFormat(QImage::Format_Grayscale8);
+    QVector<MaskSpan> spans;
+    for (int y = 0; y < gray.height(); ++y) {
+        const uchar* line = gray.constScanLine(y);
+        int x = 0;
+        while (x < gray.width()) {
+            while (x < gray.width() && line[x] < threshold) ++x;
+            const int start = x;
+            while (x < gray.width() && line[x] >= threshold) ++x;
+            if (x > start) spans.append({y, start, x});
+        }
+    }
+    return fromSpans(gray.width(), gray.height(), std::move(spans));
+}
+
+void SparseMask::appendRect(QVector<MaskSpan>& spans, int x0, int y0, int x1, int y1)
+{
+    for (int y = y0; y < y1; ++y) {
+        spans.append({y, x0, x1});
+    }
+}
+
+void SparseMask::appendDisc(QVector<MaskSpan>& spans, const QPointF& center, double radius)
+{
+    if (radius < 0.0) return;
+    const int cx = int(std::lround(center.x()));
+    const int cy = int(std::lround(center.y()));
+    const int r = int(std::floor(radius));
+    for (int dy = -r; dy <= r; ++dy) {
+        const int half = int(std::floor(std::sqrt(radius * radius - double(dy) * dy)));
+        spans.append({cy + dy, cx - half, cx + half + 1});
+    }
+}
+
+void SparseMask::buildRowIndex()
+{
+    m_rowStart.resize(m_height + 1);
+    int i = 0;
+    for (int y = 0; y <= m_height; ++y) {
+        while (i < m_spans.size() && m_spans[i].y < y) ++i;
+        m_rowStart[y] = i;
+    }
+}
+
+qint64 SparseMask::area() const
+{
+    qint64 total = 0;
+    for (const MaskSpan& s : m_spans) total += s.x1 - s.x0;
+    return total;
+}
+
+size_t SparseMask::memoryBytes() const
+{
+    return sizeof(*this) + size_t(m_spans.capacity()) * sizeof(MaskSpan) +
+           size_t(m_rowStart.capacity()) * sizeof(int);
+}
+
+void SparseMask::rowSpans(int y, int& first, int& last) const
+{
+    if (y < 0 || y >= m_height) {
+        first = last = 0;
+        return;
+    }
+    first = m_rowStart[y];
+    last = m_rowStart[y + 1];
+}
+
+bool SparseMask::contains(int x, int y) const
+{
+    int first, last;
+    rowSpans(y, first, last);
+    auto it = std::upper_bound(m_spans.constBegin() + first, m_spans.constBegin() + last, x,
+                               [](int value, const MaskSpan& s) { return value < s.x0; });
+    return it != m_spans.constBegin() + first && x < (it - 1)->x1;
+}
+
+SparseMask SparseMask::united(const SparseMask& other) const
+{
+    QVector<MaskSpan> merged(m_spans.size() + other.m_spans.size());
+    std::merge(m_spans.constBegin(), m_spans.constEnd(),
+               other.m_spans.constBegin(), other.m_spans.constEnd(),
+               merged.begin(), spanLess);
+    mergeSorted(merged);
+
+    SparseMask mask(std::max(m_width, other.m_width), std::max(m_height, other.m_height));
+    mask.m_spans = std::move(merged);
+    mask.buildRowIndex();
+    return mask;
+}
+
+SparseMask SparseMask::intersected(const SparseMask& other) const
+{
+    SparseMask mask(std::min(m_width, other.m_width), std::min(m_height, other.m_height));
+
+    int i = 0, j = 0;
+    while (i < m_spans.size() && j < other.m_spans.size()) {
+        const MaskSpan& a = m_spans[i];
+        const MaskSpan& b = other.m_spans[j];
+        if (a.y != b.y) {
+            (a.y < b.y ? i : j)++;
+            continue;
+        }
+        const int lo = std::max(a.x0, b.x0);
+        const int hi = std::min(a.x1, b.x1);
+        if (lo < hi) mask.m_spans.append({a.y, lo, hi});
+        (a.x1 < b.x1 ? i : j)++;
+    }
+
+    mask.buildRowIndex();
+    return mask;
+}
+
+SparseMask SparseMask::dilated(double radius) const
+{
+    return morphology(radius, true);
+}
+
+SparseMask SparseMask::eroded(double radius) const
+{
+    return morphology(radius, false);
+}
+
+SparseMask SparseMask::morphology(double radius, bool dilate) const
+{
+    if (radius <= 0.0 || isEmpty()) {
+        return *this;
+    }
+
+    const int margin = int(std::ceil(radius));
+    const double radius2 = radius * radius;
+    const int tilesX = (m_width + kTileSize - 1) / kTileSize;
+    const int tilesY = (m_height + kTileSize - 1) / kTileSize;
+
+    // Tiles holding mask pixels; dilation can also reach tiles within the margin
+    std::vector<quint8> occupied(size_t(tilesX) * tilesY, 0);
+    for (const MaskSpan& s : m_spans) {
+        const int ty = s.y / kTileSize;
+        for (int tx = s.x0 / kTileSize; tx <= (s.x1 - 1) / kTileSize; ++tx) {
+            occupied[size_t(ty) * tilesX + tx] = 1;
+        }
+    }
+
+    std::vector<quint8> active = occupied;
+    if (dilate) {
+        const int reach = (margin + kTileSize - 1) / kTileSize;
+        for (int ty = 0; ty < tilesY; ++ty) {
+            for (int tx = 0; tx < tilesX; ++tx) {
+                if (!occupied[size_t(ty) * tilesX + tx]) continue;
+                for (int ny = std::max(0, ty - reach); ny <= std::min(tilesY - 1, ty + reach); ++ny) {
+                    for (int nx = std::max(0, tx - reach); nx <= std::min(tilesX - 1, tx + reach); ++nx) {
+                        active[size_t(ny) * tilesX + nx] = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    QVector<int> tiles;
+    for (int t = 0; t < int(active.size()); ++t) {
+        if (active[t]) tiles.append(t);
+    }
+
+    QVector<QVector<MaskSpan>> tileSpans(tiles.size());
+    Parallel::forRange(size_t(tiles.size()), [&](size_t begin, size_t end) {
+        const int window = kTileSize + 2 * margin;
+        std::vector<double> grid(size_t(window) * window);
+        std::vector<double> f(window), d(window), z(window + 1);
+        std::vector<int> v(window);
+
+        for (size_t t = begin; t < end; ++t) {
+            const int tx0 = (tiles[int(t)] % tilesX) * kTileSize;
+            const int ty0 = (tiles[int(t)] / tilesX) * kTileSize;
+            const int tx1 = std::min(m_width, tx0 + kTileSize);
+            const int ty1 = std::min(m_height, ty0 + kTileSize);
+            const int wx0 = tx0 - margin;
+            const int wy0 = ty0 - margin;
+            const int ww = (tx1 - tx0) + 2 * margin;
+            const int wh = (ty1 - ty0) + 2 * margin;
+
+            // Features at distance zero: mask pixels for dilation,
+            // unmasked pixels for erosion
+            const double inside = dilate ? 0.0 : kFar;
+            const double outside = dilate ? kFar : 0.0;
+            std::fill(grid.begin(), grid.begin() + size_t(ww) * wh, outside);
+            for (int wy = 0; wy < wh; ++wy) {
+                int first, last;
+                rowSpans(wy0 + wy, first, last);
+                double* row = grid.data() + size_t(wy) * ww;
+                for (int i = first; i < last; ++i) {
+                    const int a = std::max(m_spans[i].x0, wx0) - wx0;
+                    const int b = std::min(m_spans[i].x1, wx0 + ww) - wx0;
+                    for (int x = a; x < b; ++x) row[x] = inside;
+                }
+            }
+
+            // Squared Euclidean distance: columns, then rows
+            for (int x = 0; x < ww; ++x) {
+                for (int y = 0; y < wh; ++y) f[y] = grid[size_t(y) * ww + x];
+                distanceTransform1D(f.data(), wh, d.data(), v.data(), z.data());
+                for (int y = 0; y < wh; ++y) grid[size_t(y) * ww + x] = d[y];
+            }
+            for (int y = margin; y < margin + (ty1 - ty0); ++y) {
+                double* row = grid.data() + size_t(y) * ww;
+                std::memcpy(f.data(), row, size_t(ww) * sizeof(double));
+                distanceTransform1D(f.data(), ww, row, v.data(), z.data());
+            }
+
+            // Runs of the tile interior that pass the distance test
+            QVector<MaskSpan>& out = tileSpans[int(t)];
+            for (int y = ty0; y < ty1; ++y) {
+                const double* row = grid.data() + size_t(y - wy0) * ww;
+                int x = tx0;
+                while (x < tx1) {
+                    auto keep = [&](int px) {
+                        const double dist2 = row[px - wx0];
+                        return dilate ? dist2 <= radius2 : dist2 > radius2;
+                    };
+                    while (x < tx1 && !keep(x)) ++x;
+                    const int start = x;
+                    while (x < tx1 && keep(x)) ++x;
+                    if (x > start) out.append({y, start, x});
+                }
+            }
+        }
+    }, 1);
+
+    QVector<MaskSpan> spans;
+    for (const QVector<MaskSpan>& part : tileSpans) spans += part;
+    return fromSpans(m_width, m_height, std::move(spans));
+}
+
+QImage SparseMask::toImage() const
+{
+    QImage image(m_width, m_height, QImage::Format_Grayscale8);
+    image.fill(0);
+    rasterize(image.bits(), image.bytesPerLine());
+    return image;
+}
+
+void SparseMask::rasterize(quint8* buffer, qsizetype bytesPerLine, quint8 value) const
+{
+    for (const MaskSpan& s : m_spans) {
+        std::memset(buffer + s.y * bytesPerLine + s.x0, value, size_t(s.x1 - s.x0));
+    }
+}
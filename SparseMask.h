@@ -0,0 +1,72 @@
+// SparseMask.h - Run-length image masks with distance-transform morphology
+#ifndef SPARSE_MASK_H
+#define SPARSE_MASK_H
+
+#include <QImage>
+#include <QPointF>
+#include <QVector>
+
+// Masked pixels [x0, x1) of row y
+struct MaskSpan {
+    int y = 0;
+    int x0 = 0;
+    int x1 = 0;
+};
+
+// Binary mask stored as sorted, merged row spans plus a per-row index, so a
+// mask covering a few percent of a frame costs a few percent of a dense
+// 8-bit plane. Consumers iterate spans() (or rowSpans()) instead of testing
+// every pixel; dense buffers are produced only by toImage()/rasterize().
+class SparseMask
+{
+public:
+    SparseMask() = default;
+    SparseMask(int width, int height);
+
+    // Spans in any order, possibly overlapping; clipped to the frame,
+    // sorted and merged
+    static SparseMask fromSpans(int width, int height, QVector<MaskSpan> spans);
+    static SparseMask fromImage(const QImage& image, int threshold = 128);
+
+    // Span builders for fromSpans(). The rectangle is half-open; the disc
+    // holds pixels within `radius` of the rounded centre.
+    static void appendRect(QVector<MaskSpan>& spans, int x0, int y0, int x1, int y1);
+    static void appendDisc(QVector<MaskSpan>& spans, const QPointF& center, double radius);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    bool isEmpty() const { return m_spans.isEmpty(); }
+    qint64 area() const;
+    size_t memoryBytes() const;
+
+    const QVector<MaskSpan>& spans() const { return m_spans; }
+    // Indices [first, last) into spans() for row y
+    void rowSpans(int y, int& first, int& last) const;
+    bool contains(int x, int y) const;
+
+    SparseMask united(const SparseMask& other) const;
+    SparseMask intersected(const SparseMask& other) const;
+
+    // Euclidean dilation/erosion by a disc. Each 64x64 tile that can change
+    // is processed independently on the thread pool with a linear-time
+    // squared distance transform over the tile plus a `radius` margin, so
+    // cost follows the masked area rather than the frame size. Pixels
+    // outside the frame count as unmasked.
+    SparseMask dilated(double radius) const;
+    SparseMask eroded(double radius) const;
+
+    // Dense rasterisation on demand
+    QImage toImage() const;                         // Grayscale8, 255 inside
+    void rasterize(quint8* buffer, qsizetype bytesPerLine, quint8 value = 255) const;
+
+private:
+    SparseMask morphology(double radius, bool dilate) const;
+    void buildRowIndex();
+
+    int m_width = 0;
+    int m_height = 0;
+    QVector<MaskSpan> m_spans;
+    QVector<int> m_rowStart;        // height + 1 offsets into m_spans
+};
+
+#endif // SPARSE_MASK_H
@@ -1,5 +1,6 @@
 #include "BrightStarDatabase.h"
 #include "StarCatalogValidator.h"
+#include "WCSRoundTripGrid.h"
 #include "GaiaGDR3Catalog.h"  // Add this line
 #include <QNetworkRequest>
 #include <QJsonDocument>
@@ -1308,126 +1309,76 @@ bool StarCatalogValidator::setWCSData(const WCSData& wcs)
     }
 }
 
-void StarCatalogValidator::setWCSFromMetadata(const QStringList& metadata)
+namespace {
+
+// Rebuild a keyword store from legacy "NAME: value (comment)" display lines,
+// for images that were not loaded through ImageReader's typed store
+ImageKeywordStore keywordStoreFromMetadata(const QStringList& metadata, int& width, int& height)
 {
-    WCSData wcs;
-    
-    qDebug() << "=== Extracting WCS from metadata ===";
-    qDebug() << "Total metadata lines:" << metadata.size();
-    
-    // Debug: Show first few metadata lines to understand the format
-    qDebug() << "=== First 10 metadata lines ===";
-    for (int i = 0; i < qMin(10, metadata.size()); ++i) {
-        qDebug() << "Line" << i << ":" << metadata[i];
-    }
-    
-    // Look for specific WCS keywords to debug
-    for (int i = 0; i < metadata.size(); ++i) {
-        const QString& line = metadata[i];
-        if (line.contains("CRVAL1", Qt::CaseInsensitive) || 
-            line.contains("CRVAL2", Qt::CaseInsensitive) ||
-            line.contains("CD1_1", Qt::CaseInsensitive) ||
-            line.contains("CD2_2", Qt::CaseInsensitive)) {
-            qDebug() << "WCS keyword line" << i << ":" << line;
-        }
-    }
-    
-    // Parse common WCS keywords from metadata
+    ImageKeywordStore store;
     for (const QString& line : metadata) {
-        if (line.contains("CRVAL1", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(CRVAL1:\s*([+-]?\d*\.?\d*(?:[eE][+-]?\d+)?))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.crval1 = match.captured(1).toDouble();
-                qDebug() << "Found CRVAL1:" << wcs.crval1;
-            }
-        } else if (line.contains("CRVAL2", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(CRVAL2:\s*([+-]?\d*\.?\d*(?:[eE][+-]?\d+)?))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.crval2 = match.captured(1).toDouble();
-                qDebug() << "Found CRVAL2:" << wcs.crval2;
-            }
-        } else if (line.contains("CRPIX1", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(CRPIX1:\s*([+-]?\d*\.?\d*(?:[eE][+-]?\d+)?))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.crpix1 = match.captured(1).toDouble();
-                qDebug() << "Found CRPIX1:" << wcs.crpix1;
-            }
-        } else if (line.contains("CRPIX2", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(CRPIX2:\s*([+-]?\d*\.?\d*(?:[eE][+-]?\d+)?))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.crpix2 = match.captured(1).toDouble();
-                qDebug() << "Found CRPIX2:" << wcs.crpix2;
+        int colon = line.indexOf(':');
+        if (colon <= 0) continue;
+        
+        QString name = line.left(colon).trimmed();
+        QString value = line.mid(colon + 1).trimmed();
+        
+        if (name.compare("Dimensions", Qt::CaseInsensitive) == 0) {
+            // "W × H × C"
+            QString dims = value;
+            dims.replace(QChar(0x00D7), 'x');
+            QStringList parts = dims.split('x', Qt::SkipEmptyParts);
+            if (parts.size() >= 2) {
+                width = parts[0].trimmed().toInt();
+                height = parts[1].trimmed().toInt();
             }
-        } else if (line.contains("CD1_1", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(CD1_1:\s*([+-]?\d*\.?\d*(?:[eE][+-]?\d+)?))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.cd11 = match.captured(1).toDouble();
-                qDebug() << "Found CD1_1:" << wcs.cd11;
-            }
-        } else if (line.contains("CD1_2", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(CD1_2:\s*([+-]?\d*\.?\d*(?:[eE][+-]?\d+)?))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.cd12 = match.captured(1).toDouble();
-                qDebug() << "Found CD1_2:" << wcs.cd12;
-            }
-        } else if (line.contains("CD2_1", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(CD2_1:\s*([+-]?\d*\.?\d*(?:[eE][+-]?\d+)?))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.cd21 = match.captured(1).toDouble();
-                qDebug() << "Found CD2_1:" << wcs.cd21;
-            }
-        } else if (line.contains("CD2_2", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(CD2_2:\s*([+-]?\d*\.?\d*(?:[eE][+-]?\d+)?))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.cd22 = match.captured(1).toDouble();
-                qDebug() << "Found CD2_2:" << wcs.cd22;
-            }
-        } else if (line.contains("PIXSCALE", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(PIXSCALE:\s*([+-]?\d*\.?\d*(?:[eE][+-]?\d+)?))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.pixscale = match.captured(1).toDouble();
-                qDebug() << "Found PIXSCALE:" << wcs.pixscale;
-            }
-        } else if (line.contains("ORIENTAT", Qt::CaseInsensitive) || line.contains("ROTATION", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"((?:ORIENTAT|ROTATION):\s*([+-]?\d*\.?\d*(?:[eE][+-]?\d+)?))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.orientation = match.captured(1).toDouble();
-                qDebug() << "Found ORIENTAT/ROTATION:" << wcs.orientation;
-            }
-        } else if (line.contains("NAXIS1", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(NAXIS1:\s*(\d+))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.width = match.captured(1).toInt();
-                qDebug() << "Found NAXIS1 (width):" << wcs.width;
-            }
-        } else if (line.contains("NAXIS2", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"(NAXIS2:\s*(\d+))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.height = match.captured(1).toInt();
-                qDebug() << "Found NAXIS2 (height):" << wcs.height;
-            }
-        } else if (line.contains("Dimensions", Qt::CaseInsensitive)) {
-            QRegularExpression re(R"((\d+)\s*[×x]\s*(\d+))");
-            auto match = re.match(line);
-            if (match.hasMatch()) {
-                wcs.width = match.captured(1).toInt();
-                wcs.height = match.captured(2).toInt();
-                qDebug() << "Found dimensions:" << wcs.width << "x" << wcs.height;
+            continue;
+        }
+        
+        QString comment;
+        if (value.endsWith(')')) {
+            int open = value.lastIndexOf(" (");
+            if (open > 0) {
+                comment = value.mid(open + 2, value.length() - open - 3);
+                value = value.left(open).trimmed();
             }
         }
+        store.insertRaw(name, value, comment);
     }
+    return store;
+}
+
+} // namespace
+
+void StarCatalogValidator::setWCSFromMetadata(const QStringList& metadata)
+{
+    int width = 0, height = 0;
+    ImageKeywordStore keywords = keywordStoreFromMetadata(metadata, width, height);
+    setWCSFromKeywords(keywords, width, height);
+}
+
+void StarCatalogValidator::setWCSFromKeywords(const ImageKeywordStore& keywords, int width, int height)
+{
+    WCSData wcs;
+    
+    qDebug() << "=== Extracting WCS from" << keywords.size() << "keywords ===";
+    
+    // Direct hashed lookups; values were decoded once at load time
+    wcs.crval1 = keywords.number("CRVAL1");
+    wcs.crval2 = keywords.number("CRVAL2");
+    wcs.crpix1 = keywords.number("CRPIX1");
+    wcs.crpix2 = keywords.number("CRPIX2");
+    wcs.cd11 = keywords.number("CD1_1");
+    wcs.cd12 = keywords.number("CD1_2");
+    wcs.cd21 = keywords.number("CD2_1");
+    wcs.cd22 = keywords.number("CD2_2");
+    wcs.pixscale = keywords.number("PIXSCALE");
+    wcs.orientation = keywords.firstNumber({"ORIENTAT", "ROTATION"});
+    wcs.width = static_cast<int>(keywords.number("NAXIS1", width));
+    wcs.height = static_cast<int>(keywords.number("NAXIS2", height));
+    
+    qDebug() << "  CRVAL:" << wcs.crval1 << wcs.crval2 << "CRPIX:" << wcs.crpix1 << wcs.crpix2;
+    qDebug() << "  CD:" << wcs.cd11 << wcs.cd12 << wcs.cd21 << wcs.cd22;
     
     // Calculate pixel scale from CD matrix if available but pixscale not directly provided
     if (wcs.pixscale == 0.0 && (wcs.cd11 != 0.0 || wcs.cd12 != 0.0 || wcs.cd21 != 0.0 || wcs.cd22 != 0.0)) {
@@ -1869,57 +1820,45 @@ bool StarCatalogValidator::setWCSFromImageMetadata(const ImageData& imageData)
         // Convert ImageData metadata to PCL FITSKeywordArray
         pcl::FITSKeywordArray keywords;
         
-        // Parse metadata lines and convert to FITS keywords
-        for (const QString& line : imageData.metadata) {
-            QString trimmedLine = line.trimmed();
-            
-            // Extract key-value pairs in the format "KEY: value (comment)"
-            QRegularExpression kvRegex(R"(([A-Z0-9_-]+):\s*([^(]+)(?:\s*\(([^)]*)\))?)", 
-                                     QRegularExpression::CaseInsensitiveOption);
-            auto match = kvRegex.match(trimmedLine);
+        // Typed keywords from the reader; fall back to the display lines
+        // for images that were assembled without going through ImageReader
+        int width = 0, height = 0;
+        ImageKeywordStore fallback;
+        const ImageKeywordStore* store = &imageData.keywords;
+        if (store->isEmpty()) {
+            fallback = keywordStoreFromMetadata(imageData.metadata, width, height);
+            store = &fallback;
+        }
+        
+        // Only WCS-related keywords that PCL recognizes
+        static const QStringList wcsKeys = {
+            "CRVAL1", "CRVAL2", "CRPIX1", "CRPIX2",
+            "CD1_1", "CD1_2", "CD2_1", "CD2_2",
+            "CDELT1", "CDELT2", "CROTA1", "CROTA2",
+            "CTYPE1", "CTYPE2", "CUNIT1", "CUNIT2",
+            "PV1_1", "PV1_2", "LONPOLE", "LATPOLE",
+            "EQUINOX", "RADESYS", "NAXIS1", "NAXIS2",
+            // Add some basic metadata
+            "DATE-OBS", "FOCALLEN", "XPIXSZ", "YPIXSZ"
+        };
+        
+        for (const QString& key : wcsKeys) {
+            const ImageKeyword* keyword = store->find(key);
+            if (!keyword || keyword->type == ImageKeyword::Type::None) continue;
             
-            if (match.hasMatch()) {
-                QString key = match.captured(1).toUpper();
-                QString valueStr = match.captured(2).trimmed();
-                QString comment = match.captured(3).trimmed();
-                
-                // Handle quoted string values
-                if (valueStr.startsWith("'") && valueStr.endsWith("'")) {
-                    valueStr = valueStr.mid(1, valueStr.length() - 2);
-                }
-                
-                // Only add WCS-related keywords that PCL recognizes
-                QStringList wcsKeys = {
-                    "CRVAL1", "CRVAL2", "CRPIX1", "CRPIX2",
-                    "CD1_1", "CD1_2", "CD2_1", "CD2_2",
-                    "CDELT1", "CDELT2", "CROTA1", "CROTA2",
-                    "CTYPE1", "CTYPE2", "CUNIT1", "CUNIT2",
-                    "PV1_1", "PV1_2", "LONPOLE", "LATPOLE",
-                    "EQUINOX", "RADESYS", "NAXIS1", "NAXIS2",
-                    // Add some basic metadata
-                    "DATE-OBS", "FOCALLEN", "XPIXSZ", "YPIXSZ"
-                };
-                
-                if (wcsKeys.contains(key)) {
-                    // Try to parse as number first
-                    bool isNumber;
-                    double numValue = valueStr.toDouble(&isNumber);
-                    
-                    if (isNumber) {
-                        keywords.Add(pcl::FITSHeaderKeyword(
-                            pcl::IsoString(key.toUtf8().constData()), 
-                            numValue, 
-                            pcl::IsoString(comment.toUtf8().constData())));
-                        qDebug() << "Added numeric keyword:" << key << "=" << numValue;
-                    } else {
-                        // Handle as string (for CTYPE, RADESYS, etc.)
-                        keywords.Add(pcl::FITSHeaderKeyword(
-                            pcl::IsoString(key.toUtf8().constData()), 
-                            pcl::IsoString(valueStr.toUtf8().constData()), 
-                            pcl::IsoString(comment.toUtf8().constData())));
-                        qDebug() << "Added string keyword:" << key << "=" << valueStr;
-                    }
-                }
+            if (keyword->isNumeric()) {
+                keywords.Add(pcl::FITSHeaderKeyword(
+                    pcl::IsoString(key.toUtf8().constData()), 
+                    keyword->number, 
+                    pcl::IsoString(keyword->comment.toUtf8().constData())));
+                qDebug() << "Added numeric keyword:" << key << "=" << keyword->number;
+            } else {
+                // Handle as string (for CTYPE, RADESYS, etc.)
+                keywords.Add(pcl::FITSHeaderKeyword(
+                    pcl::IsoString(key.toUtf8().constData()), 
+                    pcl::IsoString(keyword->text.toUtf8().constData()), 
+                    pcl::IsoString(keyword->comment.toUtf8().constData())));
+                qDebug() << "Added string keyword:" << key << "=" << keyword->text;
             }
         }
         
@@ -2128,24 +2067,14 @@ void StarCatalogValidator::testAstrometricMetadata() const
             qDebug() << "    Check if the WCS keywords in your FITS file are correct.";
         }
         
-        // Test 4: Round-trip accuracy test
+        // Test 4: Round-trip accuracy over the whole image
         qDebug() << "\nRound-trip accuracy test:";
-        pcl::DPoint testPixel(m_astrometricMetadata.Width() * 0.25, m_astrometricMetadata.Height() * 0.75);
-        pcl::DPoint worldCoord, backToPixel;
-        
-        if (m_astrometricMetadata.ImageToCelestial(worldCoord, testPixel) &&
-            m_astrometricMetadata.CelestialToImage(backToPixel, worldCoord)) {
-            
-            double errorX = testPixel.x - backToPixel.x;
-            double errorY = testPixel.y - backToPixel.y;
-            double totalError = sqrt(errorX*errorX + errorY*errorY);
-            
-            qDebug() << QString("  Original: (%1, %2)")
-                        .arg(testPixel.x, 0, 'f', 3).arg(testPixel.y, 0, 'f', 3);
-            qDebug() << QString("  Round-trip: (%1, %2)")
-                        .arg(backToPixel.x, 0, 'f', 3).arg(backToPixel.y, 0, 'f', 3);
-            qDebug() << QString("  Error: %1 pixels %2")
-                        .arg(totalError).arg(totalError < 0.1 ? "✅" : "⚠️");
+        WCSRoundTripOptions roundTripOptions;
+        roundTripOptions.tolerance = 0.1;
+        const WCSRoundTripReport roundTrip = WCSRoundTripGrid::evaluate(m_astrometricMetadata, roundTripOptions);
+        qDebug() << QString("  %1 %2").arg(roundTrip.summary()).arg(roundTrip.passed() ? "✅" : "⚠️");
+        for (const QPointF& p : roundTrip.failurePositions.mid(0, 5)) {
+            qDebug() << QString("  No convergence at (%1, %2)").arg(p.x(), 0, 'f', 0).arg(p.y(), 0, 'f', 0);
         }
         
         // Test 5: Print PCL's diagnostic info
@@ -323,6 +323,7 @@ public:
     // WCS handling
     bool setWCSData(const WCSData& wcs);
     void setWCSFromMetadata(const QStringList& metadata);
+    void setWCSFromKeywords(const ImageKeywordStore& keywords, int width = 0, int height = 0);
     WCSData getWCSData() const;
     bool hasValidWCS() const;
     
@@ -381,6 +382,8 @@ public:
     int getWidth() { return m_astrometricMetadata.Width(); }
     int getHeight() { return m_astrometricMetadata.Height(); }
     void setMetadata(pcl::AstrometricMetadata rslt) { m_astrometricMetadata = rslt; }
+    const pcl::AstrometricMetadata& astrometricMetadata() const { return m_astrometricMetadata; }
+    const QVector<CatalogStar>& catalogStars() const { return m_catalogStars; }
   
 signals:
     void catalogQueryStarted();
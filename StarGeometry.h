@@ -0,0 +1,123 @@
+// StarGeometry.h - Star list spatial index and affine fitting shared by the matchers
+#ifndef STAR_GEOMETRY_H
+#define STAR_GEOMETRY_H
+
+#include <QHash>
+#include <QPointF>
+#include <QVector>
+#include <cmath>
+
+namespace StarGeometry {
+
+// x' = a*x + b*y + c,  y' = d*x + e*y + f
+struct AffineTransform {
+    double a = 1.0, b = 0.0, c = 0.0;
+    double d = 0.0, e = 1.0, f = 0.0;
+
+    QPointF map(const QPointF& p) const { return QPointF(a * p.x() + b * p.y() + c, d * p.x() + e * p.y() + f); }
+    double determinant() const { return a * e - b * d; }
+
+    bool inverted(AffineTransform& inverse) const
+    {
+        double det = determinant();
+        if (std::abs(det) < 1e-15) return false;
+        inverse.a = e / det;
+        inverse.b = -b / det;
+        inverse.d = -d / det;
+        inverse.e = a / det;
+        inverse.c = -(inverse.a * c + inverse.b * f);
+        inverse.f = -(inverse.d * c + inverse.e * f);
+        return true;
+    }
+};
+
+// Least-squares affine transform mapping src onto dst (centred for conditioning)
+inline bool fitAffine(const QVector<QPointF>& src, const QVector<QPointF>& dst, AffineTransform& transform)
+{
+    int n = src.size();
+    if (n < 3 || dst.size() != n) return false;
+
+    double mx = 0, my = 0, mu = 0, mv = 0;
+    for (int i = 0; i < n; ++i) {
+        mx += src[i].x(); my += src[i].y();
+        mu += dst[i].x(); mv += dst[i].y();
+    }
+    mx /= n; my /= n; mu /= n; mv /= n;
+
+    double sxx = 0, sxy = 0, syy = 0, sxu = 0, syu = 0, sxv = 0, syv = 0;
+    for (int i = 0; i < n; ++i) {
+        double x = src[i].x() - mx, y = src[i].y() - my;
+        double u = dst[i].x() - mu, v = dst[i].y() - mv;
+        sxx += x * x; sxy += x * y; syy += y * y;
+        sxu += x * u; syu += y * u;
+        sxv += x * v; syv += y * v;
+    }
+
+    double det = sxx * syy - sxy * sxy;
+    if (std::abs(det) < 1e-12 * (sxx * syy + 1e-300)) return false;
+
+    transform.a = (sxu * syy - syu * sxy) / det;
+    transform.b = (syu * sxx - sxu * sxy) / det;
+    transform.d = (sxv * syy - syv * sxy) / det;
+    transform.e = (syv * sxx - sxv * sxy) / det;
+    transform.c = mu - transform.a * mx - transform.b * my;
+    transform.f = mv - transform.d * mx - transform.e * my;
+    return true;
+}
+
+// Bucket grid for nearest-neighbour lookups in a star list. The grid keeps
+// a reference to the points, which must outlive it.
+class PointGrid
+{
+public:
+    PointGrid(const QVector<QPointF>& points, double cellSize)
+        : m_points(points), m_cellSize(cellSize)
+    {
+        for (int i = 0; i < points.size(); ++i) {
+            m_cells[key(cell(points[i].x()), cell(points[i].y()))].append(i);
+        }
+    }
+
+    // Index of the nearest point within maxDistance, or -1. Points flagged
+    // in `excluded` (indexed like the point list) are skipped.
+    int nearest(const QPointF& p, double maxDistance, double* distance = nullptr,
+                const QVector<bool>* excluded = nullptr) const
+    {
+        int reach = static_cast<int>(std::ceil(maxDistance / m_cellSize));
+        int cx = cell(p.x()), cy = cell(p.y());
+        double bestSq = maxDistance * maxDistance;
+        int best = -1;
+
+        for (int y = cy - reach; y <= cy + reach; ++y) {
+            for (int x = cx - reach; x <= cx + reach; ++x) {
+                auto it = m_cells.constFind(key(x, y));
+                if (it == m_cells.constEnd()) continue;
+                for (int index : it.value()) {
+                    if (excluded && (*excluded)[index]) continue;
+                    double dx = m_points[index].x() - p.x();
+                    double dy = m_points[index].y() - p.y();
+                    double distSq = dx * dx + dy * dy;
+                    if (distSq <= bestSq) {
+                        bestSq = distSq;
+                        best = index;
+                    }
+                }
+            }
+        }
+
+        if (distance && best >= 0) *distance = std::sqrt(bestSq);
+        return best;
+    }
+
+private:
+    int cell(double v) const { return static_cast<int>(std::floor(v / m_cellSize)); }
+    static qint64 key(int x, int y) { return (qint64(x) << 32) ^ quint32(y); }
+
+    const QVector<QPointF>& m_points;
+    double m_cellSize;
+    QHash<qint64, QVector<int>> m_cells;
+};
+
+} // namespace StarGeometry
+
+#endif // STAR_GEOMETRY_H
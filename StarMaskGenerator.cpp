@@ -1,6 +1,8 @@
 #include "StarMaskGenerator.h"
 #include "StarCorrelator.h"
+#include "ImagePlaneCache.h"
 #include "PCLMockAPI.h"
+#include "ParallelFor.h"
 
 #include <pcl/Image.h>
 #include <pcl/StarDetector.h>
@@ -9,10 +11,18 @@
 #include <algorithm>
 #include <cmath>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMutexLocker>
+#include <QRecursiveMutex>
 
+// Shared by detection and the catalog dump, which may run on different
+// job threads; recursive because dumpcat() calls validateStarDetection()
 StarCorrelator correlator;
+static QRecursiveMutex s_correlatorMutex;
 
 void StarMaskGenerator::validateStarDetection() {
+    QMutexLocker locker(&s_correlatorMutex);
     
     // Run analysis
     correlator.correlateStars();
@@ -41,10 +51,13 @@ StarMaskResult StarMaskGenerator::detectStarsOld(const ImageData& imageData, flo
     }
 
     // Configure Validator
-    correlator.setImageDimensions(imageData.width, imageData.height);
-    correlator.setMatchThreshold(2.0);
-    correlator.setZeroPoint(25.0);
-    correlator.setAutoCalibrate(true);
+    {
+        QMutexLocker locker(&s_correlatorMutex);
+        correlator.setImageDimensions(imageData.width, imageData.height);
+        correlator.setMatchThreshold(2.0);
+        correlator.setZeroPoint(25.0);
+        correlator.setAutoCalibrate(true);
+    }
     
     try {
         // Initialize PCL Mock API
@@ -110,9 +123,8 @@ StarMaskResult StarMaskGenerator::detectStarsOld(const ImageData& imageData, flo
 
         qDebug() << "PCL StarDetector found" << stars.Length() << "stars";
 
-        // Create mask image
-        result.maskImage = QImage(imageData.width, imageData.height, QImage::Format_Grayscale8);
-        result.maskImage.fill(0);
+        // Star footprints as row spans, merged into the sparse mask afterwards
+        QVector<MaskSpan> maskSpans;
 
         // Convert PCL stars to our format
         result.starCenters.reserve(stars.Length());
@@ -153,29 +165,13 @@ StarMaskResult StarMaskGenerator::detectStarsOld(const ImageData& imageData, flo
             // Draw star in mask using the detection rectangle if available
             if (star.rect.IsRect()) {
                 // Use the actual detection rectangle
-                for (int y = star.rect.y0; y < star.rect.y1; ++y) {
-                    for (int x = star.rect.x0; x < star.rect.x1; ++x) {
-                        if (x >= 0 && y >= 0 && x < imageData.width && y < imageData.height) {
-                            result.maskImage.setPixel(x, y, 255);
-                        }
-                    }
-                }
+                SparseMask::appendRect(maskSpans, star.rect.x0, star.rect.y0, star.rect.x1, star.rect.y1);
             } else {
                 // Fallback: draw circular region around center
-                int r = static_cast<int>(std::ceil(starRadius));
-                for (int dy = -r; dy <= r; ++dy) {
-                    for (int dx = -r; dx <= r; ++dx) {
-                        int px = center.x() + dx;
-                        int py = center.y() + dy;
-                        if (px >= 0 && py >= 0 && px < imageData.width && py < imageData.height) {
-                            if (dx * dx + dy * dy <= r * r) {
-                                result.maskImage.setPixel(px, py, 255);
-                            }
-                        }
-                    }
-                }
+                SparseMask::appendDisc(maskSpans, center, std::ceil(starRadius));
             }
 
+	    QMutexLocker correlatorLocker(&s_correlatorMutex);
 	    correlator.addDetectedStar(result.starCenters.size(),
 				       star.pos.x,
 				       star.pos.y,
@@ -185,6 +181,8 @@ StarMaskResult StarMaskGenerator::detectStarsOld(const ImageData& imageData, flo
 				       ((star.flux - 0) / std::max(1.0f, star.mad))); // Rough SNR estimate
             }
 
+        result.mask = SparseMask::fromSpans(imageData.width, imageData.height, std::move(maskSpans));
+
         // Report automatically calculated minimum star size if available
         if (detector.MinStarSize() > 0) {
             qDebug() << "Automatically calculated minimum star size:" << detector.MinStarSize() << "pixels";
@@ -221,6 +219,7 @@ StarMaskResult StarMaskGenerator::detectStarsOld(const ImageData& imageData, flo
 
 void StarMaskGenerator::dumpcat(QVector<CatalogStar> &catalogStars)
 {
+  QMutexLocker locker(&s_correlatorMutex);
   for (const auto& star : catalogStars) {
     correlator.addCatalogStar(star.id,
 			      star.pixelPos.x(),
@@ -247,21 +246,10 @@ StarMaskResult StarMaskGenerator::detectStarsSimple(const ImageData& imageData,
     std::vector<float> localMaxima;
     std::vector<QPoint> candidates;
 
-    // Calculate image statistics for adaptive threshold
-    float sum = 0.0f;
-    float sumSq = 0.0f;
-    int count = 0;
-
-    for (int i = 0; i < width * height; ++i) {
-        float val = pixels[i];
-        sum += val;
-        sumSq += val * val;
-        count++;
-    }
-
-    float mean = sum / count;
-    float variance = (sumSq / count) - (mean * mean);
-    float stddev = std::sqrt(variance);
+    // Image statistics for adaptive threshold (shared derived-plane cache)
+    ChannelStatistics stats = imageData.derived()->channelStatistics(0);
+    float mean = static_cast<float>(stats.mean);
+    float stddev = static_cast<float>(stats.stdDev);
     
     // Adaptive threshold based on image statistics
     float detectionThreshold = mean + threshold * stddev * 5.0f;
@@ -310,9 +298,8 @@ StarMaskResult StarMaskGenerator::detectStarsSimple(const ImageData& imageData,
     // Limit to reasonable number of stars
     int maxStars = std::min(500, static_cast<int>(candidates.size()));
     
-    // Create mask image
-    result.maskImage = QImage(width, height, QImage::Format_Grayscale8);
-    result.maskImage.fill(0);
+    // Star footprints as row spans, merged into the sparse mask afterwards
+    QVector<MaskSpan> maskSpans;
 
     // Process the brightest candidates
     for (int i = 0; i < maxStars; ++i) {
@@ -329,20 +316,11 @@ StarMaskResult StarMaskGenerator::detectStarsSimple(const ImageData& imageData,
         result.starValid.append(true);
 
         // Draw star in mask
-        int r = static_cast<int>(std::ceil(starRadius));
-        for (int dy = -r; dy <= r; ++dy) {
-            for (int dx = -r; dx <= r; ++dx) {
-                int px = center.x() + dx;
-                int py = center.y() + dy;
-                if (px >= 0 && py >= 0 && px < width && py < height) {
-                    if (dx * dx + dy * dy <= r * r) {
-                        result.maskImage.setPixel(px, py, 255);
-                    }
-                }
-            }
-        }
+        SparseMask::appendDisc(maskSpans, center, std::ceil(starRadius));
     }
 
+    result.mask = SparseMask::fromSpans(width, height, std::move(maskSpans));
+
     qDebug() << "Simple star detection completed:" << result.starCenters.size() << "stars detected";
     return result;
 }
@@ -440,9 +418,8 @@ StarMaskResult StarMaskGenerator::detectStarsAdvanced(const ImageData& imageData
 
         qDebug() << "Advanced PCL StarDetector found" << stars.Length() << "stars";
 
-        // Create mask image
-        result.maskImage = QImage(imageData.width, imageData.height, QImage::Format_Grayscale8);
-        result.maskImage.fill(0);
+        // Star footprints as row spans, merged into the sparse mask afterwards
+        QVector<MaskSpan> maskSpans;
 
         // Convert PCL stars to our format with enhanced information
         result.starCenters.reserve(stars.Length());
@@ -503,27 +480,10 @@ StarMaskResult StarMaskGenerator::detectStarsAdvanced(const ImageData& imageData
             // Draw star in mask using detection rectangle if available
             if (star.rect.IsRect()) {
                 // Use the actual detection rectangle
-                for (int y = star.rect.y0; y < star.rect.y1; ++y) {
-                    for (int x = star.rect.x0; x < star.rect.x1; ++x) {
-                        if (x >= 0 && y >= 0 && x < imageData.width && y < imageData.height) {
-                            result.maskImage.setPixel(x, y, 255);
-                        }
-                    }
-                }
+                SparseMask::appendRect(maskSpans, star.rect.x0, star.rect.y0, star.rect.x1, star.rect.y1);
             } else {
                 // Fallback: draw circular region
-                int r = static_cast<int>(std::ceil(starRadius));
-                for (int dy = -r; dy <= r; ++dy) {
-                    for (int dx = -r; dx <= r; ++dx) {
-                        int px = center.x() + dx;
-                        int py = center.y() + dy;
-                        if (px >= 0 && py >= 0 && px < imageData.width && py < imageData.height) {
-                            if (dx * dx + dy * dy <= r * r) {
-                                result.maskImage.setPixel(px, py, 255);
-                            }
-                        }
-                    }
-                }
+                SparseMask::appendDisc(maskSpans, center, std::ceil(starRadius));
             }
 
             // Debug output for first few stars
@@ -552,6 +512,11 @@ StarMaskResult StarMaskGenerator::detectStarsAdvanced(const ImageData& imageData
             validStars++;
         }
 
+        result.mask = SparseMask::fromSpans(imageData.width, imageData.height, std::move(maskSpans));
+        qDebug() << QString("Star mask: %1 spans, %2 px, %3 KB")
+                    .arg(result.mask.spans().size()).arg(result.mask.area())
+                    .arg(result.mask.memoryBytes() / 1024.0, 0, 'f', 1);
+
         // Report detection statistics
         if (detector.MinStarSize() > 0) {
             qDebug() << "Automatically calculated minimum star size:" << detector.MinStarSize() << "pixels";
@@ -577,3 +542,197 @@ StarMaskResult StarMaskGenerator::detectStarsAdvanced(const ImageData& imageData
 
     return result;
 }
+
+SparseMask StarMaskGenerator::grownStarMask(const StarMaskResult& result,
+                                            double growthFactor, double minimumGrowth)
+{
+    // Bright stars have wider halos: each footprint grows in proportion to
+    // its radius. Stars sharing a rounded growth are dilated together.
+    QMap<int, QVector<MaskSpan>> byGrowth;
+    for (int i = 0; i < result.starCenters.size() && i < result.starRadii.size(); ++i) {
+        if (i < result.starValid.size() && !result.starValid[i]) continue;
+        const float radius = result.starRadii[i];
+        const int growth = int(std::lround(std::max(minimumGrowth, growthFactor * radius)));
+        SparseMask::appendDisc(byGrowth[growth], result.starCenters[i], std::ceil(radius));
+    }
+
+    SparseMask grown = result.mask;
+    for (auto it = byGrowth.begin(); it != byGrowth.end(); ++it) {
+        SparseMask footprints = SparseMask::fromSpans(result.mask.width(), result.mask.height(),
+                                                      std::move(it.value()));
+        grown = grown.united(footprints.dilated(it.key()));
+    }
+    return grown;
+}
+
+namespace {
+
+// Channel-averaged value at a full-resolution pixel
+inline float sampleLuminance(const ImageData& imageData, int x, int y)
+{
+    const size_t plane = size_t(imageData.width) * imageData.height;
+    const float* p = imageData.pixels.constData() + size_t(y) * imageData.width + x;
+    float sum = 0.0f;
+    for (int c = 0; c < imageData.channels; ++c) {
+        sum += p[c * plane];
+    }
+    return sum / imageData.channels;
+}
+
+// Background-subtracted centroid in a box around a guess; the background is
+// the median of the box border. Returns false if nothing rises above it.
+bool refineCentroid(const ImageData& imageData, QPointF& center, int halfSize, float& flux)
+{
+    for (int iteration = 0; iteration < 3; ++iteration) {
+        int cx = static_cast<int>(std::round(center.x()));
+        int cy = static_cast<int>(std::round(center.y()));
+        int x0 = std::max(0, cx - halfSize), x1 = std::min(imageData.width - 1, cx + halfSize);
+        int y0 = std::max(0, cy - halfSize), y1 = std::min(imageData.height - 1, cy + halfSize);
+        if (x1 - x0 < 2 || y1 - y0 < 2) return false;
+
+        QVector<float> border;
+        border.reserve(2 * (x1 - x0 + y1 - y0 + 2));
+        for (int x = x0; x <= x1; ++x) {
+            border.append(sampleLuminance(imageData, x, y0));
+            border.append(sampleLuminance(imageData, x, y1));
+        }
+        for (int y = y0 + 1; y < y1; ++y) {
+            border.append(sampleLuminance(imageData, x0, y));
+            border.append(sampleLuminance(imageData, x1, y));
+        }
+        std::nth_element(border.begin(), border.begin() + border.size() / 2, border.end());
+        float background = border[border.size() / 2];
+
+        double sum = 0.0, sx = 0.0, sy = 0.0;
+        for (int y = y0 + 1; y < y1; ++y) {
+            for (int x = x0 + 1; x < x1; ++x) {
+                float v = sampleLuminance(imageData, x, y) - background;
+                if (v > 0.0f && std::isfinite(v)) {
+                    sum += v;
+                    sx += v * x;
+                    sy += v * y;
+                }
+            }
+        }
+        if (sum <= 0.0) return false;
+
+        QPointF refined(sx / sum, sy / sum);
+        flux = static_cast<float>(sum);
+        bool converged = std::hypot(refined.x() - center.x(), refined.y() - center.y()) < 0.05;
+        center = refined;
+        if (converged) break;
+    }
+    return true;
+}
+
+} // namespace
+
+StarMaskResult StarMaskGenerator::detectStarsForSolving(const ImageData& imageData,
+                                                        int maxStars,
+                                                        int binLevel,
+                                                        float sensitivity)
+{
+    StarMaskResult result;
+
+    if (!imageData.isValid() || maxStars <= 0) {
+        qDebug() << "Invalid image data for solve-oriented star detection";
+        return result;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Detect on the binned level; fewer wavelet layers are needed there
+    binLevel = std::max(0, binLevel);
+    ImageData binned = binLevel > 0 ? imageData.derived()->pyramidLevel(binLevel) : imageData;
+    const double scaleX = double(imageData.width) / binned.width;
+    const double scaleY = double(imageData.height) / binned.height;
+
+    StarMaskResult detected = detectStarsAdvanced(binned, sensitivity,
+                                                  binLevel > 0 ? 4 : 5, 1, 0.5f, 0.8f, false);
+    qint64 detectMs = timer.elapsed();
+
+    // Spread the selection: bucket the (brightest-first) detections into a
+    // grid of about four stars per cell and take them round-robin, so dense
+    // regions cannot crowd out the rest of the field
+    const int candidates = detected.starCenters.size();
+    int cells = std::max(1, maxStars / 4);
+    int gridX = std::max(1, static_cast<int>(std::round(std::sqrt(cells * double(binned.width) / binned.height))));
+    int gridY = std::max(1, (cells + gridX - 1) / gridX);
+
+    QVector<QVector<int>> buckets(gridX * gridY);
+    for (int i = 0; i < candidates; ++i) {
+        const QPoint& p = detected.starCenters[i];
+        int bx = std::min(gridX - 1, p.x() * gridX / binned.width);
+        int by = std::min(gridY - 1, p.y() * gridY / binned.height);
+        buckets[by * gridX + bx].append(i);
+    }
+
+    QVector<int> selected;
+    selected.reserve(std::min(maxStars, candidates));
+    for (int round = 0; selected.size() < std::min(maxStars, candidates); ++round) {
+        // Within a round, brighter stars (lower detection rank) go first
+        QVector<int> roundStars;
+        for (const QVector<int>& bucket : buckets) {
+            if (round < bucket.size()) roundStars.append(bucket[round]);
+        }
+        std::sort(roundStars.begin(), roundStars.end());
+        for (int i : roundStars) {
+            if (selected.size() >= maxStars) break;
+            selected.append(i);
+        }
+    }
+
+    // Re-centroid the chosen stars at full resolution
+    const int count = selected.size();
+    QVector<QPointF> centers(count);
+    QVector<float> fluxes(count, 0.0f);
+    QVector<char> good(count, 0);
+
+    Parallel::forRange(count, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            int i = selected[k];
+            const QPoint& p = detected.starCenters[i];
+            float radius = detected.starRadii[i] * static_cast<float>(std::max(scaleX, scaleY));
+            int halfSize = std::max(4, static_cast<int>(std::ceil(2.5f * radius)));
+
+            QPointF center((p.x() + 0.5) * scaleX - 0.5, (p.y() + 0.5) * scaleY - 0.5);
+            good[k] = refineCentroid(imageData, center, halfSize, fluxes[k]);
+            centers[k] = center;
+        }
+    }, 16);
+
+    for (int k = 0; k < count; ++k) {
+        if (!good[k]) continue;
+        QPoint center(static_cast<int>(std::round(centers[k].x())),
+                      static_cast<int>(std::round(centers[k].y())));
+        if (center.x() < 0 || center.y() < 0 ||
+            center.x() >= imageData.width || center.y() >= imageData.height) {
+            continue;
+        }
+
+        int i = selected[k];
+        result.starCenters.append(center);
+        result.starCentroids.append(centers[k]);
+        result.starRadii.append(detected.starRadii[i] * static_cast<float>(std::max(scaleX, scaleY)));
+        result.starFluxes.append(fluxes[k]);
+        result.starValid.append(true);
+    }
+
+    // Footprints of every detection, not only the selected ones, scaled up
+    // from the binned level so background and photometry stages can mask them
+    QVector<MaskSpan> maskSpans;
+    for (int i = 0; i < candidates; ++i) {
+        const QPoint& p = detected.starCenters[i];
+        QPointF center((p.x() + 0.5) * scaleX - 0.5, (p.y() + 0.5) * scaleY - 0.5);
+        float radius = detected.starRadii[i] * static_cast<float>(std::max(scaleX, scaleY));
+        SparseMask::appendDisc(maskSpans, center, std::ceil(radius));
+    }
+    result.mask = SparseMask::fromSpans(imageData.width, imageData.height, std::move(maskSpans));
+
+    qDebug() << "Solve-oriented detection:" << candidates << "stars at bin" << (1 << binLevel)
+             << "in" << detectMs << "ms," << result.starCenters.size() << "re-centroided, total"
+             << timer.elapsed() << "ms";
+
+    return result;
+}
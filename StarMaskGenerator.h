@@ -5,6 +5,7 @@
 #include <QPoint>
 #include <QImage>
 #include "ImageReader.h"
+#include "SparseMask.h"
 #include "StarCatalogValidator.h"
 
 struct StarMaskResult {
@@ -12,7 +13,8 @@ struct StarMaskResult {
     QVector<float> starRadii;
     QVector<float> starFluxes;    // Add this missing member
     QVector<bool> starValid;
-    QImage maskImage;
+    SparseMask mask;                 // Star footprints; mask.toImage() for a dense plane
+    QVector<QPointF> starCentroids;  // Sub-pixel centres (detectStarsForSolving only)
 };
 
 class StarMaskGenerator
@@ -29,6 +31,22 @@ public:
                                              float peakResponse = 0.5f,
                                              float maxDistortion = 0.8f,
                                              bool enablePSFFitting = true);
+
+    // Fast extraction for plate solving: detects on a 2^binLevel binned
+    // pyramid level, keeps the brightest maxStars spread evenly over the
+    // frame and re-centroids only those at full resolution. Fluxes are
+    // measured at full resolution. The mask holds the footprints of every
+    // detection, scaled up from the binned level.
+    static StarMaskResult detectStarsForSolving(const ImageData& imageData,
+                                                int maxStars = 200,
+                                                int binLevel = 1,
+                                                float sensitivity = 0.5f);
+    // Star mask with each footprint dilated by max(minimumGrowth,
+    // growthFactor * radius) pixels, for excluding halos from background
+    // and photometry sky estimates
+    static SparseMask grownStarMask(const StarMaskResult& result,
+                                    double growthFactor = 1.0,
+                                    double minimumGrowth = 2.0);
     static void dumpcat(QVector<CatalogStar> &catalogStars);
     static void validateStarDetection();
 
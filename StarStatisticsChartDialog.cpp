@@ -178,6 +178,9 @@ void StarStatisticsChartDialog::onColorAnalysisClicked()
 					      m_detectedStars.starRadii,
 					      m_catalogStars,
 					      this);
+      if (!m_colorData.isEmpty()) {
+          m_colorDialog->setColorData(m_colorData);
+      }
     }
     
     m_colorDialog->show();
@@ -644,6 +647,21 @@ void StarStatisticsChartDialog::updateRGBButtonState()
     qDebug() << "=== End RGB Button Debug ===\n";
 }
 
+void StarStatisticsChartDialog::setColorPhotometry(const QVector<StarColorData>& colors,
+                                                   const QString& summary)
+{
+    m_colorData = colors;
+    m_photometryComplete = !colors.isEmpty();
+    
+    if (m_photometryStatsText) {
+        m_photometryStatsText->setPlainText(summary);
+    }
+    if (m_colorDialog && !colors.isEmpty()) {
+        m_colorDialog->setColorData(colors);
+    }
+    updateRGBButtonState();
+}
+
 void StarStatisticsChartDialog::setImageData(const ImageData* imageData)
 {
     m_imageData = imageData;
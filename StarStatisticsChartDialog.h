@@ -49,6 +49,9 @@ public:
     void setImageData(const ImageData* imageData);
     void setDetectedStars(const QVector<QPoint>& centers, const QVector<float>& radii);
     void setCatalogStars(const QVector<CatalogStar>& catalogStars);
+    // Colour photometry measured off the GUI thread; handed to the colour
+    // analysis dialog so it does not have to run again
+    void setColorPhotometry(const QVector<StarColorData>& colors, const QString& summary);
 
 private slots:
     // Keep all your existing slots
@@ -85,6 +88,7 @@ private:
     StarMaskResult m_detectedStars;          // Only if enhanced mode
     bool m_hasDetectedStars = false;         // Whether we have detected stars
     bool m_photometryComplete = false;       // Whether photometry analysis is done
+    QVector<StarColorData> m_colorData;      // Precomputed colour photometry
     
     QPushButton* m_colorAnalysisButton;
     ColorAnalysisDialog* m_colorDialog;
@@ -0,0 +1,256 @@
+// TIFFBlockDecoder.cpp - Parallel strip/tile decoding of TIFF images
+#include "TIFFBlockDecoder.h"
+#include "ParallelFor.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QThreadPool>
+
+#include <tiffio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+struct Layout {
+    int width = 0;
+    int height = 0;
+    int samplesPerPixel = 1;
+    int bitsPerSample = 8;
+    int sampleFormat = SAMPLEFORMAT_UINT;
+    bool separate = false;          // PLANARCONFIG_SEPARATE
+    bool tiled = false;
+    int blockWidth = 0;             // Tile width, or image width for strips
+    int blockHeight = 0;            // Tile height, or rows per strip
+    int blocksAcross = 1;
+    int blocksDown = 1;
+};
+
+TIFF* openTIFF(const QString& filePath)
+{
+    return TIFFOpen(filePath.toLocal8Bit().constData(), "r");
+}
+
+bool readLayout(TIFF* tiff, Layout& layout, QString& reason)
+{
+    uint32_t width = 0, height = 0;
+    uint16_t samples = 1, bits = 1, format = SAMPLEFORMAT_UINT;
+    uint16_t planar = PLANARCONFIG_CONTIG, photometric = PHOTOMETRIC_MINISBLACK;
+
+    TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
+    TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &samples);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &bits);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &format);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planar);
+    if (!TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &photometric)) {
+        photometric = samples >= 3 ? PHOTOMETRIC_RGB : PHOTOMETRIC_MINISBLACK;
+    }
+
+    if (width == 0 || height == 0 || width > uint32_t(std::numeric_limits<int>::max()) ||
+        height > uint32_t(std::numeric_limits<int>::max())) {
+        reason = "Invalid image size";
+        return false;
+    }
+    if (photometric != PHOTOMETRIC_MINISBLACK && photometric != PHOTOMETRIC_RGB) {
+        reason = QString("Photometric interpretation %1").arg(photometric);
+        return false;
+    }
+    const bool integer = format == SAMPLEFORMAT_UINT && (bits == 8 || bits == 16 || bits == 32);
+    const bool real = format == SAMPLEFORMAT_IEEEFP && (bits == 32 || bits == 64);
+    if (!integer && !real) {
+        reason = QString("%1-bit samples (format %2)").arg(bits).arg(format);
+        return false;
+    }
+
+    layout.width = int(width);
+    layout.height = int(height);
+    layout.samplesPerPixel = samples;
+    layout.bitsPerSample = bits;
+    layout.sampleFormat = format;
+    layout.separate = planar == PLANARCONFIG_SEPARATE && samples > 1;
+    layout.tiled = TIFFIsTiled(tiff);
+
+    if (layout.tiled) {
+        uint32_t tileWidth = 0, tileHeight = 0;
+        TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &tileWidth);
+        TIFFGetField(tiff, TIFFTAG_TILELENGTH, &tileHeight);
+        if (tileWidth == 0 || tileHeight == 0) {
+            reason = "Invalid tile size";
+            return false;
+        }
+        layout.blockWidth = int(tileWidth);
+        layout.blockHeight = int(tileHeight);
+    } else {
+        uint32_t rowsPerStrip = height;
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+        layout.blockWidth = int(width);
+        layout.blockHeight = int(std::min(std::max<uint32_t>(rowsPerStrip, 1), height));
+    }
+    layout.blocksAcross = (layout.width + layout.blockWidth - 1) / layout.blockWidth;
+    layout.blocksDown = (layout.height + layout.blockHeight - 1) / layout.blockHeight;
+    return true;
+}
+
+// Copies the valid part of one decoded strip/tile into the planar output.
+// Chunky blocks hold samplesPerPixel interleaved samples per pixel; a
+// separate-plane block holds samples of `plane` only.
+template <typename T>
+void convertBlock(const uchar* block, float* planes, const Layout& layout,
+                  int x0, int y0, int plane)
+{
+    // Single precision is exact for 8/16-bit and lets the loops vectorise
+    using Real = typename std::conditional<(sizeof(T) <= 2), float, double>::type;
+    const Real scale = std::is_integral<T>::value ? Real(1) / Real(std::numeric_limits<T>::max()) : Real(1);
+    const size_t planeSize = size_t(layout.width) * layout.height;
+    const int stride = layout.separate ? 1 : layout.samplesPerPixel;
+    const int columns = std::min(layout.blockWidth, layout.width - x0);
+    const int rows = std::min(layout.blockHeight, layout.height - y0);
+    const T* samples = reinterpret_cast<const T*>(block);
+
+    for (int r = 0; r < rows; ++r) {
+        const T* row = samples + size_t(r) * layout.blockWidth * stride;
+        const size_t target = size_t(y0 + r) * layout.width + x0;
+
+        if (layout.separate) {
+            float* out = planes + plane * planeSize + target;
+            for (int x = 0; x < columns; ++x) {
+                out[x] = std::is_integral<T>::value ? float(Real(row[x]) * scale) : float(row[x]);
+            }
+        } else {
+            for (int c = 0; c < layout.samplesPerPixel; ++c) {
+                float* out = planes + c * planeSize + target;
+                const T* in = row + c;
+                for (int x = 0; x < columns; ++x) {
+                    out[x] = std::is_integral<T>::value ? float(Real(in[size_t(x) * stride]) * scale)
+                                                        : float(in[size_t(x) * stride]);
+                }
+            }
+        }
+    }
+}
+
+void convertBlock(const uchar* block, float* planes, const Layout& layout, int x0, int y0, int plane)
+{
+    if (layout.sampleFormat == SAMPLEFORMAT_IEEEFP) {
+        if (layout.bitsPerSample == 32) convertBlock<float>(block, planes, layout, x0, y0, plane);
+        else convertBlock<double>(block, planes, layout, x0, y0, plane);
+    } else if (layout.bitsPerSample == 8) {
+        convertBlock<quint8>(block, planes, layout, x0, y0, plane);
+    } else if (layout.bitsPerSample == 16) {
+        convertBlock<quint16>(block, planes, layout, x0, y0, plane);
+    } else {
+        convertBlock<quint32>(block, planes, layout, x0, y0, plane);
+    }
+}
+
+} // namespace
+
+TIFFBlockDecoder::Status TIFFBlockDecoder::decode(const QString& filePath, TIFFDecodedImage& image,
+                                                  QString* errorMessage)
+{
+    auto fail = [&](const QString& message) {
+        qDebug() << "❌ TIFF decode:" << message;
+        if (errorMessage) *errorMessage = message;
+        return Failed;
+    };
+    auto unsupported = [&](const QString& reason) {
+        qDebug() << "ℹ️ TIFF block decoder not used:" << reason;
+        if (errorMessage) *errorMessage = reason;
+        return Unsupported;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Layout layout;
+    {
+        TIFF* tiff = openTIFF(filePath);
+        if (!tiff) {
+            return unsupported("libtiff cannot open the file");
+        }
+        QString reason;
+        bool ok = readLayout(tiff, layout, reason);
+        TIFFClose(tiff);
+        if (!ok) {
+            return unsupported(reason);
+        }
+    }
+
+    const int planeCount = layout.separate ? layout.samplesPerPixel : 1;
+    const int blocksPerPlane = layout.blocksAcross * layout.blocksDown;
+    const int totalBlocks = blocksPerPlane * planeCount;
+    const size_t planeSize = size_t(layout.width) * layout.height;
+
+    QVector<float> pixels(qsizetype(planeSize) * layout.samplesPerPixel);
+    float* planes = pixels.data();
+
+    // One contiguous run of blocks per worker, each with its own handle
+    const int workers = std::max(1, std::min(totalBlocks, QThreadPool::globalInstance()->maxThreadCount()));
+    std::atomic<bool> ok(true);
+    QString firstError;
+    std::atomic<bool> errorTaken(false);
+
+    Parallel::forChunks(size_t(totalBlocks), workers, [&](int, size_t begin, size_t end) {
+        auto report = [&](const QString& message) {
+            ok.store(false);
+            if (!errorTaken.exchange(true)) firstError = message;
+        };
+
+        TIFF* tiff = openTIFF(filePath);
+        if (!tiff) {
+            report("Cannot reopen file for decoding");
+            return;
+        }
+
+        const tmsize_t blockBytes = layout.tiled ? TIFFTileSize(tiff) : TIFFStripSize(tiff);
+        std::vector<uchar> buffer(size_t(std::max<tmsize_t>(blockBytes, 0)));
+
+        for (size_t index = begin; index < end && ok.load(); ++index) {
+            const int plane = int(index) / blocksPerPlane;
+            const int within = int(index) % blocksPerPlane;
+            const int x0 = (within % layout.blocksAcross) * layout.blockWidth;
+            const int y0 = (within / layout.blocksAcross) * layout.blockHeight;
+
+            tmsize_t n;
+            if (layout.tiled) {
+                uint32_t tile = TIFFComputeTile(tiff, uint32_t(x0), uint32_t(y0), 0, uint16_t(plane));
+                n = TIFFReadEncodedTile(tiff, tile, buffer.data(), blockBytes);
+            } else {
+                uint32_t strip = TIFFComputeStrip(tiff, uint32_t(y0), uint16_t(plane));
+                n = TIFFReadEncodedStrip(tiff, strip, buffer.data(), blockBytes);
+            }
+            if (n < 0) {
+                report(QString("Cannot decode %1 %2").arg(layout.tiled ? "tile" : "strip").arg(index));
+                break;
+            }
+
+            convertBlock(buffer.data(), planes, layout, x0, y0, plane);
+        }
+        TIFFClose(tiff);
+    });
+
+    if (!ok.load()) {
+        return fail(firstError);
+    }
+
+    image.width = layout.width;
+    image.height = layout.height;
+    image.channels = layout.samplesPerPixel;
+    image.pixels = std::move(pixels);
+    image.bitsPerSample = layout.bitsPerSample;
+    image.floatingPoint = layout.sampleFormat == SAMPLEFORMAT_IEEEFP;
+    image.tiled = layout.tiled;
+    image.blocks = totalBlocks;
+
+    qDebug() << QString("📂 Decoded TIFF %1x%2x%3 %4-bit%5 (%6 %7 on %8 threads) in %9 ms")
+                .arg(image.width).arg(image.height).arg(image.channels).arg(image.bitsPerSample)
+                .arg(image.floatingPoint ? QString(" float") : QString())
+                .arg(totalBlocks).arg(layout.tiled ? "tiles" : "strips").arg(workers)
+                .arg(timer.elapsed());
+    return Decoded;
+}
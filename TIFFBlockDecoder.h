@@ -0,0 +1,37 @@
+// TIFFBlockDecoder.h - Parallel strip/tile decoding of TIFF images
+#ifndef TIFF_BLOCK_DECODER_H
+#define TIFF_BLOCK_DECODER_H
+
+#include <QString>
+#include <QVector>
+
+struct TIFFDecodedImage {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    QVector<float> pixels;          // Planar, integers normalised to [0, 1]
+    int bitsPerSample = 0;
+    bool floatingPoint = false;
+    bool tiled = false;
+    int blocks = 0;                 // Strips or tiles decoded
+};
+
+// Decodes the first directory of a TIFF file with libtiff, splitting its
+// strips or tiles into contiguous ranges that are decoded concurrently.
+// Each worker opens its own handle (libtiff handles are not shareable
+// between threads) and converts its blocks straight into the destination
+// planes, deinterleaving chunky pixels on the way.
+//
+// Unsigned 8/16/32-bit and 32/64-bit float samples in grayscale or RGB
+// photometry are handled; anything else (signed, bilevel, palette, YCbCr,
+// CMYK) is reported as Unsupported so the caller can fall back to PCL.
+class TIFFBlockDecoder
+{
+public:
+    enum Status { Decoded, Unsupported, Failed };
+
+    static Status decode(const QString& filePath, TIFFDecodedImage& image,
+                         QString* errorMessage = nullptr);
+};
+
+#endif // TIFF_BLOCK_DECODER_H
@@ -0,0 +1,487 @@
+// ThumbnailCache.cpp - Stretched frame previews from strided partial reads
+#include "ThumbnailCache.h"
+#include "FrameIndex.h"
+#include "ImageReader.h"
+#include "ParallelFor.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QVector>
+#include <QtEndian>
+
+#include <tiffio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+const int kFITSBlock = 2880;
+const int kMaxHeaderBlocks = 1000;
+
+// Reduced planar image ahead of stretching
+struct Preview {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    QVector<float> planes;
+
+    float* row(int c, int y) { return planes.data() + (size_t(c) * height + y) * width; }
+    const float* row(int c, int y) const { return planes.constData() + (size_t(c) * height + y) * width; }
+};
+
+int reductionFactor(int width, int height, int maxSize)
+{
+    return std::max(1, (std::max(width, height) + maxSize - 1) / std::max(1, maxSize));
+}
+
+void allocate(Preview& preview, int width, int height, int channels, int k)
+{
+    preview.width = std::max(1, width / k);
+    preview.height = std::max(1, height / k);
+    preview.channels = channels;
+    preview.planes.resize(qsizetype(preview.width) * preview.height * channels);
+}
+
+// Source row sampled for preview row j: the centre of its k-row band
+inline int sourceRow(int j, int k, int height)
+{
+    return std::min(height - 1, j * k + k / 2);
+}
+
+// Average k neighbouring samples along one source row; `stride` is the byte
+// distance between consecutive pixels of the channel being reduced
+template <typename Load>
+void reduceRow(const uchar* row, int sourceWidth, size_t stride, int k,
+               float* out, int outWidth, Load load)
+{
+    for (int i = 0; i < outWidth; ++i) {
+        const int x0 = i * k;
+        const int n = std::min(k, sourceWidth - x0);
+        double sum = 0.0;
+        int valid = 0;
+        for (int j = 0; j < n; ++j) {
+            double v = load(row + size_t(x0 + j) * stride);
+            if (std::isfinite(v)) {
+                sum += v;
+                ++valid;
+            }
+        }
+        out[i] = valid > 0 ? float(sum / valid) : std::numeric_limits<float>::quiet_NaN();
+    }
+}
+
+template <typename T>
+inline double loadBigEndian(const uchar* p)
+{
+    if constexpr (std::is_same<T, float>::value) {
+        quint32 bits = qFromBigEndian<quint32>(p);
+        float v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    } else if constexpr (std::is_same<T, double>::value) {
+        quint64 bits = qFromBigEndian<quint64>(p);
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    } else {
+        return double(qFromBigEndian<T>(p));
+    }
+}
+
+template <typename T>
+inline double loadNative(const uchar* p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return double(v);
+}
+
+// FITS primary HDU: parse the header, then seek to and read one row per
+// preview row. Nothing else of the data unit is touched.
+bool sampleFITS(const QString& filePath, int maxSize, Preview& preview, QString& reason)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        reason = file.errorString();
+        return false;
+    }
+
+    QHash<QString, QString> values;
+    qint64 headerBytes = 0;
+    bool ended = false;
+    while (!ended) {
+        const QByteArray block = file.read(kFITSBlock);
+        if (block.size() != kFITSBlock || headerBytes >= qint64(kMaxHeaderBlocks) * kFITSBlock) {
+            reason = "Truncated FITS header";
+            return false;
+        }
+        headerBytes += kFITSBlock;
+        for (int i = 0; i < kFITSBlock; i += 80) {
+            const QByteArray card = block.mid(i, 80);
+            const QString key = QString::fromLatin1(card.left(8)).trimmed();
+            if (key == "END") {
+                ended = true;
+                break;
+            }
+            if (card.mid(8, 2) == "= ") {
+                QString value = QString::fromLatin1(card.mid(10));
+                int slash = value.indexOf('/');
+                if (slash >= 0) value.truncate(slash);
+                values.insert(key, value.trimmed());
+            }
+        }
+    }
+
+    const int bitpix = values.value("BITPIX").toInt();
+    const int naxis = values.value("NAXIS").toInt();
+    const int width = values.value("NAXIS1").toInt();
+    const int height = values.value("NAXIS2").toInt();
+    const int planes = naxis >= 3 ? values.value("NAXIS3").toInt() : 1;
+    if (naxis < 2 || width <= 0 || height <= 0 || planes <= 0) {
+        reason = "No image in the primary HDU";
+        return false;
+    }
+    if (bitpix != 8 && bitpix != 16 && bitpix != 32 && bitpix != 64 && bitpix != -32 && bitpix != -64) {
+        reason = QString("BITPIX %1").arg(bitpix);
+        return false;
+    }
+
+    bool ok = false;
+    const double bzero = values.value("BZERO").toDouble(&ok);
+    const double zero = ok ? bzero : 0.0;
+    const double bscale = values.value("BSCALE").toDouble(&ok);
+    const double scale = ok ? bscale : 1.0;
+    const bool hasBlank = values.contains("BLANK") && bitpix > 0;
+    const double blank = values.value("BLANK").toDouble();
+
+    auto load = [&](const uchar* p) -> double {
+        double stored;
+        switch (bitpix) {
+        case 8:   stored = p[0]; break;
+        case 16:  stored = loadBigEndian<qint16>(p); break;
+        case 32:  stored = loadBigEndian<qint32>(p); break;
+        case 64:  stored = loadBigEndian<qint64>(p); break;
+        case -32: stored = loadBigEndian<float>(p); break;
+        default:  stored = loadBigEndian<double>(p); break;
+        }
+        if (hasBlank && stored == blank) return std::numeric_limits<double>::quiet_NaN();
+        return zero + scale * stored;
+    };
+
+    const int channels = planes >= 3 ? 3 : 1;
+    const int k = reductionFactor(width, height, maxSize);
+    allocate(preview, width, height, channels, k);
+
+    const int bytes = std::abs(bitpix) / 8;
+    const qint64 rowBytes = qint64(width) * bytes;
+    if (headerBytes + rowBytes * height * channels > file.size()) {
+        reason = "Truncated FITS data unit";
+        return false;
+    }
+
+    QByteArray row(rowBytes, Qt::Uninitialized);
+    for (int c = 0; c < channels; ++c) {
+        for (int j = 0; j < preview.height; ++j) {
+            const qint64 offset = headerBytes + (qint64(c) * height + sourceRow(j, k, height)) * rowBytes;
+            if (!file.seek(offset) || file.read(row.data(), rowBytes) != rowBytes) {
+                reason = file.errorString();
+                return false;
+            }
+            reduceRow(reinterpret_cast<const uchar*>(row.constData()), width, bytes, k,
+                      preview.row(c, j), preview.width, load);
+        }
+    }
+    return true;
+}
+
+// Stripped TIFF: decode only the strips that hold sampled rows. Files
+// written as a single strip still decode in full, tiled files fall back.
+bool sampleTIFF(const QString& filePath, int maxSize, Preview& preview, QString& reason)
+{
+    TIFF* tiff = TIFFOpen(filePath.toLocal8Bit().constData(), "r");
+    if (!tiff) {
+        reason = "libtiff cannot open the file";
+        return false;
+    }
+
+    uint32_t width = 0, height = 0, rowsPerStrip = 0;
+    uint16_t samples = 1, bits = 8, format = SAMPLEFORMAT_UINT, planar = PLANARCONFIG_CONTIG;
+    TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
+    TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &samples);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &bits);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &format);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planar);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+
+    const bool integer = format == SAMPLEFORMAT_UINT && (bits == 8 || bits == 16 || bits == 32);
+    const bool real = format == SAMPLEFORMAT_IEEEFP && bits == 32;
+    if (TIFFIsTiled(tiff) || (planar == PLANARCONFIG_SEPARATE && samples > 1) ||
+        (!integer && !real) || width == 0 || height == 0 || width > 1000000 || height > 1000000) {
+        TIFFClose(tiff);
+        reason = "Layout not sampled by rows";
+        return false;
+    }
+    rowsPerStrip = std::max<uint32_t>(1, std::min(rowsPerStrip, height));
+
+    auto load = [&](const uchar* p) -> double {
+        if (real) return loadNative<float>(p);
+        if (bits == 8) return p[0];
+        if (bits == 16) return loadNative<quint16>(p);
+        return loadNative<quint32>(p);
+    };
+
+    const int channels = samples >= 3 ? 3 : 1;
+    const int k = reductionFactor(int(width), int(height), maxSize);
+    allocate(preview, int(width), int(height), channels, k);
+
+    const size_t bytes = bits / 8;
+    const size_t pixelStride = bytes * samples;
+    const tmsize_t scanline = TIFFScanlineSize(tiff);
+    std::vector<uchar> strip(size_t(std::max<tmsize_t>(TIFFStripSize(tiff), 0)));
+    int currentStrip = -1;
+
+    for (int j = 0; j < preview.height; ++j) {
+        const int y = sourceRow(j, k, int(height));
+        const int index = y / int(rowsPerStrip);
+        if (index != currentStrip) {
+            if (TIFFReadEncodedStrip(tiff, uint32_t(index), strip.data(), tmsize_t(strip.size())) < 0) {
+                TIFFClose(tiff);
+                reason = QString("Cannot decode strip %1").arg(index);
+                return false;
+            }
+            currentStrip = index;
+        }
+        const uchar* row = strip.data() + size_t(y - index * int(rowsPerStrip)) * scanline;
+        for (int c = 0; c < channels; ++c) {
+            reduceRow(row + c * bytes, int(width), pixelStride, k, preview.row(c, j), preview.width, load);
+        }
+    }
+
+    TIFFClose(tiff);
+    return true;
+}
+
+// Everything else: full decode through ImageReader, reduced the same way
+bool sampleFull(const QString& filePath, int maxSize, Preview& preview, QString& reason)
+{
+    ImageReader reader;
+    reader.setXISFChecksumPolicy(XISFChecksumPolicy::Skip);
+    if (!reader.readFile(filePath)) {
+        reason = reader.lastError();
+        return false;
+    }
+
+    const ImageData& image = reader.imageData();
+    const int channels = image.channels >= 3 ? 3 : 1;
+    const int k = reductionFactor(image.width, image.height, maxSize);
+    allocate(preview, image.width, image.height, channels, k);
+
+    for (int c = 0; c < channels; ++c) {
+        for (int j = 0; j < preview.height; ++j) {
+            const float* row = image.pixels.constData() +
+                               (size_t(c) * image.height + sourceRow(j, k, image.height)) * image.width;
+            reduceRow(reinterpret_cast<const uchar*>(row), image.width, sizeof(float), k,
+                      preview.row(c, j), preview.width, loadNative<float>);
+        }
+    }
+    return true;
+}
+
+inline double midtonesTransfer(double m, double x)
+{
+    if (x <= 0.0) return 0.0;
+    if (x >= 1.0) return 1.0;
+    return ((m - 1.0) * x) / ((2.0 * m - 1.0) * x - m);
+}
+
+// Per-channel screen stretch from median and MAD of the preview samples
+QImage stretch(const Preview& preview, const ThumbnailOptions& options)
+{
+    const size_t planeSize = size_t(preview.width) * preview.height;
+    std::vector<std::vector<quint8>> bytes(preview.channels, std::vector<quint8>(planeSize, 0));
+
+    for (int c = 0; c < preview.channels; ++c) {
+        const float* plane = preview.row(c, 0);
+        std::vector<float> values;
+        values.reserve(planeSize);
+        for (size_t i = 0; i < planeSize; ++i) {
+            if (std::isfinite(plane[i])) values.push_back(plane[i]);
+        }
+        if (values.empty()) continue;
+
+        auto [low, high] = std::minmax_element(values.begin(), values.end());
+        const double minimum = *low, maximum = *high;
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        const double median = values[values.size() / 2];
+        for (float& v : values) v = float(std::abs(v - median));
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        const double mad = 1.4826 * values[values.size() / 2];
+
+        const double shadows = std::clamp(median + options.shadowsClipping * mad, minimum, median);
+        const double range = maximum > shadows ? maximum - shadows : 1.0;
+        const double normalisedMedian = (median - shadows) / range;
+        const double midtones = normalisedMedian > 0.0
+                              ? midtonesTransfer(options.targetBackground, normalisedMedian) : 0.5;
+
+        quint8* out = bytes[c].data();
+        for (size_t i = 0; i < planeSize; ++i) {
+            if (!std::isfinite(plane[i])) continue;
+            double x = midtonesTransfer(midtones, (plane[i] - shadows) / range);
+            out[i] = quint8(std::lround(x * 255.0));
+        }
+    }
+
+    if (preview.channels == 1) {
+        QImage image(preview.width, preview.height, QImage::Format_Grayscale8);
+        for (int y = 0; y < preview.height; ++y) {
+            std::memcpy(image.scanLine(y), bytes[0].data() + size_t(y) * preview.width, preview.width);
+        }
+        return image;
+    }
+
+    QImage image(preview.width, preview.height, QImage::Format_RGB32);
+    for (int y = 0; y < preview.height; ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        const size_t offset = size_t(y) * preview.width;
+        for (int x = 0; x < preview.width; ++x) {
+            line[x] = qRgb(bytes[0][offset + x], bytes[1][offset + x], bytes[2][offset + x]);
+        }
+    }
+    return image;
+}
+
+bool saveImage(const QImage& image, const QString& path)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    return image.save(&file, "PNG") && file.commit();
+}
+
+} // namespace
+
+ThumbnailCache::ThumbnailCache(const QString& cacheDirectory, const ThumbnailOptions& options)
+    : m_cacheDirectory(cacheDirectory)
+    , m_options(options)
+{
+    QDir().mkpath(m_cacheDirectory);
+}
+
+QString ThumbnailCache::cacheFile(const QByteArray& quickHash) const
+{
+    // Every option that changes the rendered pixels is part of the name
+    return QDir(m_cacheDirectory).filePath(QString("%1-%2-c%3-t%4.png")
+                                           .arg(QString::fromLatin1(quickHash.toHex()))
+                                           .arg(m_options.maxSize)
+                                           .arg(m_options.shadowsClipping, 0, 'g', 6)
+                                           .arg(m_options.targetBackground, 0, 'g', 6));
+}
+
+bool ThumbnailCache::contains(const QString& filePath) const
+{
+    const QByteArray hash = FrameIndex::computeQuickHash(filePath);
+    return !hash.isEmpty() && QFileInfo::exists(cacheFile(hash));
+}
+
+QImage ThumbnailCache::render(const QString& filePath, const ThumbnailOptions& options, QString* error)
+{
+    const QString type = ImageReader::detectFileType(filePath);
+
+    Preview preview;
+    QString reason;
+    bool sampled = false;
+    if (type == "FITS") {
+        sampled = sampleFITS(filePath, options.maxSize, preview, reason);
+    } else if (type == "TIFF") {
+        sampled = sampleTIFF(filePath, options.maxSize, preview, reason);
+    }
+    if (!sampled && !sampleFull(filePath, options.maxSize, preview, reason)) {
+        if (error) *error = QString("%1: %2").arg(filePath, reason);
+        return QImage();
+    }
+
+    return stretch(preview, options);
+}
+
+QImage ThumbnailCache::thumbnail(const QString& filePath, QString* error) const
+{
+    const QByteArray hash = FrameIndex::computeQuickHash(filePath);
+    if (hash.isEmpty()) {
+        if (error) *error = QString("%1: cannot read file").arg(filePath);
+        return QImage();
+    }
+
+    const QString cached = cacheFile(hash);
+    QImage image;
+    if (QFileInfo::exists(cached) && image.load(cached, "PNG")) {
+        return image;
+    }
+
+    image = render(filePath, m_options, error);
+    if (!image.isNull() && !saveImage(image, cached)) {
+        qDebug() << "⚠️ Cannot write thumbnail cache entry:" << cached;
+    }
+    return image;
+}
+
+int ThumbnailCache::generate(const QStringList& files,
+                             ProgressCallback progress,
+                             const std::atomic<bool>* cancel,
+                             QStringList* errors) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const int total = files.size();
+    QVector<bool> available(total, false);
+    QVector<QString> failures(total);
+    std::atomic<int> done(0);
+    std::atomic<int> rendered(0);
+
+    // One file per work item, like the frame indexer
+    Parallel::forChunks(total, Parallel::chunkCount(total, 1), [&](int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (cancel && cancel->load()) return;
+
+            const QString& path = files[int(i)];
+            const QByteArray hash = FrameIndex::computeQuickHash(path);
+            if (hash.isEmpty()) {
+                failures[int(i)] = QString("%1: cannot read file").arg(path);
+            } else if (QFileInfo::exists(cacheFile(hash))) {
+                available[int(i)] = true;
+            } else {
+                QImage image = render(path, m_options, &failures[int(i)]);
+                available[int(i)] = !image.isNull() && saveImage(image, cacheFile(hash));
+                if (available[int(i)]) ++rendered;
+            }
+
+            int count = ++done;
+            if (progress) progress(count, total);
+        }
+    });
+
+    int count = 0;
+    for (int i = 0; i < total; ++i) {
+        if (available[i]) {
+            ++count;
+        } else if (errors && !failures[i].isEmpty()) {
+            errors->append(failures[i]);
+        }
+    }
+
+    qDebug() << QString("🖼️ Thumbnails: %1 of %2 available, %3 rendered in %4 ms")
+                .arg(count).arg(total).arg(rendered.load()).arg(timer.elapsed());
+    return count;
+}
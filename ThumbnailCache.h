@@ -0,0 +1,63 @@
+// ThumbnailCache.h - Stretched frame previews from strided partial reads
+#ifndef THUMBNAIL_CACHE_H
+#define THUMBNAIL_CACHE_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+
+struct ThumbnailOptions {
+    int maxSize = 256;                  // Longest side of the preview in pixels
+
+    // Auto-stretch: shadows clip at median + shadowsClipping * 1.4826 MAD,
+    // then a midtones transfer puts the median at targetBackground
+    double shadowsClipping = -2.8;
+    double targetBackground = 0.25;
+};
+
+// Small auto-stretched previews for browsing a night's frames. FITS primary
+// images and stripped TIFFs are sampled by reading only every k-th row (and
+// averaging k columns along it), so a preview costs a fraction of a full
+// decode; other files are decoded in full and reduced the same way.
+//
+// Previews are PNG files in a cache directory, named after the frame's
+// FrameIndex quick hash and the preview options so renamed or moved files
+// still hit the cache, while rewritten files or changed sizes and stretch
+// settings miss it.
+class ThumbnailCache
+{
+public:
+    using ProgressCallback = std::function<void(int done, int total)>;
+
+    explicit ThumbnailCache(const QString& cacheDirectory,
+                            const ThumbnailOptions& options = ThumbnailOptions());
+
+    // Cached preview, generated and stored on a miss
+    QImage thumbnail(const QString& filePath, QString* error = nullptr) const;
+
+    // Fill the cache for many files concurrently; returns how many previews
+    // are available afterwards
+    int generate(const QStringList& files,
+                 ProgressCallback progress = ProgressCallback(),
+                 const std::atomic<bool>* cancel = nullptr,
+                 QStringList* errors = nullptr) const;
+
+    bool contains(const QString& filePath) const;
+    QString cacheFile(const QByteArray& quickHash) const;
+
+    // Preview without touching the cache
+    static QImage render(const QString& filePath, const ThumbnailOptions& options,
+                         QString* error = nullptr);
+
+    const ThumbnailOptions& options() const { return m_options; }
+    QString cacheDirectory() const { return m_cacheDirectory; }
+
+private:
+    QString m_cacheDirectory;
+    ThumbnailOptions m_options;
+};
+
+#endif // THUMBNAIL_CACHE_H
@@ -0,0 +1,701 @@
+// TransientSearch.cpp - Difference-imaging search for transients and variables
+#include "TransientSearch.h"
+#include "GaiaGDR3Catalog.h"
+#include "ImagePlaneCache.h"
+#include "ParallelFor.h"
+#include "StarCatalogValidator.h"
+#include "StarGeometry.h"
+#include "StarMaskGenerator.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+// Triangle vertices ordered by the length of the opposite side, so that
+// matching triangles yield corresponding vertices.
+// side1 = |p0 p1| (opposite p2), side2 = |p1 p2| (opposite p0), side3 = |p2 p0| (opposite p1)
+void canonicalVertices(const TrianglePattern& t, int out[3])
+{
+    struct Vertex { int index; double opposite; };
+    Vertex v[3] = {
+        {t.starIndices[0], t.side2},
+        {t.starIndices[1], t.side3},
+        {t.starIndices[2], t.side1}
+    };
+    std::sort(v, v + 3, [](const Vertex& l, const Vertex& r) { return l.opposite < r.opposite; });
+    for (int i = 0; i < 3; ++i) out[i] = v[i].index;
+}
+
+// Least-squares similarity transform mapping p onto q
+FrameRegistration fitSimilarity(const QPointF* p, const QPointF* q, int n)
+{
+    FrameRegistration reg;
+    double mpx = 0, mpy = 0, mqx = 0, mqy = 0;
+    for (int i = 0; i < n; ++i) {
+        mpx += p[i].x(); mpy += p[i].y();
+        mqx += q[i].x(); mqy += q[i].y();
+    }
+    mpx /= n; mpy /= n; mqx /= n; mqy /= n;
+
+    double sumA = 0, sumB = 0, sumS = 0;
+    for (int i = 0; i < n; ++i) {
+        double px = p[i].x() - mpx, py = p[i].y() - mpy;
+        double qx = q[i].x() - mqx, qy = q[i].y() - mqy;
+        sumA += px * qx + py * qy;
+        sumB += px * qy - py * qx;
+        sumS += px * px + py * py;
+    }
+    if (sumS <= 0.0) return reg;
+
+    double a = sumA / sumS, b = sumB / sumS;
+    reg.a = a;  reg.b = -b; reg.c = mqx - (a * mpx - b * mpy);
+    reg.d = b;  reg.e = a;  reg.f = mqy - (b * mpx + a * mpy);
+    reg.isValid = true;
+    return reg;
+}
+
+// Least-squares affine registration over matched star pairs
+bool fitAffine(const QVector<QPointF>& src, const QVector<QPointF>& dst, FrameRegistration& reg)
+{
+    StarGeometry::AffineTransform transform;
+    if (!StarGeometry::fitAffine(src, dst, transform)) return false;
+
+    reg.a = transform.a; reg.b = transform.b; reg.c = transform.c;
+    reg.d = transform.d; reg.e = transform.e; reg.f = transform.f;
+    reg.isValid = true;
+    return true;
+}
+
+// Median of every step-th finite sample
+double sampledMedian(const QVector<float>& plane, int step = 16)
+{
+    QVector<float> samples;
+    samples.reserve(plane.size() / step + 1);
+    for (int i = 0; i < plane.size(); i += step) {
+        if (std::isfinite(plane[i])) samples.append(plane[i]);
+    }
+    if (samples.isEmpty()) return 0.0;
+    auto mid = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), mid, samples.end());
+    return *mid;
+}
+
+// Aperture sum around a position; returns false if the aperture touches
+// the image edge or undefined (NaN) pixels
+bool apertureSum(const QVector<float>& plane, int width, int height,
+                 const QPointF& center, double radius, double& sum, int& count)
+{
+    int r = static_cast<int>(std::ceil(radius));
+    int cx = qRound(center.x()), cy = qRound(center.y());
+    if (cx - r < 0 || cy - r < 0 || cx + r >= width || cy + r >= height) return false;
+
+    double radiusSq = radius * radius;
+    sum = 0.0;
+    count = 0;
+    for (int dy = -r; dy <= r; ++dy) {
+        const float* row = plane.constData() + size_t(cy + dy) * width;
+        for (int dx = -r; dx <= r; ++dx) {
+            if (dx * dx + dy * dy > radiusSq) continue;
+            float v = row[cx + dx];
+            if (!std::isfinite(v)) return false;
+            sum += v;
+            count++;
+        }
+    }
+    return count > 0;
+}
+
+} // namespace
+
+TransientSearch::TransientSearch(QObject* parent)
+    : QObject(parent)
+{
+}
+
+bool TransientSearch::setReference(const ImageData& reference)
+{
+    m_referencePlane.clear();
+    m_referenceStars.clear();
+    m_referencePSFSigma = 0.0;
+
+    if (!reference.isValid()) {
+        qDebug() << "Invalid reference frame for transient search";
+        return false;
+    }
+
+    QVector<float> plane = reference.derived()->luminance();
+    QVector<QPointF> stars = detectStarPositions(plane, reference.width, reference.height,
+                                                 m_params.detectionSensitivity);
+    if (stars.size() < 6) {
+        qDebug() << "Reference frame has too few stars for registration:" << stars.size();
+        return false;
+    }
+
+    m_referencePlane = plane;
+    m_width = reference.width;
+    m_height = reference.height;
+    m_referenceStars = stars;
+    m_referencePSFSigma = estimatePSFSigma(plane, m_width, m_height, stars);
+
+    qDebug() << "Transient search reference:" << m_width << "x" << m_height
+             << stars.size() << "stars, PSF sigma" << m_referencePSFSigma;
+    return true;
+}
+
+QVector<QPointF> TransientSearch::detectStarPositions(const QVector<float>& plane, int width, int height,
+                                                     float sensitivity, QVector<float>* fluxes)
+{
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.channels = 1;
+    image.pixels = plane;
+    image.colorSpace = "Gray";
+
+    StarMaskResult detection = StarMaskGenerator::detectStarsAdvanced(
+        image, sensitivity, 5, 1, 0.5f, 0.8f, false);
+
+    // Brightest first
+    QVector<int> order(detection.starCenters.size());
+    for (int i = 0; i < order.size(); ++i) order[i] = i;
+    if (detection.starFluxes.size() == order.size()) {
+        std::stable_sort(order.begin(), order.end(), [&](int l, int r) {
+            return detection.starFluxes[l] > detection.starFluxes[r];
+        });
+    }
+
+    QVector<QPointF> positions;
+    positions.reserve(order.size());
+    if (fluxes) fluxes->clear();
+    for (int i : order) {
+        positions.append(QPointF(detection.starCenters[i]));
+        if (fluxes) {
+            fluxes->append(i < detection.starFluxes.size() ? detection.starFluxes[i] : 0.0f);
+        }
+    }
+    return positions;
+}
+
+double TransientSearch::estimatePSFSigma(const QVector<float>& plane, int width, int height,
+                                         const QVector<QPointF>& stars)
+{
+    const int half = 6;
+    const int maxStars = 30;
+    QVector<double> sigmas;
+
+    for (int s = 0; s < stars.size() && sigmas.size() < maxStars; ++s) {
+        int cx = qRound(stars[s].x()), cy = qRound(stars[s].y());
+        if (cx - half < 0 || cy - half < 0 || cx + half >= width || cy + half >= height) continue;
+
+        // Local background from the window border
+        QVector<float> border;
+        bool finite = true;
+        for (int d = -half; d <= half && finite; ++d) {
+            float edge[4] = {
+                plane[size_t(cy - half) * width + cx + d], plane[size_t(cy + half) * width + cx + d],
+                plane[size_t(cy + d) * width + cx - half], plane[size_t(cy + d) * width + cx + half]
+            };
+            for (float v : edge) {
+                if (!std::isfinite(v)) finite = false;
+                border.append(v);
+            }
+        }
+        if (!finite) continue;
+        std::nth_element(border.begin(), border.begin() + border.size() / 2, border.end());
+        double background = border[border.size() / 2];
+
+        double sum = 0, sx = 0, sy = 0, sxx = 0, syy = 0;
+        for (int dy = -half + 1; dy < half; ++dy) {
+            for (int dx = -half + 1; dx < half; ++dx) {
+                double w = plane[size_t(cy + dy) * width + cx + dx] - background;
+                if (!(w > 0.0)) continue;
+                sum += w;
+                sx += w * dx;  sy += w * dy;
+                sxx += w * dx * dx;  syy += w * dy * dy;
+            }
+        }
+        if (sum <= 0.0) continue;
+
+        double mx = sx / sum, my = sy / sum;
+        double variance = 0.5 * ((sxx / sum - mx * mx) + (syy / sum - my * my));
+        if (variance > 0.0) sigmas.append(std::sqrt(variance));
+    }
+
+    if (sigmas.isEmpty()) return 0.0;
+    std::nth_element(sigmas.begin(), sigmas.begin() + sigmas.size() / 2, sigmas.end());
+    return sigmas[sigmas.size() / 2];
+}
+
+FrameRegistration TransientSearch::registerFrame(const QVector<QPointF>& frameStars) const
+{
+    FrameRegistration best;
+    if (m_referenceStars.size() < 3 || frameStars.size() < 3) return best;
+
+    // Triangle hypotheses from the brightest stars of each list
+    int patternStars = std::min(m_params.registrationStars, 20);
+    auto toPoints = [patternStars](const QVector<QPointF>& stars) {
+        QVector<QPoint> points;
+        for (int i = 0; i < std::min(patternStars, int(stars.size())); ++i) {
+            points.append(stars[i].toPoint());
+        }
+        return points;
+    };
+
+    StarMatchingParameters matchParams;
+    matchParams.triangleTolerancePercent = 1.0;
+    EnhancedStarMatcher matcher(matchParams);
+    QVector<TrianglePattern> refTriangles = matcher.generateTrianglePatterns(toPoints(m_referenceStars), true);
+    QVector<TrianglePattern> frameTriangles = matcher.generateTrianglePatterns(toPoints(frameStars), true);
+    auto triangleMatches = matcher.matchTrianglePatterns(refTriangles, frameTriangles).first;
+
+    const int maxHypotheses = 5000;
+    QVector<FrameRegistration> hypotheses;
+    for (const auto& pair : triangleMatches) {
+        if (hypotheses.size() >= maxHypotheses) break;
+
+        int refIdx[3], frameIdx[3];
+        canonicalVertices(refTriangles[pair.first], refIdx);
+        canonicalVertices(frameTriangles[pair.second], frameIdx);
+
+        QPointF p[3], q[3];
+        for (int k = 0; k < 3; ++k) {
+            p[k] = m_referenceStars[refIdx[k]];
+            q[k] = frameStars[frameIdx[k]];
+        }
+
+        FrameRegistration h = fitSimilarity(p, q, 3);
+        double scale = std::hypot(h.a, h.d);
+        if (h.isValid && scale > 0.8 && scale < 1.25) hypotheses.append(h);
+    }
+
+    if (hypotheses.isEmpty()) {
+        qDebug() << "Registration: no consistent triangle matches";
+        return best;
+    }
+
+    // Score each hypothesis by how many bright reference stars land on a frame star
+    int scoreStars = std::min(60, int(m_referenceStars.size()));
+    StarGeometry::PointGrid frameGrid(frameStars, 8.0);
+    double tolerance = 2.0 * m_params.matchTolerance;
+    QVector<int> scores(hypotheses.size(), 0);
+
+    Parallel::forRange(hypotheses.size(), [&](size_t begin, size_t end) {
+        for (size_t h = begin; h < end; ++h) {
+            int score = 0;
+            for (int i = 0; i < scoreStars; ++i) {
+                QPointF mapped = hypotheses[h].map(m_referenceStars[i].x(), m_referenceStars[i].y());
+                if (frameGrid.nearest(mapped, tolerance) >= 0) score++;
+            }
+            scores[h] = score;
+        }
+    }, 64);
+
+    int bestIndex = std::max_element(scores.begin(), scores.end()) - scores.begin();
+    if (scores[bestIndex] < 6) {
+        qDebug() << "Registration: best hypothesis only matched" << scores[bestIndex] << "stars";
+        return best;
+    }
+    best = hypotheses[bestIndex];
+
+    // Refine with an affine fit over all nearest-neighbour pairs
+    for (int iteration = 0; iteration < 3; ++iteration) {
+        QVector<QPointF> src, dst;
+        for (const QPointF& star : m_referenceStars) {
+            int j = frameGrid.nearest(best.map(star.x(), star.y()), tolerance);
+            if (j >= 0) {
+                src.append(star);
+                dst.append(frameStars[j]);
+            }
+        }
+
+        FrameRegistration refined = best;
+        if (src.size() < 6 || !fitAffine(src, dst, refined)) break;
+
+        double sumSq = 0.0;
+        for (int i = 0; i < src.size(); ++i) {
+            QPointF r = refined.map(src[i].x(), src[i].y()) - dst[i];
+            sumSq += r.x() * r.x() + r.y() * r.y();
+        }
+        refined.matchedStars = src.size();
+        refined.rmsResidual = std::sqrt(sumSq / src.size());
+        best = refined;
+        tolerance = m_params.matchTolerance;
+    }
+
+    best.isValid = best.matchedStars >= 6;
+    qDebug() << "Registration:" << best.matchedStars << "stars, rms" << best.rmsResidual << "px";
+    return best;
+}
+
+QVector<float> TransientSearch::resample(const QVector<float>& plane, int width, int height,
+                                         const FrameRegistration& registration,
+                                         int outputWidth, int outputHeight)
+{
+    QVector<float> output(size_t(outputWidth) * outputHeight);
+    const float* src = plane.constData();
+    float* dst = output.data();
+
+    // Bilinear; pixels mapping outside the frame become NaN
+    Parallel::forRange(outputHeight, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            float* row = dst + y * outputWidth;
+            for (int x = 0; x < outputWidth; ++x) {
+                QPointF p = registration.map(x, double(y));
+                int x0 = static_cast<int>(std::floor(p.x()));
+                int y0 = static_cast<int>(std::floor(p.y()));
+                if (x0 < 0 || y0 < 0 || x0 + 1 >= width || y0 + 1 >= height) {
+                    row[x] = kNaN;
+                    continue;
+                }
+                float fx = float(p.x() - x0), fy = float(p.y() - y0);
+                const float* s0 = src + size_t(y0) * width + x0;
+                const float* s1 = s0 + width;
+                row[x] = (s0[0] * (1 - fx) + s0[1] * fx) * (1 - fy) +
+                         (s1[0] * (1 - fx) + s1[1] * fx) * fy;
+            }
+        }
+    }, 16);
+
+    return output;
+}
+
+QVector<float> TransientSearch::gaussianConvolve(const QVector<float>& plane, int width, int height,
+                                                 double sigma)
+{
+    if (sigma < 0.05) return plane;
+
+    int radius = static_cast<int>(std::ceil(3.0 * sigma));
+    QVector<float> kernel(2 * radius + 1);
+    for (int k = -radius; k <= radius; ++k) {
+        kernel[k + radius] = float(std::exp(-0.5 * k * k / (sigma * sigma)));
+    }
+
+    // Separable passes over row bands. NaN taps are skipped and the remaining
+    // weights renormalised, so undefined borders do not spread.
+    QVector<float> horizontal(plane.size());
+    const float* src = plane.constData();
+    float* tmp = horizontal.data();
+
+    Parallel::forRange(height, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            const float* in = src + y * width;
+            float* out = tmp + y * width;
+            for (int x = 0; x < width; ++x) {
+                float sum = 0.0f, weight = 0.0f;
+                int k0 = std::max(-radius, -x), k1 = std::min(radius, width - 1 - x);
+                for (int k = k0; k <= k1; ++k) {
+                    float v = in[x + k];
+                    bool ok = std::isfinite(v);
+                    sum += ok ? kernel[k + radius] * v : 0.0f;
+                    weight += ok ? kernel[k + radius] : 0.0f;
+                }
+                out[x] = weight > 0.0f ? sum / weight : kNaN;
+            }
+        }
+    }, 16);
+
+    QVector<float> output(plane.size());
+    float* dst = output.data();
+
+    Parallel::forRange(height, [&](size_t begin, size_t end) {
+        QVector<float> sum(width), weight(width);
+        for (size_t y = begin; y < end; ++y) {
+            std::fill(sum.begin(), sum.end(), 0.0f);
+            std::fill(weight.begin(), weight.end(), 0.0f);
+            int k0 = std::max(-radius, -int(y)), k1 = std::min(radius, height - 1 - int(y));
+            for (int k = k0; k <= k1; ++k) {
+                const float* in = tmp + (y + k) * width;
+                float w = kernel[k + radius];
+                float* s = sum.data();
+                float* ws = weight.data();
+                for (int x = 0; x < width; ++x) {
+                    bool ok = std::isfinite(in[x]);
+                    s[x] += ok ? w * in[x] : 0.0f;
+                    ws[x] += ok ? w : 0.0f;
+                }
+            }
+            float* out = dst + y * width;
+            for (int x = 0; x < width; ++x) {
+                out[x] = weight[x] > 0.0f ? sum[x] / weight[x] : kNaN;
+            }
+        }
+    }, 16);
+
+    return output;
+}
+
+TransientFrameResult TransientSearch::processFrame(const ImageData& frame)
+{
+    TransientFrameResult result;
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!hasReference()) {
+        result.error = "No reference frame set";
+        return result;
+    }
+    if (!frame.isValid()) {
+        result.error = "Invalid frame";
+        return result;
+    }
+
+    // Register
+    QVector<float> framePlane = frame.derived()->luminance();
+    QVector<QPointF> frameStars = detectStarPositions(framePlane, frame.width, frame.height,
+                                                      m_params.detectionSensitivity);
+    if (frameStars.size() < 6) {
+        result.error = QString("Too few stars for registration (%1)").arg(frameStars.size());
+        return result;
+    }
+
+    result.registration = registerFrame(frameStars);
+    if (!result.registration.isValid) {
+        result.error = "Registration to the reference failed";
+        return result;
+    }
+
+    QVector<float> aligned = resample(framePlane, frame.width, frame.height,
+                                      result.registration, m_width, m_height);
+    QVector<float> reference = m_referencePlane;
+
+    // PSF match: blur whichever image is sharper up to the other's width
+    result.psfSigmaReference = m_referencePSFSigma;
+    result.psfSigmaFrame = estimatePSFSigma(aligned, m_width, m_height, m_referenceStars);
+    double kernelSq = result.psfSigmaFrame * result.psfSigmaFrame -
+                      result.psfSigmaReference * result.psfSigmaReference;
+    result.kernelSigma = std::sqrt(std::abs(kernelSq));
+    if (result.psfSigmaFrame > 0.0 && result.psfSigmaReference > 0.0) {
+        if (kernelSq > 0.0) {
+            reference = gaussianConvolve(reference, m_width, m_height, result.kernelSigma);
+            result.convolvedReference = true;
+        } else if (kernelSq < 0.0) {
+            aligned = gaussianConvolve(aligned, m_width, m_height, result.kernelSigma);
+        }
+    }
+
+    // Photometric scale from the reference stars, background offset from the medians
+    double referenceBackground = sampledMedian(reference);
+    double frameBackground = sampledMedian(aligned);
+    QVector<double> ratios;
+    for (int i = 0; i < std::min(50, int(m_referenceStars.size())); ++i) {
+        double refSum, frameSum;
+        int refCount, frameCount;
+        if (!apertureSum(reference, m_width, m_height, m_referenceStars[i], m_params.apertureRadius, refSum, refCount) ||
+            !apertureSum(aligned, m_width, m_height, m_referenceStars[i], m_params.apertureRadius, frameSum, frameCount)) {
+            continue;
+        }
+        double refFlux = refSum - refCount * referenceBackground;
+        double frameFlux = frameSum - frameCount * frameBackground;
+        if (refFlux > 0.0 && frameFlux > 0.0) ratios.append(frameFlux / refFlux);
+    }
+    if (ratios.size() >= 3) {
+        std::nth_element(ratios.begin(), ratios.begin() + ratios.size() / 2, ratios.end());
+        result.photometricScale = ratios[ratios.size() / 2];
+    }
+    result.backgroundOffset = frameBackground - result.photometricScale * referenceBackground;
+
+    // Subtract
+    QVector<float> difference(aligned.size());
+    {
+        const float* a = aligned.constData();
+        const float* r = reference.constData();
+        float* d = difference.data();
+        float scale = float(result.photometricScale);
+        float offset = float(result.backgroundOffset);
+        Parallel::forRange(difference.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                d[i] = a[i] - scale * r[i] - offset;
+            }
+        });
+    }
+
+    // Robust noise per tile
+    int tile = std::max(32, m_params.tileSize);
+    int tilesX = (m_width + tile - 1) / tile;
+    int tilesY = (m_height + tile - 1) / tile;
+    QVector<float> tileSigma(tilesX * tilesY, kNaN);
+
+    Parallel::forRange(tileSigma.size(), [&](size_t begin, size_t end) {
+        QVector<float> values;
+        for (size_t t = begin; t < end; ++t) {
+            int tx = int(t) % tilesX, ty = int(t) / tilesX;
+            int x0 = tx * tile, y0 = ty * tile;
+            int x1 = std::min(x0 + tile, m_width), y1 = std::min(y0 + tile, m_height);
+
+            values.clear();
+            for (int y = y0; y < y1; ++y) {
+                const float* row = difference.constData() + size_t(y) * m_width;
+                for (int x = x0; x < x1; ++x) {
+                    if (std::isfinite(row[x])) values.append(row[x]);
+                }
+            }
+            if (values.size() < 50) continue;
+
+            auto mid = values.begin() + values.size() / 2;
+            std::nth_element(values.begin(), mid, values.end());
+            float median = *mid;
+            for (float& v : values) v = std::abs(v - median);
+            std::nth_element(values.begin(), mid, values.end());
+            tileSigma[t] = 1.4826f * *mid;
+        }
+    }, 1);
+
+    QVector<float> validSigmas;
+    for (float s : tileSigma) {
+        if (std::isfinite(s) && s > 0.0f) validSigmas.append(s);
+    }
+    if (validSigmas.isEmpty()) {
+        result.error = "Difference image has no usable area";
+        return result;
+    }
+    std::nth_element(validSigmas.begin(), validSigmas.begin() + validSigmas.size() / 2, validSigmas.end());
+    result.differenceNoise = validSigmas[validSigmas.size() / 2];
+    for (float& s : tileSigma) {
+        if (!(std::isfinite(s) && s > 0.0f)) s = float(result.differenceNoise);
+    }
+
+    // Detect and cross-match
+    result.candidates = detectResiduals(difference, reference, tileSigma, tilesX);
+    crossMatchCandidates(result.candidates);
+
+    if (m_params.keepDifferenceImage) {
+        m_lastDifference.clear();
+        m_lastDifference.width = m_width;
+        m_lastDifference.height = m_height;
+        m_lastDifference.channels = 1;
+        m_lastDifference.pixels = difference;
+        m_lastDifference.colorSpace = "Gray";
+        m_lastDifference.format = "Difference";
+    }
+
+    result.isValid = true;
+    qDebug() << "Transient search:" << result.candidates.size() << "candidates,"
+             << "kernel sigma" << result.kernelSigma
+             << "scale" << result.photometricScale
+             << "noise" << result.differenceNoise
+             << "in" << timer.elapsed() << "ms";
+    return result;
+}
+
+QVector<TransientCandidate> TransientSearch::detectResiduals(const QVector<float>& difference,
+                                                            const QVector<float>& reference,
+                                                            const QVector<float>& tileSigma,
+                                                            int tilesX) const
+{
+    QVector<TransientCandidate> candidates;
+    int tile = std::max(32, m_params.tileSize);
+    double referenceBackground = sampledMedian(reference);
+
+    // The star detector expects [0,1] data with sources brighter than the
+    // background, so each sign is mapped to a significance image on a pedestal
+    for (int sign : {1, -1}) {
+        QVector<float> significance(difference.size());
+        float* out = significance.data();
+        Parallel::forRange(m_height, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; ++y) {
+                const float* row = difference.constData() + y * m_width;
+                const float* sigmaRow = tileSigma.constData() + (y / tile) * tilesX;
+                for (int x = 0; x < m_width; ++x) {
+                    float s = sign * row[x] / sigmaRow[x / tile];
+                    float v = 0.1f + s / 100.0f;
+                    out[y * m_width + x] = std::isfinite(v) ? std::clamp(v, 0.0f, 1.0f) : 0.1f;
+                }
+            }
+        }, 16);
+
+        QVector<QPointF> detections = detectStarPositions(significance, m_width, m_height,
+                                                          m_params.detectionSensitivity);
+
+        for (const QPointF& p : detections) {
+            double sum, refSum;
+            int count, refCount;
+            if (!apertureSum(difference, m_width, m_height, p, m_params.apertureRadius, sum, count)) continue;
+
+            int tx = qRound(p.x()) / tile, ty = qRound(p.y()) / tile;
+            double sigma = tileSigma[ty * tilesX + tx];
+            double snr = sum / (sigma * std::sqrt(double(count)));
+            if (sign * snr < m_params.detectionSigma) continue;
+
+            TransientCandidate candidate;
+            candidate.position = p;
+            candidate.flux = sum;
+            candidate.significance = snr;
+            if (apertureSum(reference, m_width, m_height, p, m_params.apertureRadius, refSum, refCount)) {
+                candidate.referenceFlux = refSum - refCount * referenceBackground;
+            }
+            candidates.append(candidate);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const TransientCandidate& l, const TransientCandidate& r) {
+        return std::abs(l.significance) > std::abs(r.significance);
+    });
+    return candidates;
+}
+
+void TransientSearch::crossMatchCandidates(QVector<TransientCandidate>& candidates) const
+{
+    if (!m_referenceWCS || !m_referenceWCS->hasValidWCS()) return;
+
+    bool haveGaia = GaiaGDR3Catalog::isAvailable();
+    double radiusDegrees = m_params.gaiaMatchRadius / 3600.0;
+
+    for (TransientCandidate& candidate : candidates) {
+        QPointF sky = m_referenceWCS->pixelToSky(candidate.position.x(), candidate.position.y());
+        if (sky.x() < 0) continue;
+
+        candidate.hasSkyPosition = true;
+        candidate.ra = sky.x();
+        candidate.dec = sky.y();
+        if (!haveGaia) continue;
+
+        auto stars = GaiaGDR3Catalog::queryRegion(candidate.ra, candidate.dec, radiusDegrees,
+                                                  m_params.gaiaMaxMagnitude);
+        double cosDec = std::cos(qDegreesToRadians(candidate.dec));
+        for (const auto& star : stars) {
+            double dRA = (star.ra - candidate.ra) * cosDec;
+            double dDec = star.dec - candidate.dec;
+            double separation = std::sqrt(dRA * dRA + dDec * dDec) * 3600.0;
+            if (!candidate.hasGaiaMatch || separation < candidate.gaiaSeparation) {
+                candidate.hasGaiaMatch = true;
+                candidate.gaiaId = star.sourceId;
+                candidate.gaiaMagnitude = star.magnitude;
+                candidate.gaiaSeparation = separation;
+            }
+        }
+    }
+}
+
+QVector<TransientFrameResult> TransientSearch::processFrames(const QStringList& filePaths)
+{
+    QVector<TransientFrameResult> results;
+    results.reserve(filePaths.size());
+
+    for (int i = 0; i < filePaths.size(); ++i) {
+        TransientFrameResult result;
+        ImageReader reader;
+        if (reader.readFile(filePaths[i])) {
+            result = processFrame(reader.imageData());
+        } else {
+            result.error = reader.lastError();
+        }
+        result.filePath = filePaths[i];
+
+        if (!result.isValid) {
+            qDebug() << "Transient search skipped" << filePaths[i] << ":" << result.error;
+        }
+
+        results.append(result);
+        emit frameProcessed(i + 1, filePaths.size(), result.candidates.size());
+    }
+
+    return results;
+}
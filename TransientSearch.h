@@ -0,0 +1,135 @@
+// TransientSearch.h - Difference-imaging search for transients and variables
+#ifndef TRANSIENT_SEARCH_H
+#define TRANSIENT_SEARCH_H
+
+#include <QObject>
+#include <QPointF>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "ImageReader.h"
+
+class StarCatalogValidator;
+
+// Affine map from reference pixels to frame pixels:
+//   x' = a*x + b*y + c,  y' = d*x + e*y + f
+struct FrameRegistration {
+    bool isValid = false;
+    double a = 1.0, b = 0.0, c = 0.0;
+    double d = 0.0, e = 1.0, f = 0.0;
+    int matchedStars = 0;
+    double rmsResidual = 0.0;       // pixels
+
+    QPointF map(double x, double y) const { return QPointF(a * x + b * y + c, d * x + e * y + f); }
+};
+
+// A significant residual in the difference image
+struct TransientCandidate {
+    QPointF position;               // Reference-frame pixel
+    double flux = 0.0;              // Residual aperture flux (frame - reference)
+    double significance = 0.0;      // Residual S/N (negative for fading sources)
+    double referenceFlux = 0.0;     // Aperture flux at the same position in the reference
+
+    bool hasSkyPosition = false;
+    double ra = 0.0;                // degrees
+    double dec = 0.0;               // degrees
+
+    bool hasGaiaMatch = false;
+    QString gaiaId;
+    double gaiaMagnitude = 0.0;
+    double gaiaSeparation = 0.0;    // arcsec
+};
+
+struct TransientFrameResult {
+    QString filePath;
+    bool isValid = false;
+    QString error;
+
+    FrameRegistration registration;
+    double psfSigmaReference = 0.0; // pixels
+    double psfSigmaFrame = 0.0;     // pixels
+    double kernelSigma = 0.0;       // Gaussian applied to the sharper image
+    bool convolvedReference = false;
+    double photometricScale = 1.0;  // frame / reference flux ratio
+    double backgroundOffset = 0.0;
+    double differenceNoise = 0.0;   // Median of the per-tile robust sigmas
+
+    QVector<TransientCandidate> candidates;
+};
+
+struct TransientSearchParameters {
+    int registrationStars = 20;         // Brightest stars used for triangle matching
+    double matchTolerance = 2.0;        // pixels, for registration refinement
+    float detectionSensitivity = 0.5f;  // StarDetector sensitivity (stars and residuals)
+    double detectionSigma = 5.0;        // Minimum residual significance
+    double apertureRadius = 4.0;        // pixels
+    int tileSize = 256;                 // Noise estimation tile (pixels)
+    double gaiaMatchRadius = 3.0;       // arcsec
+    double gaiaMaxMagnitude = 21.0;
+    bool keepDifferenceImage = false;
+};
+
+// Registers frames to a reference with the triangle star matcher, matches
+// the PSFs with a Gaussian kernel, subtracts, and runs the regular star
+// detector on the residuals. Resampling, convolution and noise estimation
+// are tiled across the thread pool.
+class TransientSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TransientSearch(QObject* parent = nullptr);
+
+    void setParameters(const TransientSearchParameters& params) { m_params = params; }
+    TransientSearchParameters getParameters() const { return m_params; }
+
+    // Reference frame; stars are detected and the PSF measured once here
+    bool setReference(const ImageData& reference);
+    bool hasReference() const { return !m_referencePlane.isEmpty(); }
+
+    // Optional WCS of the reference, used for sky positions and the Gaia cross-match
+    void setReferenceWCS(const StarCatalogValidator* validator) { m_referenceWCS = validator; }
+
+    TransientFrameResult processFrame(const ImageData& frame);
+    QVector<TransientFrameResult> processFrames(const QStringList& filePaths);
+
+    // Last difference image (reference geometry), if keepDifferenceImage is set
+    const ImageData& lastDifferenceImage() const { return m_lastDifference; }
+
+    // Stages
+    static QVector<QPointF> detectStarPositions(const QVector<float>& plane, int width, int height,
+                                                float sensitivity, QVector<float>* fluxes = nullptr);
+    static double estimatePSFSigma(const QVector<float>& plane, int width, int height,
+                                   const QVector<QPointF>& stars);
+    static QVector<float> resample(const QVector<float>& plane, int width, int height,
+                                   const FrameRegistration& registration,
+                                   int outputWidth, int outputHeight);
+    static QVector<float> gaussianConvolve(const QVector<float>& plane, int width, int height,
+                                           double sigma);
+
+    FrameRegistration registerFrame(const QVector<QPointF>& frameStars) const;
+
+signals:
+    void frameProcessed(int index, int total, int candidates);
+
+private:
+    QVector<TransientCandidate> detectResiduals(const QVector<float>& difference,
+                                                const QVector<float>& reference,
+                                                const QVector<float>& tileSigma,
+                                                int tilesX) const;
+    void crossMatchCandidates(QVector<TransientCandidate>& candidates) const;
+
+    TransientSearchParameters m_params;
+    const StarCatalogValidator* m_referenceWCS = nullptr;
+
+    QVector<float> m_referencePlane;
+    int m_width = 0;
+    int m_height = 0;
+    QVector<QPointF> m_referenceStars;  // Brightest first
+    double m_referencePSFSigma = 0.0;
+
+    ImageData m_lastDifference;
+};
+
+#endif // TRANSIENT_SEARCH_H
@@ -9,6 +9,7 @@
 #include <QDebug>
 #include <pcl/AstrometricMetadata.h>
 #include "StarCatalogValidator.h"
+#include "WCSRoundTripGrid.h"
 
 struct TestVector {
     // Input coordinates
@@ -64,6 +65,17 @@ public:
     void runKnownStarTests();
     void runSystematicGridTests();
     
+    // Dense pixel->sky->pixel check over the whole image (PCL metadata if
+    // set, otherwise the validator's solution)
+    WCSRoundTripReport runDenseRoundTripTest(const WCSRoundTripOptions& options = WCSRoundTripOptions())
+    {
+        const pcl::AstrometricMetadata& astrometry =
+            m_hasPCLMetadata || !m_validator ? m_pclMetadata : m_validator->astrometricMetadata();
+        WCSRoundTripReport report = WCSRoundTripGrid::evaluate(astrometry, options);
+        qDebug() << (report.passed() ? "✅" : "⚠️") << "Dense round-trip:" << report.summary();
+        return report;
+    }
+    
     // Specific problem diagnosis
     void diagnoseScaleProblems();
     void diagnoseRotationProblems(); 
@@ -0,0 +1,166 @@
+// WCSRoundTripGrid.cpp - Dense pixel->sky->pixel round-trip diagnostics for a WCS
+#include "WCSRoundTripGrid.h"
+#include "ParallelFor.h"
+
+#include <QColor>
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+struct ChunkStats {
+    qint64 points = 0;
+    qint64 failures = 0;
+    qint64 outOfTolerance = 0;
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    double maxError = 0.0;
+    QPointF worstPixel;
+    QVector<QPointF> failurePositions;
+};
+
+} // namespace
+
+WCSRoundTripReport WCSRoundTripGrid::evaluate(const pcl::AstrometricMetadata& astrometry,
+                                              const WCSRoundTripOptions& options)
+{
+    WCSRoundTripReport report;
+    if (!astrometry.IsValid() || astrometry.Width() <= 0 || astrometry.Height() <= 0) {
+        return report;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    report.width = astrometry.Width();
+    report.height = astrometry.Height();
+    report.step = options.step > 0
+        ? options.step
+        : std::max(1, int(std::ceil(std::sqrt(double(report.width) * report.height /
+                                              std::max<qint64>(1, options.maxPoints)))));
+    report.columns = (report.width + report.step - 1) / report.step;
+    report.rows = (report.height + report.step - 1) / report.step;
+    report.errorMap.resize(report.columns * report.rows);
+
+    const int chunks = Parallel::chunkCount(report.rows, 1);
+    QVector<ChunkStats> stats(chunks);
+
+    Parallel::forChunks(report.rows, chunks, [&](int c, size_t begin, size_t end) {
+        // The solution may cache state while transforming; keep one per worker
+        const pcl::AstrometricMetadata local(astrometry);
+        ChunkStats& s = stats[c];
+
+        for (size_t r = begin; r < end; ++r) {
+            float* errors = report.errorMap.data() + r * report.columns;
+            const double y = double(r) * report.step;
+
+            for (int col = 0; col < report.columns; ++col) {
+                const pcl::DPoint pixel(double(col) * report.step, y);
+                pcl::DPoint sky, back;
+                bool ok = false;
+                try {
+                    ok = local.ImageToCelestial(sky, pixel) && local.CelestialToImage(back, sky);
+                } catch (const pcl::Error&) {
+                    ok = false;
+                }
+
+                const double error = ok ? std::hypot(back.x - pixel.x, back.y - pixel.y)
+                                        : std::numeric_limits<double>::quiet_NaN();
+                ++s.points;
+                if (!std::isfinite(error)) {
+                    errors[col] = std::numeric_limits<float>::quiet_NaN();
+                    ++s.failures;
+                    if (s.failurePositions.size() < options.maxReportedFailures) {
+                        s.failurePositions.append(QPointF(pixel.x, pixel.y));
+                    }
+                    continue;
+                }
+
+                errors[col] = float(error);
+                s.sum += error;
+                s.sumSquares += error * error;
+                if (error > options.tolerance) ++s.outOfTolerance;
+                if (error > s.maxError) {
+                    s.maxError = error;
+                    s.worstPixel = QPointF(pixel.x, pixel.y);
+                }
+            }
+        }
+    });
+
+    double sum = 0.0, sumSquares = 0.0;
+    for (const ChunkStats& s : stats) {
+        report.points += s.points;
+        report.failures += s.failures;
+        report.outOfTolerance += s.outOfTolerance;
+        sum += s.sum;
+        sumSquares += s.sumSquares;
+        if (s.maxError > report.maxError) {
+            report.maxError = s.maxError;
+            report.worstPixel = s.worstPixel;
+        }
+        for (const QPointF& p : s.failurePositions) {
+            if (report.failurePositions.size() >= options.maxReportedFailures) break;
+            report.failurePositions.append(p);
+        }
+    }
+
+    const qint64 converged = report.points - report.failures;
+    if (converged > 0) {
+        report.meanError = sum / converged;
+        report.rmsError = std::sqrt(sumSquares / converged);
+    }
+    report.maxErrorArcsec = report.maxError * astrometry.Resolution() * 3600.0;
+    report.elapsedMs = timer.nsecsElapsed() / 1.0e6;
+    return report;
+}
+
+QImage WCSRoundTripReport::heatmap(double tolerance, double scale) const
+{
+    if (!isValid()) return QImage();
+
+    const double top = std::max(scale > 0.0 ? scale : maxError, tolerance);
+    const double bottom = std::max(tolerance / 10.0, 1e-9);
+    const double logBottom = std::log(bottom);
+    const double logRange = std::max(1e-9, std::log(std::max(top, bottom * 10.0)) - logBottom);
+
+    // 256-entry blue -> red palette on the log error scale
+    QVector<QRgb> palette(256);
+    for (int i = 0; i < 256; ++i) {
+        palette[i] = QColor::fromHsvF((1.0 - i / 255.0) * (240.0 / 360.0), 1.0, 1.0).rgb();
+    }
+    const QRgb failed = qRgb(255, 0, 255);
+
+    QImage image(columns, rows, QImage::Format_RGB32);
+    Parallel::forRange(rows, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(int(r)));
+            const float* errors = errorMap.constData() + r * columns;
+            for (int c = 0; c < columns; ++c) {
+                const float e = errors[c];
+                if (!std::isfinite(e)) {
+                    line[c] = failed;
+                    continue;
+                }
+                const double t = (std::log(std::max(double(e), bottom)) - logBottom) / logRange;
+                line[c] = palette[std::clamp(int(t * 255.0 + 0.5), 0, 255)];
+            }
+        }
+    }, 64);
+    return image;
+}
+
+QString WCSRoundTripReport::summary() const
+{
+    if (!isValid()) return "No valid astrometric solution";
+    return QString("%1 points (step %2 px) in %3 ms: max %4 px (%5\") at (%6, %7), RMS %8 px, "
+                   "%9 above tolerance, %10 failed")
+        .arg(points).arg(step).arg(elapsedMs, 0, 'f', 1)
+        .arg(maxError, 0, 'g', 3).arg(maxErrorArcsec, 0, 'g', 3)
+        .arg(worstPixel.x(), 0, 'f', 0).arg(worstPixel.y(), 0, 'f', 0)
+        .arg(rmsError, 0, 'g', 3).arg(outOfTolerance).arg(failures);
+}
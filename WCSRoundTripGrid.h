@@ -0,0 +1,62 @@
+// WCSRoundTripGrid.h - Dense pixel->sky->pixel round-trip diagnostics for a WCS
+#ifndef WCS_ROUND_TRIP_GRID_H
+#define WCS_ROUND_TRIP_GRID_H
+
+#include <QImage>
+#include <QPointF>
+#include <QString>
+#include <QVector>
+#include <pcl/AstrometricMetadata.h>
+
+struct WCSRoundTripOptions {
+    int step = 0;                   // Grid spacing in pixels; 0 picks one for maxPoints
+    qint64 maxPoints = 1 << 21;     // Budget for the automatic step
+    double tolerance = 0.01;        // Round-trip error (pixels) counted as a pass
+    int maxReportedFailures = 64;   // Failure positions kept for the report
+};
+
+struct WCSRoundTripReport {
+    int width = 0;
+    int height = 0;
+    int step = 1;
+    int columns = 0;                // Grid samples along x and y; pixel (c * step, r * step)
+    int rows = 0;
+
+    qint64 points = 0;
+    qint64 failures = 0;            // A transform failed, threw or returned non-finite values
+    qint64 outOfTolerance = 0;      // Converged but with error above tolerance
+
+    double maxError = 0.0;          // pixels
+    double rmsError = 0.0;          // pixels, over converged points
+    double meanError = 0.0;
+    double maxErrorArcsec = 0.0;    // maxError at the image scale
+    QPointF worstPixel;
+
+    // Round-trip error per grid sample, row-major; NaN where a transform failed
+    QVector<float> errorMap;
+    QVector<QPointF> failurePositions;
+
+    double elapsedMs = 0.0;
+
+    bool isValid() const { return points > 0; }
+    bool passed() const { return isValid() && failures == 0 && outOfTolerance == 0; }
+
+    // columns x rows colour map, blue (<= tolerance / 10) to red (>= scale,
+    // maxError when 0) on a log scale; failures in magenta
+    QImage heatmap(double tolerance, double scale = 0.0) const;
+    QString summary() const;
+};
+
+// Evaluates pixel->sky->pixel on a regular grid covering the whole image,
+// rows split across the thread pool with one copy of the astrometric
+// solution per worker. A solve gets a few million samples in well under a
+// second, so it can run on every solution rather than a handful of test
+// vectors.
+class WCSRoundTripGrid
+{
+public:
+    static WCSRoundTripReport evaluate(const pcl::AstrometricMetadata& astrometry,
+                                       const WCSRoundTripOptions& options = WCSRoundTripOptions());
+};
+
+#endif // WCS_ROUND_TRIP_GRID_H
@@ -0,0 +1,422 @@
+// XISFBlockDecoder.cpp - Parallel decoding of attached XISF image blocks
+#include "XISFBlockDecoder.h"
+#include "ParallelFor.h"
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QXmlStreamReader>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+
+#include <lz4.h>
+#include <zstd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+namespace {
+
+struct ImageElement {
+    int width = 0;
+    int height = 0;
+    int channels = 1;
+    QString sampleFormat;
+    bool planar = true;
+    qint64 position = 0;
+    qint64 size = 0;                // Stored (possibly compressed) block size
+    QString codec;                  // zlib, lz4, lz4hc, zstd; empty when uncompressed
+    bool shuffled = false;
+    qint64 uncompressedSize = 0;
+    int itemSize = 1;
+    QString subblocks;
+    QString checksumAlgorithm;
+    QByteArray checksumDigest;
+};
+
+struct SubBlock {
+    qint64 compressedOffset = 0;
+    qint64 compressedSize = 0;
+    qint64 uncompressedOffset = 0;
+    qint64 uncompressedSize = 0;
+};
+
+// Stored block bytes, mapped when possible. Shared with a deferred
+// checksum task, which keeps the mapping alive after the read returns.
+struct StoredBlock {
+    QFile file;
+    QByteArray buffer;
+    const uchar* data = nullptr;
+    qint64 size = 0;
+};
+
+int bytesPerSample(const QString& sampleFormat)
+{
+    if (sampleFormat == "UInt8") return 1;
+    if (sampleFormat == "UInt16") return 2;
+    if (sampleFormat == "UInt32" || sampleFormat == "Float32") return 4;
+    if (sampleFormat == "Float64") return 8;
+    return 0;
+}
+
+bool hashAlgorithm(const QString& name, QCryptographicHash::Algorithm& algorithm)
+{
+    const QString n = name.toLower();
+    if (n == "sha1" || n == "sha-1") algorithm = QCryptographicHash::Sha1;
+    else if (n == "sha256" || n == "sha-256") algorithm = QCryptographicHash::Sha256;
+    else if (n == "sha512" || n == "sha-512") algorithm = QCryptographicHash::Sha512;
+    else if (n == "sha3-256") algorithm = QCryptographicHash::Sha3_256;
+    else if (n == "sha3-512") algorithm = QCryptographicHash::Sha3_512;
+    else return false;
+    return true;
+}
+
+// Reads the XML header up to the first Image element. Returns false with a
+// reason for anything the fast path does not handle.
+bool parseImageElement(QFile& file, ImageElement& element, QString& reason)
+{
+    const QByteArray prefix = file.read(16);
+    if (prefix.size() < 16 || !prefix.startsWith("XISF0100")) {
+        reason = "Not a monolithic XISF 1.0 file";
+        return false;
+    }
+    const quint32 headerLength = qFromLittleEndian<quint32>(prefix.constData() + 8);
+    const QByteArray xml = file.read(headerLength);
+
+    QXmlStreamReader reader(xml);
+    while (!reader.atEnd()) {
+        if (reader.readNext() != QXmlStreamReader::StartElement || reader.name() != QLatin1String("Image")) {
+            continue;
+        }
+        const QXmlStreamAttributes attributes = reader.attributes();
+
+        const QStringList geometry = attributes.value("geometry").toString().split(':');
+        if (geometry.size() < 2 || geometry.size() > 3) {
+            reason = "Only two-dimensional images are decoded natively";
+            return false;
+        }
+        element.width = geometry[0].toInt();
+        element.height = geometry[1].toInt();
+        element.channels = geometry.size() == 3 ? geometry[2].toInt() : 1;
+        if (element.width <= 0 || element.height <= 0 || element.channels <= 0) {
+            reason = "Invalid image geometry";
+            return false;
+        }
+
+        element.sampleFormat = attributes.value("sampleFormat").toString();
+        if (bytesPerSample(element.sampleFormat) == 0) {
+            reason = QString("Sample format %1").arg(element.sampleFormat);
+            return false;
+        }
+        element.planar = attributes.value("pixelStorage").toString() != "Normal";
+        if (attributes.value("byteOrder").toString() == "big") {
+            reason = "Big-endian data block";
+            return false;
+        }
+
+        const QStringList location = attributes.value("location").toString().split(':');
+        if (location.size() != 3 || location[0] != "attachment") {
+            reason = "Data block is not attached";
+            return false;
+        }
+        element.position = location[1].toLongLong();
+        element.size = location[2].toLongLong();
+
+        const QString compression = attributes.value("compression").toString();
+        if (!compression.isEmpty()) {
+            const QStringList parts = compression.split(':');
+            QString codec = parts[0].toLower();
+            if (codec.endsWith("+sh")) {
+                element.shuffled = true;
+                codec.chop(3);
+            }
+            if (codec != "zlib" && codec != "lz4" && codec != "lz4hc" && codec != "zstd") {
+                reason = QString("Compression codec %1").arg(codec);
+                return false;
+            }
+            element.codec = codec;
+            element.uncompressedSize = parts.size() > 1 ? parts[1].toLongLong() : 0;
+            element.itemSize = parts.size() > 2 ? std::max(1, parts[2].toInt()) : 1;
+            element.subblocks = attributes.value("subblocks").toString();
+        }
+
+        const QString checksum = attributes.value("checksum").toString();
+        const int colon = checksum.indexOf(':');
+        if (colon > 0) {
+            element.checksumAlgorithm = checksum.left(colon);
+            element.checksumDigest = QByteArray::fromHex(checksum.mid(colon + 1).toLatin1());
+        }
+        return true;
+    }
+
+    reason = reader.hasError() ? reader.errorString() : QString("No Image element in header");
+    return false;
+}
+
+bool parseSubBlocks(const ImageElement& element, QVector<SubBlock>& blocks, QString& reason)
+{
+    if (element.subblocks.isEmpty()) {
+        blocks.append({0, element.size, 0, element.uncompressedSize});
+        return true;
+    }
+
+    // "cs1,us1:cs2,us2:..." in storage order
+    qint64 compressedOffset = 0, uncompressedOffset = 0;
+    for (const QString& item : element.subblocks.split(':', Qt::SkipEmptyParts)) {
+        const QStringList sizes = item.split(',');
+        bool compressedOk = false, uncompressedOk = false;
+        SubBlock block;
+        if (sizes.size() == 2) {
+            block.compressedSize = sizes[0].toLongLong(&compressedOk);
+            block.uncompressedSize = sizes[1].toLongLong(&uncompressedOk);
+        }
+        if (!compressedOk || !uncompressedOk || block.compressedSize <= 0 || block.uncompressedSize < 0) {
+            reason = "Malformed subblocks attribute";
+            return false;
+        }
+        block.compressedOffset = compressedOffset;
+        block.uncompressedOffset = uncompressedOffset;
+        compressedOffset += block.compressedSize;
+        uncompressedOffset += block.uncompressedSize;
+        blocks.append(block);
+    }
+
+    if (compressedOffset > element.size || uncompressedOffset != element.uncompressedSize) {
+        reason = "Sub-block sizes do not match the data block";
+        return false;
+    }
+    return true;
+}
+
+bool decompress(const QString& codec, const uchar* in, qint64 inSize, uchar* out, qint64 outSize)
+{
+    if (codec == "zstd") {
+        size_t n = ZSTD_decompress(out, size_t(outSize), in, size_t(inSize));
+        return !ZSTD_isError(n) && qint64(n) == outSize;
+    }
+    if (codec == "lz4" || codec == "lz4hc") {
+        if (inSize > INT_MAX || outSize > INT_MAX) return false;
+        int n = LZ4_decompress_safe(reinterpret_cast<const char*>(in), reinterpret_cast<char*>(out),
+                                    int(inSize), int(outSize));
+        return n == outSize;
+    }
+    if (codec == "zlib") {
+        // qUncompress expects the uncompressed size as a big-endian prefix
+        if (outSize > 0x7fffffff) return false;
+        QByteArray framed(inSize + 4, Qt::Uninitialized);
+        qToBigEndian<quint32>(quint32(outSize), framed.data());
+        std::memcpy(framed.data() + 4, in, size_t(inSize));
+        const QByteArray plain = qUncompress(framed);
+        if (plain.size() != outSize) return false;
+        std::memcpy(out, plain.constData(), size_t(outSize));
+        return true;
+    }
+    return false;
+}
+
+// Byte shuffling stores byte k of every item contiguously; a tail shorter
+// than one item is stored unshuffled.
+void unshuffle(const uchar* in, uchar* out, qint64 size, int itemSize)
+{
+    const size_t items = size_t(size / itemSize);
+    Parallel::forRange(items, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            for (int k = 0; k < itemSize; ++k) {
+                out[i * itemSize + k] = in[k * items + i];
+            }
+        }
+    }, 65536);
+    const size_t tail = size_t(size) - items * itemSize;
+    std::memcpy(out + items * itemSize, in + items * itemSize, tail);
+}
+
+template <typename T>
+inline float sampleAt(const uchar* raw, size_t index, double scale)
+{
+    T v;
+    std::memcpy(&v, raw + index * sizeof(T), sizeof(T));
+    return std::is_integral<T>::value ? float(double(v) * scale) : float(v);
+}
+
+// Integers are normalised to [0, 1] as PCL does when reading into a float image
+template <typename T>
+void convertSamples(const uchar* raw, float* out, size_t planeSize, int channels, bool planar)
+{
+    const double scale = std::is_integral<T>::value ? 1.0 / double(std::numeric_limits<T>::max()) : 1.0;
+
+    if (planar) {
+        Parallel::forRange(planeSize * channels, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = sampleAt<T>(raw, i, scale);
+            }
+        }, 65536);
+    } else {
+        Parallel::forRange(planeSize, [&](size_t begin, size_t end) {
+            for (size_t p = begin; p < end; ++p) {
+                for (int c = 0; c < channels; ++c) {
+                    out[c * planeSize + p] = sampleAt<T>(raw, p * channels + c, scale);
+                }
+            }
+        }, 65536);
+    }
+}
+
+} // namespace
+
+XISFBlockDecoder::Status XISFBlockDecoder::decodeFirstImage(const QString& filePath,
+                                                            XISFChecksumPolicy policy,
+                                                            XISFDecodedImage& image,
+                                                            QString* errorMessage)
+{
+    auto fail = [&](const QString& message) {
+        qDebug() << "❌ XISF decode:" << message;
+        if (errorMessage) *errorMessage = message;
+        return Failed;
+    };
+    auto unsupported = [&](const QString& reason) {
+        qDebug() << "ℹ️ XISF block decoder not used:" << reason;
+        if (errorMessage) *errorMessage = reason;
+        return Unsupported;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    auto block = std::make_shared<StoredBlock>();
+    block->file.setFileName(filePath);
+    if (!block->file.open(QIODevice::ReadOnly)) {
+        return fail(QString("Cannot open %1: %2").arg(filePath, block->file.errorString()));
+    }
+
+    ImageElement element;
+    QString reason;
+    if (!parseImageElement(block->file, element, reason)) {
+        return unsupported(reason);
+    }
+
+    const int sampleBytes = bytesPerSample(element.sampleFormat);
+    const size_t planeSize = size_t(element.width) * element.height;
+    const qint64 expectedSize = qint64(planeSize) * element.channels * sampleBytes;
+    const qint64 plainSize = element.codec.isEmpty() ? element.size : element.uncompressedSize;
+    if (plainSize != expectedSize) {
+        return fail(QString("Data block holds %1 bytes, geometry needs %2").arg(plainSize).arg(expectedSize));
+    }
+    if (element.position < 16 || element.size <= 0 || element.position + element.size > block->file.size()) {
+        return fail("Data block lies outside the file");
+    }
+
+    block->size = element.size;
+    block->data = block->file.map(element.position, element.size);
+    if (!block->data) {
+        block->file.seek(element.position);
+        block->buffer = block->file.read(element.size);
+        if (block->buffer.size() != element.size) {
+            return fail(QString("Read error: %1").arg(block->file.errorString()));
+        }
+        block->data = reinterpret_cast<const uchar*>(block->buffer.constData());
+    }
+
+    // The checksum covers the stored bytes, so it can run alongside decoding
+    QFuture<bool> checksum;
+    bool hasChecksum = false;
+    QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1;
+    if (policy != XISFChecksumPolicy::Skip && !element.checksumAlgorithm.isEmpty()) {
+        if (hashAlgorithm(element.checksumAlgorithm, algorithm)) {
+            const QByteArray digest = element.checksumDigest;
+            checksum = QtConcurrent::run([block, algorithm, digest, filePath]() {
+                const QByteArray actual = QCryptographicHash::hash(
+                    QByteArrayView(reinterpret_cast<const char*>(block->data), block->size), algorithm);
+                if (actual != digest) {
+                    qDebug() << "⚠️ XISF checksum mismatch:" << filePath;
+                    return false;
+                }
+                return true;
+            });
+            hasChecksum = true;
+        } else {
+            qDebug() << "⚠️ XISF checksum algorithm not supported, not verified:" << element.checksumAlgorithm;
+        }
+    }
+
+    // Decompress every sub-block into its slice of one buffer
+    const uchar* plain = block->data;
+    QByteArray decompressed;
+    QByteArray unshuffled;
+    int subBlockCount = 0;
+    if (!element.codec.isEmpty()) {
+        QVector<SubBlock> blocks;
+        if (!parseSubBlocks(element, blocks, reason)) {
+            return fail(reason);
+        }
+        subBlockCount = blocks.size();
+
+        decompressed = QByteArray(element.uncompressedSize, Qt::Uninitialized);
+        uchar* out = reinterpret_cast<uchar*>(decompressed.data());
+        std::atomic<bool> ok(true);
+        Parallel::forChunks(size_t(blocks.size()), blocks.size(), [&](int, size_t begin, size_t end) {
+            for (size_t i = begin; i < end && ok.load(); ++i) {
+                const SubBlock& sub = blocks[int(i)];
+                if (!decompress(element.codec, block->data + sub.compressedOffset, sub.compressedSize,
+                                out + sub.uncompressedOffset, sub.uncompressedSize)) {
+                    ok.store(false);
+                }
+            }
+        });
+        if (!ok.load()) {
+            return fail(QString("%1 decompression failed").arg(element.codec));
+        }
+        plain = out;
+
+        if (element.shuffled && element.itemSize > 1) {
+            unshuffled = QByteArray(element.uncompressedSize, Qt::Uninitialized);
+            unshuffle(plain, reinterpret_cast<uchar*>(unshuffled.data()), element.uncompressedSize, element.itemSize);
+            decompressed.clear();
+            plain = reinterpret_cast<const uchar*>(unshuffled.constData());
+        }
+    }
+
+    QVector<float> pixels(qsizetype(planeSize) * element.channels);
+    float* out = pixels.data();
+    if (element.sampleFormat == "UInt8") {
+        convertSamples<quint8>(plain, out, planeSize, element.channels, element.planar);
+    } else if (element.sampleFormat == "UInt16") {
+        convertSamples<quint16>(plain, out, planeSize, element.channels, element.planar);
+    } else if (element.sampleFormat == "UInt32") {
+        convertSamples<quint32>(plain, out, planeSize, element.channels, element.planar);
+    } else if (element.sampleFormat == "Float32") {
+        convertSamples<float>(plain, out, planeSize, element.channels, element.planar);
+    } else {
+        convertSamples<double>(plain, out, planeSize, element.channels, element.planar);
+    }
+
+    const bool deferred = hasChecksum && policy == XISFChecksumPolicy::Defer;
+    if (hasChecksum && !deferred && !checksum.result()) {
+        return fail(QString("%1 checksum mismatch in %2").arg(element.checksumAlgorithm, filePath));
+    }
+
+    image.width = element.width;
+    image.height = element.height;
+    image.channels = element.channels;
+    image.pixels = std::move(pixels);
+    image.codec = element.codec.isEmpty() ? QString() : element.codec + (element.shuffled ? "+sh" : "");
+    image.subBlocks = subBlockCount;
+    image.checksum = deferred ? checksum : QFuture<bool>();
+    image.checksumDeferred = deferred;
+
+    qDebug() << QString("📂 Decoded XISF %1x%2x%3 %4 (%5, %6 sub-blocks%7) in %8 ms")
+                .arg(image.width).arg(image.height).arg(image.channels).arg(element.sampleFormat)
+                .arg(image.codec.isEmpty() ? QString("uncompressed") : image.codec)
+                .arg(subBlockCount)
+                .arg(!hasChecksum ? QString() : deferred ? QString(", checksum deferred") : QString(", checksum ok"))
+                .arg(timer.elapsed());
+    return Decoded;
+}
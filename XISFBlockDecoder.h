@@ -0,0 +1,48 @@
+// XISFBlockDecoder.h - Parallel decoding of attached XISF image blocks
+#ifndef XISF_BLOCK_DECODER_H
+#define XISF_BLOCK_DECODER_H
+
+#include <QFuture>
+#include <QString>
+#include <QVector>
+
+// What to do with a data block's checksum attribute
+enum class XISFChecksumPolicy {
+    Verify,     // Hash concurrently with decompression; a mismatch fails the read
+    Defer,      // Return the image immediately and hash in the background
+    Skip        // Ignore checksums
+};
+
+struct XISFDecodedImage {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    QVector<float> pixels;          // Planar, integers normalised to [0, 1]
+    QString codec;                  // "zstd+sh", "lz4", ... or empty when uncompressed
+    int subBlocks = 0;
+    QFuture<bool> checksum;         // Deferred verification (Defer policy only)
+    bool checksumDeferred = false;
+};
+
+// Decodes the first image of an XISF file without going through
+// XISFReader::ReadImage: the header is parsed directly, the attached block
+// is memory mapped, compressed sub-blocks are decompressed in parallel
+// (zlib, LZ4, LZ4HC, Zstandard), byte shuffling is undone and samples are
+// converted to planar float in parallel chunks. The block checksum is
+// computed over the stored bytes on another thread at the same time.
+//
+// Anything outside that (inline/embedded data, big-endian or complex
+// samples, unknown codecs) is reported as Unsupported so the caller can
+// fall back to the PCL reader.
+class XISFBlockDecoder
+{
+public:
+    enum Status { Decoded, Unsupported, Failed };
+
+    static Status decodeFirstImage(const QString& filePath,
+                                   XISFChecksumPolicy policy,
+                                   XISFDecodedImage& image,
+                                   QString* errorMessage = nullptr);
+};
+
+#endif // XISF_BLOCK_DECODER_H
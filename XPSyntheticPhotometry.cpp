@@ -0,0 +1,183 @@
+// XPSyntheticPhotometry.cpp - Camera-band synthetic photometry from Gaia XP spectra
+#include "XPSyntheticPhotometry.h"
+#include "ParallelFor.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QMutexLocker>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Gaussian passband with an IR-cut roll-off above 690 nm
+XPSyntheticPhotometry::ResponseCurve gaussianBand(double peakNm, double fwhmNm, double peakResponse)
+{
+    XPSyntheticPhotometry::ResponseCurve curve;
+    double sigma = fwhmNm / 2.3548;
+    for (double nm = 350.0; nm <= 750.0; nm += 5.0) {
+        double r = peakResponse * std::exp(-0.5 * (nm - peakNm) * (nm - peakNm) / (sigma * sigma));
+        if (nm > 690.0) r *= std::exp(-(nm - 690.0) / 8.0);
+        curve.wavelengthNm.append(nm);
+        curve.response.append(r);
+    }
+    return curve;
+}
+
+} // namespace
+
+double XPSyntheticPhotometry::ResponseCurve::at(double nm) const
+{
+    if (wavelengthNm.isEmpty() || nm < wavelengthNm.first() || nm > wavelengthNm.last()) {
+        return 0.0;
+    }
+    auto upper = std::lower_bound(wavelengthNm.begin(), wavelengthNm.end(), nm);
+    int j = int(upper - wavelengthNm.begin());
+    if (j == 0) return response[0];
+    double t = (nm - wavelengthNm[j - 1]) / (wavelengthNm[j] - wavelengthNm[j - 1]);
+    return response[j - 1] + t * (response[j] - response[j - 1]);
+}
+
+XPSyntheticPhotometry::XPSyntheticPhotometry()
+{
+    defaultResponseCurves(m_curves[0], m_curves[1], m_curves[2]);
+}
+
+void XPSyntheticPhotometry::defaultResponseCurves(ResponseCurve& red, ResponseCurve& green, ResponseCurve& blue)
+{
+    red = gaussianBand(610.0, 85.0, 0.80);
+    green = gaussianBand(535.0, 95.0, 0.90);
+    blue = gaussianBand(465.0, 90.0, 0.75);
+}
+
+void XPSyntheticPhotometry::setResponseCurves(const ResponseCurve& red, const ResponseCurve& green,
+                                              const ResponseCurve& blue)
+{
+    QMutexLocker locker(&m_weightMutex);
+    m_curves[0] = red;
+    m_curves[1] = green;
+    m_curves[2] = blue;
+    m_weightCount = 0;  // Rebuild on next use
+}
+
+bool XPSyntheticPhotometry::loadResponseCurves(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "Cannot open response curves:" << filePath;
+        return false;
+    }
+
+    ResponseCurve curves[3];
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        QStringList fields = line.split(',');
+        if (fields.size() < 4) continue;
+        bool ok[4];
+        double values[4];
+        for (int k = 0; k < 4; ++k) values[k] = fields[k].trimmed().toDouble(&ok[k]);
+        if (!(ok[0] && ok[1] && ok[2] && ok[3])) continue;   // Header line
+
+        for (int c = 0; c < 3; ++c) {
+            curves[c].wavelengthNm.append(values[0]);
+            curves[c].response.append(values[c + 1]);
+        }
+    }
+
+    if (curves[0].wavelengthNm.size() < 2 ||
+        !std::is_sorted(curves[0].wavelengthNm.begin(), curves[0].wavelengthNm.end())) {
+        qDebug() << "Response curves need at least two ascending wavelengths:" << filePath;
+        return false;
+    }
+
+    setResponseCurves(curves[0], curves[1], curves[2]);
+    qDebug() << "Loaded camera response curves from" << filePath;
+    return true;
+}
+
+// Caller holds m_weightMutex
+void XPSyntheticPhotometry::buildWeights(double startNm, double stepNm, int count) const
+{
+    if (count == m_weightCount && startNm == m_weightStart && stepNm == m_weightStep) {
+        return;
+    }
+
+    // Photon counts: integral of f_lambda * lambda * R(lambda). The zero
+    // point is the same integral for f_nu = const, i.e. f_lambda ~ 1/lambda^2.
+    m_weights.resize(3 * count);
+    for (int c = 0; c < 3; ++c) {
+        double reference = 0.0;
+        for (int j = 0; j < count; ++j) {
+            double nm = startNm + j * stepNm;
+            double w = m_curves[c].at(nm) * nm * stepNm;
+            m_weights[c * count + j] = w;
+            reference += w / (nm * nm);
+        }
+        m_zeroPoints[c] = reference > 0.0 ? 2.5 * std::log10(reference) : 0.0;
+    }
+
+    m_weightStart = startNm;
+    m_weightStep = stepNm;
+    m_weightCount = count;
+}
+
+QVector<SyntheticPhotometry> XPSyntheticPhotometry::compute(const QVector<QVector<float>>& spectra,
+                                                            double startNm, double stepNm) const
+{
+    QVector<SyntheticPhotometry> results(spectra.size());
+
+    int count = 0;
+    for (const QVector<float>& spectrum : spectra) count = std::max(count, int(spectrum.size()));
+    if (count == 0 || stepNm <= 0.0) {
+        return results;
+    }
+    // Take a shared copy of the weights so a concurrent call on another grid
+    // detaches its own buffer instead of rewriting this one
+    QVector<double> weightMatrix;
+    double zeroPoints[3];
+    {
+        QMutexLocker locker(&m_weightMutex);
+        buildWeights(startNm, stepNm, count);
+        weightMatrix = m_weights;
+        std::copy(m_zeroPoints, m_zeroPoints + 3, zeroPoints);
+    }
+    const double* weights = weightMatrix.constData();
+
+    // One 3 x count GEMV per star
+    Parallel::forRange(spectra.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const QVector<float>& spectrum = spectra[int(i)];
+            if (spectrum.size() != count) continue;
+
+            const float* f = spectrum.constData();
+            SyntheticPhotometry& result = results[int(i)];
+            bool valid = true;
+            for (int c = 0; c < 3; ++c) {
+                const double* w = weights + c * count;
+                double sum = 0.0;
+                for (int j = 0; j < count; ++j) {
+                    sum += w[j] * f[j];
+                }
+                result.flux[c] = sum;
+                if (sum > 0.0 && std::isfinite(sum)) {
+                    result.magnitude[c] = -2.5 * std::log10(sum) + zeroPoints[c];
+                } else {
+                    valid = false;
+                }
+            }
+
+            if (valid) {
+                result.blueGreen = result.magnitude[2] - result.magnitude[1];
+                result.greenRed = result.magnitude[1] - result.magnitude[0];
+                result.isValid = true;
+            }
+        }
+    }, 256);
+
+    return results;
+}
@@ -0,0 +1,66 @@
+// XPSyntheticPhotometry.h - Camera-band synthetic photometry from Gaia XP spectra
+#ifndef XP_SYNTHETIC_PHOTOMETRY_H
+#define XP_SYNTHETIC_PHOTOMETRY_H
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// Synthetic fluxes and magnitudes of one star in the camera's R, G and B
+// bands. Magnitudes are AB-like: each band is normalised by its response to
+// a flat f_nu spectrum, so colours are comparable to instrumental colours
+// up to a constant per-channel offset (what colour calibration fits).
+struct SyntheticPhotometry {
+    double flux[3] = {0.0, 0.0, 0.0};       // R, G, B (arbitrary units)
+    double magnitude[3] = {0.0, 0.0, 0.0};
+    double blueGreen = 0.0;                 // B - G, same sense as StarColorData::bv_index
+    double greenRed = 0.0;                  // G - R, same sense as StarColorData::vr_index
+    bool isValid = false;
+};
+
+// Integrates sampled XP spectra (energy flux per nm) against R/G/B response
+// curves for a photon-counting sensor. The curves are folded into a 3 x N
+// weight matrix once per wavelength grid; a batch of spectra is then one
+// matrix-vector product per star, computed in parallel. compute() may be
+// called from several threads at once.
+class XPSyntheticPhotometry
+{
+public:
+    struct ResponseCurve {
+        QVector<double> wavelengthNm;       // Ascending
+        QVector<double> response;           // Relative quantum efficiency x filter
+
+        double at(double nm) const;         // Linear interpolation, 0 outside
+    };
+
+    XPSyntheticPhotometry();
+
+    // Generic one-shot-colour CMOS with an IR-cut filter
+    static void defaultResponseCurves(ResponseCurve& red, ResponseCurve& green, ResponseCurve& blue);
+
+    void setResponseCurves(const ResponseCurve& red, const ResponseCurve& green, const ResponseCurve& blue);
+
+    // CSV with columns wavelength_nm, red, green, blue ('#' comments allowed)
+    bool loadResponseCurves(const QString& filePath);
+
+    // Spectra sampled from startNm in steps of stepNm; empty spectra give
+    // invalid results
+    QVector<SyntheticPhotometry> compute(const QVector<QVector<float>>& spectra,
+                                         double startNm, double stepNm) const;
+
+private:
+    void buildWeights(double startNm, double stepNm, int count) const;
+
+    ResponseCurve m_curves[3];
+
+    // Weight matrix for the last grid, row-major 3 x m_weightCount. The grid
+    // is only known in compute(), so it is built lazily under m_weightMutex.
+    mutable QMutex m_weightMutex;
+    mutable QVector<double> m_weights;
+    mutable double m_zeroPoints[3] = {0.0, 0.0, 0.0};
+    mutable double m_weightStart = 0.0;
+    mutable double m_weightStep = 0.0;
+    mutable int m_weightCount = 0;
+};
+
+#endif // XP_SYNTHETIC_PHOTOMETRY_H
@@ -10,15 +10,17 @@
 #include <QDebug>
 #include <QVector>
 #include <QPointF>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentRun>
 #include <tiffio.h>
 #include <fstream>
+#include <memory>
 #include <vector>
 #include <cstdint>
 
-// Forward declarations
-class StarCatalogValidator;
-struct ImageData;
-struct CatalogStar;
+#include "../ImageReader.h"
+#include "../StarCatalogValidator.h"
 
 // Structure to hold Origin telescope metadata
 struct OriginMetadata {
@@ -104,10 +106,19 @@ public:
     bool extractOriginMetadata();
     bool performCatalogLookup(StarCatalogValidator* catalogValidator = nullptr);
     
+    // Streaming pipeline: Origin metadata is parsed from the header first,
+    // then the pixels decode on the thread pool while the catalog query for
+    // centerRA/centerDec/FOV runs on the calling thread. Both are joined
+    // before returning, so a file costs max(decode, catalog) rather than
+    // their sum. Without metadata (or a validator) only the pixels load.
+    bool loadTIFFFileWithCatalog(const QString& filePath, StarCatalogValidator* catalogValidator);
+    
     // Data access
     const OriginMetadata& getOriginMetadata() const { return m_originMetadata; }
     const CatalogLookupResult& getCatalogResult() const { return m_catalogResult; }
     const ImageData* getImageData() const { return m_imageData; }
+    double lastDecodeMs() const { return m_decodeMs; }
+    double lastCatalogMs() const { return m_catalogMs; }
     
     // Utility functions
     bool hasOriginMetadata() const { return m_originMetadata.isValid; }
@@ -141,7 +152,10 @@ private:
     std::ifstream m_rawFile;
     QString m_filePath;
     ImageData* m_imageData = nullptr;
+    std::unique_ptr<ImageData> m_ownedImageData;
     bool m_isLittleEndian = true;
+    double m_decodeMs = 0.0;
+    double m_catalogMs = 0.0;
     
     // Metadata
     OriginMetadata m_originMetadata;
@@ -172,6 +186,7 @@ private:
     
     // Catalog integration methods
     bool initializeCatalogSearch(StarCatalogValidator* validator);
+    bool queryCatalogSynchronously(StarCatalogValidator* validator);
     double calculateSearchRadius() const;
     bool validateCatalogResults();
     
@@ -286,6 +301,90 @@ bool OriginTIFFReader::performCatalogLookup(StarCatalogValidator* catalogValidat
     }
 }
 
+bool OriginTIFFReader::loadTIFFFileWithCatalog(const QString& filePath, StarCatalogValidator* catalogValidator)
+{
+    QElapsedTimer wall;
+    wall.start();
+    m_imageData = nullptr;
+    m_ownedImageData.reset();
+    m_decodeMs = m_catalogMs = 0.0;
+    
+    // Header only: IFD scan and Origin JSON, no strip data
+    if (!loadTIFFFile(filePath)) {
+        return false;
+    }
+    closeTIFFFile();  // The decoder opens its own handles; metadataExtracted has fired
+    
+    // Pixel decoding (itself parallel across strips) runs on the pool
+    QFuture<std::pair<bool, QString>> decode = QtConcurrent::run([this, filePath]() {
+        QElapsedTimer timer;
+        timer.start();
+        ImageReader reader;
+        const bool ok = reader.readFile(filePath);
+        if (ok) {
+            m_ownedImageData = std::make_unique<ImageData>(reader.imageData());
+        }
+        m_decodeMs = timer.nsecsElapsed() / 1.0e6;
+        return std::make_pair(ok, ok ? QString() : reader.lastError());
+    });
+    
+    // Meanwhile the catalog query runs here, where the validator lives
+    bool catalogOk = false;
+    if (m_originMetadata.isValid && catalogValidator) {
+        QElapsedTimer timer;
+        timer.start();
+        catalogOk = queryCatalogSynchronously(catalogValidator);
+        m_catalogMs = timer.nsecsElapsed() / 1.0e6;
+    }
+    
+    const std::pair<bool, QString> decoded = decode.result();
+    if (!decoded.first) {
+        m_lastError = QString("Failed to decode TIFF pixels: %1").arg(decoded.second);
+        logError(m_lastError);
+        return false;
+    }
+    m_imageData = m_ownedImageData.get();
+    
+    logInfo(QString("Loaded in %1 ms (decode %2 ms, catalog %3 ms overlapped)")
+            .arg(wall.nsecsElapsed() / 1.0e6, 0, 'f', 1)
+            .arg(m_decodeMs, 0, 'f', 1).arg(m_catalogMs, 0, 'f', 1));
+    
+    if (catalogOk && m_enablePlateSolving) {
+        attemptPlateSolving(catalogValidator);
+    }
+    if (m_originMetadata.isValid && catalogValidator) {
+        emit catalogLookupCompleted(m_catalogResult);
+    }
+    return true;
+}
+
+bool OriginTIFFReader::queryCatalogSynchronously(StarCatalogValidator* validator)
+{
+    const double searchRadius = calculateSearchRadius();
+    logInfo(QString("Catalog query for %1 at %2, radius %3")
+            .arg(m_originMetadata.objectName)
+            .arg(formatCoordinates(m_originMetadata.centerRA, m_originMetadata.centerDec))
+            .arg(formatFieldOfView(searchRadius)));
+    
+    // The local Gaia catalog answers synchronously; without it the
+    // validator falls back to a network query and results arrive later
+    // through catalogQueryFinished, as with performCatalogLookup()
+    validator->queryGaiaDR3(m_originMetadata.centerRA, m_originMetadata.centerDec, searchRadius);
+    
+    m_catalogResult.catalogStars = validator->getCatalogStars();
+    m_catalogResult.totalStarsFound = m_catalogResult.catalogStars.size();
+    m_catalogResult.searchRadiusDegrees = searchRadius;
+    m_catalogResult.catalogUsed = "Gaia DR3";
+    m_catalogResult.success = m_catalogResult.totalStarsFound > 0;
+    if (!m_catalogResult.success) {
+        m_catalogResult.errorMessage = "No catalog stars found in search region";
+        logError(m_catalogResult.errorMessage);
+    } else {
+        logInfo(QString("Found %1 catalog stars").arg(m_catalogResult.totalStarsFound));
+    }
+    return m_catalogResult.success;
+}
+
 bool OriginTIFFReader::openTIFFFile()
 {
     // Open with libtiff
@@ -1004,27 +1103,19 @@ public:
     {
         ProcessingResult result;
         
-        // 1. Load TIFF and extract Origin metadata
+        // 1-2. Origin metadata from the header, then pixel decoding
+        // overlapped with the catalog lookup it drives
         OriginTIFFReader originReader;
-        if (!originReader.loadTIFFFile(filePath)) {
+        if (!originReader.loadTIFFFileWithCatalog(filePath, catalogValidator)) {
             return result; // Failed
         }
         
         result.originMetadata = originReader.getOriginMetadata();
-        
-        // 2. Perform catalog lookup based on Origin metadata
-        if (result.originMetadata.isValid) {
-            originReader.performCatalogLookup(catalogValidator);
-            // Wait for async completion or make it synchronous
-            result.catalogResult = originReader.getCatalogResult();
-        }
+        result.catalogResult = originReader.getCatalogResult();
         
         // 3. Detect stars in the image
-        if (starDetector) {
-            ImageData* imageData = loadImageData(filePath);
-            if (imageData) {
-                result.detectedStars = starDetector->detectStars(*imageData);
-            }
+        if (starDetector && originReader.getImageData()) {
+            result.detectedStars = starDetector->detectStars(*originReader.getImageData());
         }
         
         // 4. Cross-validate detected stars with catalog
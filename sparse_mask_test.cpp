@@ -0,0 +1,102 @@
+#include "SparseMask.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Checks SparseMask's distance-transform dilation and erosion against a
+// brute-force disc test of every pixel.
+
+namespace {
+
+int failures = 0;
+
+std::vector<char> toDense(const SparseMask& mask)
+{
+    std::vector<char> dense(size_t(mask.width()) * mask.height(), 0);
+    for (const MaskSpan& s : mask.spans()) {
+        for (int x = s.x0; x < s.x1; ++x) dense[size_t(s.y) * mask.width() + x] = 1;
+    }
+    return dense;
+}
+
+// A pixel is dilated when any mask pixel lies within radius; it survives
+// erosion when every pixel within radius is masked (outside the frame is not)
+std::vector<char> bruteForce(const SparseMask& mask, double radius, bool dilate)
+{
+    const int w = mask.width(), h = mask.height();
+    const std::vector<char> src = toDense(mask);
+    const int r = int(std::ceil(radius));
+    std::vector<char> out(src.size(), 0);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            bool hit = false;
+            for (int dy = -r; dy <= r && !hit; ++dy) {
+                for (int dx = -r; dx <= r && !hit; ++dx) {
+                    if (dx * dx + dy * dy > radius * radius) continue;
+                    const int nx = x + dx, ny = y + dy;
+                    const bool inside = nx >= 0 && ny >= 0 && nx < w && ny < h &&
+                                        src[size_t(ny) * w + nx];
+                    hit = dilate ? inside : !inside;
+                }
+            }
+            out[size_t(y) * w + x] = dilate ? hit : !hit;
+        }
+    }
+    return out;
+}
+
+void check(const char* name, double radius, const SparseMask& actual, const std::vector<char>& expected)
+{
+    const std::vector<char> dense = toDense(actual);
+    int wrong = 0;
+    for (size_t i = 0; i < dense.size(); ++i) {
+        if (dense[i] != expected[i]) ++wrong;
+    }
+    std::cout << (wrong ? "FAIL " : "ok   ") << name << " r=" << radius;
+    if (wrong) std::cout << " (" << wrong << " pixels differ)";
+    std::cout << "\n";
+    if (wrong) ++failures;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "SparseMask Morphology Check\n";
+    std::cout << "===========================\n";
+
+    // A single pixel dilated by r is exactly the disc appendDisc() builds
+    for (double radius : {1.0, 2.5, 7.0, 30.0}) {
+        QVector<MaskSpan> point, disc;
+        SparseMask::appendRect(point, 100, 90, 101, 91);
+        SparseMask::appendDisc(disc, QPointF(100, 90), radius);
+        SparseMask dilated = SparseMask::fromSpans(200, 180, point).dilated(radius);
+        check("pixel dilated to disc", radius, dilated, toDense(SparseMask::fromSpans(200, 180, disc)));
+    }
+
+    // Random discs and rectangles crossing 64-pixel tile borders and the
+    // frame edges, at radii below and beyond one tile
+    std::mt19937 rng(20260518);
+    std::uniform_real_distribution<double> px(-10.0, 170.0), py(-10.0, 130.0), pr(1.0, 14.0);
+    QVector<MaskSpan> spans;
+    for (int i = 0; i < 25; ++i) {
+        SparseMask::appendDisc(spans, QPointF(px(rng), py(rng)), pr(rng));
+    }
+    SparseMask::appendRect(spans, 50, 20, 140, 75);
+    SparseMask::appendRect(spans, 0, 100, 40, 120);
+    const SparseMask mask = SparseMask::fromSpans(160, 120, spans);
+    std::cout << "Random mask: " << mask.spans().size() << " spans, area " << mask.area() << "\n";
+
+    for (double radius : {1.0, 2.5, 7.0, 20.0, 70.0}) {
+        check("dilated", radius, mask.dilated(radius), bruteForce(mask, radius, true));
+        check("eroded", radius, mask.eroded(radius), bruteForce(mask, radius, false));
+    }
+
+    if (failures) {
+        std::cout << "FAILED: " << failures << " check(s)\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}